@@ -0,0 +1,11 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstdint>
+
+// Number of operator new calls the calling thread has made so far. Counted by
+// the global operator new that AllocationCounter.cpp installs; only targets
+// that compile that file in (the app and the bench) get it.
+uint64_t ThreadAllocationCount();
+
+#endif
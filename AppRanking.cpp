@@ -0,0 +1,144 @@
+#include "AppRanking.h"
+#include <algorithm>
+
+namespace {
+
+// Seconds of interval at or after from
+int64_t OverlapFrom(int64_t begin, int64_t end, int64_t from) {
+    return std::max<int64_t>(end - std::max(begin, from), 0);
+}
+
+} // namespace
+
+void AppRanking::Assign(const std::vector<std::pair<uint32_t, std::chrono::seconds>>& totals) {
+    Clear();
+    for (const auto& entry : totals) {
+        if (entry.second.count() > 0) {
+            Grow(entry.first);
+            seconds[entry.first] = entry.second.count();
+            order.push_back(entry.first);
+        }
+    }
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return Before(a, b); });
+    for (size_t i = 0; i < order.size(); ++i) {
+        rank[order[i]] = static_cast<uint32_t>(i);
+    }
+}
+
+void AppRanking::Clear() {
+    for (uint32_t appId : order) {
+        seconds[appId] = 0;
+        rank[appId] = NOT_RANKED;
+    }
+    order.clear();
+}
+
+void AppRanking::Grow(uint32_t appId) {
+    if (appId >= seconds.size()) {
+        seconds.resize(static_cast<size_t>(appId) + 1, 0);
+        rank.resize(static_cast<size_t>(appId) + 1, NOT_RANKED);
+    }
+}
+
+void AppRanking::Add(uint32_t appId, int64_t delta) {
+    if (delta == 0) {
+        return;
+    }
+    Grow(appId);
+    seconds[appId] = std::max<int64_t>(seconds[appId] + delta, 0);
+
+    size_t position = rank[appId];
+    if (position == NOT_RANKED) {
+        if (seconds[appId] == 0) {
+            return;
+        }
+        position = order.size();
+        order.push_back(appId);
+    }
+    // Shift neighbours over until the app sits in order again; an app that
+    // dropped to zero sinks to the end and is removed
+    if (seconds[appId] == 0) {
+        for (; position + 1 < order.size(); ++position, ++moves) {
+            order[position] = order[position + 1];
+            rank[order[position]] = static_cast<uint32_t>(position);
+        }
+        order.pop_back();
+        rank[appId] = NOT_RANKED;
+        return;
+    }
+    for (; position > 0 && Before(appId, order[position - 1]); --position, ++moves) {
+        order[position] = order[position - 1];
+        rank[order[position]] = static_cast<uint32_t>(position);
+    }
+    for (; position + 1 < order.size() && Before(order[position + 1], appId); ++position, ++moves) {
+        order[position] = order[position + 1];
+        rank[order[position]] = static_cast<uint32_t>(position);
+    }
+    order[position] = appId;
+    rank[appId] = static_cast<uint32_t>(position);
+}
+
+void AppRanking::TopK(size_t k, std::vector<std::pair<uint32_t, std::chrono::seconds>>& out) const {
+    out.clear();
+    size_t count = std::min(k, order.size());
+    for (size_t i = 0; i < count; ++i) {
+        out.emplace_back(order[i], std::chrono::seconds(seconds[order[i]]));
+    }
+}
+
+void WindowRanking::Recount(const TrackingEngine& engine, int64_t newFrom, int64_t to) {
+    ranking.Assign(engine.RangeTotals(FromUnixSeconds(newFrom), FromUnixSeconds(to)));
+    const IntervalLog& log = engine.Intervals();
+    from = newFrom;
+    closedCount = log.Size();
+    trailing = log.LowerBound(from);
+    hasOpen = engine.OpenInterval(open);
+    historyEpoch = engine.HistoryEpoch();
+    valid = true;
+    ++recounts;
+}
+
+void WindowRanking::Advance(const TrackingEngine& engine, std::chrono::system_clock::time_point now) {
+    int64_t to = ToUnixSeconds(now);
+    int64_t newFrom = to - window;
+    const std::vector<FocusInterval>& log = engine.Intervals().Data();
+    if (!valid || historyEpoch != engine.HistoryEpoch() || newFrom < from || log.size() < closedCount) {
+        Recount(engine, newFrom, to);
+        return;
+    }
+
+    // Counted so far: every included interval from the trailing edge on. The
+    // leading edge is open-ended because nothing is recorded past now.
+    FocusInterval current = {};
+    bool hasCurrent = engine.OpenInterval(current);
+    bool sameOpen = hasOpen && hasCurrent && current.appId == open.appId && current.begin == open.begin;
+    if (hasOpen && !sameOpen) {
+        ranking.Add(open.appId, -OverlapFrom(open.begin, open.End(), from));
+    }
+    for (; closedCount < log.size(); ++closedCount) {
+        const FocusInterval& closed = log[closedCount];
+        ranking.Add(closed.appId, OverlapFrom(closed.begin, closed.End(), from));
+    }
+
+    // Slide the trailing edge over [from, newFrom)
+    if (newFrom > from) {
+        for (size_t i = trailing; i < log.size() && log[i].begin < newFrom; ++i) {
+            int64_t cut = std::min(log[i].End(), newFrom) - std::max(log[i].begin, from);
+            if (cut > 0) {
+                ranking.Add(log[i].appId, -cut);
+            }
+        }
+        while (trailing < log.size() && log[trailing].End() <= newFrom) {
+            ++trailing;
+        }
+    }
+
+    if (sameOpen) {
+        ranking.Add(current.appId, OverlapFrom(current.begin, current.End(), newFrom) - OverlapFrom(open.begin, open.End(), from));
+    } else if (hasCurrent) {
+        ranking.Add(current.appId, OverlapFrom(current.begin, current.End(), newFrom));
+    }
+    from = newFrom;
+    hasOpen = hasCurrent;
+    open = current;
+}
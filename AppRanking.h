@@ -0,0 +1,85 @@
+#ifndef APP_RANKING_H
+#define APP_RANKING_H
+
+#include "TrackingEngine.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// App ids ordered by time, longest first (ties by id), kept in order as
+// totals change. Changing an app's total moves it past only the apps it
+// overtakes or falls behind, so a tick that adds a second to the running app
+// costs a comparison or two instead of a sort. Apps with no time are not ranked.
+class AppRanking {
+public:
+    static constexpr uint32_t NOT_RANKED = UINT32_MAX;
+
+    // Replaces every total with totals (any order, zero entries ignored);
+    // one sort.
+    void Assign(const std::vector<std::pair<uint32_t, std::chrono::seconds>>& totals);
+    void Clear();
+
+    // Adds delta seconds to an app's total and moves it to its new rank.
+    void Add(uint32_t appId, int64_t delta);
+
+    int64_t Seconds(uint32_t appId) const { return appId < seconds.size() ? seconds[appId] : 0; }
+    // Rank of the app (0 is the longest), or NOT_RANKED
+    uint32_t Rank(uint32_t appId) const { return appId < rank.size() ? rank[appId] : NOT_RANKED; }
+    size_t Size() const { return order.size(); }
+    // Every ranked app, longest first
+    const std::vector<uint32_t>& Order() const { return order; }
+
+    // Replaces out with the k longest apps and their times, longest first.
+    void TopK(size_t k, std::vector<std::pair<uint32_t, std::chrono::seconds>>& out) const;
+
+    // Rank positions crossed by Add() so far, for benchmarks
+    uint64_t Moves() const { return moves; }
+
+private:
+    bool Before(uint32_t a, uint32_t b) const {
+        return seconds[a] > seconds[b] || (seconds[a] == seconds[b] && a < b);
+    }
+    void Grow(uint32_t appId);
+
+    std::vector<uint32_t> order;   // Ranked app ids
+    std::vector<int64_t> seconds;  // By app id
+    std::vector<uint32_t> rank;    // By app id, index into order
+    uint64_t moves = 0;
+};
+
+// AppRanking of a trailing window [now - window, now) of an engine's history,
+// advanced incrementally. Each Advance() only visits what changed since the
+// last one: the open interval, intervals closed since, and the few intervals
+// the window's trailing edge crossed. It recounts from the engine only when
+// history was rewritten (Clear(), restores) or time went backwards.
+class WindowRanking {
+public:
+    explicit WindowRanking(std::chrono::seconds window) : window(window.count()) {}
+
+    // Brings the ranking up to engine as of now, which should not be earlier
+    // than the engine's latest sample.
+    void Advance(const TrackingEngine& engine, std::chrono::system_clock::time_point now);
+    // Recounts on the next Advance().
+    void Invalidate() { valid = false; }
+
+    const AppRanking& Ranking() const { return ranking; }
+    uint64_t Recounts() const { return recounts; }
+
+private:
+    void Recount(const TrackingEngine& engine, int64_t from, int64_t to);
+
+    int64_t window;
+    AppRanking ranking;
+    bool valid = false;
+    uint64_t historyEpoch = 0;
+    int64_t from = 0;           // Trailing edge the totals are counted from
+    size_t closedCount = 0;     // Log intervals included so far
+    size_t trailing = 0;        // Every log interval before this ends by from
+    bool hasOpen = false;
+    FocusInterval open = {};    // The open interval as last included
+    uint64_t recounts = 0;
+};
+
+#endif
@@ -0,0 +1,32 @@
+#include "AppTable.h"
+#include <algorithm>
+
+uint32_t AppTable::Intern(std::string_view appName, std::string_view appPath) {
+    // Resolve by path first; different apps can only share a path when it is unknown
+    uint32_t pathId = paths.Intern(appPath);
+    if (!appPath.empty() && pathId < appIdByPath.size() && appIdByPath[pathId] != NO_APP) {
+        return appIdByPath[pathId];
+    }
+
+    uint32_t appId = names.Intern(appName);
+    if (appId == pathIds.size()) {
+        pathIds.push_back(pathId);
+        activeSeconds.push_back(0);
+        lastActive.push_back(NEVER);
+    } else if (!appPath.empty()) {
+        pathIds[appId] = pathId; // Same executable name seen at a new location
+    }
+
+    if (!appPath.empty()) {
+        if (pathId >= appIdByPath.size()) {
+            appIdByPath.resize(pathId + 1, NO_APP);
+        }
+        appIdByPath[pathId] = appId;
+    }
+    return appId;
+}
+
+void AppTable::ResetTotals() {
+    std::fill(activeSeconds.begin(), activeSeconds.end(), 0);
+    std::fill(lastActive.begin(), lastActive.end(), NEVER);
+}
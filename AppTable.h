@@ -0,0 +1,43 @@
+#ifndef APP_TABLE_H
+#define APP_TABLE_H
+
+#include "StringInterner.h"
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Per-app state stored column-wise and indexed by dense app id. An app id is
+// the interned executable name; the full path is interned separately so that
+// the tracker can go from a sampled path to a row with one hash lookup.
+class AppTable {
+public:
+    static constexpr uint32_t NO_APP = UINT32_MAX;
+    static constexpr int64_t NEVER = INT64_MIN;
+
+    // Returns the row for the executable at appPath, creating it on first sight.
+    uint32_t Intern(std::string_view appName, std::string_view appPath);
+
+    // Returns the row for appName or NO_APP.
+    uint32_t Find(std::string_view appName) const { return names.Find(appName); }
+
+    size_t Size() const { return names.Size(); }
+    const std::string& Name(uint32_t appId) const { return names.Get(appId); }
+    const std::string& Path(uint32_t appId) const { return paths.Get(pathIds[appId]); }
+
+    // Zeroes every app's totals but keeps ids stable.
+    void ResetTotals();
+
+    // Columns, one entry per app id
+    std::vector<uint32_t> pathIds;
+    std::vector<int64_t> activeSeconds;  // All-time focus time
+    std::vector<int64_t> lastActive;     // Unix seconds of the latest sample, NEVER if unseen
+
+private:
+    StringInterner names;
+    StringInterner paths;
+    std::vector<uint32_t> appIdByPath;  // Indexed by path id
+};
+
+#endif
@@ -0,0 +1,414 @@
+#include "CategoryRules.h"
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const std::string_view REGEX_PREFIX = "re:";
+
+char FoldChar(char c) {
+    return c == '/' ? '\\' : static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+std::string Fold(std::string_view text) {
+    std::string folded(text.size(), '\0');
+    std::transform(text.begin(), text.end(), folded.begin(), FoldChar);
+    return folded;
+}
+
+std::string_view Trim(std::string_view text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string_view::npos) {
+        return std::string_view();
+    }
+    return text.substr(begin, text.find_last_not_of(" \t\r") + 1 - begin);
+}
+
+// Both sides folded. Backtracks only to the latest '*', which is enough for
+// globs: whatever an earlier star could have swallowed, the later one can too.
+bool GlobMatch(std::string_view glob, std::string_view text) {
+    size_t g = 0;
+    size_t t = 0;
+    size_t star = std::string_view::npos;
+    size_t starText = 0;
+    while (t < text.size()) {
+        if (g < glob.size() && (glob[g] == '?' || glob[g] == text[t])) {
+            ++g;
+            ++t;
+        } else if (g < glob.size() && glob[g] == '*') {
+            star = g++;
+            starText = t;
+        } else if (star != std::string_view::npos) {
+            g = star + 1;
+            t = ++starText;
+        } else {
+            return false;
+        }
+    }
+    while (g < glob.size() && glob[g] == '*') {
+        ++g;
+    }
+    return g == glob.size();
+}
+
+std::string GlobLiteral(std::string_view glob) {
+    std::string_view best;
+    size_t begin = 0;
+    while (begin < glob.size()) {
+        size_t end = glob.find_first_of("*?", begin);
+        end = end == std::string_view::npos ? glob.size() : end;
+        if (end - begin > best.size()) {
+            best = glob.substr(begin, end - begin);
+        }
+        begin = end + 1;
+    }
+    return std::string(best);
+}
+
+// Index just past the group or class opening at pattern[open]
+size_t SkipBracketed(std::string_view pattern, size_t open) {
+    int depth = 0;
+    bool inClass = false;
+    for (size_t i = open; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        if (c == '\\') {
+            ++i;
+        } else if (inClass) {
+            inClass = c != ']';
+            if (!inClass && depth == 0) {
+                return i + 1;
+            }
+        } else if (c == '[') {
+            inClass = true;
+        } else if (c == '(') {
+            ++depth;
+        } else if (c == ')' && --depth == 0) {
+            return i + 1;
+        }
+    }
+    return pattern.size();
+}
+
+// The longest run of literal characters every match of the (valid) regex
+// contains, or "" if there's no such run that's easy to be sure of. Groups
+// and classes just end a run, a quantified character drops out of it, and a
+// top-level alternation gives up.
+std::string RegexLiteral(std::string_view pattern) {
+    std::string best;
+    std::string run;
+    auto endRun = [&]() {
+        if (run.size() > best.size()) {
+            best = run;
+        }
+        run.clear();
+    };
+    auto skipLazy = [&](size_t& i) {
+        if (i + 1 < pattern.size() && pattern[i + 1] == '?') {
+            ++i;
+        }
+    };
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        switch (c) {
+        case '|':
+            return std::string();
+        case '(':
+        case '[':
+            endRun();
+            i = SkipBracketed(pattern, i) - 1;
+            break;
+        case '*':
+        case '?':
+        case '{':
+            // The atom before may occur zero times
+            if (!run.empty()) {
+                run.pop_back();
+            }
+            endRun();
+            if (c == '{') {
+                i = std::min(pattern.find('}', i), pattern.size() - 1);
+            }
+            skipLazy(i);
+            break;
+        case '+':
+            endRun();
+            skipLazy(i);
+            break;
+        case '.':
+        case '^':
+        case '$':
+            endRun();
+            break;
+        case '\\': {
+            if (++i >= pattern.size()) {
+                break;
+            }
+            char escaped = pattern[i];
+            if (!std::isalnum(static_cast<unsigned char>(escaped))) {
+                run += escaped;
+                break;
+            }
+            // A class, assertion, control or numeric escape: skip its operands
+            endRun();
+            size_t operands = escaped == 'x' ? 2 : escaped == 'u' ? 4 : escaped == 'c' ? 1 : 0;
+            i = std::min(i + operands, pattern.size() - 1);
+            while (std::isdigit(static_cast<unsigned char>(escaped)) && i + 1 < pattern.size() && std::isdigit(static_cast<unsigned char>(pattern[i + 1]))) {
+                ++i;
+            }
+            break;
+        }
+        default:
+            run += c;
+        }
+    }
+    endRun();
+    return Fold(best);
+}
+
+} // namespace
+
+bool LoadCategoryRules(const std::string& filename, std::vector<CategoryRule>& rules) {
+    std::ifstream file(filename, std::ios::in);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        std::string_view text = Trim(line);
+        size_t equals = text.find('=');
+        if (text.empty() || text[0] == '#' || equals == std::string_view::npos) {
+            continue;
+        }
+        // Patterns may contain '=' but categories can't
+        std::string_view category = Trim(text.substr(0, equals));
+        std::string_view pattern = Trim(text.substr(equals + 1));
+        if (!category.empty() && !pattern.empty()) {
+            rules.push_back(CategoryRule{ std::string(category), std::string(pattern) });
+        }
+    }
+    return true;
+}
+
+CategoryMatcher::CategoryMatcher(const std::vector<CategoryRule>& ruleList) {
+    std::vector<std::string> literals;
+    for (size_t index = 0; index < ruleList.size(); ++index) {
+        const CategoryRule& source = ruleList[index];
+        Rule rule{ 0, source.pattern.compare(0, REGEX_PREFIX.size(), REGEX_PREFIX) == 0, std::string(), std::regex() };
+        if (rule.isRegex) {
+            std::string_view expression = std::string_view(source.pattern).substr(REGEX_PREFIX.size());
+            try {
+                rule.regex = std::regex(expression.begin(), expression.end(), std::regex::ECMAScript | std::regex::icase | std::regex::optimize);
+            } catch (const std::regex_error& error) {
+                std::cerr << "Error: Skipping category rule " << source.category << " = " << source.pattern << ": " << error.what() << std::endl;
+                rejected.push_back(index);
+                continue;
+            }
+            literals.push_back(RegexLiteral(expression));
+        } else {
+            rule.glob = Fold(source.pattern);
+            literals.push_back(GlobLiteral(rule.glob));
+        }
+        rule.category = categories.Intern(source.category);
+        rules.push_back(std::move(rule));
+    }
+
+    // Bytes no literal uses share class 0; upper case and '/' share their folded byte's class
+    for (const std::string& literal : literals) {
+        for (char c : literal) {
+            uint8_t byte = static_cast<uint8_t>(c);
+            if (byteClass[byte] == 0) {
+                byteClass[byte] = static_cast<uint8_t>(classCount++);
+            }
+        }
+    }
+    for (int byte = 0; byte < 256; ++byte) {
+        byteClass[byte] = byteClass[static_cast<uint8_t>(FoldChar(static_cast<char>(byte)))];
+    }
+
+    // The trie, then per state the rules ending there
+    std::vector<std::vector<uint32_t>> stateRules(1);
+    next.assign(classCount, NO_STATE);
+    for (uint32_t rule = 0; rule < literals.size(); ++rule) {
+        if (literals[rule].empty()) {
+            unanchored.push_back(rule);
+            continue;
+        }
+        uint32_t state = 0;
+        for (char c : literals[rule]) {
+            uint32_t& child = next[state * classCount + byteClass[static_cast<uint8_t>(c)]];
+            if (child == NO_STATE) {
+                child = static_cast<uint32_t>(stateRules.size());
+                stateRules.emplace_back();
+                next.resize(next.size() + classCount, NO_STATE);
+            }
+            state = next[state * classCount + byteClass[static_cast<uint8_t>(c)]];
+        }
+        stateRules[state].push_back(rule);
+    }
+    outputStart.assign(1, 0);
+    for (const std::vector<uint32_t>& ending : stateRules) {
+        outputs.insert(outputs.end(), ending.begin(), ending.end());
+        outputStart.push_back(static_cast<uint32_t>(outputs.size()));
+    }
+
+    // Breadth first, fill in the missing transitions from the failure state so the trie becomes a DFA
+    std::vector<uint32_t> failure(stateRules.size(), 0);
+    outputLink.assign(stateRules.size(), NO_STATE);
+    std::deque<uint32_t> queue;
+    for (size_t cls = 0; cls < classCount; ++cls) {
+        uint32_t& child = next[cls];
+        if (child == NO_STATE) {
+            child = 0;
+        } else {
+            queue.push_back(child);
+        }
+    }
+    while (!queue.empty()) {
+        uint32_t state = queue.front();
+        queue.pop_front();
+        uint32_t fail = failure[state];
+        for (size_t cls = 0; cls < classCount; ++cls) {
+            uint32_t& child = next[state * classCount + cls];
+            uint32_t fallback = next[fail * classCount + cls];
+            if (child == NO_STATE) {
+                child = fallback;
+                continue;
+            }
+            failure[child] = fallback;
+            outputLink[child] = outputStart[fallback] != outputStart[fallback + 1] ? fallback : outputLink[fallback];
+            queue.push_back(child);
+        }
+    }
+}
+
+bool CategoryMatcher::Verify(const Rule& rule, std::string_view path, std::string& folded) const {
+    if (rule.isRegex) {
+        return std::regex_search(path.begin(), path.end(), rule.regex);
+    }
+    if (folded.empty()) {
+        folded = Fold(path);
+    }
+    return GlobMatch(rule.glob, folded);
+}
+
+uint32_t CategoryMatcher::Match(std::string_view path) const {
+    std::vector<uint32_t> candidates(unanchored);
+    uint32_t state = 0;
+    for (char c : path) {
+        state = next[state * classCount + byteClass[static_cast<uint8_t>(c)]];
+        uint32_t output = outputStart[state] != outputStart[state + 1] ? state : outputLink[state];
+        for (; output != NO_STATE; output = outputLink[output]) {
+            candidates.insert(candidates.end(), outputs.begin() + outputStart[output], outputs.begin() + outputStart[output + 1]);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    std::string folded;
+    for (uint32_t rule : candidates) {
+        if (Verify(rules[rule], path, folded)) {
+            return rules[rule].category;
+        }
+    }
+    return NO_CATEGORY;
+}
+
+CategoryRuleCompiler::~CategoryRuleCompiler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void CategoryRuleCompiler::Submit(std::vector<CategoryRule> rules) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending = std::move(rules);
+    hasPending = true;
+    if (!worker.joinable()) {
+        worker = std::thread([this]() { WorkerLoop(); });
+    }
+    wake.notify_one();
+}
+
+std::shared_ptr<const CategoryMatcher> CategoryRuleCompiler::TakeCompiled() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::move(compiled);
+}
+
+std::shared_ptr<const CategoryMatcher> CategoryRuleCompiler::WaitCompiled() {
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return !hasPending && !busy; });
+    return std::move(compiled);
+}
+
+void CategoryRuleCompiler::WorkerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this]() { return stopping || hasPending; });
+        if (stopping) {
+            return;
+        }
+        std::vector<CategoryRule> rules = std::move(pending);
+        hasPending = false;
+        busy = true;
+        lock.unlock();
+        auto matcher = std::make_shared<const CategoryMatcher>(rules);
+        lock.lock();
+        busy = false;
+        if (!hasPending) {
+            compiled = std::move(matcher);
+        }
+        done.notify_all();
+    }
+}
+
+void CategoryTotals::SetMatcher(std::shared_ptr<const CategoryMatcher> newMatcher, const AppTable& apps) {
+    matcher = std::move(newMatcher);
+    categoryByApp.assign(apps.Size(), CategoryMatcher::NO_CATEGORY);
+    matchedPath.assign(apps.Size(), UINT32_MAX);
+    seconds.assign(CategoryCount() + 1, 0);
+    for (uint32_t appId = 0; appId < apps.Size(); ++appId) {
+        uint32_t category = Lookup(apps, appId);
+        seconds[category == CategoryMatcher::NO_CATEGORY ? seconds.size() - 1 : category] += apps.activeSeconds[appId];
+    }
+    ++version;
+}
+
+void CategoryTotals::Charge(const AppTable& apps, uint32_t appId, int64_t added) {
+    if (seconds.empty()) {
+        seconds.assign(1, 0);
+    }
+    uint32_t category = Lookup(apps, appId);
+    seconds[category == CategoryMatcher::NO_CATEGORY ? seconds.size() - 1 : category] += added;
+}
+
+void CategoryTotals::Reset() {
+    std::fill(seconds.begin(), seconds.end(), 0);
+}
+
+uint32_t CategoryTotals::Lookup(const AppTable& apps, uint32_t appId) {
+    if (appId >= categoryByApp.size()) {
+        categoryByApp.resize(apps.Size(), CategoryMatcher::NO_CATEGORY);
+        matchedPath.resize(apps.Size(), UINT32_MAX);
+    }
+    if (matchedPath[appId] != apps.pathIds[appId]) {
+        categoryByApp[appId] = matcher ? matcher->Match(apps.Path(appId)) : CategoryMatcher::NO_CATEGORY;
+        matchedPath[appId] = apps.pathIds[appId];
+        ++version;
+    }
+    return categoryByApp[appId];
+}
+
+uint32_t CategoryTotals::CategoryOf(const AppTable& apps, uint32_t appId) const {
+    if (appId < categoryByApp.size() && matchedPath[appId] == apps.pathIds[appId]) {
+        return categoryByApp[appId];
+    }
+    return matcher ? matcher->Match(apps.Path(appId)) : CategoryMatcher::NO_CATEGORY;
+}
@@ -0,0 +1,141 @@
+#ifndef CATEGORY_RULES_H
+#define CATEGORY_RULES_H
+
+#include "AppTable.h"
+#include "StringInterner.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Executables whose path matches pattern belong to category. A pattern is a
+// glob over the whole path ('*' any run of characters, '?' any one), or an
+// ECMAScript regular expression searched for anywhere in it when prefixed
+// "re:". Case is ignored, and in globs '/' matches '\' too.
+struct CategoryRule {
+    std::string category;
+    std::string pattern;
+};
+
+// Reads "Category = pattern" lines, skipping blank ones and those starting
+// with '#'. Returns false if the file can't be opened.
+bool LoadCategoryRules(const std::string& filename, std::vector<CategoryRule>& rules);
+
+// A rule set compiled for matching many paths. The longest literal every
+// match of a rule must contain goes into one Aho-Corasick automaton, run as
+// a DFA over byte classes, so a path is scanned once however many rules
+// there are; only rules whose literal turned up (and the few without one)
+// are then checked in full. The first rule in order that matches wins.
+class CategoryMatcher {
+public:
+    static constexpr uint32_t NO_CATEGORY = UINT32_MAX;
+
+    // Rules that don't compile (a bad regular expression) are left out and listed by Rejected()
+    explicit CategoryMatcher(const std::vector<CategoryRule>& rules);
+
+    // Category id of the first rule matching path, or NO_CATEGORY
+    uint32_t Match(std::string_view path) const;
+
+    size_t CategoryCount() const { return categories.Size(); }
+    const std::string& CategoryName(uint32_t category) const { return categories.Get(category); }
+    // Indices into the rules given of those left out
+    const std::vector<size_t>& Rejected() const { return rejected; }
+    size_t StateCount() const { return outputStart.size() - 1; }
+
+private:
+    struct Rule {
+        uint32_t category;
+        bool isRegex;
+        std::string glob;  // Lowercased, '/' as '\'
+        std::regex regex;
+    };
+    bool Verify(const Rule& rule, std::string_view path, std::string& folded) const;
+
+    std::vector<Rule> rules;  // In priority order
+    StringInterner categories;
+    std::vector<size_t> rejected;
+
+    // The automaton: states x classes transitions, and per state the rules
+    // whose literal ends there, plus a link to the next shorter suffix state that has some
+    static constexpr uint32_t NO_STATE = UINT32_MAX;
+    uint8_t byteClass[256] = {};
+    size_t classCount = 1;
+    std::vector<uint32_t> next;
+    std::vector<uint32_t> outputStart;  // State s outputs outputs[outputStart[s], outputStart[s + 1])
+    std::vector<uint32_t> outputs;
+    std::vector<uint32_t> outputLink;
+    std::vector<uint32_t> unanchored;  // Rules with no literal, checked on every path
+};
+
+// Compiles rule sets on a thread of its own, so an edit to thousands of rules
+// never holds up a tick. Submit() replaces whatever is still waiting, and a
+// result overtaken by a newer submission is dropped.
+class CategoryRuleCompiler {
+public:
+    CategoryRuleCompiler() = default;
+    ~CategoryRuleCompiler();
+
+    CategoryRuleCompiler(const CategoryRuleCompiler&) = delete;
+    CategoryRuleCompiler& operator=(const CategoryRuleCompiler&) = delete;
+
+    void Submit(std::vector<CategoryRule> rules);
+    // The latest compiled matcher, handed over once; nullptr if none is new
+    std::shared_ptr<const CategoryMatcher> TakeCompiled();
+    // Like TakeCompiled(), after waiting for every submission to compile
+    std::shared_ptr<const CategoryMatcher> WaitCompiled();
+
+private:
+    void WorkerLoop();
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::vector<CategoryRule> pending;
+    bool hasPending = false;
+    bool busy = false;
+    bool stopping = false;
+    std::shared_ptr<const CategoryMatcher> compiled;
+    std::thread worker;  // Started by the first Submit()
+};
+
+// Time per category, kept alongside the app totals: an app is matched once,
+// and again only if its path changes, with the result cached by app id, so
+// charging an app's time to its category is an array lookup.
+class CategoryTotals {
+public:
+    // Rematches every app and recounts the totals from the apps' own
+    void SetMatcher(std::shared_ptr<const CategoryMatcher> newMatcher, const AppTable& apps);
+    const std::shared_ptr<const CategoryMatcher>& Matcher() const { return matcher; }
+
+    void Charge(const AppTable& apps, uint32_t appId, int64_t seconds);
+    // Zeroes the totals; the cached matches stay
+    void Reset();
+
+    // CategoryMatcher::NO_CATEGORY for apps no rule matches
+    uint32_t CategoryOf(const AppTable& apps, uint32_t appId) const;
+    size_t CategoryCount() const { return matcher ? matcher->CategoryCount() : 0; }
+    const std::string& CategoryName(uint32_t category) const { return matcher->CategoryName(category); }
+    std::chrono::seconds Time(uint32_t category) const { return std::chrono::seconds(seconds[category]); }
+    std::chrono::seconds Uncategorized() const { return std::chrono::seconds(seconds.empty() ? 0 : seconds.back()); }
+
+    // Changes whenever an app's category may have, so copies of the matches know to refresh
+    uint64_t Version() const { return version; }
+
+private:
+    uint32_t Lookup(const AppTable& apps, uint32_t appId);
+
+    std::shared_ptr<const CategoryMatcher> matcher;
+    std::vector<uint32_t> categoryByApp;
+    std::vector<uint32_t> matchedPath;  // Path id each app was matched on, UINT32_MAX if not yet
+    std::vector<int64_t> seconds;       // By category id, uncategorized last
+    uint64_t version = 0;
+};
+
+#endif
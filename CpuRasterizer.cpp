@@ -0,0 +1,245 @@
+#include "CpuRasterizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CPU_RASTERIZER_SSE2 1
+#endif
+
+namespace {
+
+// x / 255, rounded, exact for x <= 255 * 255
+inline uint32_t Div255(uint32_t x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+inline uint32_t BlendPixel(uint32_t destination, uint32_t source) {
+    uint32_t inverse = 255 - (source >> 24);
+    uint32_t result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t value = ((source >> shift) & 0xff) + Div255(((destination >> shift) & 0xff) * inverse);
+        result |= std::min<uint32_t>(value, 255) << shift;
+    }
+    return result;
+}
+
+} // namespace
+
+TextExtent GreekedTextMeasurer::Measure(const wchar_t*, size_t length, RenderFont font, int dpi) {
+    return { static_cast<int>(length) * Advance(font, dpi), EmPixels(font, dpi) };
+}
+
+int GreekedTextMeasurer::EmPixels(RenderFont font, int dpi) {
+    int points = font == RenderFont::Message ? 12 : 10;
+    return (points * dpi + 36) / 72;
+}
+
+int GreekedTextMeasurer::Advance(RenderFont font, int dpi) {
+    return std::max(EmPixels(font, dpi) * 55 / 100, 2);
+}
+
+CpuRasterizer::CpuRasterizer(int width, int height, int dpi) : dpi(dpi) {
+    Resize(width, height);
+}
+
+void CpuRasterizer::Resize(int newWidth, int newHeight) {
+    width = std::max(newWidth, 0);
+    height = std::max(newHeight, 0);
+    pixels.assign(static_cast<size_t>(width) * height, 0);
+    ResetClip();
+}
+
+uint64_t CpuRasterizer::Checksum() const {
+    uint64_t hash = 14695981039346656037ull;
+    for (uint32_t pixel : pixels) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            hash = (hash ^ ((pixel >> shift) & 0xff)) * 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+bool CpuRasterizer::WritePpm(const std::string& filename) const {
+    std::FILE* file = std::fopen(filename.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error: Could not open " << filename << " for writing" << std::endl;
+        return false;
+    }
+    std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+    std::vector<unsigned char> row(static_cast<size_t>(width) * 3);
+    bool ok = true;
+    for (int y = 0; y < height && ok; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint32_t pixel = pixels[static_cast<size_t>(y) * width + x];
+            row[x * 3] = static_cast<unsigned char>(pixel >> 16);
+            row[x * 3 + 1] = static_cast<unsigned char>(pixel >> 8);
+            row[x * 3 + 2] = static_cast<unsigned char>(pixel);
+        }
+        ok = std::fwrite(row.data(), 1, row.size(), file) == row.size();
+    }
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        std::cerr << "Error: Could not write " << filename << std::endl;
+    }
+    return ok;
+}
+
+void CpuRasterizer::SetClip(int x, int y, int clipWidth, int clipHeight) {
+    clip = DamageRect{ x, y, clipWidth, clipHeight }.Intersection({ 0, 0, width, height });
+}
+
+void CpuRasterizer::ResetClip() {
+    clip = { 0, 0, width, height };
+}
+
+void CpuRasterizer::FillRect(int x, int y, int rectWidth, int rectHeight, uint32_t color) {
+    DamageRect area = DamageRect{ x, y, rectWidth, rectHeight }.Intersection(clip);
+    if (area.Empty()) {
+        return;
+    }
+    uint32_t premultiplied = Premultiply(color);
+    for (int row = area.y; row < area.Bottom(); ++row) {
+        BlendSpan(&pixels[static_cast<size_t>(row) * width + area.x], static_cast<size_t>(area.width), premultiplied);
+    }
+}
+
+void CpuRasterizer::FillRoundedRect(int x, int y, int rectWidth, int rectHeight, int radius, uint32_t color) {
+    uint32_t premultiplied = Premultiply(color);
+    FillRoundedRows(x, y, rectWidth, rectHeight, radius, [premultiplied](int) { return premultiplied; });
+}
+
+void CpuRasterizer::FillRoundedRectGradient(int x, int y, int rectWidth, int rectHeight, int radius, uint32_t top, uint32_t bottom) {
+    FillRoundedRows(x, y, rectWidth, rectHeight, radius, [top, bottom, rectHeight](int row) {
+        // Sampled at the centre of each scanline
+        uint32_t color = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            int from = static_cast<int>((top >> shift) & 0xff);
+            int to = static_cast<int>((bottom >> shift) & 0xff);
+            int value = from + (to - from) * (2 * row + 1) / (2 * rectHeight);
+            color |= static_cast<uint32_t>(value) << shift;
+        }
+        return Premultiply(color);
+    });
+}
+
+template <typename RowColor>
+void CpuRasterizer::FillRoundedRows(int x, int y, int rectWidth, int rectHeight, int radius, RowColor rowColor) {
+    DamageRect rect{ x, y, rectWidth, rectHeight };
+    DamageRect area = rect.Intersection(clip);
+    if (area.Empty()) {
+        return;
+    }
+
+    // How far each corner row is inset, from the pixel centres inside the arc
+    radius = std::max(std::min({ radius, rectWidth / 2, rectHeight / 2 }), 0);
+    cornerInsets.resize(static_cast<size_t>(radius));
+    for (int i = 0; i < radius; ++i) {
+        int distance = 2 * radius - 2 * i - 1;  // Twice the distance to the arc centre
+        double halfChord = std::sqrt(static_cast<double>(4 * radius * radius - distance * distance)) / 2;
+        cornerInsets[i] = std::max(static_cast<int>(std::ceil(radius - halfChord - 0.5)), 0);
+    }
+
+    for (int row = area.y; row < area.Bottom(); ++row) {
+        int fromTop = row - y;
+        int fromBottom = rect.Bottom() - 1 - row;
+        int inset = 0;
+        if (fromTop < radius) {
+            inset = cornerInsets[fromTop];
+        } else if (fromBottom < radius) {
+            inset = cornerInsets[fromBottom];
+        }
+        int left = std::max(x + inset, area.x);
+        int right = std::min(rect.Right() - inset, area.Right());
+        if (left < right) {
+            BlendSpan(&pixels[static_cast<size_t>(row) * width + left], static_cast<size_t>(right - left), rowColor(fromTop));
+        }
+    }
+}
+
+void CpuRasterizer::DrawImage(const std::shared_ptr<const IconImage>& image, int x, int y, int rectWidth, int rectHeight) {
+    DamageRect area = DamageRect{ x, y, rectWidth, rectHeight }.Intersection(clip);
+    if (!image || image->width <= 0 || image->height <= 0 || area.Empty()) {
+        return;
+    }
+    // Nearest neighbour; cached icons are already at their drawn size
+    for (int row = area.y; row < area.Bottom(); ++row) {
+        int sourceY = (row - y) * image->height / rectHeight;
+        const uint32_t* source = &image->pixels[static_cast<size_t>(sourceY) * image->width];
+        uint32_t* destination = &pixels[static_cast<size_t>(row) * width];
+        for (int column = area.x; column < area.Right(); ++column) {
+            uint32_t pixel = source[(column - x) * image->width / rectWidth];
+            uint32_t alpha = pixel >> 24;
+            if (alpha == 255) {
+                destination[column] = pixel;
+            } else if (alpha != 0) {
+                destination[column] = BlendPixel(destination[column], pixel);
+            }
+        }
+    }
+}
+
+void CpuRasterizer::DrawTextRun(const wchar_t* text, size_t length, RenderFont font, int x, int y, uint32_t color) {
+    int em = GreekedTextMeasurer::EmPixels(font, dpi);
+    int advance = GreekedTextMeasurer::Advance(font, dpi);
+    int glyphTop = y + em * 3 / 10;
+    int glyphHeight = std::max(em * 6 / 10, 1);
+    if (glyphTop >= clip.Bottom() || glyphTop + glyphHeight <= clip.y) {
+        return;
+    }
+    for (size_t i = 0; i < length && x < clip.Right(); ++i, x += advance) {
+        if (text[i] > L' ') {
+            FillRect(x, glyphTop, advance - 1, glyphHeight, color);
+        }
+    }
+}
+
+uint32_t CpuRasterizer::Premultiply(uint32_t argb) {
+    uint32_t alpha = argb >> 24;
+    if (alpha == 255) {
+        return argb;
+    }
+    uint32_t result = alpha << 24;
+    for (int shift = 0; shift < 24; shift += 8) {
+        result |= Div255(((argb >> shift) & 0xff) * alpha) << shift;
+    }
+    return result;
+}
+
+void CpuRasterizer::BlendSpanScalar(uint32_t* span, size_t count, uint32_t premultiplied) {
+    for (size_t i = 0; i < count; ++i) {
+        span[i] = BlendPixel(span[i], premultiplied);
+    }
+}
+
+void CpuRasterizer::BlendSpan(uint32_t* span, size_t count, uint32_t premultiplied) {
+    uint32_t alpha = premultiplied >> 24;
+    if (alpha == 255) {
+        std::fill(span, span + count, premultiplied);
+        return;
+    }
+    if (premultiplied == 0) {
+        return;
+    }
+
+    size_t i = 0;
+#ifdef CPU_RASTERIZER_SSE2
+    // Four pixels at a time with 16-bit lanes; the same arithmetic as BlendPixel
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i inverse = _mm_set1_epi16(static_cast<short>(255 - alpha));
+    const __m128i bias = _mm_set1_epi16(128);
+    const __m128i source = _mm_set1_epi32(static_cast<int>(premultiplied));
+    for (; i + 4 <= count; i += 4) {
+        __m128i destination = _mm_loadu_si128(reinterpret_cast<const __m128i*>(span + i));
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(destination, zero), inverse), bias);
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(destination, zero), inverse), bias);
+        low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+        __m128i blended = _mm_adds_epu8(_mm_packus_epi16(low, high), source);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(span + i), blended);
+    }
+#endif
+    BlendSpanScalar(span + i, count - i, premultiplied);
+}
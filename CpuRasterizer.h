@@ -0,0 +1,75 @@
+#ifndef CPU_RASTERIZER_H
+#define CPU_RASTERIZER_H
+
+#include "RenderBackend.h"
+#include "DamageRegion.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The metrics CpuRasterizer draws greeked text with: every character is one
+// advance wide. Serves as the layout's TextMeasurer wherever there is no real
+// font engine, so layout and damage agree with what the rasterizer draws.
+class GreekedTextMeasurer : public TextMeasurer {
+public:
+    TextExtent Measure(const wchar_t* text, size_t length, RenderFont font, int dpi) override;
+
+    // Height of the font's em square, in pixels
+    static int EmPixels(RenderFont font, int dpi);
+    static int Advance(RenderFont font, int dpi);
+};
+
+// Portable RenderBackend that draws into an in-memory buffer of premultiplied
+// 0xAARRGGBB pixels (the layout of IconImage and the window's DIB), so the
+// usage view can be benchmarked and compared against golden images on any
+// platform. Colour arithmetic is integer-only, so output is bit-exact across
+// compilers and with or without SIMD.
+//
+// Shapes are not antialiased. Text is greeked: each visible character becomes
+// a box one advance wide, which keeps the cost proportional to the glyph count
+// without needing a font engine.
+class CpuRasterizer : public RenderBackend {
+public:
+    CpuRasterizer(int width, int height, int dpi = 96);
+
+    // Resizes the buffer and clears it to transparent black.
+    void Resize(int width, int height);
+
+    int Width() const { return width; }
+    int Height() const { return height; }
+    const std::vector<uint32_t>& Pixels() const { return pixels; }
+
+    // FNV-1a over the pixels, for golden-image comparisons
+    uint64_t Checksum() const;
+    // Writes the buffer as a binary PPM, composited over black.
+    bool WritePpm(const std::string& filename) const;
+
+    void SetClip(int x, int y, int width, int height) override;
+    void ResetClip() override;
+    void FillRect(int x, int y, int width, int height, uint32_t color) override;
+    void FillRoundedRect(int x, int y, int width, int height, int radius, uint32_t color) override;
+    void FillRoundedRectGradient(int x, int y, int width, int height, int radius, uint32_t top, uint32_t bottom) override;
+    void DrawImage(const std::shared_ptr<const IconImage>& image, int x, int y, int width, int height) override;
+    void DrawTextRun(const wchar_t* text, size_t length, RenderFont font, int x, int y, uint32_t color) override;
+
+    // Blends a premultiplied colour over count pixels (source over). Uses SSE2
+    // where available; BlendSpanScalar() is the reference it must match.
+    static void BlendSpan(uint32_t* pixels, size_t count, uint32_t premultiplied);
+    static void BlendSpanScalar(uint32_t* pixels, size_t count, uint32_t premultiplied);
+    static uint32_t Premultiply(uint32_t argb);
+
+private:
+    // Fills a rounded rectangle one scanline at a time with the colour
+    // rowColor(row) returns (premultiplied)
+    template <typename RowColor>
+    void FillRoundedRows(int x, int y, int width, int height, int radius, RowColor rowColor);
+
+    int width = 0;
+    int height = 0;
+    int dpi = 96;
+    DamageRect clip;
+    std::vector<uint32_t> pixels;
+    std::vector<int> cornerInsets;  // Scratch, kept so drawing doesn't allocate
+};
+
+#endif
@@ -0,0 +1,88 @@
+#include "DamageRegion.h"
+#include <algorithm>
+
+bool DamageRect::Intersects(const DamageRect& other) const {
+    return !Empty() && !other.Empty() &&
+           x < other.Right() && other.x < Right() && y < other.Bottom() && other.y < Bottom();
+}
+
+bool DamageRect::Touches(const DamageRect& other) const {
+    return !Empty() && !other.Empty() &&
+           x <= other.Right() && other.x <= Right() && y <= other.Bottom() && other.y <= Bottom();
+}
+
+DamageRect DamageRect::Union(const DamageRect& other) const {
+    if (Empty()) {
+        return other;
+    }
+    if (other.Empty()) {
+        return *this;
+    }
+    int left = std::min(x, other.x);
+    int top = std::min(y, other.y);
+    return { left, top, std::max(Right(), other.Right()) - left, std::max(Bottom(), other.Bottom()) - top };
+}
+
+DamageRect DamageRect::Intersection(const DamageRect& other) const {
+    int left = std::max(x, other.x);
+    int top = std::max(y, other.y);
+    int right = std::min(Right(), other.Right());
+    int bottom = std::min(Bottom(), other.Bottom());
+    if (right <= left || bottom <= top) {
+        return {};
+    }
+    return { left, top, right - left, bottom - top };
+}
+
+void DamageRegion::Add(const DamageRect& rect) {
+    if (rect.Empty()) {
+        return;
+    }
+
+    // Merging can make the grown rectangle reach others, so repeat until stable
+    DamageRect merged = rect;
+    bool grew = true;
+    while (grew) {
+        grew = false;
+        for (size_t i = 0; i < rects.size(); ++i) {
+            if (rects[i].Touches(merged)) {
+                merged = merged.Union(rects[i]);
+                rects[i] = rects.back();
+                rects.pop_back();
+                grew = true;
+                break;
+            }
+        }
+    }
+    rects.push_back(merged);
+
+    if (rects.size() > maxRects) {
+        DamageRect bounds = Bounds();
+        rects.assign(1, bounds);
+    }
+}
+
+bool DamageRegion::Intersects(const DamageRect& rect) const {
+    for (const auto& damaged : rects) {
+        if (damaged.Intersects(rect)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+DamageRect DamageRegion::Bounds() const {
+    DamageRect bounds;
+    for (const auto& rect : rects) {
+        bounds = bounds.Union(rect);
+    }
+    return bounds;
+}
+
+int64_t DamageRegion::Area() const {
+    int64_t area = 0;
+    for (const auto& rect : rects) {
+        area += rect.Area();
+    }
+    return area;
+}
@@ -0,0 +1,48 @@
+#ifndef DAMAGE_REGION_H
+#define DAMAGE_REGION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Axis-aligned pixel rectangle; right and bottom edges are exclusive
+struct DamageRect {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+
+    int Right() const { return x + width; }
+    int Bottom() const { return y + height; }
+    bool Empty() const { return width <= 0 || height <= 0; }
+    int64_t Area() const { return Empty() ? 0 : static_cast<int64_t>(width) * height; }
+    bool Intersects(const DamageRect& other) const;
+    // True if the two overlap or share an edge
+    bool Touches(const DamageRect& other) const;
+    DamageRect Union(const DamageRect& other) const;
+    DamageRect Intersection(const DamageRect& other) const;
+};
+
+// The parts of a window that need repainting, as a short list of disjoint
+// rectangles. Rectangles that overlap or touch are merged, and once there
+// would be more than maxRects the region collapses into its bounding box, so
+// it always maps onto a handful of invalidation calls.
+class DamageRegion {
+public:
+    explicit DamageRegion(size_t maxRects = 16) : maxRects(maxRects ? maxRects : 1) {}
+
+    void Add(const DamageRect& rect);
+    void Clear() { rects.clear(); }
+
+    bool Empty() const { return rects.empty(); }
+    const std::vector<DamageRect>& Rects() const { return rects; }
+    bool Intersects(const DamageRect& rect) const;
+    DamageRect Bounds() const;
+    int64_t Area() const;
+
+private:
+    size_t maxRects;
+    std::vector<DamageRect> rects;
+};
+
+#endif
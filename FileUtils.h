@@ -0,0 +1,16 @@
+#ifndef FILE_UTILS_H
+#define FILE_UTILS_H
+
+#include <cstdio>
+#include <string>
+
+// Renames "from" to "to", replacing "to" if it exists. Returns once the
+// rename itself is on disk.
+bool RenameReplacing(const std::string& from, const std::string& to);
+
+// Pushes the stream's buffered data through to the disk.
+bool SyncFile(std::FILE* file);
+
+bool FileExists(const std::string& filename);
+
+#endif
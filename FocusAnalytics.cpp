@@ -0,0 +1,135 @@
+#include "FocusAnalytics.h"
+#include <algorithm>
+
+void AppFocus::AddSession(const FocusInterval& session) {
+    ++sessions;
+    seconds += session.length;
+    if (session.length > longest) {
+        longest = session.length;
+        longestBegin = session.begin;
+    }
+}
+
+size_t FocusSummary::LengthClass(uint32_t seconds) {
+    static const uint32_t BOUNDS[LENGTH_CLASSES - 1] = { 60, 5 * 60, 15 * 60, 30 * 60, 60 * 60 };
+    return static_cast<size_t>(std::upper_bound(BOUNDS, BOUNDS + LENGTH_CLASSES - 1, seconds) - BOUNDS);
+}
+
+void FocusSummary::AddSession(const FocusInterval& session) {
+    ++sessions;
+    seconds += session.length;
+    ++lengths[LengthClass(session.length)];
+    if (session.length > longest) {
+        longest = session.length;
+        longestAppId = session.appId;
+    }
+}
+
+void FocusAnalytics::Add(const FocusInterval& interval) {
+    if (interval.length == 0) {
+        return;
+    }
+    if (state.hasRun && interval.begin == state.run.End()) {
+        if (interval.appId == state.run.appId) {
+            state.run.length += interval.length;
+            return;
+        }
+        Switch(interval.begin);
+    }
+    if (state.hasRun) {
+        if (apps.size() <= state.run.appId) {
+            apps.resize(state.run.appId + 1);
+        }
+        apps[state.run.appId].AddSession(state.run);
+        state.finished.AddSession(state.run);
+        sessions.Add(state.run.appId, state.run.begin, state.run.length);
+        ++version;
+    }
+    state.run = interval;
+    state.hasRun = true;
+}
+
+void FocusAnalytics::Clear() {
+    apps.clear();
+    state = State();
+    sessions.Clear();
+    ++version;
+}
+
+const AppFocus& FocusAnalytics::Finished(uint32_t appId) const {
+    static const AppFocus none;
+    return appId < apps.size() ? apps[appId] : none;
+}
+
+size_t FocusAnalytics::Live(const FocusInterval* open, FocusInterval live[2]) const {
+    size_t count = 0;
+    if (state.hasRun) {
+        live[count] = state.run;
+        if (open && open->appId == state.run.appId && open->begin == state.run.End()) {
+            live[count].length += open->length;
+            return 1;
+        }
+        ++count;
+    }
+    if (open && open->length > 0) {
+        live[count++] = *open;
+    }
+    return count;
+}
+
+AppFocus FocusAnalytics::App(uint32_t appId, const FocusInterval* open) const {
+    AppFocus focus = Finished(appId);
+    FocusInterval live[2];
+    for (size_t i = 0, count = Live(open, live); i < count; ++i) {
+        if (live[i].appId == appId) {
+            focus.AddSession(live[i]);
+        }
+    }
+    return focus;
+}
+
+void FocusAnalytics::Summarize(const FocusInterval* open, int64_t now, FocusSummary& summary) const {
+    summary = state.finished;
+    FocusInterval live[2];
+    size_t count = Live(open, live);
+    for (size_t i = 0; i < count; ++i) {
+        summary.AddSession(live[i]);
+    }
+    summary.switchesLastHour = SwitchesInHourTo(now);
+    // The open interval taking over from the latest run is a switch not yet counted
+    if (count == 2 && live[1].begin == live[0].End() && live[1].appId != live[0].appId) {
+        ++summary.switches;
+        summary.switchesLastHour += live[1].begin > now - 3600 ? 1 : 0;
+    }
+}
+
+void FocusAnalytics::Restore(const State& saved, std::vector<AppFocus> savedApps, SessionDistributions savedSessions) {
+    state = saved;
+    apps = std::move(savedApps);
+    sessions = std::move(savedSessions);
+    ++version;
+}
+
+void FocusAnalytics::Switch(int64_t at) {
+    ++state.finished.switches;
+    int64_t minute = at >= 0 ? at / 60 : -((-at + 59) / 60);
+    const int64_t slots = static_cast<int64_t>(SWITCH_MINUTES);
+    size_t slot = static_cast<size_t>((minute % slots + slots) % slots);
+    if (state.switchMinutes[slot] != minute) {
+        state.switchMinutes[slot] = minute;
+        state.switchCounts[slot] = 0;
+    }
+    ++state.switchCounts[slot];
+}
+
+uint32_t FocusAnalytics::SwitchesInHourTo(int64_t now) const {
+    // Whole minutes, so the hour reaches back to the start of the minute an hour ago
+    int64_t minute = now >= 0 ? now / 60 : -((-now + 59) / 60);
+    uint32_t switches = 0;
+    for (size_t slot = 0; slot < SWITCH_MINUTES; ++slot) {
+        if (state.switchMinutes[slot] > minute - static_cast<int64_t>(SWITCH_MINUTES) && state.switchMinutes[slot] <= minute) {
+            switches += state.switchCounts[slot];
+        }
+    }
+    return switches;
+}
@@ -0,0 +1,93 @@
+#ifndef FOCUS_ANALYTICS_H
+#define FOCUS_ANALYTICS_H
+
+#include "IntervalLog.h"
+#include "SessionSketch.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Session statistics of one app. A session is a stretch of focus on the app
+// that neither a switch to another app nor a break (idle, no window) cut.
+struct AppFocus {
+    uint64_t sessions = 0;
+    int64_t seconds = 0;        // Over all sessions
+    uint32_t longest = 0;       // Longest session, in seconds
+    int64_t longestBegin = 0;   // Unix seconds
+
+    std::chrono::seconds MeanSession() const { return std::chrono::seconds(sessions ? seconds / static_cast<int64_t>(sessions) : 0); }
+    void AddSession(const FocusInterval& session);
+};
+
+// How fragmented attention is, over all apps
+struct FocusSummary {
+    // Session length classes: under 1 min, 1-5, 5-15, 15-30, 30-60 min, an hour or more
+    static const size_t LENGTH_CLASSES = 6;
+    static size_t LengthClass(uint32_t seconds);
+
+    uint64_t switches = 0;          // Focus moving straight from one app to another
+    uint32_t switchesLastHour = 0;
+    uint64_t sessions = 0;
+    int64_t seconds = 0;
+    uint32_t longest = 0;
+    uint32_t longestAppId = UINT32_MAX;
+    uint64_t lengths[LENGTH_CLASSES] = {};
+
+    std::chrono::seconds MeanSession() const { return std::chrono::seconds(sessions ? seconds / static_cast<int64_t>(sessions) : 0); }
+    void AddSession(const FocusInterval& session);
+};
+
+// Streaming session and context-switch metrics, fed each focus interval as
+// it closes. Contiguous intervals of one app (checkpoint splits) join into a
+// session, and an interval that starts where another app's ended is a
+// switch. Memory is one AppFocus per app, an hour of per-minute switch
+// counts and the session length sketches; nothing ever rereads the log.
+class FocusAnalytics {
+public:
+    // Intervals are expected in time order, as the engine closes them; one
+    // that starts before the previous ended simply starts a new session.
+    void Add(const FocusInterval& interval);
+    void Clear();
+
+    // Sessions that ended, by app id; the latest run is not among them until
+    // something other than its own continuation follows it
+    const AppFocus& Finished(uint32_t appId) const;
+    // Sessions still going given the engine's open interval (nullptr if
+    // none): the latest run, carried on by open when it continues it, and
+    // open. Returns how many of live were filled, at most two.
+    size_t Live(const FocusInterval* open, FocusInterval live[2]) const;
+    // Finished plus the app's live sessions, as if they ended now
+    AppFocus App(uint32_t appId, const FocusInterval* open) const;
+    void Summarize(const FocusInterval* open, int64_t now, FocusSummary& summary) const;
+    // Lengths of finished sessions by app and day, for quantiles over any range of days
+    const SessionDistributions& Sessions() const { return sessions; }
+
+    // Changes whenever a session finishes, so copies of Finished() know to refresh
+    uint64_t Version() const { return version; }
+    size_t AppCount() const { return apps.size(); }
+
+    // Everything but the rows by app, for the binary snapshot to save verbatim
+    static const size_t SWITCH_MINUTES = 60;
+    struct State {
+        FocusSummary finished;
+        FocusInterval run = {};  // Latest session, still open to continuation
+        bool hasRun = false;
+        int64_t switchMinutes[SWITCH_MINUTES] = {};  // Minute (Unix seconds / 60) each slot counts
+        uint32_t switchCounts[SWITCH_MINUTES] = {};
+    };
+    const State& Saved() const { return state; }
+    // Replaces everything; apps is indexed by app id
+    void Restore(const State& saved, std::vector<AppFocus> savedApps, SessionDistributions savedSessions);
+
+private:
+    void Switch(int64_t at);
+    uint32_t SwitchesInHourTo(int64_t now) const;
+
+    std::vector<AppFocus> apps;
+    State state;
+    SessionDistributions sessions;
+    uint64_t version = 0;
+};
+
+#endif
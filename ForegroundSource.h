@@ -0,0 +1,27 @@
+#ifndef FOREGROUND_SOURCE_H
+#define FOREGROUND_SOURCE_H
+
+#include <string>
+#include <utility>
+
+struct ForegroundSample {
+    ForegroundSample() = default;
+    ForegroundSample(std::string name, std::string path, std::string title = std::string())
+        : appName(std::move(name)), appPath(std::move(path)), windowTitle(std::move(title)) {}
+
+    std::string appName;
+    std::string appPath;
+    std::string windowTitle;  // UTF-8; left empty by sources that don't read titles
+};
+
+// Supplies the application that currently owns the foreground window.
+// The Windows build samples GetForegroundWindow, headless builds replay a script.
+class ForegroundSource {
+public:
+    virtual ~ForegroundSource() = default;
+
+    // Fills in the current foreground app; returns false if there is nothing to track.
+    virtual bool Sample(ForegroundSample& sample) = 0;
+};
+
+#endif
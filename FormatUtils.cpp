@@ -1,4 +1,5 @@
 #include "FormatUtils.h"
+#include <cstdint>
 
 std::string FormatDuration(std::chrono::seconds duration) {
     using namespace std::chrono;
@@ -22,4 +23,43 @@ std::string FormatDuration(std::chrono::seconds duration) {
     }
 
     return timeStr;
-}
\ No newline at end of file
+}
+
+std::wstring Utf8ToWide(const std::string& text) {
+    const uint32_t REPLACEMENT = 0xfffd;
+    std::wstring result;
+    result.reserve(text.size());
+    size_t i = 0;
+    while (i < text.size()) {
+        uint32_t lead = static_cast<unsigned char>(text[i]);
+        uint32_t codePoint = REPLACEMENT;
+        size_t length = 1;
+        if (lead < 0x80) {
+            codePoint = lead;
+        } else if (lead >= 0xc2 && lead <= 0xf4) {
+            size_t needed = lead < 0xe0 ? 2 : (lead < 0xf0 ? 3 : 4);
+            uint32_t value = lead & (0x7f >> needed);
+            size_t read = 1;
+            while (read < needed && i + read < text.size() && (static_cast<unsigned char>(text[i + read]) & 0xc0) == 0x80) {
+                value = (value << 6) | (static_cast<unsigned char>(text[i + read]) & 0x3f);
+                ++read;
+            }
+            length = read;
+            // Reject truncated, overlong, surrogate and out-of-range sequences
+            static const uint32_t minimum[] = { 0, 0, 0x80, 0x800, 0x10000 };
+            if (read == needed && value >= minimum[needed] && value <= 0x10ffff && (value < 0xd800 || value > 0xdfff)) {
+                codePoint = value;
+            }
+        }
+        i += length;
+
+        if (sizeof(wchar_t) == 2 && codePoint >= 0x10000) {
+            codePoint -= 0x10000;
+            result.push_back(static_cast<wchar_t>(0xd800 + (codePoint >> 10)));
+            result.push_back(static_cast<wchar_t>(0xdc00 + (codePoint & 0x3ff)));
+        } else {
+            result.push_back(static_cast<wchar_t>(codePoint));
+        }
+    }
+    return result;
+}
@@ -3,4 +3,8 @@
 #include <string>
 #include <chrono>
 
-std::string FormatDuration(std::chrono::seconds duration);
\ No newline at end of file
+std::string FormatDuration(std::chrono::seconds duration);
+
+// Decodes UTF-8 into wchar_t text: UTF-16 where wchar_t is 16 bits (Windows),
+// UTF-32 elsewhere. Malformed or overlong sequences become U+FFFD.
+std::wstring Utf8ToWide(const std::string& text);
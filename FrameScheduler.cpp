@@ -0,0 +1,34 @@
+#include "FrameScheduler.h"
+
+bool FrameScheduler::Wake() {
+    return visible && Start();
+}
+
+bool FrameScheduler::Interact(Clock::time_point now) {
+    interactingUntil = now + interactionLinger;
+    return Wake();
+}
+
+bool FrameScheduler::Show() {
+    visible = true;
+    return Start();
+}
+
+void FrameScheduler::Hide() {
+    visible = false;
+    ticking = false;
+}
+
+bool FrameScheduler::FrameDone(bool animating, Clock::time_point now) {
+    ++frames;
+    ticking = visible && (animating || now < interactingUntil);
+    return ticking;
+}
+
+bool FrameScheduler::Start() {
+    if (ticking) {
+        return false;
+    }
+    ticking = true;
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <chrono>
+#include <cstdint>
+
+// Decides when the UI needs a frame clock. Frames run while an animation is
+// still moving or the user interacted within the last interactionLinger, and
+// stop as soon as neither holds, or while the window is hidden. A change that
+// needs drawing wakes the clock for at least one frame; changes that arrive
+// while hidden are left to the frame that Show() starts.
+//
+// The caller owns the actual timer: start it when Wake(), Interact() or Show()
+// returns true, and stop it when FrameDone() returns false.
+class FrameScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit FrameScheduler(std::chrono::milliseconds interactionLinger = std::chrono::milliseconds(250))
+            : interactionLinger(interactionLinger) {}
+
+    // Something changed that needs drawing.
+    bool Wake();
+    // The user scrolled, clicked or dragged; keeps frames coming for a while.
+    bool Interact(Clock::time_point now = Clock::now());
+    // The window became visible, or was hidden or minimized.
+    bool Show();
+    void Hide();
+
+    // Reports one frame; animating is whether anything still moved in it.
+    // Returns false when the clock should stop.
+    bool FrameDone(bool animating, Clock::time_point now = Clock::now());
+
+    bool Ticking() const { return ticking; }
+    bool Visible() const { return visible; }
+    uint64_t Frames() const { return frames; }
+
+private:
+    bool Start();
+
+    std::chrono::milliseconds interactionLinger;
+    Clock::time_point interactingUntil;
+    bool visible = false;
+    bool ticking = false;
+    uint64_t frames = 0;
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "HeatmapView.h"
+#include <algorithm>
+
+namespace {
+
+const wchar_t* const DAY_NAMES[HeatmapGrid::DAYS] = { L"Mon", L"Tue", L"Wed", L"Thu", L"Fri", L"Sat", L"Sun" };
+const wchar_t* const HOUR_LABELS[] = { L"0", L"6", L"12", L"18" };
+
+uint32_t Mix(uint32_t from, uint32_t to, int level) {
+    uint32_t mixed = 0xff000000u;
+    for (int shift = 0; shift < 24; shift += 8) {
+        int a = (from >> shift) & 0xff;
+        int b = (to >> shift) & 0xff;
+        mixed |= static_cast<uint32_t>(a + (b - a) * level / HeatmapView::LEVELS) << shift;
+    }
+    return mixed;
+}
+
+} // namespace
+
+void HeatmapView::Layout(const DamageRect& newArea, float dpiScaleX, float dpiScaleY) {
+    area = newArea;
+    labelWidth = static_cast<int>(40 * dpiScaleX);
+    labelHeight = static_cast<int>(20 * dpiScaleY);
+    gap = std::max(static_cast<int>(2 * dpiScaleX), 1);
+    radius = static_cast<int>(2 * dpiScaleX);
+    // The title and the hour labels each take a label line above the grid
+    cellWidth = std::max((area.width - labelWidth) / HeatmapGrid::HOURS, 1);
+    cellHeight = std::max(std::min((area.height - 2 * labelHeight) / HeatmapGrid::DAYS, 2 * cellWidth), 1);
+    valid = false;
+}
+
+DamageRect HeatmapView::CellRect(int day, int hour) const {
+    return { area.x + labelWidth + hour * cellWidth, area.y + 2 * labelHeight + day * cellHeight,
+             std::max(cellWidth - gap, 1), std::max(cellHeight - gap, 1) };
+}
+
+int HeatmapView::Level(uint32_t seconds, uint32_t peak) {
+    if (seconds == 0 || peak == 0) {
+        return 0;
+    }
+    // Any time at all shows, so the lowest shade for a nonzero cell is 1
+    return std::max(static_cast<int>(static_cast<uint64_t>(seconds) * LEVELS / peak), 1);
+}
+
+void HeatmapView::Diff(const HeatmapGrid* grid, DamageRegion& region) {
+    uint32_t peak = grid ? grid->PeakHour() : 0;
+    bool full = !valid;
+    for (int day = 0; day < HeatmapGrid::DAYS; ++day) {
+        for (int hour = 0; hour < HeatmapGrid::HOURS; ++hour) {
+            auto level = static_cast<uint8_t>(grid ? Level(grid->Hour(day, hour), peak) : 0);
+            if (level != shown[day][hour] && !full) {
+                region.Add(CellRect(day, hour));
+            }
+            shown[day][hour] = level;
+        }
+    }
+    if (full) {
+        region.Add(area);
+    }
+    valid = true;
+}
+
+void HeatmapView::Paint(RenderBackend& backend, const HeatmapGrid* grid, const std::wstring& title,
+                        const HeatmapStyle& style, const DamageRect& dirty) const {
+    DamageRect clip = dirty.Intersection(area);
+    if (clip.Empty()) {
+        return;
+    }
+    backend.SetClip(clip.x, clip.y, clip.width, clip.height);
+    backend.FillRect(clip.x, clip.y, clip.width, clip.height, style.background);
+    backend.DrawTextRun(title.c_str(), title.size(), RenderFont::List, area.x + gap, area.y, style.text);
+    for (int i = 0; i < 4; ++i) {
+        const wchar_t* label = HOUR_LABELS[i];
+        backend.DrawTextRun(label, std::char_traits<wchar_t>::length(label), RenderFont::List,
+                            CellRect(0, i * 6).x, area.y + labelHeight, style.text);
+    }
+
+    uint32_t peak = grid ? grid->PeakHour() : 0;
+    for (int day = 0; day < HeatmapGrid::DAYS; ++day) {
+        DamageRect row = CellRect(day, 0);
+        if (row.y >= clip.Bottom() || row.Bottom() <= clip.y) {
+            continue;
+        }
+        backend.DrawTextRun(DAY_NAMES[day], 3, RenderFont::List, area.x + gap, row.y, style.text);
+        for (int hour = 0; hour < HeatmapGrid::HOURS; ++hour) {
+            DamageRect cell = CellRect(day, hour);
+            if (cell.Intersects(clip)) {
+                int level = grid ? Level(grid->Hour(day, hour), peak) : 0;
+                backend.FillRoundedRect(cell.x, cell.y, cell.width, cell.height, radius, Mix(style.empty, style.full, level));
+            }
+        }
+    }
+    backend.ResetClip();
+}
@@ -0,0 +1,55 @@
+#ifndef HEATMAP_VIEW_H
+#define HEATMAP_VIEW_H
+
+#include "DamageRegion.h"
+#include "RenderBackend.h"
+#include "UsageHeatmap.h"
+#include <cstdint>
+#include <string>
+
+// Colours of the heatmap view; cells shade from empty to full
+struct HeatmapStyle {
+    uint32_t background = MakeRgb(25, 25, 25);
+    uint32_t text = MakeRgb(255, 255, 255);
+    uint32_t empty = MakeRgb(40, 40, 40);
+    uint32_t full = MakeRgb(200, 200, 200);
+};
+
+// Day rows by hour columns of a HeatmapGrid, under a title line. Cells are
+// shaded in LEVELS steps relative to the busiest hour, so a tick that adds a
+// second usually changes no shade and Diff() damages nothing.
+class HeatmapView {
+public:
+    static const int LEVELS = 8;
+
+    // Places the view in area, client coordinates
+    void Layout(const DamageRect& area, float dpiScaleX, float dpiScaleY);
+    const DamageRect& Area() const { return area; }
+    DamageRect CellRect(int day, int hour) const;
+
+    // Shade of a cell, 0 for no time up to LEVELS for the peak
+    static int Level(uint32_t seconds, uint32_t peak);
+
+    // Adds the cells whose shade changed since the last Diff() to region;
+    // everything after Layout() or Invalidate(). grid may be null (no data).
+    void Diff(const HeatmapGrid* grid, DamageRegion& region);
+    // Damages the whole view on the next Diff(), e.g. when the title changes
+    void Invalidate() { valid = false; }
+
+    // Paints the part of the view inside dirty
+    void Paint(RenderBackend& backend, const HeatmapGrid* grid, const std::wstring& title,
+               const HeatmapStyle& style, const DamageRect& dirty) const;
+
+private:
+    DamageRect area;
+    int labelWidth = 0;
+    int labelHeight = 0;
+    int cellWidth = 0;
+    int cellHeight = 0;
+    int gap = 1;
+    int radius = 2;
+    uint8_t shown[HeatmapGrid::DAYS][HeatmapGrid::HOURS] = {};
+    bool valid = false;
+};
+
+#endif
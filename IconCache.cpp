@@ -0,0 +1,153 @@
+#include "IconCache.h"
+
+size_t IconCache::KeyHash::operator()(const Key& key) const {
+    size_t hash = std::hash<std::string>()(key.path);
+    hash ^= static_cast<size_t>(key.size) * 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+    hash ^= static_cast<size_t>(key.dpi) * 0xC2B2AE3D27D4EB4Full + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+IconCache::IconCache(IconDecoder& decoder, size_t capacity, std::function<void()> onReady)
+        : decoder(decoder), capacity(capacity ? capacity : 1), onReady(std::move(onReady)) {
+}
+
+IconCache::~IconCache() {
+    Stop();
+}
+
+std::shared_ptr<const IconImage> IconCache::Find(const std::string& path, int size, int dpi) {
+    std::lock_guard<std::mutex> lock(mutex);
+    probe.path.assign(path);
+    probe.size = size;
+    probe.dpi = dpi;
+    auto it = index.find(probe);
+    if (it != index.end()) {
+        ++hits;
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->image;
+    }
+
+    ++misses;
+    if (!stopping && queued.insert(probe).second) {
+        requests.push_back(probe);
+        if (!worker.joinable()) {
+            worker = std::thread(&IconCache::WorkerLoop, this);
+        }
+        wake.notify_one();
+    }
+    return nullptr;
+}
+
+void IconCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    index.clear();
+    requests.clear();
+    queued.clear();
+    ++generation;
+    if (!busy) {
+        idle.notify_all();
+    }
+}
+
+void IconCache::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        requests.clear();
+        queued.clear();
+    }
+    wake.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    idle.notify_all();
+}
+
+bool IconCache::WaitIdle(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return idle.wait_for(lock, timeout, [this] { return requests.empty() && !busy; });
+}
+
+size_t IconCache::Size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+uint64_t IconCache::Hits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hits;
+}
+
+uint64_t IconCache::Misses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return misses;
+}
+
+uint64_t IconCache::Decoded() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return decoded;
+}
+
+void IconCache::WorkerLoop() {
+    decoder.ThreadStarted();
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !requests.empty(); });
+        if (stopping) {
+            break;
+        }
+
+        Key key = std::move(requests.front());
+        requests.pop_front();
+        uint64_t startGeneration = generation;
+        busy = true;
+        lock.unlock();
+
+        // Decoding can take milliseconds (file I/O, resampling); never hold the
+        // lock through it so paint lookups stay cheap
+        auto image = std::make_shared<IconImage>();
+        bool ok = decoder.Decode(key.path, key.size, key.dpi, *image);
+        if (ok && (image->width <= 0 || image->height <= 0 ||
+                   image->pixels.size() != static_cast<size_t>(image->width) * image->height)) {
+            ok = false;
+        }
+
+        lock.lock();
+        bool inserted = false;
+        if (generation == startGeneration && !stopping) {
+            queued.erase(key);
+            // Failures are cached too, so a path without an icon isn't retried every frame
+            Insert(std::move(key), ok ? std::shared_ptr<const IconImage>(std::move(image)) : nullptr);
+            ++decoded;
+            inserted = ok;
+        }
+        if (inserted && onReady) {
+            lock.unlock();
+            onReady();
+            lock.lock();
+        }
+
+        busy = false;
+        if (requests.empty()) {
+            idle.notify_all();
+        }
+    }
+    busy = false;
+}
+
+void IconCache::Insert(Key key, std::shared_ptr<const IconImage> image) {
+    auto it = index.find(key);
+    if (it != index.end()) {
+        it->second->image = std::move(image);
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+
+    entries.push_front(Entry{ key, std::move(image) });
+    index.emplace(std::move(key), entries.begin());
+    while (entries.size() > capacity) {
+        index.erase(entries.back().key);
+        entries.pop_back();
+    }
+}
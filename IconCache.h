@@ -0,0 +1,108 @@
+#ifndef ICON_CACHE_H
+#define ICON_CACHE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// A decoded icon, already scaled to its target size
+struct IconImage {
+    int width = 0;
+    int height = 0;
+    std::vector<uint32_t> pixels;  // Premultiplied 0xAARRGGBB, top row first
+};
+
+// Produces icon images for the cache. The Windows build extracts them from
+// executables with the shell and GDI+; runs on the cache's worker thread.
+class IconDecoder {
+public:
+    virtual ~IconDecoder() = default;
+
+    // Called once on the worker thread before its first Decode()
+    virtual void ThreadStarted() {}
+
+    // Decodes the icon of the executable at path, scaled to size x size pixels
+    // for a display of the given DPI. Returns false if there is nothing to show.
+    virtual bool Decode(const std::string& path, int size, int dpi, IconImage& image) = 0;
+};
+
+// Bounded LRU cache of decoded icons keyed by (path, size, DPI). Lookups never
+// decode: a miss queues the icon for a background thread and returns nullptr,
+// and onReady is called from that thread once an icon has been added.
+// Thread-safe.
+class IconCache {
+public:
+    IconCache(IconDecoder& decoder, size_t capacity = 256, std::function<void()> onReady = nullptr);
+    ~IconCache();
+
+    IconCache(const IconCache&) = delete;
+    IconCache& operator=(const IconCache&) = delete;
+
+    // The cached icon, or nullptr while it is being decoded or if it has none.
+    std::shared_ptr<const IconImage> Find(const std::string& path, int size, int dpi);
+
+    // Drops every cached icon and queued request.
+    void Clear();
+    // Stops the worker thread; later misses are no longer decoded.
+    void Stop();
+
+    // Waits until no decode is queued or running; false on timeout.
+    bool WaitIdle(std::chrono::milliseconds timeout);
+
+    size_t Size() const;
+    uint64_t Hits() const;
+    uint64_t Misses() const;
+    uint64_t Decoded() const;
+
+private:
+    struct Key {
+        std::string path;
+        int size;
+        int dpi;
+        bool operator==(const Key& other) const { return size == other.size && dpi == other.dpi && path == other.path; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+    struct Entry {
+        Key key;
+        std::shared_ptr<const IconImage> image;  // nullptr if the decoder had nothing
+    };
+
+    void WorkerLoop();
+    void Insert(Key key, std::shared_ptr<const IconImage> image);
+
+    IconDecoder& decoder;
+    size_t capacity;
+    std::function<void()> onReady;
+
+    mutable std::mutex mutex;
+    std::list<Entry> entries;  // Most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+    std::unordered_set<Key, KeyHash> queued;  // Keys waiting for, or in, a decode
+    std::deque<Key> requests;
+    Key probe;  // Reused for lookups so that a hit doesn't allocate
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::thread worker;
+    bool stopping = false;
+    bool busy = false;
+    uint64_t generation = 0;  // Bumped by Clear() so in-flight decodes are discarded
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t decoded = 0;
+};
+
+#endif
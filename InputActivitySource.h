@@ -0,0 +1,17 @@
+#ifndef INPUT_ACTIVITY_SOURCE_H
+#define INPUT_ACTIVITY_SOURCE_H
+
+#include <chrono>
+
+// Supplies when the user last touched the keyboard or mouse, so the engine
+// can tell an unattended machine from one in use. The Windows build asks
+// GetLastInputInfo, headless builds replay a script.
+class InputActivitySource {
+public:
+    virtual ~InputActivitySource() = default;
+
+    // Fills in the time of the latest input at or before now; returns false if unknown.
+    virtual bool LastInput(std::chrono::system_clock::time_point now, std::chrono::system_clock::time_point& lastInput) = 0;
+};
+
+#endif
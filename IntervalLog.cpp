@@ -0,0 +1,84 @@
+#include "IntervalLog.h"
+#include <algorithm>
+
+bool IntervalLog::Append(const FocusInterval& interval) {
+    if (interval.length == 0) {
+        return true;
+    }
+    maxLength = std::max(maxLength, interval.length);
+    maxAppId = std::max(maxAppId, interval.appId);
+
+    if (intervals.empty() || intervals.back().begin <= interval.begin) {
+        intervals.push_back(interval);
+        return true;
+    }
+
+    auto pos = std::upper_bound(intervals.begin(), intervals.end(), interval.begin,
+                                [](int64_t begin, const FocusInterval& other) { return begin < other.begin; });
+    intervals.insert(pos, interval);
+    return false;
+}
+
+void IntervalLog::AppendSorted(const FocusInterval* records, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    if (!intervals.empty() && records[0].begin < intervals.back().begin) {
+        for (size_t i = 0; i < count; ++i) {
+            Append(records[i]);
+        }
+        return;
+    }
+
+    intervals.insert(intervals.end(), records, records + count);
+    for (size_t i = 0; i < count; ++i) {
+        maxLength = std::max(maxLength, records[i].length);
+        maxAppId = std::max(maxAppId, records[i].appId);
+    }
+}
+
+void IntervalLog::Clear() {
+    intervals.clear();
+    maxLength = 0;
+    maxAppId = 0;
+}
+
+size_t IntervalLog::LowerBound(int64_t from) const {
+    // Nothing that begins earlier than from - maxLength can reach into the window
+    int64_t earliest = from - static_cast<int64_t>(maxLength);
+    auto it = std::lower_bound(intervals.begin(), intervals.end(), earliest,
+                               [](const FocusInterval& interval, int64_t begin) { return interval.begin < begin; });
+    return static_cast<size_t>(it - intervals.begin());
+}
+
+void IntervalLog::AccumulateRange(int64_t from, int64_t to, std::vector<int64_t>& totals) const {
+    if (from >= to || intervals.empty()) {
+        return;
+    }
+    if (totals.size() <= maxAppId) {
+        totals.resize(static_cast<size_t>(maxAppId) + 1, 0);
+    }
+
+    const FocusInterval* it = intervals.data() + LowerBound(from);
+    const FocusInterval* end = intervals.data() + intervals.size();
+    int64_t* appTotals = totals.data();
+
+    // Head: intervals that began before the window and may be cut off by it
+    for (; it != end && it->begin < from; ++it) {
+        int64_t finish = std::min(it->End(), to);
+        if (finish > from) {
+            appTotals[it->appId] += finish - from;
+        }
+    }
+
+    // Body: anything beginning this early ends inside the window, no clipping needed
+    int64_t bodyLimit = to - static_cast<int64_t>(maxLength);
+    for (; it != end && it->begin < bodyLimit; ++it) {
+        appTotals[it->appId] += it->length;
+    }
+
+    // Tail: intervals that may run past the end of the window
+    for (; it != end && it->begin < to; ++it) {
+        appTotals[it->appId] += std::min(it->End(), to) - it->begin;
+    }
+}
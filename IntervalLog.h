@@ -0,0 +1,49 @@
+#ifndef INTERVAL_LOG_H
+#define INTERVAL_LOG_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// One closed span of focus on a single app. Times are Unix seconds.
+struct FocusInterval {
+    int64_t begin;
+    uint32_t length;  // Seconds
+    uint32_t appId;
+
+    int64_t End() const { return begin + length; }
+};
+
+static_assert(sizeof(FocusInterval) == 16, "FocusInterval should stay 16 bytes");
+
+// Append-only log of focus intervals ordered by begin time. All range views
+// are derived from this log instead of from per-app running totals.
+class IntervalLog {
+public:
+    // Appends an interval. Intervals arriving out of order (e.g. imported
+    // legacy totals) are inserted at their sorted position, and false is
+    // returned so that callers can tell views that index the log to recount.
+    bool Append(const FocusInterval& interval);
+    // Bulk append of records already ordered by begin time (e.g. from a snapshot)
+    void AppendSorted(const FocusInterval* records, size_t count);
+    void Clear();
+    void Reserve(size_t count) { intervals.reserve(count); }
+
+    size_t Size() const { return intervals.size(); }
+    bool Empty() const { return intervals.empty(); }
+    const std::vector<FocusInterval>& Data() const { return intervals; }
+
+    // Index of the first interval that may overlap a window starting at "from".
+    size_t LowerBound(int64_t from) const;
+
+    // Adds the seconds each app spent in focus within [from, to) to totals,
+    // which is indexed by app id and grown as needed.
+    void AccumulateRange(int64_t from, int64_t to, std::vector<int64_t>& totals) const;
+
+private:
+    std::vector<FocusInterval> intervals;
+    uint32_t maxLength = 0;  // Longest interval, bounds how far back a range scan starts
+    uint32_t maxAppId = 0;
+};
+
+#endif
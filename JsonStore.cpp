@@ -0,0 +1,454 @@
+#include "JsonStore.h"
+#include "json.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using json = nlohmann::json;
+
+bool ExportTrackingDataToJson(const TrackingEngine& engine, const std::string& filename) {
+    json j;
+    FocusInterval openInterval;
+    const FocusInterval* open = engine.OpenInterval(openInterval) ? &openInterval : nullptr;
+    for (uint32_t appId = 0; appId < engine.AppCount(); ++appId) {
+        // Ensure valid data before saving
+        std::chrono::system_clock::time_point lastActive;
+        if (engine.AppLastActive(appId, lastActive)) {
+            const std::string& appName = engine.AppName(appId);
+            j["app_data"][appName]["time_in_seconds"] = engine.AppActiveTime(appId).count();
+            j["app_data"][appName]["app_path"] = engine.AppPath(appId);
+
+            // Convert the start time to a string
+            std::time_t startTime = std::chrono::system_clock::to_time_t(lastActive);
+            j["app_data"][appName]["start_time"] = std::ctime(&startTime);
+
+            // Session metrics; the session under way counts as ending at the last sample
+            AppFocus focus = engine.Focus().App(appId, open);
+            j["app_data"][appName]["focus_sessions"] = focus.sessions;
+            j["app_data"][appName]["mean_session_seconds"] = focus.MeanSession().count();
+            j["app_data"][appName]["longest_session_seconds"] = focus.longest;
+            if (const SessionSketch* sessions = engine.Focus().Sessions().AllTime(appId)) {
+                j["app_data"][appName]["session_p50_seconds"] = sessions->Quantile(0.5).count();
+                j["app_data"][appName]["session_p90_seconds"] = sessions->Quantile(0.9).count();
+                j["app_data"][appName]["session_p99_seconds"] = sessions->Quantile(0.99).count();
+            }
+            uint32_t category = engine.AppCategory(appId);
+            if (category != CategoryMatcher::NO_CATEGORY) {
+                j["app_data"][appName]["category"] = engine.Categories().CategoryName(category);
+            }
+        }
+    }
+
+    // Context switching over all apps; informational, not read back on import
+    FocusSummary summary;
+    int64_t now = open ? openInterval.End() : 0;
+    engine.Focus().Summarize(open, now, summary);
+    j["focus"]["switches"] = summary.switches;
+    j["focus"]["switches_last_hour"] = summary.switchesLastHour;
+    j["focus"]["sessions"] = summary.sessions;
+    j["focus"]["mean_session_seconds"] = summary.MeanSession().count();
+    j["focus"]["longest_session_seconds"] = summary.longest;
+    j["focus"]["longest_session_app"] = summary.longestAppId < engine.AppCount() ? engine.AppName(summary.longestAppId) : std::string();
+    j["focus"]["session_lengths"] = summary.lengths;
+
+    // Time per category under the current rules; informational as well
+    const CategoryTotals& categories = engine.Categories();
+    j["categories"] = json::object();
+    for (uint32_t category = 0; category < categories.CategoryCount(); ++category) {
+        j["categories"][categories.CategoryName(category)] = categories.Time(category).count();
+    }
+    j["uncategorized_seconds"] = categories.Uncategorized().count();
+
+    // Interval log: app names indexed by id, then [app id, begin, length] records
+    json& intervals = j["intervals"];
+    intervals["apps"] = json::array();
+    for (uint32_t appId = 0; appId < engine.AppCount(); ++appId) {
+        intervals["apps"].push_back(engine.AppName(appId));
+    }
+    intervals["records"] = json::array();
+    for (const auto& interval : engine.Intervals().Data()) {
+        intervals["records"].push_back({ interval.appId, interval.begin, interval.length });
+    }
+    if (open && openInterval.length > 0) {
+        intervals["records"].push_back({ openInterval.appId, openInterval.begin, openInterval.length });
+    }
+
+    try {
+        std::ofstream file(filename, std::ios::out | std::ios::trunc); // Open in truncate mode
+        if (!file.is_open()) {
+            std::cerr << "Error: Unable to open file for saving data" << std::endl;
+            return false;
+        }
+
+        // Dump the JSON with proper indentation
+        file << j.dump(4) << std::endl;  // 4-space indentation and ensuring newline at the end
+        file.close();
+
+        // Check if file failed to close properly
+        if (file.fail()) {
+            std::cerr << "Error: Failed to close the file properly after saving data" << std::endl;
+            return false;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error saving JSON to file: " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+namespace {
+
+// Reads a file in fixed-size chunks so that only one chunk is resident at a time
+class ChunkedFile {
+public:
+    explicit ChunkedFile(std::FILE* file) : file(file), buffer(64 * 1024) {
+        Fill();
+    }
+
+    bool AtEnd() const { return index >= size; }
+    char Current() const { return buffer[index]; }
+    void Advance() {
+        if (++index == size) {
+            Fill();
+        }
+    }
+    size_t Position() const { return consumed + index; }
+
+private:
+    void Fill() {
+        consumed += size;
+        size = std::fread(buffer.data(), 1, buffer.size(), file);
+        index = 0;
+    }
+
+    std::FILE* file;
+    std::vector<char> buffer;
+    size_t size = 0;
+    size_t index = 0;
+    size_t consumed = 0;  // Bytes before the current chunk
+};
+
+// Input iterator over a ChunkedFile; a default-constructed cursor is the end
+class ChunkCursor {
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = char;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const char*;
+    using reference = char;
+
+    ChunkCursor() = default;
+    explicit ChunkCursor(ChunkedFile* source) : source(source) {
+    }
+
+    char operator*() const { return source->Current(); }
+    ChunkCursor& operator++() {
+        source->Advance();
+        return *this;
+    }
+    ChunkCursor operator++(int) {
+        ChunkCursor previous = *this;
+        ++*this;
+        return previous;
+    }
+    bool operator==(const ChunkCursor& other) const { return AtEnd() == other.AtEnd(); }
+    bool operator!=(const ChunkCursor& other) const { return AtEnd() != other.AtEnd(); }
+
+private:
+    bool AtEnd() const { return !source || source->AtEnd(); }
+
+    ChunkedFile* source = nullptr;
+};
+
+// SAX consumer for tracking_data.json. Interval records go into the engine as
+// they are parsed; only the per-app sections, which are small, are held in
+// memory. Records that arrive before "apps" and "app_data" are complete (not
+// the order ExportTrackingDataToJson writes) are buffered until the end.
+class JsonImportHandler : public nlohmann::json_sax<json> {
+public:
+    JsonImportHandler(TrackingEngine& engine, const ChunkedFile& source, size_t size, const JsonImportProgress& progress)
+            : engine(engine), source(source), size(size), progress(progress) {
+    }
+
+    bool null() override { return Value(OTHER_VALUE, 0, nullptr); }
+    bool boolean(bool) override { return Value(OTHER_VALUE, 0, nullptr); }
+    bool number_integer(number_integer_t value) override { return Value(INTEGER_VALUE, value, nullptr); }
+    bool number_unsigned(number_unsigned_t value) override {
+        if (value > static_cast<number_unsigned_t>(INT64_MAX)) {
+            return Value(OTHER_VALUE, 0, nullptr);
+        }
+        return Value(UNSIGNED_VALUE, static_cast<int64_t>(value), nullptr);
+    }
+    bool number_float(number_float_t value, const string_t&) override {
+        return Value(FLOAT_VALUE, static_cast<int64_t>(value), nullptr);
+    }
+    bool string(string_t& value) override { return Value(STRING_VALUE, 0, &value); }
+    bool binary(binary_t&) override { return Value(OTHER_VALUE, 0, nullptr); }
+
+    bool start_object(std::size_t) override {
+        Section parent = stack.empty() ? NONE : stack.back();
+        if (parent == NONE) {
+            stack.push_back(ROOT);
+        } else if (parent == ROOT && currentKey == "app_data") {
+            stack.push_back(APP_DATA);
+        } else if (parent == ROOT && currentKey == "intervals") {
+            stack.push_back(INTERVALS);
+        } else if (parent == APP_DATA) {
+            stack.push_back(APP_ENTRY);
+            entry = LegacyEntry();
+            entry.appName = currentKey;
+        } else {
+            Malformed(parent);
+            stack.push_back(SKIP);
+        }
+        return true;
+    }
+
+    bool end_object() override {
+        Section section = stack.back();
+        stack.pop_back();
+        if (section == APP_DATA) {
+            appDataDone = true;
+            ResolveApps();
+        } else if (section == APP_ENTRY && !entry.appName.empty()) {
+            legacyEntries.push_back(std::move(entry));
+        }
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        Section parent = stack.empty() ? NONE : stack.back();
+        if (parent == INTERVALS && currentKey == "apps") {
+            stack.push_back(APP_NAMES);
+            appNames.clear();
+        } else if (parent == INTERVALS && currentKey == "records") {
+            stack.push_back(RECORDS);
+            sawRecords = true;
+        } else if (parent == RECORDS) {
+            stack.push_back(RECORD);
+            recordFields = 0;
+            recordValid = true;
+        } else {
+            Malformed(parent);
+            stack.push_back(SKIP);
+        }
+        return true;
+    }
+
+    bool end_array() override {
+        Section section = stack.back();
+        stack.pop_back();
+        if (section == APP_NAMES) {
+            appsDone = true;
+            ResolveApps();
+        } else if (section == RECORD) {
+            FinishRecord();
+        }
+        return true;
+    }
+
+    bool key(string_t& value) override {
+        currentKey = value;
+        return true;
+    }
+
+    bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& error) override {
+        std::cerr << "Error parsing JSON at byte " << position << ": " << error.what() << std::endl;
+        return false;
+    }
+
+    // Applies whatever could not be applied while streaming. Called once parsing stops.
+    void Finish(JsonImportStats& stats) {
+        if (appsDone && sawRecords) {
+            appDataDone = true;
+            ResolveApps();
+            for (const FocusInterval& record : buffered) {
+                Apply(record);
+            }
+        } else {
+            // Legacy files only have a total and the last active time per app;
+            // treat each total as one interval ending at the last active time
+            for (const LegacyEntry& legacy : legacyEntries) {
+                if (!legacy.hasPath || !legacy.hasStartTime || !legacy.hasSeconds) {
+                    ++skipped; // Skip entries with missing data
+                    continue;
+                }
+                std::tm tm = {};
+                std::istringstream ss(legacy.startTime);
+                ss >> std::get_time(&tm, "%a %b %d %H:%M:%S %Y");
+                auto startTime = std::chrono::system_clock::from_time_t(std::mktime(&tm));
+                engine.RestoreInterval(legacy.appName, legacy.appPath, startTime - std::chrono::seconds(legacy.seconds), startTime);
+                ++imported;
+            }
+        }
+        ReportProgress(true);
+
+        stats.imported = imported;
+        stats.skipped = skipped;
+    }
+
+private:
+    enum Section { NONE, ROOT, APP_DATA, APP_ENTRY, INTERVALS, APP_NAMES, RECORDS, RECORD, SKIP };
+    enum ValueType { INTEGER_VALUE, UNSIGNED_VALUE, FLOAT_VALUE, STRING_VALUE, OTHER_VALUE };
+
+    struct LegacyEntry {
+        std::string appName;
+        std::string appPath;
+        std::string startTime;
+        int64_t seconds = 0;
+        bool hasPath = false;
+        bool hasStartTime = false;
+        bool hasSeconds = false;
+    };
+
+    bool Value(ValueType type, int64_t number, string_t* text) {
+        Section section = stack.empty() ? NONE : stack.back();
+        if (section == APP_ENTRY) {
+            if (currentKey == "app_path" && type == STRING_VALUE) {
+                entry.appPath = std::move(*text);
+                entry.hasPath = true;
+            } else if (currentKey == "start_time" && type == STRING_VALUE) {
+                entry.startTime = std::move(*text);
+                entry.hasStartTime = true;
+            } else if (currentKey == "time_in_seconds" && type != STRING_VALUE && type != OTHER_VALUE) {
+                entry.seconds = number;
+                entry.hasSeconds = true;
+            }
+        } else if (section == APP_NAMES) {
+            // Non-string names stay as empty placeholders so later ids keep their positions
+            appNames.push_back(type == STRING_VALUE ? std::move(*text) : std::string());
+        } else if (section == RECORD) {
+            // [app id, begin, length]: a non-negative id and two integers
+            bool valid = recordFields == 0 ? type == UNSIGNED_VALUE : type == INTEGER_VALUE || type == UNSIGNED_VALUE;
+            if (recordFields < 3) {
+                recordValues[recordFields] = number;
+            }
+            recordValid = recordValid && valid && recordFields < 3;
+            ++recordFields;
+        } else {
+            Malformed(section);
+        }
+        return true;
+    }
+
+    void Malformed(Section parent) {
+        if (parent == RECORDS) {
+            ++skipped;
+        } else if (parent == RECORD) {
+            recordValid = false;
+        }
+    }
+
+    void FinishRecord() {
+        if (!recordValid || recordFields != 3 || recordValues[2] < 0 || recordValues[2] > UINT32_MAX
+            || recordValues[0] > UINT32_MAX) {
+            ++skipped;
+            return;
+        }
+        FocusInterval record = { recordValues[1], static_cast<uint32_t>(recordValues[2]), static_cast<uint32_t>(recordValues[0]) };
+        if (appsDone && appDataDone) {
+            Apply(record);
+        } else {
+            buffered.push_back(record);
+        }
+        ReportProgress(false);
+    }
+
+    // Looks up each listed app's path once both per-app sections are in
+    void ResolveApps() {
+        if (!appsDone || !appDataDone || appPaths.size() == appNames.size()) {
+            return;
+        }
+        std::unordered_map<std::string_view, const std::string*> pathByName;
+        for (const LegacyEntry& legacy : legacyEntries) {
+            if (legacy.hasPath) {
+                pathByName[legacy.appName] = &legacy.appPath;
+            }
+        }
+        appPaths.clear();
+        for (const std::string& appName : appNames) {
+            auto it = pathByName.find(appName);
+            appPaths.push_back(it == pathByName.end() ? std::string() : *it->second);
+        }
+    }
+
+    void Apply(const FocusInterval& record) {
+        if (record.appId >= appNames.size() || appNames[record.appId].empty()) {
+            ++skipped; // Skip records of unknown apps
+            return;
+        }
+        auto begin = FromUnixSeconds(record.begin);
+        engine.RestoreInterval(appNames[record.appId], appPaths[record.appId], begin, begin + std::chrono::seconds(record.length));
+        ++imported;
+    }
+
+    void ReportProgress(bool done) {
+        if (!progress || (!done && ++sinceProgress < 4096)) {
+            return;
+        }
+        sinceProgress = 0;
+        progress(done ? size : std::min(source.Position(), size), size);
+    }
+
+    TrackingEngine& engine;
+    const ChunkedFile& source;
+    size_t size;
+    const JsonImportProgress& progress;
+    size_t sinceProgress = 0;
+
+    std::vector<Section> stack;
+    std::string currentKey;  // Most recent object key
+
+    LegacyEntry entry;
+    std::vector<LegacyEntry> legacyEntries;
+    bool appDataDone = false;
+
+    std::vector<std::string> appNames;
+    std::vector<std::string> appPaths;  // Parallel to appNames once resolved
+    bool appsDone = false;
+
+    bool sawRecords = false;
+    int64_t recordValues[3] = {};
+    size_t recordFields = 0;
+    bool recordValid = false;
+    std::vector<FocusInterval> buffered;
+
+    size_t imported = 0;
+    size_t skipped = 0;
+};
+
+} // namespace
+
+bool ImportTrackingDataFromJson(TrackingEngine& engine, const std::string& filename,
+                                const JsonImportProgress& progress, JsonImportStats* stats) {
+    std::FILE* file = std::fopen(filename.c_str(), "rb");
+    if (!file) {
+        std::cerr << "Error: Could not open file for loading data" << std::endl;
+        return false; // If the file doesn't exist, skip loading
+    }
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+
+    ChunkedFile source(file);
+    JsonImportHandler handler(engine, source, size > 0 ? static_cast<size_t>(size) : 0, progress);
+    bool parsed = json::sax_parse(ChunkCursor(&source), ChunkCursor(), &handler);
+    std::fclose(file);
+
+    // A syntax error ends the stream, but everything read before it is kept
+    JsonImportStats result;
+    handler.Finish(result);
+    if (stats) {
+        *stats = result;
+    }
+    return parsed;
+}
@@ -0,0 +1,31 @@
+#ifndef JSON_STORE_H
+#define JSON_STORE_H
+
+#include "TrackingEngine.h"
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// tracking_data.json import/export. The binary snapshot is the primary store;
+// JSON stays as the human-readable interchange format and the upgrade path
+// for data written by older versions. Callers serialize access to the engine.
+
+// Writes per-app totals ("app_data") and the interval log ("intervals").
+bool ExportTrackingDataToJson(const TrackingEngine& engine, const std::string& filename);
+
+// Called during an import with the bytes parsed so far and the file size.
+using JsonImportProgress = std::function<void(size_t bytesDone, size_t bytesTotal)>;
+
+struct JsonImportStats {
+    size_t imported = 0;  // Intervals (or legacy per-app totals) restored
+    size_t skipped = 0;   // Malformed entries left out
+};
+
+// Reads a file written by ExportTrackingDataToJson or by older versions that
+// only stored per-app totals. The file is streamed through a SAX parser, so
+// memory use stays flat however large it is. Malformed entries are skipped;
+// on a syntax error, everything before it is kept and false is returned.
+bool ImportTrackingDataFromJson(TrackingEngine& engine, const std::string& filename,
+                                const JsonImportProgress& progress = nullptr, JsonImportStats* stats = nullptr);
+
+#endif
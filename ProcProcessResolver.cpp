@@ -0,0 +1,107 @@
+#include "ProcProcessResolver.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+int OpenPidfd(uint32_t pid) {
+#ifdef SYS_pidfd_open
+    return static_cast<int>(syscall(SYS_pidfd_open, static_cast<pid_t>(pid), 0));
+#else
+    return -1;
+#endif
+}
+
+} // namespace
+
+ProcProcessResolver::~ProcProcessResolver() {
+    for (const auto& entry : pidfds) {
+        close(entry.second);
+    }
+}
+
+bool ProcProcessResolver::ReadStartTime(uint32_t pid, uint64_t& startTime) {
+    char statPath[64];
+    std::snprintf(statPath, sizeof(statPath), "/proc/%u/stat", pid);
+
+    int fd = open(statPath, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    char buffer[1024];
+    ssize_t length = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (length <= 0) {
+        return false;
+    }
+    buffer[length] = '\0';
+
+    // The command name may contain spaces and parentheses; fields resume after the last ')'
+    const char* cursor = std::strrchr(buffer, ')');
+    if (!cursor) {
+        return false;
+    }
+    ++cursor;
+
+    // Skip fields 3..21 to land on starttime (field 22)
+    for (int field = 3; field <= 21; ++field) {
+        cursor = std::strchr(cursor + 1, ' ');
+        if (!cursor) {
+            return false;
+        }
+    }
+    startTime = std::strtoull(cursor + 1, nullptr, 10);
+    return true;
+}
+
+bool ProcProcessResolver::Resolve(uint32_t pid, ProcessIdentity& identity) {
+    char exeLink[64];
+    std::snprintf(exeLink, sizeof(exeLink), "/proc/%u/exe", pid);
+
+    char exePath[4096];
+    ssize_t length = readlink(exeLink, exePath, sizeof(exePath) - 1);
+    if (length <= 0 || !ReadStartTime(pid, identity.startTime)) {
+        return false;
+    }
+
+    identity.appPath.assign(exePath, static_cast<size_t>(length));
+    identity.appName = AppNameFromPath(identity.appPath);
+    return true;
+}
+
+bool ProcProcessResolver::IsSameProcess(uint32_t pid, uint64_t startTime) {
+    auto it = pidfds.find(pid);
+    if (it != pidfds.end()) {
+        // A pidfd becomes readable once its process exits
+        pollfd request = { it->second, POLLIN, 0 };
+        return poll(&request, 1, 0) == 0;
+    }
+
+    // First check for this process: compare start times, then keep a pidfd for later ones.
+    // The pidfd is opened before the start time is read, so it can't belong to a newer process.
+    int pidfd = OpenPidfd(pid);
+    uint64_t current = 0;
+    if (!ReadStartTime(pid, current) || current != startTime) {
+        if (pidfd >= 0) {
+            close(pidfd);
+        }
+        return false;
+    }
+    if (pidfd >= 0) {
+        pidfds[pid] = pidfd;
+    }
+    return true;
+}
+
+void ProcProcessResolver::Release(uint32_t pid) {
+    auto it = pidfds.find(pid);
+    if (it != pidfds.end()) {
+        close(it->second);
+        pidfds.erase(it);
+    }
+}
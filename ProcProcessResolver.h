@@ -0,0 +1,26 @@
+#ifndef PROC_PROCESS_RESOLVER_H
+#define PROC_PROCESS_RESOLVER_H
+
+#include "ProcessResolver.h"
+#include <unordered_map>
+
+// Linux resolver backed by procfs: the path comes from readlink(/proc/<pid>/exe)
+// and the start time (in clock ticks since boot) from field 22 of /proc/<pid>/stat.
+// Where the kernel supports it a pidfd is kept per checked process, so the
+// per-tick liveness check is a single poll() instead of re-reading procfs.
+class ProcProcessResolver : public ProcessResolver {
+public:
+    ~ProcProcessResolver() override;
+
+    bool Resolve(uint32_t pid, ProcessIdentity& identity) override;
+    bool IsSameProcess(uint32_t pid, uint64_t startTime) override;
+    void Release(uint32_t pid) override;
+
+    // Reads only the start time; false if the process doesn't exist.
+    static bool ReadStartTime(uint32_t pid, uint64_t& startTime);
+
+private:
+    std::unordered_map<uint32_t, int> pidfds;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#include "ProcessIdentityCache.h"
+#include <algorithm>
+#include <utility>
+
+std::string AppNameFromPath(const std::string& path) {
+    size_t pos = path.find_last_of("\\/");
+    return pos == std::string::npos ? path : path.substr(pos + 1);
+}
+
+ProcessIdentityCache::ProcessIdentityCache(ProcessResolver& resolver, size_t capacity)
+        : resolver(resolver), capacity(std::max<size_t>(capacity, 1)) {
+}
+
+ProcessIdentityCache::~ProcessIdentityCache() {
+    Clear();
+}
+
+const ProcessIdentity* ProcessIdentityCache::Lookup(uint32_t pid) {
+    ++clock;
+
+    auto it = entries.find(pid);
+    if (it != entries.end()) {
+        if (resolver.IsSameProcess(pid, it->second.identity.startTime)) {
+            ++hits;
+            it->second.lastUsed = clock;
+            return &it->second.identity;
+        }
+        // The process exited, or the pid now belongs to someone else
+        ++invalidations;
+        Evict(it);
+    }
+
+    ++misses;
+    ProcessIdentity identity;
+    if (!resolver.Resolve(pid, identity)) {
+        return nullptr;
+    }
+
+    if (entries.size() >= capacity) {
+        Sweep();
+    }
+    if (entries.size() >= capacity) {
+        auto oldest = std::min_element(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+            return a.second.lastUsed < b.second.lastUsed;
+        });
+        Evict(oldest);
+    }
+
+    Entry& entry = entries[pid];
+    entry.identity = std::move(identity);
+    entry.lastUsed = clock;
+    return &entry.identity;
+}
+
+void ProcessIdentityCache::Sweep() {
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (resolver.IsSameProcess(it->first, it->second.identity.startTime)) {
+            ++it;
+            continue;
+        }
+        ++invalidations;
+        resolver.Release(it->first);
+        it = entries.erase(it);
+    }
+}
+
+void ProcessIdentityCache::Clear() {
+    for (const auto& entry : entries) {
+        resolver.Release(entry.first);
+    }
+    entries.clear();
+}
+
+void ProcessIdentityCache::Evict(std::unordered_map<uint32_t, Entry>::iterator it) {
+    resolver.Release(it->first);
+    entries.erase(it);
+}
@@ -0,0 +1,50 @@
+#ifndef PROCESS_IDENTITY_CACHE_H
+#define PROCESS_IDENTITY_CACHE_H
+
+#include "ProcessResolver.h"
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+
+// Caches resolved process identities keyed by (pid, start time). A cached
+// entry is reused for as long as the resolver confirms the same process is
+// still running; exited processes and reused pids fall through to Resolve().
+class ProcessIdentityCache {
+public:
+    explicit ProcessIdentityCache(ProcessResolver& resolver, size_t capacity = 64);
+    ~ProcessIdentityCache();
+
+    ProcessIdentityCache(const ProcessIdentityCache&) = delete;
+    ProcessIdentityCache& operator=(const ProcessIdentityCache&) = delete;
+
+    // Returns the identity of pid, or nullptr if it can't be resolved. The
+    // pointer stays valid until the next Lookup(), Sweep() or Clear().
+    const ProcessIdentity* Lookup(uint32_t pid);
+
+    // Drops entries whose process has exited.
+    void Sweep();
+    void Clear();
+
+    size_t Size() const { return entries.size(); }
+    uint64_t Hits() const { return hits; }
+    uint64_t Misses() const { return misses; }
+    uint64_t Invalidations() const { return invalidations; }
+
+private:
+    struct Entry {
+        ProcessIdentity identity;
+        uint64_t lastUsed;
+    };
+
+    void Evict(std::unordered_map<uint32_t, Entry>::iterator it);
+
+    ProcessResolver& resolver;
+    size_t capacity;
+    std::unordered_map<uint32_t, Entry> entries;
+    uint64_t clock = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t invalidations = 0;
+};
+
+#endif
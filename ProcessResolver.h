@@ -0,0 +1,35 @@
+#ifndef PROCESS_RESOLVER_H
+#define PROCESS_RESOLVER_H
+
+#include <cstdint>
+#include <string>
+
+// What the tracker needs to know about a foreground process.
+struct ProcessIdentity {
+    std::string appName;  // Executable file name
+    std::string appPath;  // Full executable path
+    uint64_t startTime;   // Platform-specific creation timestamp, tells reused pids apart
+};
+
+// Looks up process identities from the OS. Resolve() is the expensive call the
+// ProcessIdentityCache tries to avoid; IsSameProcess() must be cheap enough to
+// run every tick.
+class ProcessResolver {
+public:
+    virtual ~ProcessResolver() = default;
+
+    // Queries the executable path and start time of pid. Returns false if the
+    // process is gone or can't be inspected.
+    virtual bool Resolve(uint32_t pid, ProcessIdentity& identity) = 0;
+
+    // True while the process that Resolve() saw as (pid, startTime) is still running.
+    virtual bool IsSameProcess(uint32_t pid, uint64_t startTime) = 0;
+
+    // Called when the cache forgets pid, so per-process resources can be freed.
+    virtual void Release(uint32_t /*pid*/) {}
+};
+
+// "C:\\dir\\app.exe" -> "app.exe"
+std::string AppNameFromPath(const std::string& path);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef RATE_COUNTER_H
+#define RATE_COUNTER_H
+
+#include <chrono>
+#include <cstdint>
+
+// Sums amounts over consecutive one-second windows, e.g. pixels repainted per
+// second. LastSecond() is the total of the most recent completed window.
+class RateCounter {
+public:
+    // Returns true when this call closed a window, i.e. LastSecond() changed.
+    bool Add(uint64_t amount, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) {
+        bool rolled = Roll(now);
+        current += amount;
+        total += amount;
+        return rolled;
+    }
+
+    uint64_t LastSecond() const { return lastSecond; }
+    uint64_t Total() const { return total; }
+
+private:
+    bool Roll(std::chrono::steady_clock::time_point now) {
+        if (!started) {
+            started = true;
+            windowStart = now;
+            return false;
+        }
+        if (now - windowStart < std::chrono::seconds(1)) {
+            return false;
+        }
+        // Spread over the whole gap if nothing was added for a while
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - windowStart).count();
+        lastSecond = current * 1000 / static_cast<uint64_t>(elapsed);
+        current = 0;
+        windowStart = now;
+        return true;
+    }
+
+    bool started = false;
+    std::chrono::steady_clock::time_point windowStart;
+    uint64_t current = 0;
+    uint64_t lastSecond = 0;
+    uint64_t total = 0;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef RENDER_BACKEND_H
+#define RENDER_BACKEND_H
+
+#include "IconCache.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Colours are 0xAARRGGBB with straight (not premultiplied) alpha, the same
+// value Gdiplus::Color takes
+constexpr uint32_t MakeArgb(uint8_t a, uint8_t r, uint8_t g, uint8_t b) {
+    return (static_cast<uint32_t>(a) << 24) | (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | b;
+}
+
+constexpr uint32_t MakeRgb(uint8_t r, uint8_t g, uint8_t b) {
+    return MakeArgb(255, r, g, b);
+}
+
+// Fonts the usage view draws with, sized by the backend for its DPI
+enum class RenderFont {
+    List,     // App names and durations
+    Message,  // The empty-list message
+};
+
+// Size of a laid-out line of text, in pixels
+struct TextExtent {
+    int width = 0;
+    int height = 0;
+};
+
+// Lays out text the way a backend will draw it. Measuring is far more costly
+// than drawing an already converted string, so results are cached per run by
+// TextRunCache rather than recomputed each frame.
+class TextMeasurer {
+public:
+    virtual ~TextMeasurer() = default;
+
+    virtual TextExtent Measure(const wchar_t* text, size_t length, RenderFont font, int dpi) = 0;
+};
+
+// What painting the usage view needs from a renderer. RenderSurface draws
+// with GDI+ on Windows; CpuRasterizer draws into memory anywhere, for
+// benchmarks and golden-image checks. Coordinates are client pixels.
+class RenderBackend {
+public:
+    virtual ~RenderBackend() = default;
+
+    // Limits drawing to a rectangle until ResetClip()
+    virtual void SetClip(int x, int y, int width, int height) = 0;
+    virtual void ResetClip() = 0;
+
+    virtual void FillRect(int x, int y, int width, int height, uint32_t color) = 0;
+    virtual void FillRoundedRect(int x, int y, int width, int height, int radius, uint32_t color) = 0;
+    // Vertical gradient from top to bottom across the rectangle's own height
+    virtual void FillRoundedRectGradient(int x, int y, int width, int height, int radius, uint32_t top, uint32_t bottom) = 0;
+    // Scales the icon to the rectangle
+    virtual void DrawImage(const std::shared_ptr<const IconImage>& image, int x, int y, int width, int height) = 0;
+    // Draws a single line of text with its top-left corner at x, y
+    virtual void DrawTextRun(const wchar_t* text, size_t length, RenderFont font, int x, int y, uint32_t color) = 0;
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include "RenderSurface.h"
+#include <algorithm>
+
+using namespace Gdiplus;
+
+namespace {
+
+// Icon wrappers kept before the cache starts over; matches the icon cache size
+constexpr size_t MAX_ICON_BITMAPS = 256;
+
+} // namespace
+
+RenderSurface::~RenderSurface() {
+    Release();
+}
+
+bool RenderSurface::Prepare(HDC hdc, int newWidth, int newHeight, float newDpiScaleX, float newDpiScaleY) {
+    if (newWidth <= 0 || newHeight <= 0) {
+        return false;
+    }
+
+    if (newDpiScaleX != dpiScaleX || newDpiScaleY != dpiScaleY || !listFont) {
+        dpiScaleX = newDpiScaleX;
+        dpiScaleY = newDpiScaleY;
+        listFont = std::make_unique<Font>(L"Segoe UI", static_cast<REAL>(10 * dpiScaleY));
+        messageFont = std::make_unique<Font>(L"Segoe UI", static_cast<REAL>(12 * dpiScaleY));
+        solidBrush = std::make_unique<SolidBrush>(Color());
+        path = std::make_unique<GraphicsPath>();
+        iconBitmaps.clear(); // Icon sizes follow the DPI
+    }
+
+    if (buffer && newWidth == width && newHeight == height) {
+        return true;
+    }
+
+    ReleaseBuffer();
+    BITMAPINFO info = {};
+    info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    info.bmiHeader.biWidth = newWidth;
+    info.bmiHeader.biHeight = -newHeight; // Top-down, like GDI+ scanlines
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+
+    void* bits = nullptr;
+    dib = CreateDIBSection(hdc, &info, DIB_RGB_COLORS, &bits, NULL, 0);
+    memoryDC = dib ? CreateCompatibleDC(hdc) : NULL;
+    if (!dib || !memoryDC) {
+        ReleaseBuffer();
+        return false;
+    }
+    previousBitmap = SelectObject(memoryDC, dib);
+
+    buffer = std::make_unique<Bitmap>(newWidth, newHeight, newWidth * 4, PixelFormat32bppPARGB, static_cast<BYTE*>(bits));
+    graphics = std::make_unique<Gdiplus::Graphics>(buffer.get());
+    graphics->SetSmoothingMode(SmoothingModeAntiAlias);
+    // Only icons are drawn as images, and the cache keeps them at their final size
+    graphics->SetInterpolationMode(InterpolationModeNearestNeighbor);
+    graphics->SetTextRenderingHint(TextRenderingHintClearTypeGridFit);
+    graphics->SetPixelOffsetMode(PixelOffsetModeHighQuality);
+    graphics->SetCompositingQuality(CompositingQualityHighQuality);
+
+    width = newWidth;
+    height = newHeight;
+    ++recreations;
+    return true;
+}
+
+void RenderSurface::Present(HDC hdc, const RECT& rect) {
+    if (!buffer) {
+        return;
+    }
+    graphics->Flush(FlushIntentionSync);
+    BitBlt(hdc, rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top,
+           memoryDC, rect.left, rect.top, SRCCOPY);
+}
+
+void RenderSurface::Release() {
+    ReleaseBuffer();
+    iconBitmaps.clear();
+    path.reset();
+    listFont.reset();
+    messageFont.reset();
+    solidBrush.reset();
+    for (GradientSlot& slot : gradients) {
+        slot = GradientSlot();
+    }
+    dpiScaleX = 0.0f;
+    dpiScaleY = 0.0f;
+}
+
+void RenderSurface::ReleaseBuffer() {
+    graphics.reset();
+    buffer.reset();
+    if (memoryDC) {
+        SelectObject(memoryDC, previousBitmap);
+        DeleteDC(memoryDC);
+        memoryDC = NULL;
+    }
+    if (dib) {
+        DeleteObject(dib);
+        dib = NULL;
+    }
+    width = 0;
+    height = 0;
+}
+
+void RenderSurface::SetClip(int x, int y, int clipWidth, int clipHeight) {
+    graphics->SetClip(Rect(x, y, clipWidth, clipHeight));
+}
+
+void RenderSurface::ResetClip() {
+    graphics->ResetClip();
+}
+
+void RenderSurface::FillRect(int x, int y, int rectWidth, int rectHeight, uint32_t color) {
+    solidBrush->SetColor(Color(color));
+    graphics->FillRectangle(solidBrush.get(), x, y, rectWidth, rectHeight);
+}
+
+void RenderSurface::FillRoundedRect(int x, int y, int rectWidth, int rectHeight, int radius, uint32_t color) {
+    if (RoundedPath(x, y, rectWidth, rectHeight, radius)) {
+        solidBrush->SetColor(Color(color));
+        graphics->FillPath(solidBrush.get(), path.get());
+    }
+}
+
+void RenderSurface::FillRoundedRectGradient(int x, int y, int rectWidth, int rectHeight, int radius, uint32_t top, uint32_t bottom) {
+    if (RoundedPath(x, y, rectWidth, rectHeight, radius)) {
+        graphics->FillPath(&Gradient(top, bottom, y, rectHeight), path.get());
+    }
+}
+
+void RenderSurface::DrawImage(const std::shared_ptr<const IconImage>& image, int x, int y, int rectWidth, int rectHeight) {
+    graphics->DrawImage(IconBitmap(image), Rect(x, y, rectWidth, rectHeight), 0, 0, image->width, image->height, UnitPixel);
+}
+
+void RenderSurface::DrawTextRun(const wchar_t* text, size_t length, RenderFont font, int x, int y, uint32_t color) {
+    solidBrush->SetColor(Color(color));
+    Font* drawFont = font == RenderFont::Message ? messageFont.get() : listFont.get();
+    graphics->DrawString(text, static_cast<INT>(length), drawFont, PointF(static_cast<REAL>(x), static_cast<REAL>(y)), solidBrush.get());
+}
+
+bool RenderSurface::RoundedPath(int x, int y, int rectWidth, int rectHeight, int radius) {
+    if (rectWidth <= 0 || rectHeight <= 0) {
+        return false;
+    }
+    int diameter = std::min(radius * 2, std::min(rectWidth, rectHeight));
+    path->Reset();
+    if (diameter <= 0) {
+        path->AddRectangle(Rect(x, y, rectWidth, rectHeight));
+        return true;
+    }
+    path->AddArc(x, y, diameter, diameter, 180, 90);
+    path->AddArc(x + rectWidth - diameter, y, diameter, diameter, 270, 90);
+    path->AddArc(x + rectWidth - diameter, y + rectHeight - diameter, diameter, diameter, 0, 90);
+    path->AddArc(x, y + rectHeight - diameter, diameter, diameter, 90, 90);
+    path->CloseFigure();
+    return true;
+}
+
+LinearGradientBrush& RenderSurface::Gradient(uint32_t top, uint32_t bottom, int y, int gradientHeight) {
+    GradientSlot* slot = nullptr;
+    for (GradientSlot& candidate : gradients) {
+        if (candidate.brush && candidate.height == gradientHeight) {
+            slot = &candidate;
+            break;
+        }
+    }
+    if (!slot) {
+        slot = &gradients[nextGradient];
+        nextGradient = (nextGradient + 1) % (sizeof(gradients) / sizeof(gradients[0]));
+        slot->brush = std::make_unique<LinearGradientBrush>(Point(0, 0), Point(0, gradientHeight), Color(top), Color(bottom));
+        slot->height = gradientHeight;
+        slot->top = top;
+        slot->bottom = bottom;
+    } else if (slot->top != top || slot->bottom != bottom) {
+        slot->brush->SetLinearColors(Color(top), Color(bottom));
+        slot->top = top;
+        slot->bottom = bottom;
+    }
+    slot->brush->ResetTransform();
+    slot->brush->TranslateTransform(0.0f, static_cast<REAL>(y));
+    return *slot->brush;
+}
+
+Bitmap* RenderSurface::IconBitmap(const std::shared_ptr<const IconImage>& icon) {
+    auto it = iconBitmaps.find(icon.get());
+    if (it != iconBitmaps.end()) {
+        return it->second.bitmap.get();
+    }
+
+    if (iconBitmaps.size() >= MAX_ICON_BITMAPS) {
+        iconBitmaps.clear();
+    }
+    IconBitmapEntry entry;
+    entry.image = icon;
+    entry.bitmap = std::make_unique<Bitmap>(icon->width, icon->height, icon->width * 4, PixelFormat32bppPARGB,
+                                            reinterpret_cast<BYTE*>(const_cast<uint32_t*>(icon->pixels.data())));
+    Bitmap* bitmap = entry.bitmap.get();
+    iconBitmaps.emplace(icon.get(), std::move(entry));
+    return bitmap;
+}
@@ -0,0 +1,87 @@
+#ifndef RENDER_SURFACE_H
+#define RENDER_SURFACE_H
+
+#include <windows.h>
+#include <gdiplus.h>
+#include <memory>
+#include <unordered_map>
+#include "RenderBackend.h"
+
+// GDI+ RenderBackend over the window's persistent back buffer: a DIB section
+// the size of the client area that GDI+ draws into and BitBlt copies out of.
+// The buffer, fonts, brushes and path are recreated only when the client
+// size or DPI changes; colours are set on the cached brushes per call, so a
+// steady-state frame creates no GDI+ objects and makes no heap allocations.
+//
+// Nothing is created before the first Prepare(), so a global instance is fine
+// as long as Release() runs before GDI+ shuts down.
+class RenderSurface : public RenderBackend {
+public:
+    RenderSurface() = default;
+    ~RenderSurface() override;
+
+    RenderSurface(const RenderSurface&) = delete;
+    RenderSurface& operator=(const RenderSurface&) = delete;
+
+    // Matches the buffer to the client size and DPI. Returns false if it
+    // could not be created.
+    bool Prepare(HDC hdc, int width, int height, float dpiScaleX, float dpiScaleY);
+    // Copies rect from the buffer to the same place on hdc.
+    void Present(HDC hdc, const RECT& rect);
+    // Frees the buffer and everything cached.
+    void Release();
+
+    uint64_t Recreations() const { return recreations; }
+
+    void SetClip(int x, int y, int width, int height) override;
+    void ResetClip() override;
+    void FillRect(int x, int y, int width, int height, uint32_t color) override;
+    void FillRoundedRect(int x, int y, int width, int height, int radius, uint32_t color) override;
+    void FillRoundedRectGradient(int x, int y, int width, int height, int radius, uint32_t top, uint32_t bottom) override;
+    void DrawImage(const std::shared_ptr<const IconImage>& image, int x, int y, int width, int height) override;
+    void DrawTextRun(const wchar_t* text, size_t length, RenderFont font, int x, int y, uint32_t color) override;
+
+private:
+    struct IconBitmapEntry {
+        std::shared_ptr<const IconImage> image;  // Keeps the pixels alive
+        std::unique_ptr<Gdiplus::Bitmap> bitmap;
+    };
+    // Gradient brushes go from (0, 0) to (0, height) and are translated to
+    // where they are used; one is kept per height drawn (bars, scroll thumb)
+    struct GradientSlot {
+        int height = 0;
+        uint32_t top = 0;
+        uint32_t bottom = 0;
+        std::unique_ptr<Gdiplus::LinearGradientBrush> brush;
+    };
+
+    void ReleaseBuffer();
+    // Builds a rounded rectangle into path; returns false if there is nothing to fill
+    bool RoundedPath(int x, int y, int width, int height, int radius);
+    Gdiplus::LinearGradientBrush& Gradient(uint32_t top, uint32_t bottom, int y, int gradientHeight);
+    // A GDI+ bitmap over a cached icon's pixels, made once per icon
+    Gdiplus::Bitmap* IconBitmap(const std::shared_ptr<const IconImage>& icon);
+
+    int width = 0;
+    int height = 0;
+    float dpiScaleX = 0.0f;
+    float dpiScaleY = 0.0f;
+
+    HDC memoryDC = NULL;
+    HBITMAP dib = NULL;
+    HGDIOBJ previousBitmap = NULL;
+    std::unique_ptr<Gdiplus::Bitmap> buffer;
+    std::unique_ptr<Gdiplus::Graphics> graphics;
+    std::unique_ptr<Gdiplus::GraphicsPath> path;
+
+    std::unique_ptr<Gdiplus::Font> listFont;
+    std::unique_ptr<Gdiplus::Font> messageFont;
+    std::unique_ptr<Gdiplus::SolidBrush> solidBrush;
+    GradientSlot gradients[4];
+    size_t nextGradient = 0;
+
+    std::unordered_map<const IconImage*, IconBitmapEntry> iconBitmaps;
+    uint64_t recreations = 0;
+};
+
+#endif
@@ -0,0 +1,265 @@
+#include "RollupStore.h"
+#include <algorithm>
+
+namespace {
+
+const int64_t MINUTE = 60;
+const int64_t HOUR = 60 * MINUTE;
+const int64_t DAY = 24 * HOUR;
+
+int64_t FloorTo(int64_t time, int64_t width) {
+    int64_t remainder = time % width;
+    return remainder < 0 ? time - remainder - width : time - remainder;
+}
+
+int64_t CeilTo(int64_t time, int64_t width) {
+    int64_t floor = FloorTo(time, width);
+    return floor == time ? time : floor + width;
+}
+
+} // namespace
+
+int64_t RollupStore::BucketWidth(Tier tier) {
+    switch (tier) {
+        case MINUTE_TIER:
+            return MINUTE;
+        case HOUR_TIER:
+            return HOUR;
+        default:
+            return DAY;
+    }
+}
+
+int64_t RollupStore::QueryWindow(Tier tier) {
+    switch (tier) {
+        case MINUTE_TIER:
+            return DAY;
+        case HOUR_TIER:
+            return 31 * DAY;
+        default:
+            return INT64_MAX;
+    }
+}
+
+int64_t RollupStore::Retention(Tier tier) {
+    // One coarser bucket of slack beyond the query window
+    switch (tier) {
+        case MINUTE_TIER:
+            return DAY + HOUR;
+        case HOUR_TIER:
+            return 32 * DAY;
+        default:
+            return INT64_MAX;
+    }
+}
+
+void RollupStore::Add(uint32_t appId, int64_t begin, int64_t end) {
+    if (end <= begin) {
+        return;
+    }
+    newest = std::max(newest, end);
+
+    for (int tier = 0; tier < TIER_COUNT; ++tier) {
+        AddToTier(static_cast<Tier>(tier), appId, begin, end);
+        Prune(static_cast<Tier>(tier));
+    }
+}
+
+void RollupStore::Remove(uint32_t appId, int64_t begin, int64_t end) {
+    if (end <= begin) {
+        return;
+    }
+    for (int tier = 0; tier < TIER_COUNT; ++tier) {
+        RemoveFromTier(static_cast<Tier>(tier), appId, begin, end);
+    }
+}
+
+void RollupStore::Clear() {
+    for (auto& tier : tiers) {
+        tier.buckets.clear();
+        tier.firstStart = 0;
+    }
+    newest = INT64_MIN;
+}
+
+void RollupStore::Restore(Tier tier, int64_t start, uint32_t appId, uint32_t seconds) {
+    // Snapshots list a tier bucket by bucket, oldest first, so the entry nearly always goes in the last one
+    TierData& data = tiers[tier];
+    int64_t width = BucketWidth(tier);
+    Bucket* bucket = !data.buckets.empty() && start == data.firstStart + static_cast<int64_t>(data.buckets.size() - 1) * width
+                         ? &data.buckets.back()
+                         : BucketAt(tier, FloorTo(start, width), true);
+    bucket->entries.push_back({ appId, seconds });
+}
+
+int64_t RollupStore::AlignUp(int64_t from) const {
+    if (newest == INT64_MIN) {
+        return from;
+    }
+    if (from >= newest - QueryWindow(MINUTE_TIER)) {
+        return CeilTo(from, MINUTE);
+    }
+    if (from >= newest - QueryWindow(HOUR_TIER)) {
+        return CeilTo(from, HOUR);
+    }
+    return CeilTo(from, DAY);
+}
+
+int64_t RollupStore::AlignDown(int64_t to) const {
+    if (newest == INT64_MIN) {
+        return to;
+    }
+    if (to >= newest - QueryWindow(MINUTE_TIER)) {
+        return FloorTo(to, MINUTE);
+    }
+    if (to >= newest - QueryWindow(HOUR_TIER)) {
+        return FloorTo(to, HOUR);
+    }
+    return FloorTo(to, DAY);
+}
+
+void RollupStore::Accumulate(int64_t from, int64_t to, std::vector<int64_t>& totals) const {
+    if (newest == INT64_MIN) {
+        return;
+    }
+
+    int64_t cursor = from;
+    while (cursor < to) {
+        // Take the coarsest bucket that starts here, fits in the range and is still retained
+        int64_t width = 0;
+        const Bucket* bucket = nullptr;
+        for (int tier = DAY_TIER; tier >= MINUTE_TIER; --tier) {
+            int64_t tierWidth = BucketWidth(static_cast<Tier>(tier));
+            if (FloorTo(cursor, tierWidth) != cursor || cursor + tierWidth > to) {
+                continue;
+            }
+            if (Retention(static_cast<Tier>(tier)) != INT64_MAX
+                && cursor + tierWidth <= newest - Retention(static_cast<Tier>(tier))) {
+                continue;
+            }
+            width = tierWidth;
+            bucket = FindBucket(static_cast<Tier>(tier), cursor);
+            break;
+        }
+
+        if (width == 0) {
+            // Unaligned range; skip a minute rather than loop forever
+            width = MINUTE;
+        }
+
+        if (bucket) {
+            for (const Entry& entry : bucket->entries) {
+                if (entry.appId >= totals.size()) {
+                    totals.resize(entry.appId + 1, 0);
+                }
+                totals[entry.appId] += entry.seconds;
+            }
+        }
+        cursor += width;
+    }
+}
+
+void RollupStore::AddToTier(Tier tier, uint32_t appId, int64_t begin, int64_t end) {
+    int64_t width = BucketWidth(tier);
+    int64_t start = FloorTo(begin, width);
+
+    // Skip the part of the span that this tier no longer retains
+    if (Retention(tier) != INT64_MAX) {
+        start = std::max(start, FloorTo(newest - Retention(tier), width));
+    }
+
+    for (; start < end; start += width) {
+        int64_t overlap = std::min(end, start + width) - std::max(begin, start);
+        if (overlap <= 0) {
+            continue;
+        }
+
+        Bucket* bucket = BucketAt(tier, start, true);
+        if (bucket->lastEntry < bucket->entries.size() && bucket->entries[bucket->lastEntry].appId == appId) {
+            bucket->entries[bucket->lastEntry].seconds += static_cast<uint32_t>(overlap);
+            continue;
+        }
+
+        auto it = std::find_if(bucket->entries.begin(), bucket->entries.end(),
+                               [appId](const Entry& entry) { return entry.appId == appId; });
+        if (it == bucket->entries.end()) {
+            bucket->entries.push_back({ appId, static_cast<uint32_t>(overlap) });
+            bucket->lastEntry = static_cast<uint32_t>(bucket->entries.size() - 1);
+        } else {
+            it->seconds += static_cast<uint32_t>(overlap);
+            bucket->lastEntry = static_cast<uint32_t>(it - bucket->entries.begin());
+        }
+    }
+}
+
+void RollupStore::RemoveFromTier(Tier tier, uint32_t appId, int64_t begin, int64_t end) {
+    int64_t width = BucketWidth(tier);
+    for (int64_t start = FloorTo(begin, width); start < end; start += width) {
+        int64_t overlap = std::min(end, start + width) - std::max(begin, start);
+        Bucket* bucket = BucketAt(tier, start, false);
+        if (!bucket || overlap <= 0) {
+            continue;
+        }
+        // The entry stays, at zero if need be, so lastEntry keeps pointing at it
+        for (Entry& entry : bucket->entries) {
+            if (entry.appId == appId) {
+                entry.seconds -= std::min(entry.seconds, static_cast<uint32_t>(overlap));
+                break;
+            }
+        }
+    }
+}
+
+RollupStore::Bucket* RollupStore::BucketAt(Tier tier, int64_t start, bool create) {
+    TierData& data = tiers[tier];
+    int64_t width = BucketWidth(tier);
+
+    if (data.buckets.empty()) {
+        if (!create) {
+            return nullptr;
+        }
+        data.firstStart = start;
+        data.buckets.emplace_back();
+        return &data.buckets.back();
+    }
+
+    if (start < data.firstStart) {
+        if (!create) {
+            return nullptr;
+        }
+        size_t missing = static_cast<size_t>((data.firstStart - start) / width);
+        data.buckets.insert(data.buckets.begin(), missing, Bucket());
+        data.firstStart = start;
+    }
+
+    size_t index = static_cast<size_t>((start - data.firstStart) / width);
+    if (index >= data.buckets.size()) {
+        if (!create) {
+            return nullptr;
+        }
+        data.buckets.resize(index + 1);
+    }
+    return &data.buckets[index];
+}
+
+const RollupStore::Bucket* RollupStore::FindBucket(Tier tier, int64_t start) const {
+    const TierData& data = tiers[tier];
+    if (data.buckets.empty() || start < data.firstStart) {
+        return nullptr;
+    }
+    size_t index = static_cast<size_t>((start - data.firstStart) / BucketWidth(tier));
+    return index < data.buckets.size() ? &data.buckets[index] : nullptr;
+}
+
+void RollupStore::Prune(Tier tier) {
+    if (Retention(tier) == INT64_MAX) {
+        return;
+    }
+    TierData& data = tiers[tier];
+    int64_t width = BucketWidth(tier);
+    int64_t cutoff = newest - Retention(tier);
+    while (!data.buckets.empty() && data.firstStart + width <= cutoff) {
+        data.buckets.pop_front();
+        data.firstStart += width;
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef ROLLUP_STORE_H
+#define ROLLUP_STORE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+// Pre-aggregated focus time per app in fixed time buckets. Three tiers are
+// kept side by side: per-minute buckets for the last day, hourly buckets for
+// the last month and daily buckets for all history. Range queries walk the
+// coarsest buckets that fit, so their cost is O(buckets x apps in range).
+class RollupStore {
+public:
+    enum Tier { MINUTE_TIER, HOUR_TIER, DAY_TIER, TIER_COUNT };
+
+    struct Entry {
+        uint32_t appId;
+        uint32_t seconds;
+    };
+
+    // Adds the span [begin, end) of focus on appId to every tier.
+    void Add(uint32_t appId, int64_t begin, int64_t end);
+    // Takes back a span Add() was given, e.g. an idle tail found after the fact.
+    // Buckets already pruned from a tier are left alone.
+    void Remove(uint32_t appId, int64_t begin, int64_t end);
+    void Clear();
+
+    // Puts back one saved entry verbatim (snapshot loading); each (bucket, app)
+    // pair must be restored at most once. Call RestoreNewest once afterwards.
+    void Restore(Tier tier, int64_t start, uint32_t appId, uint32_t seconds);
+    void RestoreNewest(int64_t time) { newest = time; }
+    int64_t Newest() const { return newest; }
+
+    // Calls fn(bucketStart, entry) for every entry of a tier, oldest bucket first.
+    template <typename Fn>
+    void ForEachEntry(Tier tier, Fn fn) const {
+        int64_t start = tiers[tier].firstStart;
+        for (const Bucket& bucket : tiers[tier].buckets) {
+            for (const Entry& entry : bucket.entries) {
+                fn(start, entry);
+            }
+            start += BucketWidth(tier);
+        }
+    }
+
+    // Range endpoints snapped to the finest bucket boundary still retained at that time.
+    // [AlignUp(from), AlignDown(to)) can be answered entirely from rollups.
+    int64_t AlignUp(int64_t from) const;
+    int64_t AlignDown(int64_t to) const;
+
+    // Adds per-app seconds within [from, to) to totals (indexed by app id).
+    // Both ends must be aligned with AlignUp/AlignDown.
+    void Accumulate(int64_t from, int64_t to, std::vector<int64_t>& totals) const;
+
+    size_t BucketCount(Tier tier) const { return tiers[tier].buckets.size(); }
+
+    static int64_t BucketWidth(Tier tier);
+
+private:
+    struct Bucket {
+        std::vector<Entry> entries;
+        uint32_t lastEntry = 0;  // Most recently updated entry, usually the current app
+    };
+
+    struct TierData {
+        int64_t firstStart = 0;  // Start time of buckets.front()
+        std::deque<Bucket> buckets;
+    };
+
+    // How far back each tier is guaranteed to be queryable, relative to the newest data
+    static int64_t QueryWindow(Tier tier);
+    // How far back each tier keeps buckets; a little longer than QueryWindow so
+    // that aligned ranges never step onto a pruned bucket
+    static int64_t Retention(Tier tier);
+
+    void AddToTier(Tier tier, uint32_t appId, int64_t begin, int64_t end);
+    void RemoveFromTier(Tier tier, uint32_t appId, int64_t begin, int64_t end);
+    Bucket* BucketAt(Tier tier, int64_t start, bool create);
+    const Bucket* FindBucket(Tier tier, int64_t start) const;
+    void Prune(Tier tier);
+
+    TierData tiers[TIER_COUNT];
+    int64_t newest = INT64_MIN;  // Latest time any span reached
+};
+
+#endif
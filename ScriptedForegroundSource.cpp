@@ -0,0 +1,84 @@
+#include "ScriptedForegroundSource.h"
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+ScriptedForegroundSource::ScriptedForegroundSource(std::vector<Step> steps)
+        : steps(std::move(steps)) {
+}
+
+void ScriptedForegroundSource::AddStep(const std::string& appName, const std::string& appPath, size_t samples,
+                                       const std::string& windowTitle) {
+    if (samples == 0) {
+        return;
+    }
+    // Merge with the previous step if the window didn't change
+    if (!steps.empty() && steps.back().appName == appName && steps.back().appPath == appPath &&
+        steps.back().windowTitle == windowTitle) {
+        steps.back().samples += samples;
+        return;
+    }
+    steps.push_back({ appName, appPath, samples, windowTitle });
+}
+
+bool ScriptedForegroundSource::LoadTrace(const std::string& filename) {
+    std::ifstream file(filename, std::ios::in);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open trace file " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        size_t first = line.find('|');
+        size_t second = first == std::string::npos ? std::string::npos : line.find('|', first + 1);
+        if (second == std::string::npos) {
+            continue; // Skip malformed lines
+        }
+
+        size_t samples = 0;
+        try {
+            samples = std::stoul(line.substr(0, first));
+        } catch (const std::exception&) {
+            continue;
+        }
+        // Paths can't hold '|', so a third one starts the optional title
+        size_t third = line.find('|', second + 1);
+        std::string title = third == std::string::npos ? std::string() : line.substr(third + 1);
+        AddStep(line.substr(first + 1, second - first - 1), line.substr(second + 1, third - second - 1), samples, title);
+    }
+    return true;
+}
+
+bool ScriptedForegroundSource::Sample(ForegroundSample& sample) {
+    if (Finished()) {
+        return false;
+    }
+
+    const Step& step = steps[stepIndex];
+    if (++samplesTaken >= step.samples) {
+        ++stepIndex;
+        samplesTaken = 0;
+    }
+
+    if (step.appName.empty()) {
+        return false;
+    }
+    sample.appName = step.appName;
+    sample.appPath = step.appPath;
+    sample.windowTitle = step.windowTitle;
+    return true;
+}
+
+bool ScriptedForegroundSource::Finished() const {
+    return stepIndex >= steps.size();
+}
+
+void ScriptedForegroundSource::Rewind() {
+    stepIndex = 0;
+    samplesTaken = 0;
+}
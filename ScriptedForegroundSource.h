@@ -0,0 +1,41 @@
+#ifndef SCRIPTED_FOREGROUND_SOURCE_H
+#define SCRIPTED_FOREGROUND_SOURCE_H
+
+#include "ForegroundSource.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Replays a fixed sequence of foreground apps, one sample per Sample() call.
+// Used to drive the tracking engine without a live desktop.
+class ScriptedForegroundSource : public ForegroundSource {
+public:
+    struct Step {
+        std::string appName;  // Empty name means "no foreground window"
+        std::string appPath;
+        size_t samples;       // How many consecutive samples return this app
+        std::string windowTitle;
+    };
+
+    ScriptedForegroundSource() = default;
+    explicit ScriptedForegroundSource(std::vector<Step> steps);
+
+    void AddStep(const std::string& appName, const std::string& appPath, size_t samples, const std::string& windowTitle = "");
+
+    // Loads a trace with one "samples|appName|appPath[|windowTitle]" step per line. Lines starting with '#' are ignored.
+    bool LoadTrace(const std::string& filename);
+
+    bool Sample(ForegroundSample& sample) override;
+
+    bool Finished() const;
+    void Rewind();
+
+    const std::vector<Step>& Steps() const { return steps; }
+
+private:
+    std::vector<Step> steps;
+    size_t stepIndex = 0;
+    size_t samplesTaken = 0;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#include "ScriptedInputSource.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+void ScriptedInputSource::AddInput(std::chrono::seconds offset) {
+    sorted = sorted && (inputs.empty() || inputs.back() <= offset);
+    inputs.push_back(offset);
+}
+
+void ScriptedInputSource::AddActivity(std::chrono::seconds offset, std::chrono::seconds duration, std::chrono::seconds every) {
+    for (std::chrono::seconds t(0); t < duration; t += std::max(every, std::chrono::seconds(1))) {
+        AddInput(offset + t);
+    }
+}
+
+bool ScriptedInputSource::LoadTrace(const std::string& filename) {
+    std::ifstream file(filename, std::ios::in);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open input trace " << filename << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        try {
+            AddInput(std::chrono::seconds(std::stoll(line)));
+        } catch (const std::exception&) {
+            continue; // Skip malformed lines
+        }
+    }
+    return true;
+}
+
+bool ScriptedInputSource::LastInput(std::chrono::system_clock::time_point now, std::chrono::system_clock::time_point& lastInput) {
+    if (!sorted) {
+        std::sort(inputs.begin(), inputs.end());
+        sorted = true;
+        next = 0;
+    }
+    auto offset = std::chrono::duration_cast<std::chrono::seconds>(now - start);
+    if (next > 0 && inputs[next - 1] > offset) {
+        next = 0;  // Went back in time
+    }
+    while (next < inputs.size() && inputs[next] <= offset) {
+        ++next;
+    }
+    if (next == 0) {
+        return false;
+    }
+    lastInput = start + inputs[next - 1];
+    return true;
+}
@@ -0,0 +1,34 @@
+#ifndef SCRIPTED_INPUT_SOURCE_H
+#define SCRIPTED_INPUT_SOURCE_H
+
+#include "InputActivitySource.h"
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Replays recorded input times, as offsets from a start time. Queries are
+// expected to move forward in time, as a tracker's clock does, and cost
+// amortized O(1); an earlier query rescans from the start.
+class ScriptedInputSource : public InputActivitySource {
+public:
+    explicit ScriptedInputSource(std::chrono::system_clock::time_point start) : start(start) {}
+
+    // Inputs may be added in any order before the first query.
+    void AddInput(std::chrono::seconds offset);
+    // One input every "every" over [offset, offset + duration), e.g. typing
+    void AddActivity(std::chrono::seconds offset, std::chrono::seconds duration, std::chrono::seconds every);
+
+    // Loads a trace with one input offset in whole seconds per line. Lines starting with '#' are ignored.
+    bool LoadTrace(const std::string& filename);
+
+    bool LastInput(std::chrono::system_clock::time_point now, std::chrono::system_clock::time_point& lastInput) override;
+
+private:
+    std::chrono::system_clock::time_point start;
+    std::vector<std::chrono::seconds> inputs;
+    bool sorted = true;
+    size_t next = 0;  // First input after the previous query
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include "SessionSketch.h"
+#include <algorithm>
+
+namespace {
+
+int64_t FloorTo(int64_t time, int64_t width) {
+    int64_t remainder = time % width;
+    return remainder < 0 ? time - remainder - width : time - remainder;
+}
+
+int HighestBit(uint32_t value) {
+    int bit = 0;
+    while (value >>= 1) {
+        ++bit;
+    }
+    return bit;
+}
+
+} // namespace
+
+size_t SessionSketch::Bucket(uint32_t seconds) {
+    if (seconds < 8) {
+        return seconds;
+    }
+    int exponent = HighestBit(seconds);
+    size_t sub = (seconds >> (exponent - 3)) & 7;
+    return 8 + static_cast<size_t>(exponent - 3) * 8 + sub;
+}
+
+uint32_t SessionSketch::BucketLow(size_t bucket) {
+    if (bucket < 8) {
+        return static_cast<uint32_t>(bucket);
+    }
+    int exponent = static_cast<int>((bucket - 8) / 8) + 3;
+    uint32_t sub = static_cast<uint32_t>((bucket - 8) % 8);
+    return (8 + sub) << (exponent - 3);
+}
+
+uint32_t SessionSketch::BucketHigh(size_t bucket) {
+    return bucket + 1 < BUCKETS ? BucketLow(bucket + 1) - 1 : UINT32_MAX;
+}
+
+void SessionSketch::AddBucket(size_t bucket, uint32_t added) {
+    counts[bucket] += added;
+    count += added;
+}
+
+void SessionSketch::Merge(const SessionSketch& other) {
+    for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+        counts[bucket] += other.counts[bucket];
+    }
+    count += other.count;
+}
+
+void SessionSketch::Clear() {
+    std::fill(std::begin(counts), std::end(counts), 0);
+    count = 0;
+}
+
+std::chrono::seconds SessionSketch::Quantile(double q) const {
+    if (count == 0) {
+        return std::chrono::seconds(0);
+    }
+    // The rank-th shortest session, 1-based
+    uint64_t rank = static_cast<uint64_t>(std::max(1.0, std::min(1.0, q) * static_cast<double>(count) + 0.5));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            return std::chrono::seconds(BucketLow(bucket) + (static_cast<int64_t>(BucketHigh(bucket)) - BucketLow(bucket)) / 2);
+        }
+    }
+    return std::chrono::seconds(BucketHigh(BUCKETS - 1));
+}
+
+void SessionDistributions::Add(uint32_t appId, int64_t begin, uint32_t length) {
+    size_t bucket = SessionSketch::Bucket(length);
+    AddAt(begin, appId, bucket, 1);
+    if (allTime.size() <= appId) {
+        allTime.resize(appId + 1);
+    }
+    allTime[appId].AddBucket(bucket, 1);
+}
+
+void SessionDistributions::Clear() {
+    entries.clear();
+    spans.clear();
+    allTime.clear();
+}
+
+void SessionDistributions::Query(uint32_t appId, int64_t from, int64_t to, SessionSketch& out) const {
+    if (from >= to) {
+        return;
+    }
+    auto span = std::partition_point(spans.begin(), spans.end(), [from](const Span& s) { return s.start + s.width <= from; });
+    for (; span != spans.end() && span->start < to; ++span) {
+        auto last = entries.begin() + static_cast<ptrdiff_t>(SpanEnd(static_cast<size_t>(span - spans.begin())));
+        auto entry = std::lower_bound(entries.begin() + static_cast<ptrdiff_t>(span->first), last, EntryKey(appId, 0));
+        for (; entry != last && EntryApp(*entry) == appId; ++entry) {
+            out.AddBucket(EntryBucket(*entry), EntryCount(*entry));
+        }
+    }
+}
+
+const SessionSketch* SessionDistributions::AllTime(uint32_t appId) const {
+    return appId < allTime.size() && allTime[appId].Count() > 0 ? &allTime[appId] : nullptr;
+}
+
+void SessionDistributions::RestoreSpan(int64_t start, int64_t width, const uint64_t* spanEntries, size_t count) {
+    if (!spans.empty() && spans.back().start + spans.back().width > start) {
+        for (size_t index = 0; index < count; ++index) {
+            Restore(start, EntryApp(spanEntries[index]), EntryBucket(spanEntries[index]), EntryCount(spanEntries[index]));
+        }
+        return;
+    }
+    if (count == 0) {
+        return;
+    }
+    spans.push_back(Span{ start, width, entries.size() });
+    entries.insert(entries.end(), spanEntries, spanEntries + count);
+    for (size_t index = 0; index < count; ++index) {
+        uint32_t appId = EntryApp(spanEntries[index]);
+        if (allTime.size() <= appId) {
+            allTime.resize(appId + 1);
+        }
+        allTime[appId].AddBucket(EntryBucket(spanEntries[index]), EntryCount(spanEntries[index]));
+    }
+}
+
+void SessionDistributions::Restore(int64_t time, uint32_t appId, size_t bucket, uint32_t count) {
+    if (bucket >= SessionSketch::BUCKETS || count == 0) {
+        return;
+    }
+    AddAt(time, appId, bucket, count);
+    if (allTime.size() <= appId) {
+        allTime.resize(appId + 1);
+    }
+    allTime[appId].AddBucket(bucket, count);
+}
+
+void SessionDistributions::AddAt(int64_t time, uint32_t appId, size_t bucket, uint32_t count) {
+    uint64_t key = EntryKey(appId, bucket);
+    count = std::min(count, MAX_ENTRY_COUNT);
+    // Sessions close in time order, so the span is nearly always the last one
+    if (spans.empty() || spans.back().start + spans.back().width <= time) {
+        spans.push_back(Span{ FloorTo(time, DAY), DAY, entries.size() });
+        entries.push_back(key | count);
+        FoldOldDays();
+        return;
+    }
+    if (spans.back().start <= time && (entries.size() == spans.back().first || entries.back() < key)) {
+        entries.push_back(key | count);
+        return;
+    }
+
+    // Days never straddle a month, so a time no span holds gets a day of its own
+    auto span = std::partition_point(spans.begin(), spans.end(), [time](const Span& s) { return s.start + s.width <= time; });
+    size_t spanIndex = static_cast<size_t>(span - spans.begin());
+    bool added = span->start > time;
+    if (added) {
+        span = spans.insert(span, Span{ FloorTo(time, DAY), DAY, span->first });
+    }
+    auto first = entries.begin() + static_cast<ptrdiff_t>(span->first);
+    auto last = entries.begin() + static_cast<ptrdiff_t>(SpanEnd(spanIndex));
+    auto entry = std::lower_bound(first, last, key);
+    // A day holds at most 86400 sessions and a month 30 times that, so counts stay inside an entry
+    if (entry != last && (*entry & ~uint64_t(MAX_ENTRY_COUNT)) == key) {
+        *entry = key | std::min<uint32_t>(EntryCount(*entry) + count, MAX_ENTRY_COUNT);
+        return;
+    }
+    entries.insert(entry, key | count);
+    for (size_t later = spanIndex + 1; later < spans.size(); ++later) {
+        ++spans[later].first;
+    }
+    if (added) {
+        FoldOldDays();
+    }
+}
+
+void SessionDistributions::FoldOldDays() {
+    int64_t cutoff = spans.back().start - DAY_WINDOW;
+    std::vector<uint64_t> merged;
+    for (size_t span = 0; span < spans.size(); ++span) {
+        int64_t month = FloorTo(spans[span].start, MONTH);
+        if (spans[span].width != DAY || month + MONTH > cutoff) {
+            continue;
+        }
+        size_t last = span;
+        while (last + 1 < spans.size() && spans[last + 1].width == DAY && spans[last + 1].start < month + MONTH) {
+            ++last;
+        }
+
+        // Sum the days' entries into one sorted run in place of theirs
+        size_t begin = spans[span].first;
+        size_t end = SpanEnd(last);
+        merged.assign(entries.begin() + static_cast<ptrdiff_t>(begin), entries.begin() + static_cast<ptrdiff_t>(end));
+        std::sort(merged.begin(), merged.end());
+        size_t kept = 0;
+        for (uint64_t entry : merged) {
+            if (kept > 0 && (merged[kept - 1] & ~uint64_t(MAX_ENTRY_COUNT)) == (entry & ~uint64_t(MAX_ENTRY_COUNT))) {
+                uint32_t sum = std::min<uint32_t>(EntryCount(merged[kept - 1]) + EntryCount(entry), MAX_ENTRY_COUNT);
+                merged[kept - 1] = (entry & ~uint64_t(MAX_ENTRY_COUNT)) | sum;
+            } else {
+                merged[kept++] = entry;
+            }
+        }
+        std::copy(merged.begin(), merged.begin() + static_cast<ptrdiff_t>(kept), entries.begin() + static_cast<ptrdiff_t>(begin));
+        entries.erase(entries.begin() + static_cast<ptrdiff_t>(begin + kept), entries.begin() + static_cast<ptrdiff_t>(end));
+
+        spans[span] = Span{ month, MONTH, begin };
+        spans.erase(spans.begin() + static_cast<ptrdiff_t>(span) + 1, spans.begin() + static_cast<ptrdiff_t>(last) + 1);
+        for (size_t later = span + 1; later < spans.size(); ++later) {
+            spans[later].first -= end - begin - kept;
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef SESSION_SKETCH_H
+#define SESSION_SKETCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Histogram of session lengths in log buckets: exact below 8 s, then 8
+// buckets per doubling, so a quantile read back is within 1/16 of the true
+// length. Sketches merge by adding counts, which is what lets a range of
+// days be answered from per-day sketches.
+class SessionSketch {
+public:
+    static constexpr size_t BUCKETS = 8 + 29 * 8;  // Up to 2^32 s
+
+    static size_t Bucket(uint32_t seconds);
+    // Range of lengths a bucket holds, [low, high]
+    static uint32_t BucketLow(size_t bucket);
+    static uint32_t BucketHigh(size_t bucket);
+
+    void Add(uint32_t seconds) { AddBucket(Bucket(seconds), 1); }
+    void AddBucket(size_t bucket, uint32_t count);
+    void Merge(const SessionSketch& other);
+    void Clear();
+
+    uint64_t Count() const { return count; }
+    // Length that a fraction q of sessions are at most, e.g. 0.9 for p90;
+    // the middle of its bucket. Zero for an empty sketch.
+    std::chrono::seconds Quantile(double q) const;
+
+private:
+    uint32_t counts[BUCKETS] = {};
+    uint64_t count = 0;
+};
+
+// Per-app session sketches over time, plus one per app over all of it.
+// Like the rollups, recent history is kept finer: a sketch per UTC day for
+// the last DAY_WINDOW, then one per 30-day month, so years of heavy
+// switching stay small. Spans are kept sparse, as (app, bucket, count)
+// entries, since an app rarely has sessions in more than a handful of
+// buckets a span.
+class SessionDistributions {
+public:
+    static constexpr int64_t DAY = 24 * 3600;
+    static constexpr int64_t MONTH = 30 * DAY;        // Counted from the Unix epoch
+    static constexpr int64_t DAY_WINDOW = 31 * DAY;   // Behind the newest day, days fold into months
+
+    // A finished session, counted in the span it began in
+    void Add(uint32_t appId, int64_t begin, uint32_t length);
+    void Clear();
+
+    // Adds the sessions of appId that began in the spans [from, to) touches to
+    // out: exact to the day over the last DAY_WINDOW, to the month before it
+    void Query(uint32_t appId, int64_t from, int64_t to, SessionSketch& out) const;
+    // Every session of appId; nullptr if it has none
+    const SessionSketch* AllTime(uint32_t appId) const;
+
+    // Verbatim save and restore for the binary snapshot. A span's entries
+    // pack app id, bucket and count into 64 bits, sorted, so they order by
+    // app then bucket.
+    static uint64_t PackEntry(uint32_t appId, size_t bucket, uint32_t count) { return EntryKey(appId, bucket) | count; }
+    static uint32_t EntryApp(uint64_t entry) { return static_cast<uint32_t>(entry >> 32); }
+    static size_t EntryBucket(uint64_t entry) { return static_cast<size_t>((entry >> 24) & 0xFF); }
+    static uint32_t EntryCount(uint64_t entry) { return static_cast<uint32_t>(entry & MAX_ENTRY_COUNT); }
+    static constexpr uint32_t MAX_ENTRY_COUNT = 0xFFFFFF;
+
+    // fn(start, width, entries, count) for each span, oldest first; width is DAY or MONTH
+    template <typename Fn>
+    void ForEachSpan(Fn fn) const {
+        for (size_t span = 0; span < spans.size(); ++span) {
+            fn(spans[span].start, spans[span].width, entries.data() + spans[span].first, SpanEnd(span) - spans[span].first);
+        }
+    }
+    size_t SpanCount() const { return spans.size(); }
+    size_t EntryCount() const { return entries.size(); }
+    void Reserve(size_t entryCount) { entries.reserve(entryCount); }
+    // A span of sorted packed entries, as ForEachSpan() gave it. Copied as a
+    // block when it comes after every span held; merged entry by entry otherwise.
+    void RestoreSpan(int64_t start, int64_t width, const uint64_t* spanEntries, size_t count);
+    // One entry, into the span holding time, in any order; restoring one that exists adds to it
+    void Restore(int64_t time, uint32_t appId, size_t bucket, uint32_t count);
+
+private:
+    static uint64_t EntryKey(uint32_t appId, size_t bucket) { return (uint64_t(appId) << 32) | (uint64_t(bucket) << 24); }
+
+    struct Span {
+        int64_t start;
+        int64_t width;
+        size_t first;  // Index of the span's first entry
+    };
+    size_t SpanEnd(size_t span) const { return span + 1 < spans.size() ? spans[span + 1].first : entries.size(); }
+    void AddAt(int64_t time, uint32_t appId, size_t bucket, uint32_t count);
+    // Merges the days of every month that has fallen entirely behind DAY_WINDOW
+    void FoldOldDays();
+
+    // All spans' entries back to back, so a snapshot's spans restore as one block each
+    std::vector<uint64_t> entries;
+    std::vector<Span> spans;  // By start, never overlapping
+    std::vector<SessionSketch> allTime;  // By app id, grown as apps get sessions
+};
+
+#endif
@@ -0,0 +1,392 @@
+#include "SnapshotFile.h"
+#include "FileUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = { 'S', 'T', 'T', 'S', 'N', 'A', 'P', '\0' };
+
+uint64_t AlignTo8(uint64_t offset) {
+    return (offset + 7) & ~uint64_t(7);
+}
+
+// True if [offset, offset + count * recordSize) lies inside a file of fileSize bytes
+bool SectionFits(uint64_t offset, uint64_t count, uint64_t recordSize, uint64_t fileSize) {
+    if (offset % 8 != 0 || offset > fileSize) {
+        return false;
+    }
+    return count <= (fileSize - offset) / recordSize;
+}
+
+// Restores the focus section and session sketches; what an older file lacks
+// is rebuilt from its intervals
+void RestoreFocus(TrackingEngine& engine, const SnapshotView& view, const std::vector<uint32_t>& appIdMap) {
+    const SnapshotFocus* focus = view.Focus();
+    const SnapshotSessionSpan* spans = view.SessionSpans();
+    FocusAnalytics rebuilt;
+    if (!focus || !spans) {
+        for (size_t index = 0; index < view.IntervalCount(); ++index) {
+            FocusInterval interval = view.Intervals()[index];
+            interval.appId = appIdMap[interval.appId];
+            rebuilt.Add(interval);
+        }
+    }
+
+    FocusAnalytics::State state = rebuilt.Saved();
+    std::vector<AppFocus> apps(engine.AppCount());
+    if (focus) {
+        state.finished.switches = focus->switches;
+        state.finished.sessions = focus->sessions;
+        state.finished.seconds = focus->seconds;
+        state.finished.longest = focus->longest;
+        state.finished.longestAppId = focus->longestAppId == UINT32_MAX ? UINT32_MAX : appIdMap[focus->longestAppId];
+        std::copy(std::begin(focus->lengths), std::end(focus->lengths), state.finished.lengths);
+        state.run = focus->run;
+        state.hasRun = focus->hasRun != 0;
+        if (state.hasRun) {
+            state.run.appId = appIdMap[focus->run.appId];
+        }
+        std::copy(std::begin(focus->switchMinutes), std::end(focus->switchMinutes), state.switchMinutes);
+        std::copy(std::begin(focus->switchCounts), std::end(focus->switchCounts), state.switchCounts);
+        const SnapshotAppFocus* saved = view.AppFocus();
+        for (size_t index = 0; index < view.AppCount(); ++index) {
+            AppFocus& app = apps[appIdMap[index]];
+            app.sessions = saved[index].sessions;
+            app.seconds = saved[index].seconds;
+            app.longest = saved[index].longest;
+            app.longestBegin = saved[index].longestBegin;
+        }
+    } else {
+        for (uint32_t appId = 0; appId < apps.size(); ++appId) {
+            apps[appId] = rebuilt.Finished(appId);
+        }
+    }
+
+    SessionDistributions sessions;
+    if (spans) {
+        // Into an empty engine app ids come back unchanged, so spans copy as blocks
+        bool sameIds = true;
+        for (size_t index = 0; index < appIdMap.size() && sameIds; ++index) {
+            sameIds = appIdMap[index] == index;
+        }
+        sessions.Reserve(view.SessionEntryCount());
+        const uint64_t* entries = view.SessionEntries();
+        for (size_t span = 0; span < view.SessionSpanCount(); ++span) {
+            size_t count = spans[span].entryCount;
+            if (sameIds) {
+                sessions.RestoreSpan(spans[span].start, spans[span].days * SessionDistributions::DAY, entries, count);
+            } else {
+                for (size_t index = 0; index < count; ++index) {
+                    sessions.Restore(spans[span].start, appIdMap[SessionDistributions::EntryApp(entries[index])],
+                                     SessionDistributions::EntryBucket(entries[index]), SessionDistributions::EntryCount(entries[index]));
+                }
+            }
+            entries += count;
+        }
+    } else {
+        sessions = rebuilt.Sessions();
+    }
+    engine.RestoreFocus(state, std::move(apps), std::move(sessions));
+}
+
+} // namespace
+
+bool SnapshotView::Open(const std::string& filename) {
+    Close();
+    if (!file.Open(filename) || file.Size() < SnapshotHeaderSize(SNAPSHOT_OLDEST_VERSION)) {
+        file.Close();
+        return false;
+    }
+
+    const SnapshotHeader* candidate = reinterpret_cast<const SnapshotHeader*>(file.Data());
+    uint64_t fileSize = file.Size();
+    bool valid = std::memcmp(candidate->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0
+                 && candidate->version >= SNAPSHOT_OLDEST_VERSION && candidate->version <= SNAPSHOT_VERSION
+                 && candidate->headerSize == SnapshotHeaderSize(candidate->version)
+                 && fileSize >= candidate->headerSize
+                 && candidate->stringsOffset <= fileSize
+                 && candidate->stringsSize <= fileSize - candidate->stringsOffset
+                 && candidate->appCount < AppTable::NO_APP
+                 && SectionFits(candidate->appsOffset, candidate->appCount, sizeof(SnapshotApp), fileSize)
+                 && SectionFits(candidate->intervalsOffset, candidate->intervalCount, sizeof(FocusInterval), fileSize);
+
+    uint64_t rollupCount = 0;
+    for (int tier = 0; tier < RollupStore::TIER_COUNT && valid; ++tier) {
+        valid = candidate->rollupCounts[tier] <= fileSize / sizeof(SnapshotRollup);
+        rollupCount += candidate->rollupCounts[tier];
+    }
+    valid = valid && SectionFits(candidate->rollupsOffset, rollupCount, sizeof(SnapshotRollup), fileSize);
+    if (valid && candidate->version >= 3) {
+        valid = SectionFits(candidate->focusOffset, 1, sizeof(SnapshotFocus), fileSize)
+                && SectionFits(candidate->focusOffset + sizeof(SnapshotFocus), candidate->appCount, sizeof(SnapshotAppFocus), fileSize);
+    }
+    if (valid && candidate->version >= 4) {
+        valid = SectionFits(candidate->sessionSpansOffset, candidate->sessionSpanCount, sizeof(SnapshotSessionSpan), fileSize)
+                && SectionFits(candidate->sessionsOffset, candidate->sessionEntryCount, sizeof(uint64_t), fileSize);
+    }
+
+    if (!valid) {
+        file.Close();
+        return false;
+    }
+    header = candidate;
+    return true;
+}
+
+std::string_view SnapshotView::AppName(size_t index) const {
+    const SnapshotApp& app = App(index);
+    return std::string_view(Section<char>(header->stringsOffset) + app.nameOffset, app.nameLength);
+}
+
+std::string_view SnapshotView::AppPath(size_t index) const {
+    const SnapshotApp& app = App(index);
+    return std::string_view(Section<char>(header->stringsOffset) + app.pathOffset, app.pathLength);
+}
+
+const SnapshotRollup* SnapshotView::Rollups(RollupStore::Tier tier) const {
+    uint64_t offset = header->rollupsOffset;
+    for (int previous = 0; previous < tier; ++previous) {
+        offset += header->rollupCounts[previous] * sizeof(SnapshotRollup);
+    }
+    return Section<SnapshotRollup>(offset);
+}
+
+const SnapshotFocus* SnapshotView::Focus() const {
+    return header->version >= 3 ? Section<SnapshotFocus>(header->focusOffset) : nullptr;
+}
+
+const SnapshotSessionSpan* SnapshotView::SessionSpans() const {
+    return header->version >= 4 ? Section<SnapshotSessionSpan>(header->sessionSpansOffset) : nullptr;
+}
+
+bool WriteSnapshot(const TrackingEngine& engine, const std::string& filename, uint64_t journalSequence) {
+    const AppTable& apps = engine.Apps();
+
+    // String table and app rows
+    std::string strings;
+    std::vector<SnapshotApp> appRows(apps.Size());
+    for (uint32_t appId = 0; appId < apps.Size(); ++appId) {
+        SnapshotApp& row = appRows[appId];
+        row.nameOffset = static_cast<uint32_t>(strings.size());
+        row.nameLength = static_cast<uint32_t>(apps.Name(appId).size());
+        strings += apps.Name(appId);
+        row.pathOffset = static_cast<uint32_t>(strings.size());
+        row.pathLength = static_cast<uint32_t>(apps.Path(appId).size());
+        strings += apps.Path(appId);
+        row.activeSeconds = apps.activeSeconds[appId];
+        row.lastActive = apps.lastActive[appId];
+    }
+
+    // The open interval is saved as a closed one, like the JSON export does
+    const std::vector<FocusInterval>& intervals = engine.Intervals().Data();
+    FocusInterval openInterval;
+    bool hasOpen = engine.OpenInterval(openInterval) && openInterval.length > 0;
+
+    // Focus metrics as they will be once the open interval closes; a
+    // checkpoint splits it first, so the copy is only made on exit
+    const FocusAnalytics* analytics = &engine.Focus();
+    FocusAnalytics withOpen;
+    if (hasOpen) {
+        withOpen = engine.Focus();
+        withOpen.Add(openInterval);
+        analytics = &withOpen;
+    }
+    const FocusAnalytics::State& state = analytics->Saved();
+    SnapshotFocus focus = {};
+    focus.switches = state.finished.switches;
+    focus.sessions = state.finished.sessions;
+    focus.seconds = state.finished.seconds;
+    focus.longest = state.finished.longest;
+    focus.longestAppId = state.finished.longestAppId;
+    std::copy(std::begin(state.finished.lengths), std::end(state.finished.lengths), focus.lengths);
+    focus.run = state.run;
+    focus.hasRun = state.hasRun ? 1 : 0;
+    std::copy(std::begin(state.switchMinutes), std::end(state.switchMinutes), focus.switchMinutes);
+    std::copy(std::begin(state.switchCounts), std::end(state.switchCounts), focus.switchCounts);
+    std::vector<SnapshotAppFocus> appFocus(apps.Size(), SnapshotAppFocus());
+    for (uint32_t appId = 0; appId < apps.Size(); ++appId) {
+        const AppFocus& app = analytics->Finished(appId);
+        appFocus[appId] = { app.sessions, app.seconds, app.longest, 0, app.longestBegin };
+    }
+    std::vector<SnapshotSessionSpan> sessionSpans;
+    sessionSpans.reserve(analytics->Sessions().SpanCount());
+    analytics->Sessions().ForEachSpan([&sessionSpans](int64_t start, int64_t width, const uint64_t*, size_t count) {
+        sessionSpans.push_back({ start, static_cast<uint32_t>(width / SessionDistributions::DAY), static_cast<uint32_t>(count) });
+    });
+
+    std::vector<SnapshotRollup> rollups;
+    SnapshotHeader header = {};
+    for (int tier = 0; tier < RollupStore::TIER_COUNT; ++tier) {
+        size_t before = rollups.size();
+        engine.Rollups().ForEachEntry(static_cast<RollupStore::Tier>(tier),
+                                      [&rollups](int64_t start, const RollupStore::Entry& entry) {
+            if (entry.seconds > 0) {
+                rollups.push_back({ start, entry.appId, entry.seconds });
+            }
+        });
+        header.rollupCounts[tier] = rollups.size() - before;
+    }
+
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.savedAt = ToUnixSeconds(std::chrono::system_clock::now());
+    header.rollupNewest = engine.Rollups().Newest();
+    header.journalSequence = journalSequence;
+    header.stringsOffset = sizeof(SnapshotHeader);
+    header.stringsSize = strings.size();
+    header.appsOffset = AlignTo8(header.stringsOffset + header.stringsSize);
+    header.appCount = appRows.size();
+    header.intervalsOffset = header.appsOffset + appRows.size() * sizeof(SnapshotApp);
+    header.intervalCount = intervals.size() + (hasOpen ? 1 : 0);
+    header.rollupsOffset = header.intervalsOffset + header.intervalCount * sizeof(FocusInterval);
+    header.focusOffset = header.rollupsOffset + rollups.size() * sizeof(SnapshotRollup);
+    header.sessionSpansOffset = header.focusOffset + sizeof(SnapshotFocus) + appFocus.size() * sizeof(SnapshotAppFocus);
+    header.sessionSpanCount = sessionSpans.size();
+    header.sessionsOffset = header.sessionSpansOffset + sessionSpans.size() * sizeof(SnapshotSessionSpan);
+    header.sessionEntryCount = analytics->Sessions().EntryCount();
+
+    std::string tempName = filename + ".tmp";
+    std::FILE* file = std::fopen(tempName.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error: Unable to open " << tempName << " for saving data" << std::endl;
+        return false;
+    }
+    bool written = true;
+    auto write = [&written, file](const void* data, size_t size) {
+        written = written && std::fwrite(data, 1, size, file) == size;
+    };
+
+    const char padding[8] = {};
+    write(&header, sizeof(header));
+    write(strings.data(), strings.size());
+    write(padding, header.appsOffset - header.stringsOffset - header.stringsSize);
+    write(appRows.data(), appRows.size() * sizeof(SnapshotApp));
+    // The open interval goes in begin order too; it only precedes logged
+    // intervals if the clock stepped back across a restart
+    size_t openAt = intervals.size();
+    if (hasOpen) {
+        openAt = static_cast<size_t>(std::upper_bound(intervals.begin(), intervals.end(), openInterval.begin,
+                                                      [](int64_t begin, const FocusInterval& other) { return begin < other.begin; }) -
+                                     intervals.begin());
+    }
+    write(intervals.data(), openAt * sizeof(FocusInterval));
+    if (hasOpen) {
+        write(&openInterval, sizeof(openInterval));
+    }
+    write(intervals.data() + openAt, (intervals.size() - openAt) * sizeof(FocusInterval));
+    write(rollups.data(), rollups.size() * sizeof(SnapshotRollup));
+    write(&focus, sizeof(focus));
+    write(appFocus.data(), appFocus.size() * sizeof(SnapshotAppFocus));
+    write(sessionSpans.data(), sessionSpans.size() * sizeof(SnapshotSessionSpan));
+    analytics->Sessions().ForEachSpan([&write](int64_t, int64_t, const uint64_t* entries, size_t count) {
+        write(entries, count * sizeof(uint64_t));
+    });
+
+    // On disk before the rename, so the journals it replaces are never the only copy
+    written = written && SyncFile(file);
+    if (std::fclose(file) != 0 || !written) {
+        std::cerr << "Error: Failed to write " << tempName << std::endl;
+        std::remove(tempName.c_str());
+        return false;
+    }
+
+    if (!RenameReplacing(tempName, filename)) {
+        std::cerr << "Error: Unable to replace " << filename << std::endl;
+        std::remove(tempName.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool LoadSnapshot(TrackingEngine& engine, const std::string& filename, uint64_t* journalSequence) {
+    SnapshotView view;
+    if (!view.Open(filename)) {
+        return false;
+    }
+
+    // Check the records before touching the engine
+    const SnapshotHeader& header = view.Header();
+    for (size_t index = 0; index < view.AppCount(); ++index) {
+        const SnapshotApp& app = view.App(index);
+        if (uint64_t(app.nameOffset) + app.nameLength > header.stringsSize
+            || uint64_t(app.pathOffset) + app.pathLength > header.stringsSize || app.nameLength == 0) {
+            std::cerr << "Error: " << filename << " has a damaged app table" << std::endl;
+            return false;
+        }
+    }
+    const FocusInterval* intervals = view.Intervals();
+    for (size_t index = 0; index < view.IntervalCount(); ++index) {
+        if (intervals[index].appId >= view.AppCount() || (index > 0 && intervals[index].begin < intervals[index - 1].begin)) {
+            std::cerr << "Error: " << filename << " has damaged interval records" << std::endl;
+            return false;
+        }
+    }
+    for (int tier = 0; tier < RollupStore::TIER_COUNT; ++tier) {
+        const SnapshotRollup* rollups = view.Rollups(static_cast<RollupStore::Tier>(tier));
+        for (size_t index = 0; index < view.RollupCount(static_cast<RollupStore::Tier>(tier)); ++index) {
+            if (rollups[index].appId >= view.AppCount()) {
+                std::cerr << "Error: " << filename << " has damaged rollup records" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    const SnapshotFocus* focus = view.Focus();
+    if (focus && ((focus->hasRun && focus->run.appId >= view.AppCount())
+                  || (focus->longestAppId != UINT32_MAX && focus->longestAppId >= view.AppCount()))) {
+        std::cerr << "Error: " << filename << " has damaged focus records" << std::endl;
+        return false;
+    }
+    // Spans must not overlap and each span's entries be sorted, as Query() searches them
+    const SnapshotSessionSpan* sessionSpans = view.SessionSpans();
+    const uint64_t* sessions = view.SessionEntries();
+    uint64_t sessionEntries = 0;
+    bool sessionsValid = true;
+    for (size_t span = 0; span < view.SessionSpanCount() && sessionsValid; ++span) {
+        const SnapshotSessionSpan& current = sessionSpans[span];
+        int64_t width = int64_t(current.days) * SessionDistributions::DAY;
+        sessionsValid = (width == SessionDistributions::DAY || width == SessionDistributions::MONTH)
+                        && current.start % width == 0
+                        && (span == 0 || sessionSpans[span - 1].start + int64_t(sessionSpans[span - 1].days) * SessionDistributions::DAY <= current.start)
+                        && current.entryCount <= view.SessionEntryCount() - sessionEntries;
+        for (uint64_t index = sessionEntries; sessionsValid && index < sessionEntries + current.entryCount; ++index) {
+            sessionsValid = SessionDistributions::EntryApp(sessions[index]) < view.AppCount()
+                            && SessionDistributions::EntryBucket(sessions[index]) < SessionSketch::BUCKETS
+                            && (index == sessionEntries || sessions[index - 1] < sessions[index]);
+        }
+        sessionEntries += current.entryCount;
+    }
+    if (!sessionsValid || sessionEntries != view.SessionEntryCount()) {
+        std::cerr << "Error: " << filename << " has damaged session records" << std::endl;
+        return false;
+    }
+
+    std::vector<uint32_t> appIdMap(view.AppCount());
+    for (size_t index = 0; index < view.AppCount(); ++index) {
+        const SnapshotApp& app = view.App(index);
+        appIdMap[index] = engine.RestoreApp(view.AppName(index), view.AppPath(index),
+                                            app.activeSeconds, app.lastActive);
+    }
+
+    engine.RestoreIntervals(intervals, view.IntervalCount(), appIdMap);
+
+    for (int tier = 0; tier < RollupStore::TIER_COUNT; ++tier) {
+        const SnapshotRollup* rollups = view.Rollups(static_cast<RollupStore::Tier>(tier));
+        for (size_t index = 0; index < view.RollupCount(static_cast<RollupStore::Tier>(tier)); ++index) {
+            engine.RestoreRollup(static_cast<RollupStore::Tier>(tier), rollups[index].start,
+                                 appIdMap[rollups[index].appId], rollups[index].seconds);
+        }
+    }
+    engine.RestoreRollupNewest(header.rollupNewest);
+    RestoreFocus(engine, view, appIdMap);
+    if (journalSequence) {
+        *journalSequence = header.journalSequence;
+    }
+    return true;
+}
@@ -0,0 +1,159 @@
+#ifndef SNAPSHOT_FILE_H
+#define SNAPSHOT_FILE_H
+
+#include "TrackingEngine.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// tracking_data.bin: versioned binary snapshot of the tracking engine.
+//
+// Layout (little-endian, every section 8-byte aligned):
+//   SnapshotHeader
+//   string table    UTF-8 bytes of every app name and path, not terminated
+//   SnapshotApp     x appCount, indexed by app id
+//   FocusInterval   x intervalCount, sorted by begin (the open interval included)
+//   SnapshotRollup  x rollupCounts[tier], minute tier first, oldest bucket first
+//   SnapshotFocus, then SnapshotAppFocus x appCount   (version 3 on)
+//   SnapshotSessionSpan x sessionSpanCount, oldest first   (version 4 on)
+//   uint64_t        x sessionEntryCount, packed SessionDistributions entries, by span
+//
+// Every record has a fixed width, so a mapped file is read in place: the
+// interval section is handed to the engine as-is and only the app rows and
+// rollup entries are visited one by one.
+
+constexpr uint32_t SNAPSHOT_VERSION = 4;
+// Older files still load, with the sections they lack rebuilt from their
+// intervals: version 2 has no focus metrics and its header ends at
+// focusOffset, version 3 has no session sketches and its header ends at
+// sessionSpansOffset
+constexpr uint32_t SNAPSHOT_OLDEST_VERSION = 2;
+
+struct SnapshotHeader {
+    char magic[8];            // "STTSNAP" followed by a zero byte
+    uint32_t version;
+    uint32_t headerSize;      // sizeof(SnapshotHeader) when written
+    int64_t savedAt;          // Unix seconds
+    int64_t rollupNewest;     // RollupStore::Newest()
+    uint64_t journalSequence; // First journal record not contained in the snapshot
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+    uint64_t appsOffset;
+    uint64_t appCount;
+    uint64_t intervalsOffset;
+    uint64_t intervalCount;
+    uint64_t rollupsOffset;
+    uint64_t rollupCounts[RollupStore::TIER_COUNT];
+    uint64_t focusOffset;
+    uint64_t sessionSpansOffset;
+    uint64_t sessionSpanCount;
+    uint64_t sessionsOffset;
+    uint64_t sessionEntryCount;
+};
+static_assert(sizeof(SnapshotHeader) == 160, "SnapshotHeader is part of the file format");
+
+constexpr uint32_t SnapshotHeaderSize(uint32_t version) {
+    return version == 2 ? 120 : version == 3 ? 128 : static_cast<uint32_t>(sizeof(SnapshotHeader));
+}
+
+struct SnapshotApp {
+    uint32_t nameOffset;    // Into the string table
+    uint32_t nameLength;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+    int64_t activeSeconds;
+    int64_t lastActive;     // AppTable::NEVER if inactive since the last clear
+};
+static_assert(sizeof(SnapshotApp) == 32, "SnapshotApp is part of the file format");
+
+struct SnapshotRollup {
+    int64_t start;
+    uint32_t appId;
+    uint32_t seconds;
+};
+static_assert(sizeof(SnapshotRollup) == 16, "SnapshotRollup is part of the file format");
+
+// FocusAnalytics::State, the open interval included as a closed one
+struct SnapshotFocus {
+    uint64_t switches;
+    uint64_t sessions;
+    int64_t seconds;
+    uint32_t longest;
+    uint32_t longestAppId;  // UINT32_MAX if no session
+    uint64_t lengths[FocusSummary::LENGTH_CLASSES];
+    FocusInterval run;
+    uint32_t hasRun;
+    uint32_t reserved;
+    int64_t switchMinutes[FocusAnalytics::SWITCH_MINUTES];
+    uint32_t switchCounts[FocusAnalytics::SWITCH_MINUTES];
+};
+static_assert(sizeof(SnapshotFocus) == 824, "SnapshotFocus is part of the file format");
+
+struct SnapshotAppFocus {
+    uint64_t sessions;
+    int64_t seconds;
+    uint32_t longest;
+    uint32_t reserved;
+    int64_t longestBegin;
+};
+static_assert(sizeof(SnapshotAppFocus) == 32, "SnapshotAppFocus is part of the file format");
+
+// The session sketches of a day or month; its entries follow the previous span's
+struct SnapshotSessionSpan {
+    int64_t start;          // Unix seconds, a multiple of the width
+    uint32_t days;          // Width: 1, or 30 for a SessionDistributions::MONTH
+    uint32_t entryCount;
+};
+static_assert(sizeof(SnapshotSessionSpan) == 16, "SnapshotSessionSpan is part of the file format");
+
+// Read-only view over a mapped snapshot. Open() checks the header and that
+// every section lies within the file; the accessors then read the mapping directly.
+class SnapshotView {
+public:
+    bool Open(const std::string& filename);
+    void Close() { file.Close(); header = nullptr; }
+
+    const SnapshotHeader& Header() const { return *header; }
+
+    size_t AppCount() const { return static_cast<size_t>(header->appCount); }
+    const SnapshotApp& App(size_t index) const { return Apps()[index]; }
+    std::string_view AppName(size_t index) const;
+    std::string_view AppPath(size_t index) const;
+
+    const FocusInterval* Intervals() const { return Section<FocusInterval>(header->intervalsOffset); }
+    size_t IntervalCount() const { return static_cast<size_t>(header->intervalCount); }
+
+    const SnapshotRollup* Rollups(RollupStore::Tier tier) const;
+    size_t RollupCount(RollupStore::Tier tier) const { return static_cast<size_t>(header->rollupCounts[tier]); }
+
+    // nullptr for a version 2 file
+    const SnapshotFocus* Focus() const;
+    // nullptr before version 4
+    const SnapshotSessionSpan* SessionSpans() const;
+    size_t SessionSpanCount() const { return SessionSpans() ? static_cast<size_t>(header->sessionSpanCount) : 0; }
+    const uint64_t* SessionEntries() const { return SessionSpans() ? Section<uint64_t>(header->sessionsOffset) : nullptr; }
+    size_t SessionEntryCount() const { return SessionSpans() ? static_cast<size_t>(header->sessionEntryCount) : 0; }
+    const SnapshotAppFocus* AppFocus() const { return Focus() ? reinterpret_cast<const SnapshotAppFocus*>(Focus() + 1) : nullptr; }
+
+private:
+    template <typename T>
+    const T* Section(uint64_t offset) const { return reinterpret_cast<const T*>(file.Data() + offset); }
+    const SnapshotApp* Apps() const { return Section<SnapshotApp>(header->appsOffset); }
+
+    MappedFile file;
+    const SnapshotHeader* header = nullptr;
+};
+
+// Writes the engine to filename, replacing it only once the new file is complete.
+// journalSequence is the first journal record the engine does not reflect yet.
+// Callers serialize access to the engine.
+bool WriteSnapshot(const TrackingEngine& engine, const std::string& filename, uint64_t journalSequence = 0);
+
+// Restores a snapshot into the engine (normally an empty one). Returns false,
+// leaving the engine untouched, if the file is missing, from another version or damaged.
+// journalSequence, if given, receives the value passed to WriteSnapshot.
+bool LoadSnapshot(TrackingEngine& engine, const std::string& filename, uint64_t* journalSequence = nullptr);
+
+#endif
@@ -0,0 +1,40 @@
+#include "StringInterner.h"
+
+StringInterner::StringInterner(const StringInterner& other) {
+    *this = other;
+}
+
+StringInterner& StringInterner::operator=(const StringInterner& other) {
+    if (this == &other) {
+        return *this;
+    }
+    strings = other.strings;
+    ids.clear();
+    ids.reserve(strings.size());
+    for (uint32_t id = 0; id < strings.size(); ++id) {
+        ids.emplace(std::string_view(strings[id]), id);
+    }
+    return *this;
+}
+
+uint32_t StringInterner::Intern(std::string_view value) {
+    auto it = ids.find(value);
+    if (it != ids.end()) {
+        return it->second;
+    }
+
+    uint32_t id = static_cast<uint32_t>(strings.size());
+    strings.emplace_back(value);
+    ids.emplace(std::string_view(strings.back()), id);
+    return id;
+}
+
+uint32_t StringInterner::Find(std::string_view value) const {
+    auto it = ids.find(value);
+    return it == ids.end() ? NOT_FOUND : it->second;
+}
+
+void StringInterner::Clear() {
+    ids.clear();
+    strings.clear();
+}
@@ -0,0 +1,40 @@
+#ifndef STRING_INTERNER_H
+#define STRING_INTERNER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Maps strings to dense 32-bit ids in insertion order. Interned strings never
+// move, so views handed out by Get() stay valid for the interner's lifetime.
+class StringInterner {
+public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    StringInterner() = default;
+    // Copies rebuild the index so that its keys point into the copy's own strings
+    StringInterner(const StringInterner& other);
+    StringInterner& operator=(const StringInterner& other);
+    StringInterner(StringInterner&&) = default;
+    StringInterner& operator=(StringInterner&&) = default;
+
+    // Returns the id of "value", adding it if it hasn't been seen before.
+    uint32_t Intern(std::string_view value);
+
+    // Returns the id of "value" or NOT_FOUND.
+    uint32_t Find(std::string_view value) const;
+
+    const std::string& Get(uint32_t id) const { return strings[id]; }
+    size_t Size() const { return strings.size(); }
+
+    void Clear();
+
+private:
+    std::deque<std::string> strings;
+    std::unordered_map<std::string_view, uint32_t> ids;  // Keys point into strings
+};
+
+#endif
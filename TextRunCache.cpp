@@ -0,0 +1,27 @@
+#include "TextRunCache.h"
+#include "FormatUtils.h"
+
+size_t TextRunCache::KeyHash::operator()(const Key& key) const {
+    uint64_t hash = key.stringId * 0x9e3779b97f4a7c15ull;
+    hash ^= (static_cast<uint64_t>(key.dpi) << 8 | static_cast<uint64_t>(key.font)) + (hash >> 29);
+    return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
+const TextRun& TextRunCache::Get(uint64_t stringId, RenderFont font, int dpi, const std::string& utf8, TextMeasurer& measurer) {
+    auto inserted = runs.try_emplace(Key{ stringId, font, dpi });
+    TextRun& run = inserted.first->second;
+    if (inserted.second) {
+        run.text = Utf8ToWide(utf8);
+        run.extent = measurer.Measure(run.text.c_str(), run.text.size(), font, dpi);
+        ++misses;
+    }
+    return run;
+}
+
+bool TextRunCache::Trim() {
+    if (runs.size() <= capacity) {
+        return false;
+    }
+    runs.clear();
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef TEXT_RUN_CACHE_H
+#define TEXT_RUN_CACHE_H
+
+#include "RenderBackend.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// A label converted to wchar_t text and measured for one font and DPI
+struct TextRun {
+    std::wstring text;
+    TextExtent extent;
+};
+
+// Converted and measured labels keyed by (string id, font, DPI). A run is
+// made the first time its key is asked for and reused until the cache is
+// trimmed, so the UTF-8 conversion and text layout happen once per distinct
+// label rather than once per row per frame. Callers choose string ids so that
+// an id always names the same text; a label whose text changes (a duration
+// ticking over to the next minute) simply asks for a different id.
+class TextRunCache {
+public:
+    // Ids for the kinds of label the usage list shows
+    static uint64_t AppNameId(uint32_t appId) { return appId; }
+    static uint64_t DurationId(int64_t minutes) { return (1ull << 63) | static_cast<uint64_t>(minutes); }
+    static uint64_t TitleId(uint32_t appId, uint32_t serial) { return (1ull << 62) | (static_cast<uint64_t>(appId) << 32) | serial; }
+    static uint64_t PercentId(int percent) { return (1ull << 61) | static_cast<uint64_t>(percent); }
+
+    explicit TextRunCache(size_t capacity = 4096) : capacity(capacity) {}
+
+    // The run for the key, converting utf8 and measuring it with measurer only
+    // on a miss. The reference stays valid until Trim() drops it.
+    const TextRun& Get(uint64_t stringId, RenderFont font, int dpi, const std::string& utf8, TextMeasurer& measurer);
+    // Drops every run once more than capacity are held; returns true if it
+    // did, after which no reference from Get() may be used.
+    bool Trim();
+
+    size_t Size() const { return runs.size(); }
+    uint64_t Misses() const { return misses; }
+
+private:
+    struct Key {
+        uint64_t stringId;
+        RenderFont font;
+        int dpi;
+        bool operator==(const Key& other) const { return stringId == other.stringId && font == other.font && dpi == other.dpi; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    size_t capacity;
+    std::unordered_map<Key, TextRun, KeyHash> runs;  // Nodes never move, so references stay valid
+    uint64_t misses = 0;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) {
+        threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t taskCount, const std::function<void(size_t)>& loopTask) {
+    if (taskCount == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> callerLock(callerMutex);
+    if (workers.empty() || taskCount == 1) {
+        for (size_t i = 0; i < taskCount; ++i) {
+            loopTask(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &loopTask;
+        count = taskCount;
+        next = 0;
+        active = workers.size();
+        ++generation;
+    }
+    wake.notify_all();
+    RunTasks();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return active == 0; });
+    task = nullptr;
+}
+
+void ThreadPool::RunTasks() {
+    for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+        (*task)(i);
+    }
+}
+
+void ThreadPool::WorkerLoop() {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+        RunTasks();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --active;
+        }
+        done.notify_one();
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data-parallel loops. ParallelFor() hands
+// out indices from a shared counter, so uneven tasks balance themselves, and
+// the calling thread works alongside the pool rather than waiting idle.
+// One loop runs at a time; concurrent callers queue up.
+class ThreadPool {
+public:
+    // threads is the total parallelism including the caller; 0 means one per core
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Threads a loop runs on, counting the caller
+    size_t Size() const { return workers.size() + 1; }
+
+    // Runs task(i) for every i in [0, count) and returns once all are done.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    void WorkerLoop();
+    void RunTasks();
+
+    std::vector<std::thread> workers;
+    std::mutex callerMutex;  // Serializes ParallelFor() callers
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t)>* task = nullptr;
+    size_t count = 0;
+    std::atomic<size_t> next{ 0 };
+    size_t active = 0;         // Workers still inside the current loop
+    uint64_t generation = 0;   // Bumped for every loop so workers join each once
+    bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,84 @@
+#include "TitleSketch.h"
+#include <algorithm>
+#include <functional>
+
+void TitleSketch::Add(const std::string& title, int64_t seconds) {
+    if (seconds <= 0) {
+        return;
+    }
+    total += seconds;
+    // A window keeps its title for many samples in a row
+    if (last < counters.size() && counters[last].title == title) {
+        counters[last].count += seconds;
+        return;
+    }
+
+    uint64_t hash = std::hash<std::string>()(title);
+    for (size_t i = 0; i < counters.size(); ++i) {
+        if (counters[i].hash == hash && counters[i].title == title) {
+            counters[i].count += seconds;
+            last = i;
+            return;
+        }
+    }
+    if (counters.size() < capacity) {
+        counters.push_back({ title, hash, seconds, 0, nextSerial++ });
+        last = counters.size() - 1;
+        return;
+    }
+
+    // Full: the smallest counter is handed over, keeping its count as error
+    size_t smallest = 0;
+    for (size_t i = 1; i < counters.size(); ++i) {
+        if (counters[i].count < counters[smallest].count) {
+            smallest = i;
+        }
+    }
+    Counter& counter = counters[smallest];
+    counter.title = title;  // Reuses the evicted title's buffer
+    counter.hash = hash;
+    counter.error = counter.count;
+    counter.count += seconds;
+    counter.serial = nextSerial++;
+    last = smallest;
+}
+
+void TitleSketch::Remove(const std::string& title, int64_t seconds) {
+    for (size_t i = 0; i < counters.size() && seconds > 0; ++i) {
+        Counter& counter = counters[i];
+        if (counter.title == title) {
+            int64_t removed = std::min(seconds, counter.count - counter.error);
+            counter.count -= removed;
+            total -= removed;
+            return;
+        }
+    }
+}
+
+void TitleSketch::Clear() {
+    counters.clear();
+    last = 0;
+    total = 0;
+}
+
+void TitleSketch::Summarize(size_t n, TitleSummary& summary) const {
+    std::vector<const Counter*> order;
+    order.reserve(counters.size());
+    for (const Counter& counter : counters) {
+        order.push_back(&counter);
+    }
+    auto guaranteed = [](const Counter* counter) { return counter->count - counter->error; };
+    size_t shown = std::min(n, order.size());
+    std::partial_sort(order.begin(), order.begin() + shown, order.end(), [&](const Counter* a, const Counter* b) {
+        return guaranteed(a) > guaranteed(b) || (guaranteed(a) == guaranteed(b) && a->serial < b->serial);
+    });
+
+    summary.top.clear();
+    int64_t listed = 0;
+    for (size_t i = 0; i < shown && guaranteed(order[i]) > 0; ++i) {
+        summary.top.push_back({ order[i]->title, order[i]->serial, std::chrono::seconds(guaranteed(order[i])) });
+        listed += guaranteed(order[i]);
+    }
+    summary.total = std::chrono::seconds(total);
+    summary.other = std::chrono::seconds(total - listed);
+}
@@ -0,0 +1,66 @@
+#ifndef TITLE_SKETCH_H
+#define TITLE_SKETCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One window title's share of an app's time
+struct TitleShare {
+    std::string title;
+    uint32_t serial = 0;  // Names this title for as long as it stays monitored
+    std::chrono::seconds time{ 0 };
+};
+
+// The titles worth showing under an app: the heaviest ones, longest first,
+// and everything else folded into other. top's times plus other make total.
+struct TitleSummary {
+    std::vector<TitleShare> top;
+    std::chrono::seconds other{ 0 };
+    std::chrono::seconds total{ 0 };
+};
+
+// Seconds per window title of one app in bounded memory, by Space-Saving: a
+// fixed set of counters, where a title that isn't monitored takes over the
+// smallest counter and inherits its count as error. Any title holding more
+// than 1/capacity of the app's time is guaranteed to be monitored, and its
+// count minus error is time it really had. Add() costs O(capacity) at worst
+// (a new title), independent of how many distinct titles went by, and O(1)
+// for the common case of the same title as the last sample.
+class TitleSketch {
+public:
+    explicit TitleSketch(size_t capacity = 32) : capacity(capacity ? capacity : 1) {}
+
+    void Add(const std::string& title, int64_t seconds);
+    // Takes back time just added to title (an idle tail). Never takes a
+    // counter below its error, so a title evicted since loses nothing more.
+    void Remove(const std::string& title, int64_t seconds);
+    void Clear();
+
+    // The n titles with the most guaranteed time; their guaranteed time is
+    // reported, and the evicted tail plus every counter's error goes to other
+    void Summarize(size_t n, TitleSummary& summary) const;
+
+    int64_t Total() const { return total; }
+    size_t Monitored() const { return counters.size(); }
+    size_t Capacity() const { return capacity; }
+
+private:
+    struct Counter {
+        std::string title;
+        uint64_t hash = 0;
+        int64_t count = 0;
+        int64_t error = 0;  // Count inherited from the title this counter evicted
+        uint32_t serial = 0;
+    };
+
+    size_t capacity;
+    std::vector<Counter> counters;
+    size_t last = 0;  // Counter of the previous Add(), checked first
+    int64_t total = 0;
+    uint32_t nextSerial = 0;
+};
+
+#endif
@@ -1,83 +1,282 @@
 #include "Tracker.h"
+#include "WindowManager.h"
 #include <windows.h>
 #include <psapi.h>
+#include <shellapi.h>
 #include <chrono>
+#include <fstream>
+#include <iostream>
 #include <thread>
 #include <mutex>
-#include <map>
 #include <string>
-#include <sstream>
+#include <atomic>
+#include <unordered_map>
+#include "ProcessIdentityCache.h"
+#include "CategoryRules.h"
+#include "FileUtils.h"
 
-extern std::map<std::string, std::chrono::system_clock::time_point> appStartTime;
+// Converts wide text to UTF-8 into out, reusing its buffer
+static void AssignUtf8(const wchar_t* text, int length, std::string& out) {
+    int utf8Size = length > 0 ? WideCharToMultiByte(CP_UTF8, 0, text, length, NULL, 0, NULL, NULL) : 0;
+    out.resize(static_cast<size_t>(utf8Size));
+    if (utf8Size > 0) {
+        WideCharToMultiByte(CP_UTF8, 0, text, length, &out[0], utf8Size, NULL, NULL);
+    }
+}
+
+// Resolves processes with a kept-open handle per cached pid. Holding the
+// handle stops Windows from reusing the pid, so an exit check is all
+// IsSameProcess() needs.
+class WindowsProcessResolver : public ProcessResolver {
+public:
+    ~WindowsProcessResolver() override {
+        for (const auto& entry : handles) {
+            CloseHandle(entry.second);
+        }
+    }
+
+    bool Resolve(uint32_t pid, ProcessIdentity& identity) override {
+        HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ | SYNCHRONIZE, FALSE, pid);
+        if (!hProcess) {
+            return false;
+        }
+
+        // Wide API, stored as UTF-8, so paths outside the ANSI code page survive
+        wchar_t exePath[MAX_PATH];
+        DWORD exePathSize = GetModuleFileNameExW(hProcess, NULL, exePath, MAX_PATH);
+        FILETIME creationTime, exitTime, kernelTime, userTime;
+        if (exePathSize == 0 || !GetProcessTimes(hProcess, &creationTime, &exitTime, &kernelTime, &userTime)) {
+            CloseHandle(hProcess);
+            return false;
+        }
+
+        AssignUtf8(exePath, static_cast<int>(exePathSize), identity.appPath);
+        identity.appName = AppNameFromPath(identity.appPath);
+        identity.startTime = (static_cast<uint64_t>(creationTime.dwHighDateTime) << 32) | creationTime.dwLowDateTime;
+
+        Release(pid);
+        handles[pid] = hProcess;
+        return true;
+    }
+
+    bool IsSameProcess(uint32_t pid, uint64_t) override {
+        auto it = handles.find(pid);
+        return it != handles.end() && WaitForSingleObject(it->second, 0) == WAIT_TIMEOUT;
+    }
+
+    void Release(uint32_t pid) override {
+        auto it = handles.find(pid);
+        if (it != handles.end()) {
+            CloseHandle(it->second);
+            handles.erase(it);
+        }
+    }
+
+private:
+    std::unordered_map<uint32_t, HANDLE> handles;
+};
+
+// Reports the executable behind the current foreground window, and its title
+// while title tracking is on.
+class WindowsForegroundSource : public ForegroundSource {
+public:
+    explicit WindowsForegroundSource(ProcessResolver& resolver) : identities(resolver) {
+    }
+
+    std::atomic<bool> readTitles{ false };
+
+    bool Sample(ForegroundSample& sample) override {
+        HWND hwnd = GetForegroundWindow();
+        if (hwnd == NULL) {
+            return false;
+        }
+
+        DWORD processId = 0;
+        GetWindowThreadProcessId(hwnd, &processId);
+
+        // Assigning into the caller's strings reuses their buffers between ticks
+        const ProcessIdentity* identity = identities.Lookup(processId);
+        if (identity) {
+            sample.appName = identity->appName;
+            sample.appPath = identity->appPath;
+        } else {
+            sample.appName = "Unknown";
+            sample.appPath.clear();
+        }
+        if (readTitles.load(std::memory_order_relaxed)) {
+            wchar_t title[256];
+            AssignUtf8(title, GetWindowTextW(hwnd, title, 256), sample.windowTitle);
+        } else {
+            sample.windowTitle.clear();
+        }
+        return true;
+    }
+
+private:
+    ProcessIdentityCache identities;
+};
+
+// Reports the last keyboard or mouse input to this session
+class WindowsInputSource : public InputActivitySource {
+public:
+    bool LastInput(std::chrono::system_clock::time_point now, std::chrono::system_clock::time_point& lastInput) override {
+        LASTINPUTINFO info = { sizeof(LASTINPUTINFO) };
+        if (!GetLastInputInfo(&info)) {
+            return false;
+        }
+        // Both tick counts wrap at 2^32 together, so the unsigned difference stays right
+        DWORD idleMilliseconds = GetTickCount() - info.dwTime;
+        lastInput = now - std::chrono::milliseconds(idleMilliseconds);
+        return true;
+    }
+};
 
 std::mutex dataMutex;
-std::map<std::string, std::chrono::seconds> appActiveTime;
-std::map<std::string, std::string> appPaths;
-std::string currentAppName = "";
-std::string currentAppPath = "";
+TrackingEngine trackingEngine;
+TrackingStore trackingStore("tracking_data.bin");
+SnapshotPublisher usagePublisher({ std::chrono::hours(24), std::chrono::hours(72), std::chrono::hours(24 * 7), std::chrono::hours(24 * 30) });
+static WindowsProcessResolver processResolver;
+static WindowsForegroundSource foregroundSource(processResolver);
+static WindowsInputSource inputSource;
+static const std::chrono::minutes IDLE_THRESHOLD(5);
+static std::atomic<bool> idleDetection{ true };
+static CategoryRuleCompiler categoryCompiler;
+static const char* CATEGORY_RULES_FILE = "category_rules.txt";
+static const int CATEGORY_RULES_CHECK_TICKS = 5;
+static FILETIME categoryRulesWritten = {};
 extern HWND hWnd;
 extern bool isRunning;
 extern bool isPaused;
 
+// Local time minus UTC right now, daylight saving included
+static std::chrono::seconds LocalUtcOffset() {
+    TIME_ZONE_INFORMATION zone;
+    DWORD id = GetTimeZoneInformation(&zone);
+    LONG bias = zone.Bias + (id == TIME_ZONE_ID_DAYLIGHT ? zone.DaylightBias : 0);
+    return std::chrono::minutes(-bias);
+}
+
+// Hands the rules file to the compiler if it was written, created or deleted
+// since the last look. Returns false if it hasn't changed.
+static bool SubmitChangedCategoryRules() {
+    FILETIME written = {};
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if (GetFileAttributesExA(CATEGORY_RULES_FILE, GetFileExInfoStandard, &info)) {
+        written = info.ftLastWriteTime;
+    }
+    if (CompareFileTime(&written, &categoryRulesWritten) == 0) {
+        return false;
+    }
+    categoryRulesWritten = written;
+    std::vector<CategoryRule> rules;
+    LoadCategoryRules(CATEGORY_RULES_FILE, rules);  // No file means no categories
+    categoryCompiler.Submit(std::move(rules));
+    return true;
+}
+
 void StartTrackingThread() {
     std::thread trackingThread([]() {
+        int ticks = 0;
         while (isRunning) {
+            bool recorded = false;
+            // Compiling happens on the compiler's thread; the tick only swaps the result in
+            if (++ticks % CATEGORY_RULES_CHECK_TICKS == 0) {
+                SubmitChangedCategoryRules();
+            }
+            if (auto matcher = categoryCompiler.TakeCompiled()) {
+                std::lock_guard<std::mutex> lock(dataMutex);
+                trackingEngine.SetCategoryMatcher(std::move(matcher));
+            }
             if (!isPaused) {
-                HWND hwnd = GetForegroundWindow();
-                if (hwnd != NULL) {
-                    auto [appName, appPath] = GetAppNameAndPathFromWindow(hwnd);
-                    if (!appName.empty()) {
-                        std::lock_guard<std::mutex> lock(dataMutex);
-
-                        // Check if the app changed
-                        if (appName != currentAppName) {
-                            // Update the old app's time
-                            if (!currentAppName.empty()) {
-                                auto now = std::chrono::system_clock::now();
-                                auto duration = std::chrono::duration_cast<std::chrono::seconds>(
-                                        now - appStartTime[currentAppName]);
-                                appActiveTime[currentAppName] += duration;
-                                appPaths[currentAppName] = currentAppPath;
-                            }
-
-                            // Reset tracking for the new app
-                            currentAppName = appName;
-                            currentAppPath = appPath;
-                            appStartTime[currentAppName] = std::chrono::system_clock::now();
-                        } else {
-                            // Update the active time for the current app
-                            auto now = std::chrono::system_clock::now();
-                            auto duration = std::chrono::duration_cast<std::chrono::seconds>(
-                                    now - appStartTime[currentAppName]);
-                            appActiveTime[currentAppName] += duration;
-                            appStartTime[currentAppName] = now; // Reset the start time to "now"
-                        }
-                    }
-                }
+                // The window reads the published snapshot, never the engine,
+                // so the lock is only held for the tick itself. Without a
+                // foreground window the tick still runs, so that a locked
+                // desktop is seen going idle.
+                std::lock_guard<std::mutex> lock(dataMutex);
+                auto now = std::chrono::system_clock::now();
+                trackingEngine.Tick(foregroundSource, inputSource, now);
+                usagePublisher.SetUtcOffset(LocalUtcOffset());  // Recounts the heatmaps if daylight saving flipped
+                usagePublisher.Publish(trackingEngine, now);
+                recorded = true;
+            }
+
+            // Disk work happens outside dataMutex so painting never waits on it
+            trackingStore.Journal().FlushIfDue();
+            if (trackingStore.CheckpointDue()) {
+                CheckpointTrackingData();
+            }
+            // A hidden window catches up when it is shown, so don't wake it
+            if (recorded && IsWindowVisible(hWnd) && !IsIconic(hWnd)) {
+                PostMessage(hWnd, WM_APP_REFRESH, 0, 0);
             }
-            InvalidateRect(hWnd, NULL, TRUE);
             std::this_thread::sleep_for(std::chrono::seconds(1));
         }
     });
     trackingThread.detach();
 }
 
-std::pair<std::string, std::string> GetAppNameAndPathFromWindow(HWND hwnd) {
-    DWORD processId = 0;
-    GetWindowThreadProcessId(hwnd, &processId);
+void RecoverTrackingData() {
+    std::lock_guard<std::mutex> lock(dataMutex);
+    if (!trackingStore.Recover(trackingEngine, "tracking_data.json")) {
+        std::cerr << "Error: Journaling is off for this session, data is only saved on exit" << std::endl;
+    }
+    trackingEngine.SetIdleThreshold(idleDetection ? IDLE_THRESHOLD : std::chrono::minutes(0));
+    if (SubmitChangedCategoryRules()) {
+        trackingEngine.SetCategoryMatcher(categoryCompiler.WaitCompiled());
+    }
+    // The first publish builds the heatmaps from the whole history; ticks extend them
+    usagePublisher.SetUtcOffset(LocalUtcOffset());
+    usagePublisher.Publish(trackingEngine, std::chrono::system_clock::now());
+}
 
-    HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ,
-                                  FALSE, processId);
-    if (hProcess) {
-        char exePath[MAX_PATH];
-        if (GetModuleFileNameExA(hProcess, NULL, exePath, MAX_PATH)) {
-            CloseHandle(hProcess);
-            std::string fullPath(exePath);
-            size_t pos = fullPath.find_last_of("\\/");
-            std::string appName = fullPath.substr(pos + 1);
-            return { appName, fullPath };
-        }
-        CloseHandle(hProcess);
+void SetWindowTitleTracking(bool enabled) {
+    {
+        std::lock_guard<std::mutex> lock(dataMutex);
+        trackingEngine.SetTitleTracking(enabled);
+    }
+    foregroundSource.readTitles = enabled;
+}
+
+bool WindowTitleTracking() {
+    return foregroundSource.readTitles;
+}
+
+void SetIdleDetection(bool enabled) {
+    std::lock_guard<std::mutex> lock(dataMutex);
+    trackingEngine.SetIdleThreshold(enabled ? IDLE_THRESHOLD : std::chrono::minutes(0));
+    idleDetection = enabled;
+}
+
+bool IdleDetection() {
+    return idleDetection;
+}
+
+void EditCategoryRules() {
+    if (!FileExists(CATEGORY_RULES_FILE)) {
+        std::ofstream file(CATEGORY_RULES_FILE, std::ios::out);
+        file << "# One rule per line: Category = pattern. The first rule matching an app's path wins.\n"
+                "# Patterns are globs over the whole path (* matches anything, ? one character),\n"
+                "# or regular expressions searched for in it when prefixed with re:. Case is ignored.\n"
+                "Development = *\\devenv.exe\n"
+                "Development = *\\Microsoft VS Code\\Code.exe\n"
+                "Browsing = *\\chrome.exe\n"
+                "Browsing = *\\firefox.exe\n"
+                "Browsing = *\\msedge.exe\n"
+                "Communication = re:\\\\(slack|teams|discord|outlook)\\.exe$\n";
+    }
+    ShellExecuteA(NULL, "open", "notepad.exe", CATEGORY_RULES_FILE, NULL, SW_SHOWNORMAL);
+}
+
+void PublishUsageSnapshot() {
+    std::lock_guard<std::mutex> lock(dataMutex);
+    usagePublisher.Publish(trackingEngine, std::chrono::system_clock::now());
+}
+
+void CheckpointTrackingData() {
+    TrackingStore::Checkpoint checkpoint;
+    {
+        std::lock_guard<std::mutex> lock(dataMutex);
+        checkpoint = trackingStore.PrepareCheckpoint(trackingEngine);
     }
-    return { "Unknown", "" };
+    trackingStore.CommitCheckpoint(checkpoint);
 }
@@ -6,16 +6,35 @@
 #include <utility>
 #include <chrono>
 #include <mutex>
-#include <map>
+#include "TrackingEngine.h"
+#include "TrackingStore.h"
+#include "UsageSnapshot.h"
 
 extern std::mutex dataMutex;
-extern std::map<std::string, std::chrono::seconds> appActiveTime;
-extern std::map<std::string, std::string> appPaths;
-extern std::string currentAppName;
-extern std::string currentAppPath;
+extern TrackingEngine trackingEngine;
+extern TrackingStore trackingStore;
+// What the window draws from, republished by the tracker every tick. Its
+// ranges are the last 24 hours, 3 days, week and 30 days, in TimeRange order.
+extern SnapshotPublisher usagePublisher;
 
-std::pair<std::string, std::string> GetAppNameAndPathFromWindow(HWND hwnd);
 void StartTrackingThread();
+
+// Loads tracking_data.bin and replays its journal; call before the tracking thread starts.
+void RecoverTrackingData();
+// Turns per-window-title attribution on or off; takes dataMutex itself.
+void SetWindowTitleTracking(bool enabled);
+bool WindowTitleTracking();
+// Stops counting after five minutes without keyboard or mouse input, taking
+// back the idle minutes already counted. On by default; takes dataMutex itself.
+void SetIdleDetection(bool enabled);
+bool IdleDetection();
+// Opens category_rules.txt in Notepad, first writing an example if there is
+// none. The tracker picks up saved edits within a few seconds.
+void EditCategoryRules();
+// Publishes a fresh usage snapshot now rather than on the next tick. Takes dataMutex itself.
+void PublishUsageSnapshot();
+// Writes a snapshot and compacts the journal. Takes dataMutex itself.
+void CheckpointTrackingData();
 std::string FormatDuration(std::chrono::seconds duration);
 
 #endif
@@ -0,0 +1,3250 @@
+// Headless test-and-bench driver for the tracking core.
+// Replays scripted foreground traces through TrackingEngine on a synthetic clock,
+// checks the resulting totals against the script and reports per-tick cost.
+//
+// Usage: tracker_bench [--trace <file>] [--ticks <n>] [--apps <n>] [--frame <file.ppm>]
+
+#include "TrackingEngine.h"
+#include "ScriptedForegroundSource.h"
+#include "ScriptedInputSource.h"
+#include "FormatUtils.h"
+#include "JsonStore.h"
+#include "SnapshotFile.h"
+#include "TrackingStore.h"
+#include "IconCache.h"
+#include "UsageListLayout.h"
+#include "UsageListDamage.h"
+#include "FrameScheduler.h"
+#include "UsageListRenderer.h"
+#include "CpuRasterizer.h"
+#include "TextRunCache.h"
+#include "UsageSnapshot.h"
+#include "AppRanking.h"
+#include "UsageQuery.h"
+#include "ThreadPool.h"
+#include "UsageHeatmap.h"
+#include "HeatmapView.h"
+#include "TitleSketch.h"
+#include "FocusAnalytics.h"
+#include "CategoryRules.h"
+#include "AllocationCounter.h"
+#include "json.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <regex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "ProcessIdentityCache.h"
+#include <iomanip>
+#include <sstream>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#ifndef _WIN32
+#include "ProcProcessResolver.h"
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+int failures = 0;
+
+void Check(bool condition, const char* what) {
+    if (!condition) {
+        std::printf("FAIL: %s\n", what);
+        ++failures;
+    }
+}
+
+long long ActiveSeconds(const TrackingEngine& engine, const std::string& appName) {
+    uint32_t appId = engine.Apps().Find(appName);
+    return appId == AppTable::NO_APP ? 0 : engine.AppActiveTime(appId).count();
+}
+
+// Builds a trace of random focus runs over "appCount" apps totalling "ticks" samples.
+ScriptedForegroundSource MakeSyntheticTrace(size_t ticks, size_t appCount, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<size_t> appDist(0, appCount - 1);
+    std::geometric_distribution<size_t> runDist(0.02); // ~50 s average focus run
+
+    ScriptedForegroundSource source;
+    size_t remaining = ticks;
+    while (remaining > 0) {
+        size_t run = std::min(remaining, runDist(rng) + 1);
+        size_t app = appDist(rng);
+        std::string name = "app" + std::to_string(app) + ".exe";
+        source.AddStep(name, "C:\\Program Files\\" + name, run);
+        remaining -= run;
+    }
+    return source;
+}
+
+// Expected totals for a trace sampled once per second: each sample charges the
+// time since the previous sample to the app seen previously.
+std::map<std::string, std::chrono::seconds> ExpectedTotals(const ScriptedForegroundSource& source) {
+    std::map<std::string, std::chrono::seconds> expected;
+    std::string last;
+    long long lastTick = 0;
+    long long tick = 0;
+    for (const auto& step : source.Steps()) {
+        if (!step.appName.empty()) {
+            if (!last.empty()) {
+                expected[last] += std::chrono::seconds(tick - lastTick);
+            }
+            expected[step.appName] += std::chrono::seconds(step.samples - 1);
+            last = step.appName;
+            lastTick = tick + static_cast<long long>(step.samples) - 1;
+        }
+        tick += static_cast<long long>(step.samples);
+    }
+    return expected;
+}
+
+void RunReplay(const char* label, ScriptedForegroundSource& source, bool checkAccuracy) {
+    TrackingEngine engine;
+    auto simulated = std::chrono::system_clock::time_point(std::chrono::hours(24 * 365 * 50));
+
+    size_t ticks = 0;
+    auto begin = std::chrono::steady_clock::now();
+    while (!source.Finished()) {
+        engine.Tick(source, simulated);
+        simulated += std::chrono::seconds(1);
+        ++ticks;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    double nsPerTick = std::chrono::duration<double, std::nano>(elapsed).count() / (ticks ? ticks : 1);
+
+    std::chrono::seconds total(0);
+    for (uint32_t appId = 0; appId < engine.AppCount(); ++appId) {
+        total += engine.AppActiveTime(appId);
+    }
+    std::printf("%-24s ticks=%zu apps=%zu tracked=%s  %.1f ns/tick\n",
+                label, ticks, engine.AppCount(), FormatDuration(total).c_str(), nsPerTick);
+
+    if (checkAccuracy) {
+        auto expected = ExpectedTotals(source);
+        long long drift = 0;
+        for (const auto& [appName, seconds] : expected) {
+            drift += std::llabs(ActiveSeconds(engine, appName) - seconds.count());
+        }
+        std::printf("%-24s accuracy drift=%llds\n", label, drift);
+        Check(drift == 0, "replayed totals match the script");
+
+        // The interval log must account for exactly the same time as the running totals
+        auto logged = engine.RangeTotals(std::chrono::system_clock::time_point(), simulated);
+        std::chrono::seconds loggedTotal(0);
+        for (const auto& entry : logged) {
+            loggedTotal += entry.second;
+        }
+        std::printf("%-24s intervals=%zu (%zu bytes)\n", label, engine.Intervals().Size(),
+                    engine.Intervals().Size() * sizeof(FocusInterval));
+        Check(loggedTotal == total, "interval log matches running totals");
+    }
+}
+
+void TestSwitchAccounting() {
+    TrackingEngine engine;
+    auto t0 = std::chrono::system_clock::time_point(std::chrono::seconds(1000));
+    engine.Record({ "a.exe", "C:\\a.exe" }, t0);
+    engine.Record({ "a.exe", "C:\\a.exe" }, t0 + std::chrono::seconds(5));
+    engine.Record({ "b.exe", "C:\\b.exe" }, t0 + std::chrono::seconds(8));
+    engine.Record({ "b.exe", "C:\\b.exe" }, t0 + std::chrono::seconds(10));
+
+    Check(ActiveSeconds(engine, "a.exe") == 8, "switch charges the previous app");
+    Check(ActiveSeconds(engine, "b.exe") == 2, "same-app samples accumulate");
+    Check(engine.AppPath(engine.Apps().Find("a.exe")) == "C:\\a.exe", "path remembered on switch");
+    Check(engine.CurrentAppId() == engine.Apps().Find("b.exe"), "current app follows the last sample");
+
+    engine.Clear(t0 + std::chrono::seconds(11));
+    std::chrono::system_clock::time_point lastActive;
+    Check(ActiveSeconds(engine, "a.exe") == 0 && ActiveSeconds(engine, "b.exe") == 0
+          && !engine.AppLastActive(engine.Apps().Find("a.exe"), lastActive)
+          && engine.AppLastActive(engine.Apps().Find("b.exe"), lastActive),
+          "clear keeps only the current app");
+}
+
+void TestGapsAreSkipped() {
+    ScriptedForegroundSource source;
+    source.AddStep("a.exe", "C:\\a.exe", 3);
+    source.AddStep("", "", 2); // No foreground window
+    source.AddStep("a.exe", "C:\\a.exe", 1);
+
+    TrackingEngine engine;
+    auto t = std::chrono::system_clock::time_point(std::chrono::seconds(0));
+    size_t recorded = 0;
+    while (!source.Finished()) {
+        recorded += engine.Tick(source, t) ? 1 : 0;
+        t += std::chrono::seconds(1);
+    }
+    Check(recorded == 4, "empty samples are not recorded");
+    Check(ActiveSeconds(engine, "a.exe") == 5, "time without a sample stays with the current app");
+}
+
+void TestIntervalSlicing() {
+    TrackingEngine engine;
+    auto t0 = std::chrono::system_clock::time_point(std::chrono::hours(1000));
+    engine.Record({ "a.exe", "C:\\a.exe" }, t0);
+    engine.Record({ "b.exe", "C:\\b.exe" }, t0 + std::chrono::seconds(100));
+    engine.Record({ "a.exe", "C:\\a.exe" }, t0 + std::chrono::seconds(150));
+    engine.Record({ "a.exe", "C:\\a.exe" }, t0 + std::chrono::seconds(200));
+
+    Check(engine.Intervals().Size() == 2, "each switch closes one interval");
+
+    // Window [50, 175) cuts into the first a.exe span and the open one
+    auto totals = engine.RangeTotals(t0 + std::chrono::seconds(50), t0 + std::chrono::seconds(175));
+    std::map<std::string, long long> byName;
+    for (const auto& [appId, seconds] : totals) {
+        byName[engine.AppName(appId)] = seconds.count();
+    }
+    Check(byName["a.exe"] == 75, "range clips intervals on both ends");
+    Check(byName["b.exe"] == 50, "range includes fully covered intervals");
+
+    auto none = engine.RangeTotals(t0 + std::chrono::seconds(500), t0 + std::chrono::seconds(600));
+    Check(none.empty(), "apps without time in the window are omitted");
+}
+
+// A year of history at ~500k intervals; every range query must stay sub-millisecond.
+void BenchRangeQueries() {
+    const int64_t yearStart = 1700000000;
+    const size_t intervalCount = 500000;
+    const int64_t span = 365LL * 24 * 3600;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<uint32_t> appDist(0, 299);
+
+    IntervalLog log;
+    log.Reserve(intervalCount);
+    int64_t step = span / static_cast<int64_t>(intervalCount);
+    for (size_t i = 0; i < intervalCount; ++i) {
+        log.Append({ yearStart + static_cast<int64_t>(i) * step, static_cast<uint32_t>(step - 5), appDist(rng) });
+    }
+
+    const int64_t now = yearStart + span;
+    const struct { const char* label; int64_t seconds; } ranges[] = {
+            { "today", 24 * 3600 }, { "last 3 days", 72 * 3600 }, { "last week", 7 * 24 * 3600 },
+            { "last month", 30 * 24 * 3600 }, { "last year", span },
+    };
+
+    std::vector<int64_t> totals(300, 0);
+    for (const auto& range : ranges) {
+        const int iterations = 50;
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            std::fill(totals.begin(), totals.end(), 0);
+            log.AccumulateRange(now - range.seconds, now, totals);
+        }
+        double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / iterations;
+        std::printf("range query %-12s intervals=%zu  %.1f us\n", range.label, log.Size(), micros);
+        Check(micros < 1000.0, "range query stays under 1 ms");
+    }
+}
+
+// Months of history over hundreds of apps, fed through RestoreInterval so the
+// rollups are built the same way as on load. Rollup answers must match a raw
+// scan of the interval log exactly.
+void BenchRollups() {
+    const int64_t now = 1700000000;
+    const int64_t span = 180LL * 24 * 3600;
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<uint32_t> appDist(0, 499);
+    std::uniform_int_distribution<int64_t> lengthDist(5, 120);
+    std::uniform_int_distribution<int64_t> gapDist(0, 30);
+
+    TrackingEngine engine;
+    for (int64_t t = now - span; t < now;) {
+        int64_t length = lengthDist(rng);
+        std::string name = "app" + std::to_string(appDist(rng)) + ".exe";
+        engine.RestoreInterval(name, "C:\\" + name, FromUnixSeconds(t), FromUnixSeconds(t + length));
+        t += length + gapDist(rng);
+    }
+    std::printf("rollups intervals=%zu buckets minute=%zu hour=%zu day=%zu\n", engine.Intervals().Size(),
+                engine.Rollups().BucketCount(RollupStore::MINUTE_TIER),
+                engine.Rollups().BucketCount(RollupStore::HOUR_TIER),
+                engine.Rollups().BucketCount(RollupStore::DAY_TIER));
+
+    const struct { const char* label; int64_t seconds; } ranges[] = {
+            { "today", 24 * 3600 }, { "last 3 days", 72 * 3600 }, { "last week", 7 * 24 * 3600 },
+            { "last month", 30 * 24 * 3600 }, { "last 6 months", span },
+    };
+    for (const auto& range : ranges) {
+        const int iterations = 200;
+        std::vector<std::pair<uint32_t, std::chrono::seconds>> totals;
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            totals = engine.RangeTotals(FromUnixSeconds(now - range.seconds + 17), FromUnixSeconds(now));
+        }
+        double rollupMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / iterations;
+
+        std::vector<int64_t> raw;
+        begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            raw.assign(engine.AppCount(), 0);
+            engine.Intervals().AccumulateRange(now - range.seconds + 17, now, raw);
+        }
+        double rawMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / iterations;
+
+        bool same = true;
+        size_t nonZero = 0;
+        for (const auto& [appId, seconds] : totals) {
+            same = same && raw[appId] == seconds.count();
+        }
+        for (int64_t value : raw) {
+            nonZero += value > 0 ? 1 : 0;
+        }
+        same = same && nonZero == totals.size();
+
+        std::printf("rollup query %-14s apps=%zu  rollups %.1f us, raw scan %.1f us\n",
+                    range.label, totals.size(), rollupMicros, rawMicros);
+        Check(same, "rollup totals match a raw interval scan");
+        Check(rollupMicros < 4000.0, "rollup query fits in a 60 Hz frame budget");
+    }
+}
+
+// A year of random focus intervals over 200 apps (~400k intervals) ending at "now"
+void MakeYearOfHistory(TrackingEngine& engine, int64_t now) {
+    const int64_t span = 365LL * 24 * 3600;
+    std::mt19937 rng(23);
+    std::uniform_int_distribution<uint32_t> appDist(0, 199);
+    std::uniform_int_distribution<int64_t> lengthDist(5, 120);
+    std::uniform_int_distribution<int64_t> gapDist(0, 30);
+
+    for (int64_t t = now - span; t < now;) {
+        int64_t length = lengthDist(rng);
+        std::string name = "app" + std::to_string(appDist(rng)) + ".exe";
+        engine.RestoreInterval(name, "C:\\" + name, FromUnixSeconds(t), FromUnixSeconds(t + length));
+        t += length + gapDist(rng);
+    }
+}
+
+// Startup cost with a year of history: mapped binary snapshot versus JSON import.
+void BenchSnapshotLoad() {
+    const int64_t now = 1700000000;
+    const int64_t span = 365LL * 24 * 3600;
+    TrackingEngine engine;
+    MakeYearOfHistory(engine, now);
+    // Leave an open interval behind, as a running tracker would
+    engine.Record({ "app7.exe", "C:\\app7.exe" }, FromUnixSeconds(now));
+    engine.Record({ "app7.exe", "C:\\app7.exe" }, FromUnixSeconds(now + 40));
+
+    const char* snapshotFile = "tracker_bench_snapshot.bin";
+    const char* jsonFile = "tracker_bench_snapshot.json";
+    Check(WriteSnapshot(engine, snapshotFile), "snapshot is written");
+    Check(ExportTrackingDataToJson(engine, jsonFile), "JSON export is written");
+
+    TrackingEngine fromSnapshot;
+    auto begin = std::chrono::steady_clock::now();
+    bool loaded = LoadSnapshot(fromSnapshot, snapshotFile);
+    double snapshotMillis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    Check(loaded, "snapshot loads");
+
+    TrackingEngine fromJson;
+    begin = std::chrono::steady_clock::now();
+    loaded = ImportTrackingDataFromJson(fromJson, jsonFile);
+    double jsonMillis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    Check(loaded, "JSON imports");
+
+    std::printf("snapshot load intervals=%zu apps=%zu  snapshot %.2f ms, JSON %.1f ms\n",
+                fromSnapshot.Intervals().Size(), fromSnapshot.AppCount(), snapshotMillis, jsonMillis);
+    Check(snapshotMillis < 10.0, "a year of history loads in under 10 ms");
+
+    bool same = fromSnapshot.AppCount() == engine.AppCount();
+    for (uint32_t appId = 0; same && appId < engine.AppCount(); ++appId) {
+        same = fromSnapshot.AppName(appId) == engine.AppName(appId)
+               && fromSnapshot.AppPath(appId) == engine.AppPath(appId)
+               && fromSnapshot.AppActiveTime(appId) == engine.AppActiveTime(appId);
+    }
+    Check(same, "snapshot round-trips the app table");
+
+    const int64_t ranges[] = { 3600, 24 * 3600, 7 * 24 * 3600, 30 * 24 * 3600, span };
+    for (int64_t range : ranges) {
+        auto expected = engine.RangeTotals(FromUnixSeconds(now + 40 - range + 17), FromUnixSeconds(now + 40));
+        Check(fromSnapshot.RangeTotals(FromUnixSeconds(now + 40 - range + 17), FromUnixSeconds(now + 40)) == expected,
+              "snapshot round-trips range totals");
+        Check(fromJson.RangeTotals(FromUnixSeconds(now + 40 - range + 17), FromUnixSeconds(now + 40)) == expected,
+              "JSON round-trips range totals");
+    }
+
+    std::remove(snapshotFile);
+    std::remove(jsonFile);
+}
+
+// Focus seconds per app name over all time, including the open interval
+std::map<std::string, long long> TotalsByName(const TrackingEngine& engine) {
+    std::map<std::string, long long> totals;
+    auto all = engine.RangeTotals(std::chrono::system_clock::time_point(),
+                                  std::chrono::system_clock::time_point(std::chrono::hours(24 * 365 * 100)));
+    for (const auto& [appId, seconds] : all) {
+        totals[engine.AppName(appId)] += seconds.count();
+    }
+    return totals;
+}
+
+long long Sum(const std::map<std::string, long long>& totals) {
+    long long sum = 0;
+    for (const auto& entry : totals) {
+        sum += entry.second;
+    }
+    return sum;
+}
+
+void RemoveStoreFiles(const TrackingStore& store) {
+    std::remove(store.SnapshotFile().c_str());
+    std::remove(store.JournalFile().c_str());
+    std::remove(store.ArchivedJournalFile().c_str());
+}
+
+// Runs a trace with journaling on, "crashes" (abandons the store without a
+// final checkpoint) and recovers into a fresh engine. Flush deadlines run on
+// the simulated clock, one tick per second.
+void TestJournalRecovery() {
+    const std::string snapshotFile = "tracker_bench_journal.bin";
+    const size_t ticks = 200000;
+    const auto progressDelay = std::chrono::seconds(30);
+
+    enum Crash { AFTER_FLUSH, MID_CHECKPOINT, TORN_TAIL };
+    const struct { Crash crash; const char* label; } cases[] = {
+            { AFTER_FLUSH, "after flush" }, { MID_CHECKPOINT, "mid checkpoint" }, { TORN_TAIL, "torn tail" },
+    };
+    for (const auto& test : cases) {
+        ScriptedForegroundSource source = MakeSyntheticTrace(ticks, 40, 5);
+        TrackingEngine engine;
+        TrackingStore store(snapshotFile);
+        RemoveStoreFiles(store);
+        Check(store.Recover(engine, ""), "journal starts on an empty store");
+
+        auto simulated = std::chrono::system_clock::time_point(std::chrono::hours(24 * 365 * 50));
+        auto steady = std::chrono::steady_clock::time_point();
+        uint64_t bytesAtCheckpoint = 0;
+        size_t switches = 0;
+        uint32_t lastApp = AppTable::NO_APP;
+        for (size_t tick = 0; !source.Finished(); ++tick) {
+            engine.Tick(source, simulated);
+            simulated += std::chrono::seconds(1);
+            steady += std::chrono::seconds(1);
+            if (engine.CurrentAppId() != lastApp) {
+                lastApp = engine.CurrentAppId();
+                ++switches;
+            }
+            store.Journal().FlushIfDue(steady);
+            if (tick == ticks / 2) {
+                TrackingStore::Checkpoint checkpoint = store.PrepareCheckpoint(engine);
+                if (test.crash != MID_CHECKPOINT) {
+                    store.CommitCheckpoint(checkpoint);
+                }
+                bytesAtCheckpoint = store.Journal().BytesWritten();
+                switches = 0;
+            }
+        }
+        store.Journal().Flush();
+        uint64_t journalBytes = store.Journal().BytesWritten() - bytesAtCheckpoint;
+        engine.SetListener(nullptr);
+
+        if (test.crash == TORN_TAIL) {
+            // Cut the last record short, as a crash during the write would
+            std::ifstream in(store.JournalFile(), std::ios::binary);
+            std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            in.close();
+            std::ofstream out(store.JournalFile(), std::ios::binary | std::ios::trunc);
+            out.write(contents.data(), static_cast<std::streamsize>(contents.size() - 3));
+            out.close();
+
+            TrackingEngine scratch;
+            JournalReplayResult result;
+            Check(ReplayJournal(scratch, store.JournalFile(), 0, result) && result.torn,
+                  "a torn journal record is detected");
+        }
+
+        TrackingEngine recovered;
+        TrackingStore recovery(snapshotFile);
+        auto begin = std::chrono::steady_clock::now();
+        Check(recovery.Recover(recovered, ""), "recovery restarts the journal");
+        double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        recovery.Close(recovered);
+
+        auto expected = TotalsByName(engine);
+        auto actual = TotalsByName(recovered);
+        std::printf("journal %-15s switches=%zu  %.1f bytes/switch  recovered %lld/%lld s in %.2f ms\n",
+                    test.label, switches, switches ? double(journalBytes) / switches : 0.0,
+                    Sum(actual), Sum(expected), millis);
+        if (test.crash == TORN_TAIL) {
+            // Only the open interval's progress since its last record may be lost
+            Check(Sum(actual) <= Sum(expected) && Sum(actual) >= Sum(expected) - progressDelay.count() - 1,
+                  "recovery after a torn write loses at most the unwritten progress");
+        } else {
+            Check(actual == expected, "recovered totals match the crashed engine");
+        }
+        Check(switches > 0 && journalBytes / switches < 32, "journal costs a few bytes per app switch");
+
+        TrackingEngine reloaded;
+        Check(LoadSnapshot(reloaded, snapshotFile) && TotalsByName(reloaded) == actual,
+              "recovery checkpoints what it replayed");
+        store.Close(engine);
+        RemoveStoreFiles(store);
+    }
+
+    // A snapshot that won't load is kept with its journal, not replaced by the legacy JSON
+    TrackingEngine legacy;
+    legacy.Record({ "legacy.exe", "C:\\legacy.exe" }, FromUnixSeconds(1700000000));
+    legacy.Record({ "legacy.exe", "C:\\legacy.exe" }, FromUnixSeconds(1700000100));
+    Check(ExportTrackingDataToJson(legacy, "tracker_bench_legacy.json"), "legacy JSON written");
+    TrackingStore store(snapshotFile);
+    RemoveStoreFiles(store);
+    std::ofstream(snapshotFile, std::ios::binary) << "not a snapshot";
+    std::ofstream(store.JournalFile(), std::ios::binary) << "not a journal";
+    TrackingEngine recovered;
+    Check(store.Recover(recovered, "tracker_bench_legacy.json") && recovered.AppCount() == 0,
+          "a damaged snapshot starts empty history instead of importing the legacy JSON");
+    recovered.Record({ "new.exe", "C:\\new.exe" }, FromUnixSeconds(1700000200));
+    Check(store.CommitCheckpoint(store.PrepareCheckpoint(recovered)), "the fresh history checkpoints");
+    auto contents = [](const std::string& filename) {
+        std::ifstream in(filename, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    };
+    Check(contents(snapshotFile + ".bad") == "not a snapshot" && contents(store.JournalFile() + ".bad") == "not a journal",
+          "the damaged snapshot and its journal are set aside, not overwritten");
+    store.Close(recovered);
+    RemoveStoreFiles(store);
+    std::remove((snapshotFile + ".bad").c_str());
+    std::remove((store.JournalFile() + ".bad").c_str());
+    std::remove("tracker_bench_legacy.json");
+}
+
+// The DOM-based import that ImportTrackingDataFromJson replaced, kept as the baseline
+bool DomImport(TrackingEngine& engine, const std::string& filename) {
+    using json = nlohmann::json;
+    std::ifstream file(filename, std::ios::in);
+    if (!file.is_open()) {
+        return false;
+    }
+    json j;
+    try {
+        file >> j;
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    const json& appData = j.contains("app_data") ? j["app_data"] : json::object();
+    if (j.contains("intervals") && j["intervals"].contains("apps") && j["intervals"].contains("records")) {
+        const json& apps = j["intervals"]["apps"];
+        for (const auto& record : j["intervals"]["records"]) {
+            if (!record.is_array() || record.size() != 3 || !record[0].is_number_unsigned()
+                || record[0].get<size_t>() >= apps.size() || !apps[record[0].get<size_t>()].is_string()
+                || !record[1].is_number_integer() || !record[2].is_number_integer()) {
+                continue;
+            }
+            std::string appName = apps[record[0].get<size_t>()].get<std::string>();
+            std::string appPath;
+            if (appData.contains(appName) && appData[appName].contains("app_path")) {
+                appPath = appData[appName]["app_path"].get<std::string>();
+            }
+            auto begin = FromUnixSeconds(record[1].get<int64_t>());
+            engine.RestoreInterval(appName, appPath, begin, begin + std::chrono::seconds(record[2].get<int64_t>()));
+        }
+    }
+    return true;
+}
+
+bool WriteTextFile(const char* filename, const std::string& contents) {
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file << contents;
+    return file.good();
+}
+
+void TestJsonImport() {
+    const char* jsonFile = "tracker_bench_import.json";
+    const char* appData = R"("app_data": {
+        "a.exe": { "app_path": "C:\\a.exe", "start_time": "Mon Jan  1 00:00:00 2024\n", "time_in_seconds": 10 },
+        "b.exe": { "app_path": "C:\\b.exe", "start_time": "Mon Jan  1 00:00:00 2024\n", "time_in_seconds": 30 }
+    })";
+    const char* apps = R"("apps": ["a.exe", 5, "b.exe"])";
+    const char* records = R"("records": [[0, 100, 10], [1, 200, 5], [2, 300, "x"], "junk", [0, 400, 20, 7],
+                                         [9, 1, 1], [0, 450, -3], [2, 500, 30]])";
+
+    // Export order, then the reverse order, which forces records to be buffered
+    const std::string layouts[] = {
+            std::string("{") + appData + R"(, "intervals": {)" + apps + ", " + records + "}}",
+            std::string(R"({"intervals": {)") + records + ", " + apps + "}, " + appData + "}",
+    };
+    for (const std::string& layout : layouts) {
+        Check(WriteTextFile(jsonFile, layout), "import fixture is written");
+        TrackingEngine engine;
+        JsonImportStats stats;
+        Check(ImportTrackingDataFromJson(engine, jsonFile, nullptr, &stats), "JSON import parses");
+        Check(stats.imported == 2 && stats.skipped == 6, "malformed records are skipped");
+        Check(ActiveSeconds(engine, "a.exe") == 10 && ActiveSeconds(engine, "b.exe") == 30,
+              "well-formed records are imported");
+        uint32_t appId = engine.Apps().Find("a.exe");
+        Check(appId != AppTable::NO_APP && engine.AppPath(appId) == "C:\\a.exe", "paths come from app_data");
+    }
+
+    // Legacy files: per-app totals only
+    Check(WriteTextFile(jsonFile, std::string("{") + appData + "}"), "import fixture is written");
+    TrackingEngine legacy;
+    Check(ImportTrackingDataFromJson(legacy, jsonFile), "legacy JSON import parses");
+    Check(ActiveSeconds(legacy, "a.exe") == 10 && ActiveSeconds(legacy, "b.exe") == 30, "legacy totals are imported");
+
+    // A truncated file keeps what came before the damage
+    std::string truncated = layouts[0].substr(0, layouts[0].find("[2, 500"));
+    Check(WriteTextFile(jsonFile, truncated), "import fixture is written");
+    TrackingEngine partial;
+    Check(!ImportTrackingDataFromJson(partial, jsonFile), "a syntax error is reported");
+    Check(ActiveSeconds(partial, "a.exe") == 10, "records before a syntax error are kept");
+
+    std::remove(jsonFile);
+}
+
+#ifdef __linux__
+// Reads a "Vm...: <n> kB" line from /proc/self/status
+long ProcStatusKb(const char* field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, std::strlen(field), field) == 0) {
+            return std::strtol(line.c_str() + std::strlen(field) + 1, nullptr, 10);
+        }
+    }
+    return -1;
+}
+
+// Starts a fresh peak-RSS window and returns the current RSS in kB
+long ResetPeakRss() {
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+    std::ofstream("/proc/self/clear_refs") << "5";
+    return ProcStatusKb("VmRSS:");
+}
+#endif
+
+// Legacy import of a year of history: streaming SAX import versus the DOM parse it replaced.
+void BenchJsonImport() {
+    const char* jsonFile = "tracker_bench_year.json";
+    {
+        TrackingEngine engine;
+        MakeYearOfHistory(engine, 1700000000);
+        Check(ExportTrackingDataToJson(engine, jsonFile), "JSON export is written");
+    }
+    std::ifstream sizeProbe(jsonFile, std::ios::binary | std::ios::ate);
+    double megabytes = static_cast<double>(sizeProbe.tellg()) / (1024 * 1024);
+    sizeProbe.close();
+
+    const struct { const char* label; bool streaming; } paths[] = { { "DOM", false }, { "SAX", true } };
+    std::map<std::string, long long> totals[2];
+    for (int i = 0; i < 2; ++i) {
+        long peakKb = -1;
+        size_t progressCalls = 0;
+        double millis;
+        {
+            TrackingEngine engine;
+#ifdef __linux__
+            long baselineKb = ResetPeakRss();
+#endif
+            auto begin = std::chrono::steady_clock::now();
+            bool imported = paths[i].streaming
+                    ? ImportTrackingDataFromJson(engine, jsonFile, [&progressCalls](size_t, size_t) { ++progressCalls; })
+                    : DomImport(engine, jsonFile);
+            millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+#ifdef __linux__
+            peakKb = ProcStatusKb("VmHWM:") - baselineKb;
+#endif
+            Check(imported, "year of JSON imports");
+            totals[i] = TotalsByName(engine);
+        }
+        std::printf("json import %-4s %.1f MB file  %.0f ms  peak RSS +%ld kB  progress reports=%zu\n",
+                    paths[i].label, megabytes, millis, peakKb, progressCalls);
+        if (paths[i].streaming) {
+            Check(progressCalls > 1, "streaming import reports progress");
+        }
+    }
+    Check(totals[0] == totals[1], "SAX and DOM imports agree");
+    std::remove(jsonFile);
+}
+
+// Per-tick and per-paint app lookups: the string-keyed maps the tracker used
+// to keep versus the interned struct-of-arrays AppTable.
+void BenchAppLookups(size_t appCount) {
+    std::vector<std::string> names;
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < appCount; ++i) {
+        names.push_back("SomeVendorApplication" + std::to_string(i) + ".exe");
+        paths.push_back("C:\\Program Files\\Some Vendor\\" + names.back());
+    }
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<size_t> appDist(0, appCount - 1);
+    std::vector<size_t> sequence(200000);
+    for (auto& app : sequence) {
+        app = appDist(rng);
+    }
+    const int paints = 200;
+
+    // Map-based layout
+    std::map<std::string, std::chrono::seconds> appActiveTime;
+    std::map<std::string, std::string> appPaths;
+    std::map<std::string, int64_t> appStartTime;
+    std::map<std::string, int> barWidths;
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < sequence.size(); ++i) {
+        const std::string& name = names[sequence[i]];
+        appActiveTime[name] += std::chrono::seconds(1);
+        appPaths[name] = paths[sequence[i]];
+        appStartTime[name] = static_cast<int64_t>(i);
+    }
+    double mapTickNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / sequence.size();
+
+    long long sink = 0;
+    begin = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < paints; ++frame) {
+        for (const auto& [name, seconds] : appActiveTime) {
+            sink += appStartTime.find(name)->second + static_cast<long long>(appPaths[name].size());
+            sink += barWidths[name] += static_cast<int>(seconds.count() & 1);
+        }
+    }
+    double mapPaintUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / paints;
+
+    // Interned table
+    AppTable table;
+    std::vector<int> tableBarWidths;
+    begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < sequence.size(); ++i) {
+        uint32_t appId = table.Intern(names[sequence[i]], paths[sequence[i]]);
+        table.activeSeconds[appId] += 1;
+        table.lastActive[appId] = static_cast<int64_t>(i);
+    }
+    double tableTickNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / sequence.size();
+
+    tableBarWidths.resize(table.Size(), 0);
+    begin = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < paints; ++frame) {
+        for (uint32_t appId = 0; appId < table.Size(); ++appId) {
+            sink += table.lastActive[appId] + static_cast<long long>(table.Path(appId).size());
+            sink += tableBarWidths[appId] += static_cast<int>(table.activeSeconds[appId] & 1);
+        }
+    }
+    double tablePaintUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / paints;
+
+    std::printf("app lookups apps=%zu  maps: %.1f ns/tick %.1f us/paint   table: %.1f ns/tick %.1f us/paint  (%lld)\n",
+                appCount, mapTickNs, mapPaintUs, tableTickNs, tablePaintUs, sink & 1);
+    Check(table.Size() == appCount, "every distinct app gets one row");
+}
+
+// Stands in for ExtractIcon + FromHICON + bicubic resize: renders a 256x256
+// source and box-filters it down to the target size.
+class SyntheticIconDecoder : public IconDecoder {
+public:
+    bool Decode(const std::string& path, int size, int, IconImage& image) override {
+        ++decodes;
+        if (path.find("missing") != std::string::npos) {
+            return false;
+        }
+        const int sourceSize = 256;
+        uint32_t seed = static_cast<uint32_t>(std::hash<std::string>()(path));
+        std::vector<uint32_t> source(sourceSize * sourceSize);
+        for (int y = 0; y < sourceSize; ++y) {
+            for (int x = 0; x < sourceSize; ++x) {
+                source[y * sourceSize + x] = seed ^ static_cast<uint32_t>(x * 2654435761u + y * 40503u);
+            }
+        }
+        image.width = size;
+        image.height = size;
+        image.pixels.resize(static_cast<size_t>(size) * size);
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                uint32_t sum[4] = {};
+                int y0 = y * sourceSize / size, y1 = (y + 1) * sourceSize / size;
+                int x0 = x * sourceSize / size, x1 = (x + 1) * sourceSize / size;
+                for (int sy = y0; sy < y1; ++sy) {
+                    for (int sx = x0; sx < x1; ++sx) {
+                        uint32_t pixel = source[sy * sourceSize + sx];
+                        for (int c = 0; c < 4; ++c) {
+                            sum[c] += (pixel >> (c * 8)) & 0xFF;
+                        }
+                    }
+                }
+                uint32_t count = static_cast<uint32_t>((y1 - y0) * (x1 - x0));
+                uint32_t alpha = sum[3] / count;
+                uint32_t pixel = alpha << 24;
+                for (int c = 0; c < 3; ++c) {
+                    pixel |= (sum[c] / count * alpha / 255) << (c * 8);  // Premultiplied
+                }
+                image.pixels[static_cast<size_t>(y) * size + x] = pixel;
+            }
+        }
+        return true;
+    }
+
+    std::atomic<int> decodes{ 0 };
+};
+
+void TestIconCache() {
+    SyntheticIconDecoder decoder;
+    std::atomic<int> ready{ 0 };
+    IconCache cache(decoder, 4, [&ready] { ++ready; });
+
+    Check(cache.Find("C:\\a.exe", 32, 96) == nullptr, "a miss returns a placeholder");
+    Check(cache.WaitIdle(std::chrono::seconds(5)), "queued icons are decoded");
+    auto icon = cache.Find("C:\\a.exe", 32, 96);
+    Check(icon && icon->width == 32 && icon->pixels.size() == 32 * 32, "decoded icon has the target size");
+    Check(ready == 1, "the UI is told when an icon is ready");
+
+    cache.Find("C:\\a.exe", 48, 144);
+    cache.Find("C:\\missing.exe", 32, 96);
+    cache.WaitIdle(std::chrono::seconds(5));
+    Check(cache.Find("C:\\missing.exe", 32, 96) == nullptr && decoder.decodes == 3,
+          "size and DPI are part of the key and failures are not retried");
+
+    for (int i = 0; i < 6; ++i) {
+        cache.Find("C:\\app" + std::to_string(i) + ".exe", 32, 96);
+        cache.WaitIdle(std::chrono::seconds(5));
+    }
+    Check(cache.Size() == 4, "the cache stays within its capacity");
+    Check(cache.Find("C:\\app5.exe", 32, 96) != nullptr, "recent icons stay cached");
+    Check(icon->width == 32, "evicted icons stay valid while still drawn");
+
+    cache.Clear();
+    Check(cache.Size() == 0 && cache.Find("C:\\app5.exe", 32, 96) == nullptr, "clear drops every icon");
+    cache.Stop();
+}
+
+// Labels are converted from UTF-8 properly and measured once per distinct
+// text: rebuilding the list within a minute measures nothing new.
+void TestTextRuns() {
+    Check(Utf8ToWide("app.exe") == L"app.exe", "ASCII converts unchanged");
+    std::wstring accented = Utf8ToWide("caf\xc3\xa9 \xe6\x97\xa5.exe");
+    Check(accented.size() == 10 && accented[3] == 0xe9 && accented[5] == 0x65e5, "multi-byte sequences decode to one character");
+    std::wstring emoji = Utf8ToWide("\xf0\x9f\x98\x80");
+    Check(sizeof(wchar_t) == 2 ? emoji.size() == 2 && emoji[0] == 0xd83d && emoji[1] == 0xde00
+                               : emoji.size() == 1 && static_cast<uint32_t>(emoji[0]) == 0x1f600,
+          "characters beyond the BMP become surrogate pairs in UTF-16");
+    std::wstring broken = Utf8ToWide("a\xc3(\xc0\xaf\xed\xa0\x80");
+    Check(broken.size() == 6 && broken[1] == 0xfffd && broken[2] == L'(' && broken[3] == 0xfffd && broken[5] == 0xfffd,
+          "malformed, overlong and surrogate sequences become U+FFFD");
+
+    TrackingEngine engine;
+    int64_t now = 1700000000;
+    const int appCount = 30;
+    for (int i = 0; i < appCount * 3; ++i) {
+        std::string name = "\xd0\xbf\xd1\x80\xd0\xb8\xd0\xbb" + std::to_string(i % appCount) + ".exe";
+        engine.Record({ name, "C:\\" + name }, FromUnixSeconds(now));
+        now += 61 + (i * 37) % 600;
+    }
+    UsageListLayout layout;
+    UsageListParams params;
+    params.clientWidth = 400;
+    params.clientHeight = 600;
+    params.rangeStart = FromUnixSeconds(now - 24 * 3600);
+    params.now = FromUnixSeconds(now);
+    layout.Update(engine, params);
+    const UsageRow& top = layout.Rows()[0];
+    Check(top.name->text.compare(0, 4, L"\x43f\x440\x438\x43b") == 0, "app names are decoded from UTF-8");
+    Check(top.name->extent.width == static_cast<int>(top.name->text.size()) * GreekedTextMeasurer::Advance(RenderFont::List, 96),
+          "runs carry their measured extent");
+
+    // A minute of ticks on the running app: each rebuilds the layout, but at
+    // most one duration label changes text
+    uint64_t rebuilds = layout.Rebuilds();
+    uint64_t misses = layout.TextRuns().Misses();
+    std::string runningApp = engine.AppName(engine.Apps().Find("\xd0\xbf\xd1\x80\xd0\xb8\xd0\xbb" + std::to_string(appCount - 1) + ".exe"));
+    for (int s = 1; s <= 60; ++s) {
+        engine.Record({ runningApp, "C:\\" + runningApp }, FromUnixSeconds(now + s));
+        params.now = FromUnixSeconds(now + s);
+        layout.Update(engine, params);
+    }
+    Check(layout.Rebuilds() - rebuilds == 60, "every tick rebuilds the layout");
+    Check(layout.TextRuns().Misses() - misses <= 1, "labels are converted and measured only when their text changes");
+
+    params.dpiScaleX = params.dpiScaleY = 1.5f;
+    layout.Update(engine, params);
+    Check(layout.Rows()[0].name->extent.height == GreekedTextMeasurer::EmPixels(RenderFont::List, 144), "a DPI change remeasures labels");
+}
+
+// 60 Hz paints of a list of apps: decoding every icon on every frame (what
+// WM_PAINT used to do) versus cached lookups with decoding off the UI thread.
+void BenchIconCache() {
+    const int visibleApps = 20;
+    const int frames = 120;
+    std::vector<std::string> paths;
+    for (int i = 0; i < visibleApps; ++i) {
+        paths.push_back("C:\\Program Files\\Vendor\\app" + std::to_string(i) + ".exe");
+    }
+
+    SyntheticIconDecoder inlineDecoder;
+    uint64_t sink = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; ++frame) {
+        for (const auto& path : paths) {
+            IconImage image;
+            inlineDecoder.Decode(path, 32, 96, image);
+            sink += image.pixels[frame % image.pixels.size()];
+        }
+    }
+    double inlineUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / frames;
+
+    SyntheticIconDecoder decoder;
+    IconCache cache(decoder);
+    double firstUs = 0.0;
+    double worstUs = 0.0;
+    double steadyUs = 0.0;
+    int placeholders = 0;
+    for (int frame = 0; frame < frames; ++frame) {
+        auto frameBegin = std::chrono::steady_clock::now();
+        for (const auto& path : paths) {
+            auto icon = cache.Find(path, 32, 96);
+            if (icon) {
+                sink += icon->pixels[frame % icon->pixels.size()];
+            } else {
+                ++placeholders;
+            }
+        }
+        double frameUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - frameBegin).count();
+        if (frame == 0) {
+            // The first frame races the decode thread it wakes; on one core that
+            // is scheduling, not blocking, so it is reported but not checked
+            firstUs = frameUs;
+            cache.WaitIdle(std::chrono::seconds(5));  // Stand-in for the frames that pass while decoding
+        } else {
+            worstUs = std::max(worstUs, frameUs);
+            steadyUs += frameUs;
+        }
+    }
+    steadyUs /= frames - 1;
+    cache.Stop();
+
+    std::printf("icon paint apps=%d  decode every frame: %.0f us/frame   cached: first %.1f us, then %.2f us/frame (worst %.1f us), decodes=%d placeholders=%d  (%llu)\n",
+                visibleApps, inlineUs, firstUs, steadyUs, worstUs, decoder.decodes.load(), placeholders,
+                static_cast<unsigned long long>(sink & 1));
+    Check(decoder.decodes == visibleApps, "each icon is decoded once");
+    Check(placeholders == visibleApps, "only the first frame shows placeholders");
+    Check(worstUs < 1000.0, "cached icon lookups stay far below a frame");
+}
+
+// Ten seconds of 60 Hz paints of a 250-app list with the tracker ticking once a
+// second: rebuilding the list every frame (what WM_PAINT used to do) versus the
+// retained UsageListLayout, which rebuilds once per tick.
+void BenchUsageListLayout() {
+    const int appCount = 250;
+    const int seconds = 10;
+    const int framesPerSecond = 60;
+    const float dpiScale = 1.5f;
+    const int clientWidth = 600;
+    const int clientHeight = 800;
+
+    TrackingEngine engine;
+    int64_t now = 1700000000;
+    for (int i = 0; i < appCount * 4; ++i) {
+        std::string name = "app" + std::to_string(i % appCount) + ".exe";
+        engine.Record({ name, "C:\\Program Files\\" + name }, FromUnixSeconds(now));
+        now += 1 + (i * 37) % 300;
+    }
+    const int64_t firstSecond = now;
+
+    // The old per-frame path: slice, sort, convert and lay out every row
+    long long sink = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (int second = 0; second < seconds; ++second) {
+        now = firstSecond + second;
+        engine.Record({ "app0.exe", "C:\\Program Files\\app0.exe" }, FromUnixSeconds(now));
+        for (int frame = 0; frame < framesPerSecond; ++frame) {
+            auto apps = engine.RangeTotals(FromUnixSeconds(now - 24 * 3600), FromUnixSeconds(now));
+            std::sort(apps.begin(), apps.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+            std::chrono::seconds totalTime(0);
+            for (const auto& entry : apps) {
+                totalTime += entry.second;
+            }
+            int yPos = static_cast<int>(30 * dpiScale);
+            int iconSize = static_cast<int>(32 * dpiScale);
+            for (const auto& entry : apps) {
+                const std::string& appName = engine.AppName(entry.first);
+                std::wstring wAppName(appName.begin(), appName.end());
+                std::string timeStr = FormatDuration(entry.second);
+                std::wstring wTimeStr(timeStr.begin(), timeStr.end());
+                int barX = static_cast<int>(10 * dpiScale) + iconSize + static_cast<int>(5 * dpiScale);
+                double percentage = static_cast<double>(entry.second.count()) / std::max<long long>(totalTime.count(), 1);
+                int barMaxWidth = std::min(300, static_cast<int>(clientWidth - barX - 20 * dpiScale));
+                sink += static_cast<int>(percentage * barMaxWidth) + yPos + static_cast<long long>(wAppName.size() + wTimeStr.size());
+                yPos += iconSize + static_cast<int>(15 * dpiScale);
+            }
+        }
+    }
+    double rebuildUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / (seconds * framesPerSecond);
+
+    UsageListLayout layout;
+    UsageListParams params;
+    params.dpiScaleX = dpiScale;
+    params.dpiScaleY = dpiScale;
+    params.clientWidth = clientWidth;
+    params.clientHeight = clientHeight;
+    begin = std::chrono::steady_clock::now();
+    for (int second = 0; second < seconds; ++second) {
+        now = firstSecond + seconds + second;
+        engine.Record({ "app0.exe", "C:\\Program Files\\app0.exe" }, FromUnixSeconds(now));
+        params.rangeStart = FromUnixSeconds(now - 24 * 3600);
+        params.now = FromUnixSeconds(now);
+        for (int frame = 0; frame < framesPerSecond; ++frame) {
+            layout.Update(engine, params);
+            for (const UsageRow& row : layout.Rows()) {
+                sink += row.targetBarWidth + row.barY + static_cast<long long>(row.name->text.size() + row.timeText->text.size());
+            }
+        }
+    }
+    double retainedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / (seconds * framesPerSecond);
+
+    std::printf("usage list apps=%d  rebuild every frame: %.1f us/frame   retained: %.1f us/frame, %llu rebuilds  (%lld)\n",
+                appCount, rebuildUs, retainedUs, static_cast<unsigned long long>(layout.Rebuilds()), sink & 1);
+    Check(layout.Rebuilds() == static_cast<uint64_t>(seconds), "the layout rebuilds once per tracker tick");
+    Check(retainedUs * 5 < rebuildUs, "a retained frame is much cheaper than a rebuilt one");
+
+    // The model matches a fresh build, and a resize alone relayouts it
+    const auto& rows = layout.Rows();
+    auto expected = engine.RangeTotals(params.rangeStart, params.now);
+    bool sorted = rows.size() == expected.size() && rows.size() == static_cast<size_t>(appCount);
+    for (size_t i = 1; sorted && i < rows.size(); ++i) {
+        sorted = rows[i - 1].time >= rows[i].time && rows[i].barY > rows[i - 1].barY;
+    }
+    Check(sorted, "rows are sorted by time and stacked top to bottom");
+    std::string timeStr = FormatDuration(rows[0].time);
+    Check(rows[0].timeText->text == std::wstring(timeStr.begin(), timeStr.end()), "time labels follow the row's duration");
+    params.clientWidth = 200;
+    Check(layout.Update(engine, params), "a resize rebuilds the layout");
+    Check(layout.Rows()[0].targetBarWidth < 200 - layout.Rows()[0].barX, "bars fit the resized window");
+    Check(!layout.Update(engine, params), "an unchanged frame reuses the layout");
+}
+
+// A size x size icon with transparent corners, distinct per seed
+std::shared_ptr<const IconImage> MakeTestIcon(int size, uint32_t seed) {
+    auto image = std::make_shared<IconImage>();
+    image->width = size;
+    image->height = size;
+    image->pixels.resize(static_cast<size_t>(size) * size);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            bool corner = (x < 2 || x >= size - 2) && (y < 2 || y >= size - 2);
+            uint32_t alpha = corner ? 0 : (x == 2 || y == 2 ? 128 : 255);
+            uint32_t shade = (seed * 53 + static_cast<uint32_t>(x * 5 + y * 3)) & 0xff;
+            uint32_t value = shade * alpha / 255;
+            image->pixels[static_cast<size_t>(y) * size + x] = (alpha << 24) | (value << 16) | ((value / 2) << 8) | (alpha - value / 2);
+        }
+    }
+    return image;
+}
+
+// Ten seconds of the 60 Hz frame loop over a 40-app list: every pixel that
+// differs between consecutive frames must be inside the damage, and the damage
+// should be a small fraction of what full-window invalidation repaints.
+void BenchUsageListDamage() {
+    const int appCount = 40;
+    const int clientWidth = 400;
+    const int clientHeight = 600;
+
+    TrackingEngine engine;
+    int64_t now = 1700000000;
+    for (int i = 0; i < appCount * 4; ++i) {
+        std::string name = "app" + std::to_string(i % appCount) + ".exe";
+        engine.Record({ name, "C:\\Program Files\\" + name }, FromUnixSeconds(now));
+        now += 1 + (i * 37) % 300;
+    }
+
+    UsageListLayout layout;
+    UsageListDamage damage;
+    UsageListParams params;
+    params.clientWidth = clientWidth;
+    params.clientHeight = clientHeight;
+    std::vector<int> barWidths;
+    std::vector<bool> iconReady(appCount, false);
+    std::vector<std::shared_ptr<const IconImage>> iconImages;
+    for (int i = 0; i < appCount; ++i) {
+        iconImages.push_back(MakeTestIcon(32, static_cast<uint32_t>(i)));
+    }
+    UsageIconLookup icon = [&](const UsageRow& row) {
+        return iconReady[row.appId] ? iconImages[row.appId] : nullptr;
+    };
+    UsageListStyle style;
+    CpuRasterizer full(clientWidth, clientHeight);
+    CpuRasterizer partial(clientWidth, clientHeight);  // Only ever repaints the damage
+    bool partialMatches = true;
+    double fullUs = 0.0;
+    double partialUs = 0.0;
+
+    UsageListFrame frame;
+    frame.clientWidth = clientWidth;
+    frame.clientHeight = clientHeight;
+    frame.scrollBarWidth = 15;
+    frame.barWidths = &barWidths;
+    frame.iconReady = [&iconReady](const UsageRow& row) { return static_cast<bool>(iconReady[row.appId]); };
+
+    std::vector<uint32_t> previous;
+    std::vector<uint32_t> current;
+    int64_t damagedPixels = 0;
+    int64_t fullPixels = 0;
+    int64_t uncovered = 0;
+    int frames = 0;
+    int partialFrames = 0;
+    for (int second = 0; second < 10; ++second) {
+        now += 1;
+        // Mostly the same app, with an occasional switch that reorders rows
+        std::string name = second % 4 == 3 ? "app7.exe" : "app3.exe";
+        engine.Record({ name, "C:\\Program Files\\" + name }, FromUnixSeconds(now));
+        // Switching ranges reorders the rows and sets every bar animating
+        params.rangeStart = FromUnixSeconds(now - (second < 2 ? 7 * 24 : 2) * 3600);
+        params.now = FromUnixSeconds(now);
+
+        for (int tick = 0; tick < 60; ++tick, ++frames) {
+            layout.Update(engine, params);
+            for (const UsageRow& row : layout.Rows()) {
+                if (row.appId >= barWidths.size()) {
+                    barWidths.resize(row.appId + 1, -1);
+                }
+                int& width = barWidths[row.appId];
+                width = width < 0 ? row.targetBarWidth : static_cast<int>(width + 0.1f * (row.targetBarWidth - width));
+            }
+            if (frames % 7 == 0) {
+                iconReady[(frames / 7) % 12] = true;  // Icons trickle in from the decoder
+            }
+            if (second == 5 && tick == 30) {
+                frame.scrollPos = 120;
+            }
+            int scrollMax = std::max(layout.ContentHeight() - clientHeight, 1);
+            frame.thumbY = static_cast<int>((clientHeight - 50) * (static_cast<double>(frame.scrollPos) / scrollMax));
+
+            DamageRegion region;
+            damage.Diff(layout, frame, region);
+            auto paintStart = std::chrono::steady_clock::now();
+            PaintUsageList(full, layout, frame, style, icon, { 0, 0, clientWidth, clientHeight });
+            auto paintEnd = std::chrono::steady_clock::now();
+            for (const DamageRect& rect : region.Rects()) {
+                PaintUsageList(partial, layout, frame, style, icon, rect);
+            }
+            partialUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - paintEnd).count();
+            fullUs += std::chrono::duration<double, std::micro>(paintEnd - paintStart).count();
+            current = full.Pixels();
+            partialMatches &= partial.Pixels() == current;
+            if (!previous.empty()) {
+                for (int y = 0; y < clientHeight; ++y) {
+                    for (int x = 0; x < clientWidth; ++x) {
+                        size_t i = static_cast<size_t>(y) * clientWidth + x;
+                        if (current[i] != previous[i] && !region.Intersects({ x, y, 1, 1 })) {
+                            ++uncovered;
+                        }
+                    }
+                }
+            }
+            damagedPixels += region.Area();
+            if (!region.Empty() && region.Area() < static_cast<int64_t>(clientWidth) * clientHeight) {
+                ++partialFrames;
+            }
+            fullPixels += static_cast<int64_t>(clientWidth) * clientHeight;
+            previous.swap(current);
+        }
+    }
+
+    double seconds = frames / 60.0;
+    std::printf("usage list damage  full invalidation %.1f Mpx/s   damage-tracked %.2f Mpx/s (%.1f%%), %d partial frames\n",
+                fullPixels / seconds / 1e6, damagedPixels / seconds / 1e6, 100.0 * damagedPixels / fullPixels, partialFrames);
+    std::printf("usage list paint   full frame %.1f us   damage only %.1f us (CPU rasterizer)\n", fullUs / frames, partialUs / frames);
+    Check(uncovered == 0, "every changed pixel is inside the damage");
+    Check(partialMatches, "repainting only the damage reproduces a full paint");
+    Check(damagedPixels * 5 < fullPixels, "damage tracking repaints a fraction of the window");
+
+    DamageRegion region(4);
+    region.Add({ 0, 0, 10, 10 });
+    region.Add({ 10, 0, 10, 10 });
+    Check(region.Rects().size() == 1 && region.Area() == 200, "touching rectangles merge");
+    for (int i = 0; i < 5; ++i) {
+        region.Add({ 0, 100 + i * 20, 5, 5 });
+    }
+    DamageRect bounds = region.Bounds();
+    Check(region.Rects().size() <= 4 && bounds.Right() == 20 && bounds.Bottom() == 185,
+          "a fragmented region collapses to its bounds");
+}
+
+// Pixel-exact checks of the CPU rasterizer, and a golden image of the usage
+// view: a fixed list rendered at 1.5x DPI must hash to the same value on
+// every platform. Update GOLDEN_USAGE_VIEW only for a deliberate visual change
+// (tracker_bench --frame <file.ppm> writes the frame out for inspection).
+const uint64_t GOLDEN_USAGE_VIEW = 0x22927c21c8e11655ull;
+
+void RenderGoldenUsageView(CpuRasterizer& raster) {
+    TrackingEngine engine;
+    int64_t now = 1700000000;
+    for (int i = 0; i < 24; ++i) {
+        std::string name = "app" + std::to_string(i % 8) + ".exe";
+        engine.Record({ name, "C:\\Program Files\\" + name }, FromUnixSeconds(now));
+        now += 60 + (i * 37) % 900;
+    }
+    UsageListLayout layout;
+    UsageListParams params;
+    params.dpiScaleX = 1.5f;
+    params.dpiScaleY = 1.5f;
+    params.clientWidth = raster.Width();
+    params.clientHeight = raster.Height();
+    params.rangeStart = FromUnixSeconds(now - 24 * 3600);
+    params.now = FromUnixSeconds(now);
+    layout.Update(engine, params);
+
+    std::vector<int> barWidths(engine.AppCount(), 0);
+    for (const UsageRow& row : layout.Rows()) {
+        barWidths[row.appId] = row.targetBarWidth;
+    }
+    UsageListFrame frame;
+    frame.clientWidth = raster.Width();
+    frame.clientHeight = raster.Height();
+    frame.scrollBarWidth = 15;
+    frame.thumbY = 20;
+    frame.barWidths = &barWidths;
+    UsageListStyle style;
+    style.dpiScaleX = 1.5f;
+    UsageIconLookup icon = [&layout](const UsageRow& row) {
+        return row.appId % 2 ? MakeTestIcon(layout.IconSize(), row.appId) : nullptr;
+    };
+    PaintUsageList(raster, layout, frame, style, icon, { 0, 0, raster.Width(), raster.Height() });
+}
+
+void TestCpuRasterizer(const char* framePath) {
+    // The SIMD span fill matches the scalar reference for every alpha and
+    // for lengths around the vector width
+    std::mt19937 rng(7);
+    bool spansMatch = true;
+    for (uint32_t alpha = 0; alpha < 256; alpha += 5) {
+        uint32_t color = CpuRasterizer::Premultiply((alpha << 24) | (rng() & 0xffffff));
+        for (size_t count = 0; count < 11; ++count) {
+            std::vector<uint32_t> simd(count);
+            for (uint32_t& pixel : simd) {
+                pixel = CpuRasterizer::Premultiply(static_cast<uint32_t>(rng()));
+            }
+            std::vector<uint32_t> scalar = simd;
+            CpuRasterizer::BlendSpan(simd.data(), count, color);
+            CpuRasterizer::BlendSpanScalar(scalar.data(), count, color);
+            spansMatch &= simd == scalar;
+        }
+    }
+    Check(spansMatch, "SIMD span blending matches the scalar reference");
+
+    CpuRasterizer raster(16, 8);
+    raster.FillRect(0, 0, 16, 8, MakeRgb(100, 0, 200));
+    raster.FillRect(0, 0, 4, 4, MakeArgb(128, 255, 255, 255));
+    Check(raster.Pixels()[0] == 0xffb280e4u, "translucent fills blend source over");
+    raster.FillRoundedRect(4, 0, 12, 8, 3, MakeRgb(10, 20, 30));
+    Check(raster.Pixels()[4] == 0xff6400c8u && raster.Pixels()[15] == 0xff6400c8u, "rounded corners are left unpainted");
+    Check(raster.Pixels()[7] == 0xff0a141eu && raster.Pixels()[4 + 3 * 16] == 0xff0a141eu, "the inside of a rounded rect is filled");
+    raster.SetClip(8, 2, 4, 4);
+    raster.FillRoundedRectGradient(0, 0, 16, 8, 0, MakeRgb(0, 0, 0), MakeRgb(0, 0, 255));
+    raster.ResetClip();
+    Check(raster.Pixels()[8 + 2 * 16] == 0xff00004fu && raster.Pixels()[8 + 5 * 16] == 0xff0000afu,
+          "gradients are sampled at scanline centres");
+    Check(raster.Pixels()[12 + 2 * 16] == 0xff0a141eu && raster.Pixels()[8 + 1 * 16] == 0xff0a141eu, "drawing stays inside the clip");
+
+    CpuRasterizer view(400, 300, 144);
+    RenderGoldenUsageView(view);
+    uint64_t checksum = view.Checksum();
+    CpuRasterizer again(400, 300, 144);
+    RenderGoldenUsageView(again);
+    Check(again.Checksum() == checksum, "rendering the same frame twice is identical");
+    if (checksum != GOLDEN_USAGE_VIEW) {
+        std::printf("usage view checksum %016llx, golden %016llx\n", static_cast<unsigned long long>(checksum),
+                    static_cast<unsigned long long>(GOLDEN_USAGE_VIEW));
+    }
+    Check(checksum == GOLDEN_USAGE_VIEW, "the usage view matches its golden image");
+    if (framePath) {
+        view.WritePpm(framePath);
+    }
+}
+
+// Frame time of the usage view on the CPU rasterizer at a typical window
+// size, and how much the SIMD span fill saves on the bar gradients
+void BenchCpuRasterizer() {
+    const int frames = 200;
+    CpuRasterizer view(800, 1000, 144);
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; ++f) {
+        RenderGoldenUsageView(view);
+    }
+    double frameUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / frames;
+
+    const size_t spanLength = 300;
+    const int spans = 200000;
+    std::vector<uint32_t> span(spanLength, 0xff191919u);
+    uint32_t color = CpuRasterizer::Premultiply(MakeArgb(150, 150, 150, 150));
+    double spanNs[2];
+    for (int pass = 0; pass < 2; ++pass) {
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < spans; ++i) {
+            span[i % spanLength] = 0xff191919u;
+            if (pass == 0) {
+                CpuRasterizer::BlendSpanScalar(span.data(), spanLength, color);
+            } else {
+                CpuRasterizer::BlendSpan(span.data(), spanLength, color);
+            }
+        }
+        spanNs[pass] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / spans;
+    }
+    std::printf("cpu rasterizer     800x1000 usage view %.1f us/frame   %zu px span: scalar %.0f ns, SIMD %.0f ns  (%u)\n",
+                frameUs, spanLength, spanNs[0], spanNs[1], span[0] & 1);
+}
+
+// Snapshots match the engine at the time they were taken and never change
+// afterwards, and a layout built from one agrees with one built from the engine.
+void TestUsageSnapshots() {
+    TrackingEngine engine;
+    int64_t now = 1700000000;
+    for (int i = 0; i < 60; ++i) {
+        std::string name = "app" + std::to_string(i % 12) + ".exe";
+        engine.Record({ name, "C:\\" + name }, FromUnixSeconds(now));
+        now += 30 + (i * 37) % 4000;
+    }
+    SnapshotPublisher publisher({ std::chrono::hours(24), std::chrono::hours(24 * 7) });
+    Check(publisher.Current() == nullptr && publisher.Sequence() == 0, "nothing is published before the first tick");
+    publisher.Publish(engine, FromUnixSeconds(now));
+    auto first = publisher.Current();
+    auto expected = engine.RangeTotals(FromUnixSeconds(now - 7 * 24 * 3600), FromUnixSeconds(now));
+    std::sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) { return a.second > b.second || (a.second == b.second && a.first < b.first); });
+    Check(first && first->sequence == 1 && first->ranges.size() == 2 && first->ranges[1] == expected, "snapshots carry each range's sorted totals");
+    Check(first->AppCount() == engine.AppCount() && first->AppPath(3) == engine.AppPath(3), "snapshots name every app");
+
+    std::vector<std::pair<uint32_t, std::chrono::seconds>> kept = first->ranges[0];
+    engine.Record({ "app0.exe", "C:\\app0.exe" }, FromUnixSeconds(now + 500));
+    publisher.Publish(engine, FromUnixSeconds(now + 500));
+    auto second = publisher.Current();
+    Check(second->sequence == 2 && publisher.Sequence() == 2 && first->ranges[0] == kept, "a held snapshot is unaffected by later ticks");
+    Check(second->apps == first->apps, "the app directory is shared until an app is added");
+    engine.Record({ "new.exe", "C:\\new.exe" }, FromUnixSeconds(now + 501));
+    publisher.Publish(engine, FromUnixSeconds(now + 501));
+    Check(publisher.Current()->apps != first->apps && publisher.Current()->AppName(engine.AppCount() - 1) == "new.exe" &&
+          first->AppCount() == engine.AppCount() - 1, "new apps get a new directory and old snapshots keep theirs");
+
+    UsageListLayout fromEngine;
+    UsageListLayout fromSnapshot;
+    UsageListParams params;
+    params.clientWidth = 400;
+    params.clientHeight = 600;
+    params.rangeStart = FromUnixSeconds(now + 501 - 24 * 3600);
+    params.now = FromUnixSeconds(now + 501);
+    fromEngine.Update(engine, params);
+    Check(fromSnapshot.Update(*publisher.Current(), 0, params), "a new snapshot rebuilds the layout");
+    Check(!fromSnapshot.Update(*publisher.Current(), 0, params), "the same snapshot reuses the layout");
+    bool same = fromEngine.Rows().size() == fromSnapshot.Rows().size();
+    for (size_t i = 0; same && i < fromEngine.Rows().size(); ++i) {
+        same = fromEngine.Rows()[i].time == fromSnapshot.Rows()[i].time &&
+               fromEngine.Rows()[i].name->text == fromSnapshot.Rows()[i].name->text;
+    }
+    Check(same, "a snapshot lays out like the engine it was taken from");
+}
+
+// Tick latency while the UI paints slowly: the old scheme held dataMutex for
+// the whole paint, so ticks queued behind it; with published snapshots the
+// paint takes no lock and a tick only costs its own work.
+void BenchSnapshotPublishing() {
+    TrackingEngine engine;
+    MakeYearOfHistory(engine, 1700000000);
+    int64_t now = 1700000000;
+    std::mutex mutex;
+    SnapshotPublisher publisher({ std::chrono::hours(24), std::chrono::hours(72), std::chrono::hours(24 * 7), std::chrono::hours(24 * 30) });
+    publisher.Publish(engine, FromUnixSeconds(now));
+
+    const auto paintCost = std::chrono::milliseconds(4);
+    const int ticks = 100;
+    double meanUs[2] = {};
+    double worstUs[2] = {};
+    for (int mode = 0; mode < 2; ++mode) {
+        bool snapshots = mode == 1;
+        std::atomic<bool> painting{ true };
+        std::atomic<uint64_t> frames{ 0 };
+        std::thread ui([&]() {
+            while (painting) {
+                if (snapshots) {
+                    auto snapshot = publisher.Current();
+                    std::this_thread::sleep_for(paintCost);
+                    frames += snapshot->ranges[0].size() > 0 ? 1 : 0;
+                } else {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    std::this_thread::sleep_for(paintCost);
+                    ++frames;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        });
+        double total = 0.0;
+        for (int i = 0; i < ticks; ++i) {
+            std::this_thread::sleep_for(std::chrono::microseconds(700 + (i * 331) % 2000));
+            auto start = std::chrono::steady_clock::now();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++now;
+                engine.Record({ "app" + std::to_string(i % 7) + ".exe", "" }, FromUnixSeconds(now));
+                if (snapshots) {
+                    publisher.Publish(engine, FromUnixSeconds(now));
+                }
+            }
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            total += us;
+            worstUs[mode] = std::max(worstUs[mode], us);
+        }
+        painting = false;
+        ui.join();
+        meanUs[mode] = total / ticks;
+    }
+    std::printf("tick under paint   lock held while painting: mean %.0f us, worst %.0f us   snapshots: mean %.0f us, worst %.0f us\n",
+                meanUs[0], worstUs[0], meanUs[1], worstUs[1]);
+    Check(meanUs[1] * 4 < meanUs[0], "ticks no longer wait for paint");
+}
+
+// The incrementally kept rankings agree with recounting and sorting: random
+// adds against a sorted copy, and trailing windows against RangeTotals()
+// through app switches, checkpoint splits and a Clear().
+void TestAppRanking() {
+    std::mt19937 rng(11);
+    AppRanking ranking;
+    std::vector<int64_t> reference(50, 0);
+    bool ordered = true;
+    for (int i = 0; i < 5000 && ordered; ++i) {
+        uint32_t appId = rng() % reference.size();
+        int64_t delta = static_cast<int64_t>(rng() % 200) - (i % 3 == 0 ? 150 : 0);
+        delta = std::max(delta, -reference[appId]);
+        reference[appId] += delta;
+        ranking.Add(appId, delta);
+        std::vector<uint32_t> expected;
+        for (uint32_t id = 0; id < reference.size(); ++id) {
+            if (reference[id] > 0) {
+                expected.push_back(id);
+            }
+        }
+        std::sort(expected.begin(), expected.end(), [&](uint32_t a, uint32_t b) {
+            return reference[a] > reference[b] || (reference[a] == reference[b] && a < b);
+        });
+        ordered = ranking.Order() == expected && ranking.Rank(expected.empty() ? 0 : expected[0]) == (expected.empty() ? AppRanking::NOT_RANKED : 0);
+    }
+    Check(ordered, "a ranking stays sorted through adds and removals");
+    std::vector<std::pair<uint32_t, std::chrono::seconds>> top;
+    ranking.TopK(3, top);
+    Check(top.size() == std::min<size_t>(3, ranking.Size()) && (top.empty() || top[0].second.count() == ranking.Seconds(ranking.Order()[0])),
+          "top-k reads the head of the ranking");
+
+    TrackingEngine engine;
+    int64_t now = 1700000000;
+    WindowRanking day(std::chrono::hours(24));
+    WindowRanking hour(std::chrono::hours(1));
+    bool matches = true;
+    auto compare = [&](WindowRanking& window, int64_t seconds) {
+        auto expected = engine.RangeTotals(FromUnixSeconds(now - seconds), FromUnixSeconds(now));
+        std::sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) { return a.second > b.second || (a.second == b.second && a.first < b.first); });
+        window.Advance(engine, FromUnixSeconds(now));
+        std::vector<std::pair<uint32_t, std::chrono::seconds>> actual;
+        window.Ranking().TopK(SIZE_MAX, actual);
+        return actual == expected;
+    };
+    std::geometric_distribution<int> runs(0.05);
+    for (int step = 0; step < 3000 && matches; ++step) {
+        std::string name = "app" + std::to_string(rng() % 30) + ".exe";
+        int run = runs(rng) + 1;
+        for (int s = 0; s < run && matches; s += 7) {
+            now += std::min(7, run - s) + (step % 50 == 0 ? 3600 : 0);  // An occasional gap
+            engine.Record({ name, "" }, FromUnixSeconds(now));
+            matches = compare(day, 24 * 3600) && compare(hour, 3600);
+        }
+        if (step % 400 == 399) {
+            engine.SplitOpenInterval();
+        }
+        if (step == 2000) {
+            engine.Clear(FromUnixSeconds(now));
+        }
+    }
+    Check(matches, "window rankings match a recount every tick");
+    Check(day.Recounts() == 2 && hour.Recounts() == 2, "only the first tick and the clear recount");
+}
+
+// Keeping the usage list ordered at 10k apps: copying the totals out and
+// sorting them every tick (as paint used to) versus repositioning the
+// running app in the ranking and reading the top of it.
+void BenchRanking() {
+    const size_t appCount = 10000;
+    const int ticks = 2000;
+    const size_t topK = 20;
+    std::mt19937 rng(5);
+    std::vector<int64_t> activeSeconds(appCount);
+    AppRanking ranking;
+    std::vector<std::pair<uint32_t, std::chrono::seconds>> initial;
+    for (uint32_t appId = 0; appId < appCount; ++appId) {
+        activeSeconds[appId] = 1 + rng() % 100000;
+        initial.emplace_back(appId, std::chrono::seconds(activeSeconds[appId]));
+    }
+    ranking.Assign(initial);
+
+    std::vector<uint32_t> running(ticks);
+    for (int i = 0; i < ticks; ++i) {
+        running[i] = i / 50 % 2 ? static_cast<uint32_t>(rng() % appCount) : static_cast<uint32_t>(i / 100 % 10);  // Long runs on a few apps
+    }
+
+    long long sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::pair<uint32_t, std::chrono::seconds>> sorted;
+    for (int i = 0; i < ticks; ++i) {
+        ++activeSeconds[running[i]];
+        sorted.clear();
+        for (uint32_t appId = 0; appId < appCount; ++appId) {
+            sorted.emplace_back(appId, std::chrono::seconds(activeSeconds[appId]));
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second > b.second || (a.second == b.second && a.first < b.first); });
+        sink += sorted[topK - 1].first;
+    }
+    double sortUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / ticks;
+
+    std::vector<std::pair<uint32_t, std::chrono::seconds>> top;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ticks; ++i) {
+        ranking.Add(running[i], 1);
+        ranking.TopK(topK, top);
+        sink += top[topK - 1].first;
+    }
+    double rankUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / ticks;
+    ranking.TopK(appCount, top);
+
+    std::printf("ranking apps=%zu   copy+sort %.1f us/tick   incremental %.3f us/tick (%.2f moves/tick)  (%lld)\n",
+                appCount, sortUs, rankUs, static_cast<double>(ranking.Moves()) / ticks, sink & 1);
+    Check(top == sorted, "the incremental ranking ends where sorting does");
+    Check(rankUs * 20 < sortUs, "repositioning one app is much cheaper than sorting");
+
+    // Trailing windows over a year of history: RangeTotals + sort per tick
+    // versus advancing the window ranking
+    TrackingEngine engine;
+    MakeYearOfHistory(engine, 1700000000);
+    int64_t now = 1700000000;
+    WindowRanking month(std::chrono::hours(24 * 30));
+    month.Advance(engine, FromUnixSeconds(now));
+    double queryUs[2] = {};
+    for (int mode = 0; mode < 2; ++mode) {
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 500; ++i) {
+            ++now;
+            engine.Record({ "app" + std::to_string(i / 60 % 5) + ".exe", "" }, FromUnixSeconds(now));
+            if (mode == 0) {
+                auto totals = engine.RangeTotals(FromUnixSeconds(now - 30 * 24 * 3600), FromUnixSeconds(now));
+                std::sort(totals.begin(), totals.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+                sink += totals.size();
+            } else {
+                month.Advance(engine, FromUnixSeconds(now));
+                month.Ranking().TopK(topK, top);
+                sink += top.size();
+            }
+        }
+        queryUs[mode] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / 500;
+    }
+    std::printf("ranking last month  RangeTotals+sort %.1f us/tick   window ranking %.1f us/tick  (%lld)\n", queryUs[0], queryUs[1], sink & 1);
+    Check(queryUs[1] < queryUs[0], "advancing a window ranking beats requerying it");
+}
+
+void TestUsageQuery() {
+    TrackingEngine engine;
+    const int64_t now = 1700000000;
+    MakeYearOfHistory(engine, now);
+    engine.Record({ "app3.exe", "C:\\app3.exe" }, FromUnixSeconds(now));
+    engine.Record({ "app3.exe", "C:\\app3.exe" }, FromUnixSeconds(now + 90));
+    ThreadPool pools[] = { ThreadPool(1), ThreadPool(2), ThreadPool(4) };
+
+    auto byApp = [](const std::vector<UsageGroup>& groups) {
+        std::map<uint32_t, int64_t> totals;
+        for (const UsageGroup& group : groups) {
+            totals[group.appId] += group.time.count();
+        }
+        return totals;
+    };
+    bool matches = true;
+    bool aligned = true;
+    bool same = true;
+    for (int64_t seconds : { 3600LL, 24 * 3600LL + 1234, 40 * 24 * 3600LL, 365 * 24 * 3600LL }) {
+        UsageQuery query;
+        query.from = FromUnixSeconds(now + 90 - seconds);
+        query.to = FromUnixSeconds(now + 60);
+        std::map<uint32_t, int64_t> expected;
+        for (const auto& [appId, time] : engine.RangeTotals(query.from, query.to)) {
+            expected[appId] = time.count();
+        }
+        for (UsageGrouping grouping : { UsageGrouping::App, UsageGrouping::AppDay, UsageGrouping::AppHour }) {
+            query.grouping = grouping;
+            query.utcOffset = std::chrono::hours(grouping == UsageGrouping::AppHour ? 0 : -5);
+            auto groups = RunUsageQuery(engine, query, nullptr);
+            matches = matches && byApp(groups) == expected;
+            int64_t bucket = grouping == UsageGrouping::AppDay ? 24 * 3600 : 3600;
+            for (const UsageGroup& group : groups) {
+                aligned = aligned && (grouping == UsageGrouping::App ? group.bucketStart == ToUnixSeconds(query.from)
+                                                                     : (group.bucketStart + query.utcOffset.count()) % bucket == 0 &&
+                                                                       group.time.count() <= bucket);
+            }
+            for (ThreadPool& pool : pools) {
+                same = same && RunUsageQuery(engine, query, &pool) == groups;
+            }
+        }
+    }
+    Check(matches, "query totals per app match RangeTotals in every grouping");
+    Check(aligned, "day and hour groups start on a local bucket boundary");
+    Check(same, "parallel queries return exactly the single-threaded result");
+
+    UsageQuery filtered;
+    filtered.from = FromUnixSeconds(now - 30 * 24 * 3600);
+    filtered.to = FromUnixSeconds(now + 90);
+    filtered.grouping = UsageGrouping::AppDay;
+    filtered.apps = { engine.Apps().Find("app3.exe"), engine.Apps().Find("app42.exe") };
+    auto groups = RunUsageQuery(engine, filtered, &pools[2]);
+    auto totals = byApp(groups);
+    UsageQuery unfiltered;
+    unfiltered.from = filtered.from;
+    unfiltered.to = filtered.to;
+    auto all = byApp(RunUsageQuery(engine, unfiltered, nullptr));
+    Check(totals.size() == 2 && totals[filtered.apps[0]] == all[filtered.apps[0]] && totals[filtered.apps[1]] == all[filtered.apps[1]],
+          "an app filter keeps only the listed apps, with their full time");
+    Check(std::is_sorted(groups.begin(), groups.end(), [](const UsageGroup& a, const UsageGroup& b) {
+              return a.bucketStart < b.bucketStart || (a.bucketStart == b.bucketStart && a.appId < b.appId);
+          }), "groups come ordered by bucket, then app");
+    UsageQuery reversed;
+    reversed.from = filtered.to;
+    reversed.to = filtered.from;
+    Check(RunUsageQuery(engine, reversed, &pools[1]).empty(), "an empty window has no groups");
+}
+
+// Reports over five years of history (~4M intervals): per-app, per-day and
+// per-hour breakdowns of the whole span on growing thread counts.
+void BenchUsageQuery() {
+    const int64_t now = 1700000000;
+    const int64_t span = 5 * 365LL * 24 * 3600;
+    const uint32_t appCount = 500;
+    TrackingEngine engine;
+    std::vector<uint32_t> appIds;
+    for (uint32_t app = 0; app < appCount; ++app) {
+        std::string name = "app" + std::to_string(app) + ".exe";
+        appIds.push_back(engine.RestoreApp(name, "C:\\" + name, 0, 0));
+    }
+    std::mt19937 rng(31);
+    std::vector<FocusInterval> records;
+    for (int64_t t = now - span; t < now;) {
+        uint32_t length = 5 + rng() % 60;
+        records.push_back({ t, length, static_cast<uint32_t>(rng() % appCount) });
+        t += length + rng() % 5;
+    }
+    engine.RestoreIntervals(records.data(), records.size(), appIds);
+
+    size_t cores = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+    const struct { const char* label; UsageGrouping grouping; } groupings[] = {
+            { "app", UsageGrouping::App }, { "app/day", UsageGrouping::AppDay }, { "app/hour", UsageGrouping::AppHour },
+    };
+    for (const auto& grouping : groupings) {
+        UsageQuery query;
+        query.from = FromUnixSeconds(now - span);
+        query.to = FromUnixSeconds(now);
+        query.grouping = grouping.grouping;
+        std::vector<UsageGroup> reference;
+        double singleMs = 0;
+        std::string line;
+        for (size_t threads = 1; threads <= std::max<size_t>(cores, 4); threads *= 2) {
+            ThreadPool pool(threads);
+            const int iterations = 3;
+            std::vector<UsageGroup> groups;
+            auto begin = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                groups = RunUsageQuery(engine, query, &pool);
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() / iterations;
+            if (threads == 1) {
+                reference = groups;
+                singleMs = ms;
+            }
+            Check(groups == reference, "thread count doesn't change a query's answer");
+            char part[64];
+            std::snprintf(part, sizeof(part), "  %zut %.1f ms", threads, ms);
+            line += part;
+            // Only meaningful where the threads have cores of their own
+            if (threads == 4 && cores >= 4) {
+                Check(ms * 2 < singleMs, "four threads scan at least twice as fast as one");
+            }
+        }
+        std::printf("usage query %-9s intervals=%zu groups=%zu cores=%zu%s\n", grouping.label, records.size(), reference.size(),
+                    cores, line.c_str());
+    }
+}
+
+bool SameGrid(const HeatmapGrid* a, const HeatmapGrid* b) {
+    static const HeatmapGrid empty;
+    return std::memcmp(a ? a : &empty, b ? b : &empty, sizeof(HeatmapGrid)) == 0;
+}
+
+void TestUsageHeatmap() {
+    int day;
+    int quarter;
+    UsageHeatmap::Cell(1700000000, 0, day, quarter);  // Tuesday 14 November 2023, 22:13 UTC
+    Check(day == 1 && quarter == 88, "Unix time maps to its UTC weekday and quarter hour");
+    UsageHeatmap::Cell(1700000000, 2 * 3600, day, quarter);
+    Check(day == 2 && quarter == 0, "the UTC offset moves cells into local time");
+
+    // Ticks across day boundaries, gaps, splits and a clear must keep the
+    // incremental grids equal to a recount
+    std::mt19937 rng(19);
+    TrackingEngine engine;
+    UsageHeatmap heatmap(std::chrono::hours(-7));
+    int64_t now = 1700000000;
+    bool matches = true;
+    std::shared_ptr<const HeatmapGrid> held;
+    HeatmapGrid heldCopy;
+    for (int step = 0; step < 3000 && matches; ++step) {
+        std::string name = "app" + std::to_string(rng() % 12) + ".exe";
+        for (int s = 0, run = 1 + static_cast<int>(rng() % 400); s < run; s += 30) {
+            now += 30 + (step % 97 == 0 ? 5 * 3600 : 0);
+            engine.Record({ name, "" }, FromUnixSeconds(now));
+            heatmap.Advance(engine);
+        }
+        if (step % 300 == 299) {
+            engine.SplitOpenInterval();
+        }
+        if (step == 2000) {
+            engine.Clear(FromUnixSeconds(now));
+        }
+        if (step == 1000) {
+            held = heatmap.Overall();
+            heldCopy = *held;
+        }
+        if (step % 50 == 0) {
+            heatmap.Advance(engine);
+            UsageHeatmap recount(std::chrono::hours(-7));
+            recount.Advance(engine);
+            matches = SameGrid(heatmap.Overall().get(), recount.Overall().get());
+            for (uint32_t appId = 0; appId < engine.AppCount() && matches; ++appId) {
+                matches = SameGrid(heatmap.App(appId), recount.App(appId));
+            }
+        }
+    }
+    Check(matches, "incremental heatmaps match a recount");
+    Check(heatmap.Recounts() == 2, "only the first advance and the clear recount");
+    Check(SameGrid(held.get(), &heldCopy) && !SameGrid(held.get(), heatmap.Overall().get()),
+          "a grid handed out is copied rather than changed");
+
+    // Against the range query's hourly groups over a year of history
+    TrackingEngine year;
+    MakeYearOfHistory(year, 1700000000);
+    UsageHeatmap yearHeatmap(std::chrono::hours(5));
+    yearHeatmap.Advance(year);
+    UsageQuery query;
+    query.from = FromUnixSeconds(0);
+    query.to = FromUnixSeconds(1700000000 + 3600);  // The last interval may run past now
+    query.grouping = UsageGrouping::AppHour;
+    query.utcOffset = std::chrono::hours(5);
+    HeatmapGrid expected;
+    uint32_t appId = year.Apps().Find("app9.exe");
+    HeatmapGrid expectedApp;
+    for (const UsageGroup& group : RunUsageQuery(year, query)) {
+        UsageHeatmap::Cell(group.bucketStart, 5 * 3600, day, quarter);
+        expected.seconds[day][quarter] += static_cast<uint32_t>(group.time.count());
+        if (group.appId == appId) {
+            expectedApp.seconds[day][quarter] += static_cast<uint32_t>(group.time.count());
+        }
+    }
+    bool hoursMatch = true;
+    for (int d = 0; d < HeatmapGrid::DAYS; ++d) {
+        for (int hour = 0; hour < HeatmapGrid::HOURS; ++hour) {
+            hoursMatch = hoursMatch && yearHeatmap.Overall()->Hour(d, hour) == expected.Quarter(d, hour * 4) &&
+                         yearHeatmap.App(appId)->Hour(d, hour) == expectedApp.Quarter(d, hour * 4);
+        }
+    }
+    Check(hoursMatch, "heatmap hours agree with hourly range query groups");
+
+    // The view damages only cells whose shade changed and paints the peak full
+    HeatmapView view;
+    view.Layout({ 0, 0, 400, 300 }, 1.0f, 1.0f);
+    HeatmapGrid grid;
+    grid.seconds[2][40] = 3600;
+    grid.seconds[4][8] = 100;
+    DamageRegion region;
+    view.Diff(&grid, region);
+    Check(region.Bounds().width == 400 && region.Bounds().height == 300, "a fresh view damages everything");
+    region.Clear();
+    grid.seconds[4][8] += 1;
+    view.Diff(&grid, region);
+    Check(region.Empty(), "a second that moves no shade damages nothing");
+    grid.seconds[6][95] = 1800;
+    view.Diff(&grid, region);
+    DamageRect cell = view.CellRect(6, 23);
+    Check(region.Rects().size() == 1 && region.Bounds().x == cell.x && region.Bounds().y == cell.y, "a new shade damages its own cell");
+    HeatmapStyle style;
+    CpuRasterizer raster(400, 300);
+    view.Paint(raster, &grid, L"All apps", style, view.Area());
+    DamageRect peak = view.CellRect(2, 10);
+    DamageRect blank = view.CellRect(0, 0);
+    Check(raster.Pixels()[(peak.y + peak.height / 2) * 400 + peak.x + peak.width / 2] == style.full &&
+          raster.Pixels()[(blank.y + blank.height / 2) * 400 + blank.x + blank.width / 2] == style.empty,
+          "the busiest hour is painted full and an unused one empty");
+}
+
+// Day-by-hour view of a year of history: built once on load, then advanced per
+// tick, versus regrouping the history (as a paint without the heatmap would)
+void BenchHeatmap() {
+    TrackingEngine engine;
+    int64_t now = 1700000000;
+    MakeYearOfHistory(engine, now);
+    auto start = std::chrono::steady_clock::now();
+    UsageHeatmap heatmap;
+    heatmap.Advance(engine);
+    double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    const int ticks = 2000;
+    uint64_t sink = 0;
+    std::shared_ptr<const HeatmapGrid> shown;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ticks; ++i) {
+        ++now;
+        engine.Record({ "app" + std::to_string(i / 60 % 5) + ".exe", "" }, FromUnixSeconds(now));
+        heatmap.Advance(engine);
+        shown = heatmap.Overall();  // Held as a snapshot would, so every tick copies on write
+        sink += shown->Hour(i % 7, i % 24);
+    }
+    double tickUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / ticks;
+
+    UsageQuery query;
+    query.from = FromUnixSeconds(0);
+    query.to = FromUnixSeconds(now);
+    query.grouping = UsageGrouping::AppHour;
+    start = std::chrono::steady_clock::now();
+    sink += RunUsageQuery(engine, query).size();
+    double rescanMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("heatmap intervals=%zu  build %.1f ms   advance %.2f us/tick   hourly rescan %.1f ms  (%llu)\n",
+                engine.Intervals().Size(), loadMs, tickUs, rescanMs, static_cast<unsigned long long>(sink & 1));
+    Check(tickUs * 100 < rescanMs * 1000, "advancing the heatmap is far cheaper than regrouping history");
+}
+
+void TestWindowTitles() {
+    // A Zipf-like stream over 5000 distinct titles: the heavy ones must be
+    // monitored, short of their exact time by at most total / capacity (what
+    // they had before they were last admitted), and nothing may be lost
+    std::mt19937 rng(29);
+    TitleSketch sketch(32);
+    std::map<std::string, int64_t> exact;
+    for (int i = 0; i < 200000; ++i) {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        int rank = static_cast<int>(std::pow(5000.0, u * u * u));  // Rank 1 is the heaviest
+        std::string title = "Document " + std::to_string(rank);
+        int64_t seconds = 1 + static_cast<int64_t>(rng() % 3);
+        sketch.Add(title, seconds);
+        exact[title] += seconds;
+    }
+    TitleSummary summary;
+    sketch.Summarize(5, summary);
+    std::vector<std::pair<int64_t, std::string>> heaviest;
+    int64_t total = 0;
+    for (const auto& [title, seconds] : exact) {
+        heaviest.emplace_back(seconds, title);
+        total += seconds;
+    }
+    std::sort(heaviest.rbegin(), heaviest.rend());
+    bool boundedTop = summary.top.size() == 5;
+    int64_t listed = 0;
+    for (size_t i = 0; i < summary.top.size(); ++i) {
+        int64_t missing = heaviest[i].first - summary.top[i].time.count();
+        boundedTop = boundedTop && summary.top[i].title == heaviest[i].second && missing >= 0 && missing <= total / 32;
+        listed += summary.top[i].time.count();
+    }
+    Check(boundedTop, "the top titles are monitored, within the sketch's error bound");
+    Check(summary.total.count() == total && listed + summary.other.count() == total, "listed titles and other add up to the app's time");
+    Check(sketch.Monitored() == 32, "memory stays at the sketch's capacity");
+
+    // The engine charges each sample's elapsed time to the title seen at the
+    // previous sample, as it does for apps
+    ScriptedForegroundSource source;
+    source.AddStep("browser.exe", "C:\\browser.exe", 100, "Mail");
+    source.AddStep("browser.exe", "C:\\browser.exe", 50, "News");
+    source.AddStep("editor.exe", "C:\\editor.exe", 30, "notes.txt");
+    source.AddStep("browser.exe", "C:\\browser.exe", 20, "Mail");
+    TrackingEngine engine;
+    engine.SetTitleTracking(true);
+    auto now = std::chrono::system_clock::time_point(std::chrono::hours(24 * 365 * 50));
+    while (engine.Tick(source, now)) {
+        now += std::chrono::seconds(1);
+    }
+    uint32_t browser = engine.Apps().Find("browser.exe");
+    engine.AppTitles(browser)->Summarize(5, summary);
+    Check(summary.top.size() == 2 && summary.top[0].title == "Mail" && summary.top[0].time.count() == 119 &&
+          summary.top[1].title == "News" && summary.top[1].time.count() == 50 && summary.other.count() == 0 &&
+          summary.total == engine.AppActiveTime(browser), "titles split their app's time exactly");
+    engine.Clear(now);
+    Check(engine.AppTitles(browser) == nullptr, "clearing drops title time");
+
+    // Expanded apps list their titles as sub-rows from the snapshot
+    engine = TrackingEngine();
+    engine.SetTitleTracking(true);
+    source.Rewind();
+    while (engine.Tick(source, now)) {
+        now += std::chrono::seconds(1);
+    }
+    SnapshotPublisher publisher({ std::chrono::hours(24) });
+    publisher.Publish(engine, now);
+    std::vector<char> expanded(engine.AppCount(), 0);
+    browser = engine.Apps().Find("browser.exe");
+    expanded[browser] = 1;
+    UsageListParams params;
+    params.clientWidth = 400;
+    params.clientHeight = 300;
+    params.expandedApps = &expanded;
+    UsageListLayout layout;
+    layout.Update(*publisher.Current(), 0, params);
+    const auto& rows = layout.Rows();
+    Check(rows.size() == 4 && !rows[0].IsTitle() && rows[0].appId == browser && rows[1].IsTitle() && rows[2].IsTitle() &&
+          rows[1].name->text == L"Mail" && rows[1].timeText->text == L"70%" && !rows[3].IsTitle(),
+          "an expanded app lists its titles under it");
+    const TitleSummary* before = publisher.Current()->AppTitles(engine.Apps().Find("editor.exe"));
+    engine.Record({ "browser.exe", "C:\\browser.exe", "Mail" }, now);
+    publisher.Publish(engine, now);
+    Check(publisher.Current()->AppTitles(engine.Apps().Find("editor.exe")) == before, "unchanged apps keep their title summary");
+}
+
+// Per-sample cost of title attribution with an endless stream of new titles
+// (a browser cycling through tabs and pages): a Space-Saving sketch versus an
+// exact map that grows with every distinct title.
+void BenchWindowTitles() {
+    const int samples = 500000;
+    std::mt19937 rng(37);
+    std::vector<std::string> titles;
+    for (int i = 0; i < samples / 10; ++i) {
+        titles.push_back("Page " + std::to_string(rng()) + " - Browser");
+    }
+    std::vector<uint32_t> stream(samples);
+    for (int i = 0; i < samples; ++i) {
+        stream[i] = i / 10 % 7 == 0 ? static_cast<uint32_t>(i / 10) % titles.size() : static_cast<uint32_t>(i / 400 % 8);  // Dwells on a few favourites
+    }
+
+    TitleSketch sketch(TrackingEngine::TITLES_PER_APP);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < samples; ++i) {
+        sketch.Add(titles[stream[i]], 1);
+    }
+    double sketchNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / samples;
+
+    std::unordered_map<std::string, int64_t> exact;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < samples; ++i) {
+        exact[titles[stream[i]]] += 1;
+    }
+    double exactNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / samples;
+
+    TitleSummary summary;
+    sketch.Summarize(SnapshotPublisher::TITLES_SHOWN, summary);
+    bool favourites = summary.top.size() == SnapshotPublisher::TITLES_SHOWN;
+    for (const TitleShare& share : summary.top) {
+        favourites = favourites && share.time.count() == exact[share.title];
+    }
+    std::printf("window titles samples=%d distinct=%zu  sketch %.0f ns/sample (%zu counters)   exact map %.0f ns/sample (%zu entries)\n",
+                samples, exact.size(), sketchNs, sketch.Monitored(), exactNs, exact.size());
+    Check(favourites, "the sketch reports the favourite titles exactly");
+    Check(sketch.Monitored() <= TrackingEngine::TITLES_PER_APP, "the sketch never grows past its capacity");
+}
+
+void TestIdleAccounting() {
+    // Half an hour of a.exe, b.exe, then c.exe, with two bursts of input and a
+    // late keystroke; the run starts 700 s before an hour so that trimmed
+    // tails cross rollup buckets
+    ScriptedForegroundSource source;
+    source.AddStep("a.exe", "C:\\a.exe", 600, "Doc");
+    source.AddStep("b.exe", "C:\\b.exe", 260, "Page");
+    source.AddStep("c.exe", "C:\\c.exe", 40, "Shell");
+    auto start = FromUnixSeconds(1700002800 - 700);
+    Check(WriteTextFile("idle_trace.txt", "# Input offsets\n0\n10\n20\n30\n40\n50\n60\n70\n80\n90\n880\n"), "input trace written");
+    ScriptedInputSource input(start);
+    Check(input.LoadTrace("idle_trace.txt"), "input trace loads");
+    std::remove("idle_trace.txt");
+    input.AddActivity(std::chrono::seconds(500), std::chrono::seconds(200), std::chrono::seconds(10));
+
+    TrackingEngine engine;
+    engine.SetTitleTracking(true);
+    engine.SetIdleThreshold(std::chrono::seconds(120));
+    WindowRanking ranking(std::chrono::hours(1));
+    UsageHeatmap heatmap(std::chrono::hours(2));
+    auto now = start;
+    bool follows = true;
+    bool idleAt300 = false;
+    for (int tick = 0; !source.Finished(); ++tick, now += std::chrono::seconds(1)) {
+        engine.Tick(source, input, now);
+        idleAt300 = idleAt300 || (tick == 300 && engine.Idle());
+        ranking.Advance(engine, now);
+        heatmap.Advance(engine);
+        if (tick % 10 == 0 || (tick >= 205 && tick <= 215) || (tick >= 805 && tick <= 815)) {
+            auto expected = engine.RangeTotals(now - std::chrono::hours(1), now);
+            std::sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) { return a.second > b.second || (a.second == b.second && a.first < b.first); });
+            std::vector<std::pair<uint32_t, std::chrono::seconds>> actual;
+            ranking.Ranking().TopK(SIZE_MAX, actual);
+            UsageHeatmap recount(std::chrono::hours(2));
+            recount.Advance(engine);
+            follows = follows && actual == expected && SameGrid(heatmap.Overall().get(), recount.Overall().get());
+        }
+    }
+
+    // Idle from the input at 90 to 500 and from 690 to 880, noticed 120 s late
+    Check(idleAt300 && !engine.Idle(), "input ends and resumes idleness");
+    Check(ActiveSeconds(engine, "a.exe") == 190 && ActiveSeconds(engine, "b.exe") == 90 && ActiveSeconds(engine, "c.exe") == 19,
+          "idle tails are taken back and resumed time starts at the input");
+    const std::vector<FocusInterval>& log = engine.Intervals().Data();
+    int64_t base = ToUnixSeconds(start);
+    Check(engine.Intervals().Size() == 3 && log[0].begin == base && log[0].length == 90 && log[1].begin == base + 500 &&
+          log[1].length == 100 && log[2].begin == base + 600 && log[2].length == 90,
+          "the log holds the trimmed intervals");
+    std::chrono::seconds rolled(0);
+    for (const auto& entry : engine.RangeTotals(start - std::chrono::hours(48), now + std::chrono::hours(48))) {
+        rolled += entry.second;
+        follows = follows && entry.second == engine.AppActiveTime(entry.first);
+    }
+    Check(rolled.count() == 299, "rollups lose the trimmed tails too");
+    Check(follows, "rankings and heatmaps follow trims like a recount");
+    TitleSummary titles;
+    engine.AppTitles(engine.Apps().Find("a.exe"))->Summarize(1, titles);
+    Check(titles.total.count() == 190 && titles.top[0].time.count() == 190, "title time is trimmed with its app");
+
+    // With the threshold at zero the input is ignored
+    TrackingEngine plain;
+    TrackingEngine unfiltered;
+    source.Rewind();
+    ScriptedInputSource silent(start);
+    now = start;
+    while (!source.Finished()) {
+        plain.Tick(source, silent, now);
+        now += std::chrono::seconds(1);
+    }
+    source.Rewind();
+    now = start;
+    while (!source.Finished()) {
+        unfiltered.Tick(source, now);
+        now += std::chrono::seconds(1);
+    }
+    Check(plain.RangeTotals(start, now) == unfiltered.RangeTotals(start, now) && plain.Intervals().Size() == unfiltered.Intervals().Size(),
+          "without a threshold idle input changes nothing");
+
+    // Idle detection turned off during an 8 hour break: counting resumes at the next sample
+    TrackingEngine dozing;
+    dozing.SetIdleThreshold(std::chrono::seconds(120));
+    auto awake = FromUnixSeconds(1700000000);
+    for (int tick = 0; tick <= 60; ++tick) {
+        dozing.Record({ "a.exe", "C:\\a.exe" }, awake + std::chrono::seconds(tick), awake + std::chrono::seconds(tick));
+    }
+    dozing.Record({ "a.exe", "C:\\a.exe" }, awake + std::chrono::hours(8), awake + std::chrono::seconds(60));
+    bool dozed = dozing.Idle();
+    dozing.SetIdleThreshold(std::chrono::seconds(0));
+    dozing.Record({ "a.exe", "C:\\a.exe" }, awake + std::chrono::hours(8) + std::chrono::seconds(1));
+    dozing.Record({ "a.exe", "C:\\a.exe" }, awake + std::chrono::hours(8) + std::chrono::seconds(2));
+    Check(dozed && !dozing.Idle() && ActiveSeconds(dozing, "a.exe") == 61, "turning idle detection off mid-break doesn't charge the break");
+}
+
+// The wall clock stepping back mid-session, as after a time sync:
+// a [0, 100), b [100, 200), back 150 s, then c sampled from 50 to 95
+void TestClockStepBack() {
+    const int64_t base = 1700000000;
+    TrackingEngine engine;
+    auto sample = [&engine, base](const char* name, int64_t offset) {
+        engine.Record({ name, std::string("C:\\") + name }, FromUnixSeconds(base + offset));
+    };
+    for (int64_t t = 0; t < 100; ++t) {
+        sample("a.exe", t);
+    }
+    for (int64_t t = 100; t <= 200; ++t) {
+        sample("b.exe", t);
+    }
+    for (int64_t t = 50; t <= 95; ++t) {
+        sample("c.exe", t);
+    }
+
+    bool ordered = true;
+    const std::vector<FocusInterval>& log = engine.Intervals().Data();
+    for (size_t index = 1; index < log.size(); ++index) {
+        ordered = ordered && log[index].begin >= log[index - 1].End();
+    }
+    FocusInterval open;
+    Check(ordered && engine.OpenInterval(open) && open.begin == base + 200, "after a step back the log stays in time order");
+    Check(ActiveSeconds(engine, "a.exe") == 100 && ActiveSeconds(engine, "b.exe") == 100 && ActiveSeconds(engine, "c.exe") == 0,
+          "time the clock repeats isn't charged twice");
+    bool consistent = true;
+    for (const auto& entry : engine.RangeTotals(FromUnixSeconds(base - 3600), FromUnixSeconds(base + 3600))) {
+        consistent = consistent && entry.second == engine.AppActiveTime(entry.first);
+    }
+    Check(consistent, "range totals agree with the app totals after a step back");
+
+    // Across a restart there's no open interval to wait for, so a closed one
+    // can land before logged ones; views that index the log have to recount
+    Check(WriteSnapshot(engine, "clock_step.bin"), "clock step snapshot written");
+    TrackingEngine restarted;
+    Check(LoadSnapshot(restarted, "clock_step.bin"), "clock step snapshot loads");
+    std::remove("clock_step.bin");
+    auto now = FromUnixSeconds(base + 300);
+    WindowRanking ranking(std::chrono::hours(1));
+    UsageHeatmap heatmap(std::chrono::hours(2));
+    ranking.Advance(restarted, now);
+    heatmap.Advance(restarted);
+    uint64_t epoch = restarted.HistoryEpoch();
+    for (int64_t t = 20; t <= 60; ++t) {
+        restarted.Record(t < 60 ? ForegroundSample("d.exe", "C:\\d.exe") : ForegroundSample("e.exe", "C:\\e.exe"), FromUnixSeconds(base + t));
+    }
+    ranking.Advance(restarted, now);
+    heatmap.Advance(restarted);
+    auto expected = restarted.RangeTotals(now - std::chrono::hours(1), now);
+    std::sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) { return a.second > b.second || (a.second == b.second && a.first < b.first); });
+    std::vector<std::pair<uint32_t, std::chrono::seconds>> actual;
+    ranking.Ranking().TopK(SIZE_MAX, actual);
+    UsageHeatmap recount(std::chrono::hours(2));
+    recount.Advance(restarted);
+    Check(restarted.HistoryEpoch() != epoch && ActiveSeconds(restarted, "d.exe") == 40, "an interval landing before logged ones starts a new history epoch");
+    Check(actual == expected && SameGrid(heatmap.Overall().get(), recount.Overall().get()), "rankings and heatmaps recount after an out-of-order interval");
+
+    // The open interval now begins before logged ones; snapshots keep it in begin order
+    for (int64_t t = 61; t <= 80; ++t) {
+        restarted.Record({ "e.exe", "C:\\e.exe" }, FromUnixSeconds(base + t));
+    }
+    Check(WriteSnapshot(restarted, "clock_step.bin"), "snapshot with an early open interval written");
+    TrackingEngine reloaded;
+    Check(LoadSnapshot(reloaded, "clock_step.bin") && TotalsByName(reloaded) == TotalsByName(restarted),
+          "a snapshot whose open interval precedes logged ones loads back");
+    std::remove("clock_step.bin");
+}
+
+// What idle detection adds to a tick: the plain replay versus one asking a
+// scripted input source every tick, with input in bursts and idle breaks
+void BenchIdle() {
+    const size_t ticks = 1000000;
+    ScriptedForegroundSource source = MakeSyntheticTrace(ticks, 50, 47);
+    auto start = std::chrono::system_clock::time_point(std::chrono::hours(24 * 365 * 50));
+    ScriptedInputSource input(start);
+    std::mt19937 rng(53);
+    for (int64_t offset = 0; offset < static_cast<int64_t>(ticks); ) {
+        int64_t burst = 60 + rng() % 1800;
+        input.AddActivity(std::chrono::seconds(offset), std::chrono::seconds(burst), std::chrono::seconds(1 + rng() % 20));
+        offset += burst + (rng() % 4 == 0 ? 300 + rng() % 3600 : rng() % 200);
+    }
+
+    double nsPerTick[2];
+    TrackingEngine engines[2];
+    engines[1].SetIdleThreshold(std::chrono::minutes(5));
+    for (int idle = 0; idle < 2; ++idle) {
+        source.Rewind();
+        auto now = start;
+        auto begin = std::chrono::steady_clock::now();
+        while (!source.Finished()) {
+            if (idle) {
+                engines[idle].Tick(source, input, now);
+            } else {
+                engines[idle].Tick(source, now);
+            }
+            now += std::chrono::seconds(1);
+        }
+        nsPerTick[idle] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / ticks;
+    }
+    std::chrono::seconds tracked[2] = { std::chrono::seconds(0), std::chrono::seconds(0) };
+    bool agree = true;
+    for (int idle = 0; idle < 2; ++idle) {
+        for (uint32_t appId = 0; appId < engines[idle].AppCount(); ++appId) {
+            tracked[idle] += engines[idle].AppActiveTime(appId);
+        }
+        std::chrono::seconds logged(0);
+        for (const auto& entry : engines[idle].RangeTotals(start, start + std::chrono::seconds(ticks + 1))) {
+            logged += entry.second;
+        }
+        agree = agree && logged == tracked[idle];
+    }
+    std::printf("idle detection ticks=%zu  plain %.1f ns/tick (%s)   idle-aware %.1f ns/tick (%s)\n", ticks,
+                nsPerTick[0], FormatDuration(tracked[0]).c_str(), nsPerTick[1], FormatDuration(tracked[1]).c_str());
+    Check(tracked[1] < tracked[0], "idle breaks are not counted");
+    Check(agree, "idle-aware totals match the log and rollups");
+}
+
+// Session metrics recounted from the whole log, the way the streaming stage must agree with
+void RecountFocus(const TrackingEngine& engine, std::vector<AppFocus>& apps, FocusSummary& summary) {
+    std::vector<FocusInterval> sessions;
+    std::vector<FocusInterval> intervals = engine.Intervals().Data();
+    FocusInterval open;
+    if (engine.OpenInterval(open) && open.length > 0) {
+        intervals.push_back(open);
+    }
+    summary = FocusSummary();
+    for (const FocusInterval& interval : intervals) {
+        if (!sessions.empty() && sessions.back().End() == interval.begin) {
+            if (sessions.back().appId == interval.appId) {
+                sessions.back().length += interval.length;
+                continue;
+            }
+            ++summary.switches;
+        }
+        sessions.push_back(interval);
+    }
+    apps.assign(engine.AppCount(), AppFocus());
+    for (const FocusInterval& session : sessions) {
+        apps[session.appId].AddSession(session);
+        summary.AddSession(session);
+    }
+}
+
+void TestFocusAnalytics() {
+    // A.exe split by a checkpoint, a switch to B, a break, then A handing over to C
+    FocusAnalytics analytics;
+    const uint32_t A = 0, B = 1, C = 2;
+    for (FocusInterval interval : { FocusInterval{ 0, 100, A }, FocusInterval{ 100, 50, A }, FocusInterval{ 150, 250, B },
+                                    FocusInterval{ 1000, 60, A }, FocusInterval{ 1060, 10, C } }) {
+        analytics.Add(interval);
+    }
+    FocusInterval open = { 1070, 30, C };
+    AppFocus a = analytics.App(A, &open);
+    AppFocus c = analytics.App(C, &open);
+    Check(a.sessions == 2 && a.seconds == 210 && a.longest == 150 && a.longestBegin == 0 && a.MeanSession().count() == 105,
+          "contiguous intervals of an app are one session");
+    Check(c.sessions == 1 && c.longest == 40 && analytics.Finished(C).sessions == 0, "the session under way carries on into the open interval");
+    FocusSummary summary;
+    analytics.Summarize(&open, 1100, summary);
+    Check(summary.switches == 2 && summary.switchesLastHour == 2, "only direct hand-overs are switches");
+    Check(summary.sessions == 4 && summary.longest == 250 && summary.longestAppId == B && summary.lengths[0] == 1 && summary.lengths[1] == 3,
+          "sessions are summarized by length");
+    analytics.Summarize(&open, 1100 + 2 * 3600, summary);
+    Check(summary.switchesLastHour == 0, "switches age out of the last hour");
+    open = { 1070, 30, B };
+    analytics.Summarize(&open, 1100, summary);
+    Check(summary.switches == 3 && summary.sessions == 5, "a hand-over to the open interval counts before it closes");
+
+    // Random ticks with checkpoint splits, idle breaks and gaps must agree with a recount
+    std::mt19937 rng(59);
+    TrackingEngine engine;
+    engine.SetIdleThreshold(std::chrono::seconds(300));
+    int64_t now = 1700000000;
+    int64_t lastInput = now;
+    bool matches = true;
+    SnapshotPublisher publisher({ std::chrono::hours(1) });
+    for (int step = 0; step < 2000 && matches; ++step) {
+        std::string name = "app" + std::to_string(rng() % 8) + ".exe";
+        for (int s = 0, run = 1 + static_cast<int>(rng() % 300); s < run; s += 10) {
+            now += 10;
+            lastInput = step % 37 == 0 ? lastInput : now;  // Now and then nobody types for a while
+            engine.Record({ step % 53 == 0 ? "" : name, "" }, FromUnixSeconds(now), FromUnixSeconds(lastInput));
+        }
+        if (step % 90 == 0) {
+            engine.SplitOpenInterval();
+        }
+        if (step % 100 == 0) {
+            std::vector<AppFocus> apps;
+            FocusSummary expected;
+            RecountFocus(engine, apps, expected);
+            FocusInterval current;
+            const FocusInterval* openInterval = engine.OpenInterval(current) ? &current : nullptr;
+            engine.Focus().Summarize(openInterval, now, summary);
+            publisher.Publish(engine, FromUnixSeconds(now));
+            matches = summary.switches == expected.switches && summary.sessions == expected.sessions &&
+                      summary.seconds == expected.seconds && summary.longest == expected.longest &&
+                      std::equal(std::begin(summary.lengths), std::end(summary.lengths), std::begin(expected.lengths));
+            for (uint32_t appId = 0; appId < engine.AppCount() && matches; ++appId) {
+                AppFocus streamed = engine.Focus().App(appId, openInterval);
+                AppFocus published = publisher.Current()->AppFocusOf(appId);
+                matches = streamed.sessions == apps[appId].sessions && streamed.seconds == apps[appId].seconds &&
+                          streamed.longest == apps[appId].longest && published.sessions == streamed.sessions &&
+                          published.longest == streamed.longest && published.seconds == streamed.seconds;
+            }
+        }
+    }
+    Check(matches, "streamed focus metrics match a recount of the log");
+    Check(publisher.Current()->focus.sessions > 0 && publisher.Current()->focus.switches < publisher.Current()->focus.sessions,
+          "snapshots carry the focus summary");
+
+    // Exports carry them too
+    Check(ExportTrackingDataToJson(engine, "focus_export.json"), "focus export written");
+    std::ifstream file("focus_export.json");
+    nlohmann::json exported;
+    file >> exported;
+    file.close();
+    std::remove("focus_export.json");
+    uint32_t app0 = engine.Apps().Find("app0.exe");
+    FocusInterval current;
+    engine.OpenInterval(current);
+    engine.Focus().Summarize(&current, current.End(), summary);
+    Check(exported["focus"]["switches"].get<uint64_t>() == summary.switches &&
+          exported["app_data"]["app0.exe"]["focus_sessions"].get<uint64_t>() == engine.Focus().App(app0, &current).sessions,
+          "the JSON export lists focus metrics");
+
+    // Snapshots save the metrics rather than rebuild them; version 2 files rebuild them on load
+    Check(WriteSnapshot(engine, "focus_snapshot.bin"), "focus snapshot written");
+    TrackingEngine loaded;
+    Check(LoadSnapshot(loaded, "focus_snapshot.bin"), "focus snapshot loads");
+    FocusSummary restored;
+    loaded.Focus().Summarize(nullptr, current.End(), restored);
+    {
+        std::fstream patch("focus_snapshot.bin", std::ios::in | std::ios::out | std::ios::binary);
+        SnapshotHeader header;
+        patch.read(reinterpret_cast<char*>(&header), sizeof(header));
+        header.version = SNAPSHOT_OLDEST_VERSION;
+        header.headerSize = SnapshotHeaderSize(SNAPSHOT_OLDEST_VERSION);
+        patch.seekp(0);
+        patch.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+    TrackingEngine migrated;
+    Check(LoadSnapshot(migrated, "focus_snapshot.bin"), "a version 2 snapshot still loads");
+    std::remove("focus_snapshot.bin");
+    FocusSummary rebuilt;
+    migrated.Focus().Summarize(nullptr, current.End(), rebuilt);
+    uint32_t loadedApp0 = loaded.Apps().Find("app0.exe");
+    Check(restored.sessions == summary.sessions && restored.switches == summary.switches && restored.longest == summary.longest &&
+          restored.switchesLastHour == summary.switchesLastHour &&
+          loaded.Focus().App(loadedApp0, nullptr).seconds == engine.Focus().App(app0, &current).seconds,
+          "focus metrics survive a snapshot");
+    Check(rebuilt.sessions == restored.sessions && rebuilt.switches == restored.switches && rebuilt.seconds == restored.seconds,
+          "focus metrics are rebuilt from a version 2 snapshot");
+}
+
+// Context-switch metrics over a year of history: streaming each closed
+// interval into the analytics versus recounting the log for every query.
+void BenchFocusAnalytics() {
+    TrackingEngine engine;
+    const int64_t now = 1700000000;
+    MakeYearOfHistory(engine, now);
+    const auto& log = engine.Intervals().Data();
+
+    FocusAnalytics analytics;
+    auto start = std::chrono::steady_clock::now();
+    for (const FocusInterval& interval : log) {
+        analytics.Add(interval);
+    }
+    double addNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / log.size();
+
+    const int queries = 1000;
+    FocusSummary summary;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < queries; ++i) {
+        analytics.Summarize(nullptr, now + i, summary);
+    }
+    double queryNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / queries;
+
+    std::vector<AppFocus> apps;
+    FocusSummary recounted;
+    start = std::chrono::steady_clock::now();
+    RecountFocus(engine, apps, recounted);
+    double recountUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("focus analytics intervals=%zu  streamed %.1f ns/interval, %.0f ns/query   recount %.0f us/query\n",
+                log.size(), addNs, queryNs, recountUs);
+    Check(summary.sessions == recounted.sessions && summary.switches == recounted.switches && summary.longest == recounted.longest,
+          "streamed metrics over a year match a recount");
+    Check(analytics.AppCount() <= engine.AppCount(), "focus memory stays per app");
+}
+
+// Quantile of a sorted sample the way SessionSketch ranks it
+uint32_t ExactQuantile(const std::vector<uint32_t>& sorted, double q) {
+    size_t rank = static_cast<size_t>(std::max(1.0, q * static_cast<double>(sorted.size()) + 0.5));
+    return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+bool SameSketch(const SessionSketch& a, const SessionSketch& b) {
+    for (double q : { 0.1, 0.5, 0.9, 0.99, 1.0 }) {
+        if (a.Quantile(q) != b.Quantile(q)) {
+            return false;
+        }
+    }
+    return a.Count() == b.Count();
+}
+
+void TestSessionSketches() {
+    bool bounded = true;
+    for (uint32_t seconds : { 0u, 1u, 7u, 8u, 9u, 15u, 16u, 100u, 3599u, 3600u, 86400u, 1000000u, UINT32_MAX }) {
+        size_t bucket = SessionSketch::Bucket(seconds);
+        bounded = bounded && bucket < SessionSketch::BUCKETS && SessionSketch::BucketLow(bucket) <= seconds &&
+                  seconds <= SessionSketch::BucketHigh(bucket);
+    }
+    Check(bounded, "every length falls inside its bucket");
+
+    // Quantiles stay within 1/16 of the exact ones, and merging is adding
+    std::mt19937 rng(61);
+    std::exponential_distribution<double> lengthDist(1.0 / 300);
+    SessionSketch whole, first, second;
+    std::vector<uint32_t> lengths;
+    for (int i = 0; i < 20000; ++i) {
+        uint32_t length = static_cast<uint32_t>(lengthDist(rng));
+        lengths.push_back(length);
+        whole.Add(length);
+        (i % 3 == 0 ? first : second).Add(length);
+    }
+    std::sort(lengths.begin(), lengths.end());
+    bool close = true;
+    for (double q : { 0.01, 0.25, 0.5, 0.75, 0.9, 0.99, 0.999 }) {
+        int64_t exact = ExactQuantile(lengths, q);
+        close = close && std::llabs(whole.Quantile(q).count() - exact) <= exact / 16 + 1;
+    }
+    Check(close, "sketch quantiles are within 1/16 of the exact ones");
+    first.Merge(second);
+    Check(SameSketch(first, whole), "merged sketches equal one sketch of everything");
+    Check(SessionSketch().Quantile(0.5).count() == 0, "an empty sketch has no quantiles");
+
+    // Ranges are answered by day over the last DAY_WINDOW and by month before it
+    const int64_t DAY = SessionDistributions::DAY;
+    const int64_t start = 600 * SessionDistributions::MONTH;
+    SessionDistributions distributions;
+    struct Session { uint32_t appId; int64_t begin; uint32_t length; };
+    std::vector<Session> sessions;
+    for (int64_t t = start; t < start + 200 * DAY;) {
+        Session session = { static_cast<uint32_t>(rng() % 5), t, static_cast<uint32_t>(lengthDist(rng)) + 1 };
+        sessions.push_back(session);
+        distributions.Add(session.appId, session.begin, session.length);
+        t += session.length + static_cast<int64_t>(rng() % 3000);
+    }
+    const int64_t newestDay = (sessions.back().begin / DAY) * DAY;
+    auto expect = [&](uint32_t appId, int64_t from, int64_t to) {
+        SessionSketch sketch;
+        for (const Session& session : sessions) {
+            if (session.appId == appId && session.begin >= from && session.begin < to) {
+                sketch.Add(session.length);
+            }
+        }
+        return sketch;
+    };
+    bool ranges = true;
+    for (int i = 0; i < 200 && ranges; ++i) {
+        uint32_t appId = static_cast<uint32_t>(i % 5);
+        int64_t from = newestDay - SessionDistributions::DAY_WINDOW + static_cast<int64_t>(rng() % 25) * DAY;
+        int64_t to = from + (1 + static_cast<int64_t>(rng() % 6)) * DAY;
+        SessionSketch queried;
+        distributions.Query(appId, from + static_cast<int64_t>(rng() % DAY), to - 1, queried);
+        ranges = SameSketch(queried, expect(appId, from, to));
+    }
+    Check(ranges, "recent ranges are exact to the day");
+    SessionSketch olderMonths;
+    distributions.Query(3, start + SessionDistributions::MONTH + 5 * DAY, start + 3 * SessionDistributions::MONTH - DAY, olderMonths);
+    Check(SameSketch(olderMonths, expect(3, start + SessionDistributions::MONTH, start + 3 * SessionDistributions::MONTH)),
+          "older ranges widen to whole months");
+    Check(SameSketch(*distributions.AllTime(2), expect(2, INT64_MIN, INT64_MAX)) && !distributions.AllTime(9),
+          "all-time sketches hold every session");
+    Check(distributions.SpanCount() <= 7 + 31 + 30, "days behind the window fold into months");
+
+    // Entries restored out of order merge into the same distributions
+    std::vector<std::pair<int64_t, uint64_t>> saved;
+    distributions.ForEachSpan([&saved](int64_t spanStart, int64_t, const uint64_t* entries, size_t count) {
+        for (size_t index = 0; index < count; ++index) {
+            saved.emplace_back(spanStart, entries[index]);
+        }
+    });
+    SessionDistributions reversed;
+    for (auto entry = saved.rbegin(); entry != saved.rend(); ++entry) {
+        reversed.Restore(entry->first, SessionDistributions::EntryApp(entry->second), SessionDistributions::EntryBucket(entry->second),
+                         SessionDistributions::EntryCount(entry->second));
+    }
+    bool same = reversed.EntryCount() == distributions.EntryCount();
+    for (uint32_t appId = 0; appId < 5 && same; ++appId) {
+        SessionSketch a, b;
+        distributions.Query(appId, start, start + 200 * DAY, a);
+        reversed.Query(appId, start, start + 200 * DAY, b);
+        same = SameSketch(a, b) && SameSketch(*reversed.AllTime(appId), *distributions.AllTime(appId));
+    }
+    Check(same, "entries restored in any order give the same distributions");
+
+    // Through the engine: published and exported quantiles, snapshots, and version 3 files
+    TrackingEngine engine;
+    int64_t now = 1700000000;
+    for (int i = 0; i < 3000; ++i) {
+        std::string name = "app" + std::to_string(rng() % 4) + ".exe";
+        now += 1 + static_cast<int64_t>(lengthDist(rng));
+        engine.Record({ name, "C:\\" + name }, FromUnixSeconds(now));
+    }
+    SnapshotPublisher publisher({ std::chrono::hours(1) });
+    publisher.Publish(engine, FromUnixSeconds(now));
+    uint32_t app1 = engine.Apps().Find("app1.exe");
+    const SessionSketch* sketch = engine.Focus().Sessions().AllTime(app1);
+    SessionQuantiles published = publisher.Current()->AppSessionQuantiles(app1);
+    Check(sketch && published.sessions == sketch->Count() && published.sessions == engine.Focus().Finished(app1).sessions &&
+          published.p50 == sketch->Quantile(0.5) && published.p99 == sketch->Quantile(0.99),
+          "snapshots carry each app's session quantiles");
+
+    Check(ExportTrackingDataToJson(engine, "sessions_export.json"), "session export written");
+    std::ifstream file("sessions_export.json");
+    nlohmann::json exported;
+    file >> exported;
+    file.close();
+    std::remove("sessions_export.json");
+    Check(exported["app_data"]["app1.exe"]["session_p90_seconds"].get<int64_t>() == sketch->Quantile(0.9).count(),
+          "the JSON export lists session quantiles");
+
+    engine.SplitOpenInterval();
+    Check(WriteSnapshot(engine, "sessions_snapshot.bin"), "session snapshot written");
+    TrackingEngine loaded;
+    Check(LoadSnapshot(loaded, "sessions_snapshot.bin"), "session snapshot loads");
+    {
+        std::fstream patch("sessions_snapshot.bin", std::ios::in | std::ios::out | std::ios::binary);
+        SnapshotHeader header;
+        patch.read(reinterpret_cast<char*>(&header), sizeof(header));
+        header.version = 3;
+        header.headerSize = SnapshotHeaderSize(3);
+        patch.seekp(0);
+        patch.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+    TrackingEngine migrated;
+    Check(LoadSnapshot(migrated, "sessions_snapshot.bin"), "a version 3 snapshot still loads");
+    std::remove("sessions_snapshot.bin");
+    bool restored = true;
+    for (uint32_t appId = 0; appId < engine.AppCount() && restored; ++appId) {
+        SessionSketch original, fromFile, rebuilt;
+        engine.Focus().Sessions().Query(appId, now - 3 * DAY, now + DAY, original);
+        loaded.Focus().Sessions().Query(appId, now - 3 * DAY, now + DAY, fromFile);
+        migrated.Focus().Sessions().Query(appId, now - 3 * DAY, now + DAY, rebuilt);
+        restored = SameSketch(original, fromFile) && SameSketch(original, rebuilt) &&
+                   SameSketch(*loaded.Focus().Sessions().AllTime(appId), *engine.Focus().Sessions().AllTime(appId));
+    }
+    Check(restored, "session sketches survive a snapshot and are rebuilt from a version 3 one");
+}
+
+// Session length quantiles over a year of history: from the sketches for a
+// week, a month and the year, versus sorting the matching log intervals.
+void BenchSessionSketches() {
+    TrackingEngine engine;
+    const int64_t now = 1700000000;
+    MakeYearOfHistory(engine, now);
+    const auto& log = engine.Intervals().Data();
+    const SessionDistributions& sessions = engine.Focus().Sessions();
+
+    const int64_t ranges[] = { 7 * SessionDistributions::DAY, 30 * SessionDistributions::DAY, 365 * SessionDistributions::DAY };
+    for (int64_t range : ranges) {
+        // Sketches answer whole days, so the scan starts at midnight too
+        const int64_t from = (now - range) / SessionDistributions::DAY * SessionDistributions::DAY;
+        const int queries = 200;
+        std::chrono::seconds p90(0);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < queries; ++i) {
+            SessionSketch sketch;
+            sessions.Query(static_cast<uint32_t>(i % 200), from, now, sketch);
+            p90 = sketch.Quantile(0.9);
+        }
+        double sketchUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / queries;
+
+        // Consecutive intervals of an app are one session, as in the analytics
+        start = std::chrono::steady_clock::now();
+        std::vector<uint32_t> lengths;
+        const uint32_t appId = (queries - 1) % 200;
+        for (size_t index = 0; index < log.size(); ++index) {
+            if (log[index].appId == appId && log[index].begin >= from &&
+                (index == 0 || log[index - 1].appId != appId || log[index - 1].End() != log[index].begin)) {
+                uint32_t length = log[index].length;
+                for (size_t next = index + 1; next < log.size() && log[next].appId == appId && log[next].begin == log[next - 1].End(); ++next) {
+                    length += log[next].length;
+                }
+                lengths.push_back(length);
+            }
+        }
+        std::sort(lengths.begin(), lengths.end());
+        double scanUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        int64_t exact = lengths.empty() ? 0 : ExactQuantile(lengths, 0.9);
+        std::printf("session p90 last %3lld days  sketch %.1f us/query   log scan %.0f us/query  (%llds vs %llds)\n",
+                    static_cast<long long>(range / SessionDistributions::DAY), sketchUs, scanUs,
+                    static_cast<long long>(p90.count()), static_cast<long long>(exact));
+        Check(std::llabs(p90.count() - exact) <= exact / 16 + 1, "sketched p90 is within 1/16 of the exact one");
+    }
+    std::printf("session sketches intervals=%zu  %zu spans, %zu entries (%zu KB)\n", log.size(), sessions.SpanCount(),
+                sessions.EntryCount(), sessions.EntryCount() * sizeof(uint64_t) / 1024);
+    Check(sessions.EntryCount() < log.size(), "session sketches stay smaller than the log");
+}
+
+// Rules checked one by one, the way a matcher without the automaton would
+struct SequentialRule {
+    std::string category;
+    bool isRegex;
+    std::string glob;
+    std::regex regex;
+};
+
+std::string FoldPath(const std::string& path) {
+    std::string folded;
+    for (char c : path) {
+        folded += c == '/' ? '\\' : static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return folded;
+}
+
+bool RecursiveGlob(const char* glob, const char* text) {
+    if (*glob == '*') {
+        return RecursiveGlob(glob + 1, text) || (*text && RecursiveGlob(glob, text + 1));
+    }
+    return *glob ? *text && (*glob == '?' || *glob == *text) && RecursiveGlob(glob + 1, text + 1) : !*text;
+}
+
+std::vector<SequentialRule> CompileSequential(const std::vector<CategoryRule>& rules) {
+    std::vector<SequentialRule> compiled;
+    for (const CategoryRule& rule : rules) {
+        if (rule.pattern.compare(0, 3, "re:") == 0) {
+            try {
+                compiled.push_back({ rule.category, true, std::string(), std::regex(rule.pattern.substr(3), std::regex::ECMAScript | std::regex::icase) });
+            } catch (const std::regex_error&) {
+            }
+        } else {
+            compiled.push_back({ rule.category, false, FoldPath(rule.pattern), std::regex() });
+        }
+    }
+    return compiled;
+}
+
+// Category name of the first matching rule, "" if none
+std::string SequentialMatch(const std::vector<SequentialRule>& rules, const std::string& path) {
+    std::string folded = FoldPath(path);
+    for (const SequentialRule& rule : rules) {
+        if (rule.isRegex ? std::regex_search(path, rule.regex) : RecursiveGlob(rule.glob.c_str(), folded.c_str())) {
+            return rule.category;
+        }
+    }
+    return std::string();
+}
+
+std::string MatchedName(const CategoryMatcher& matcher, const std::string& path) {
+    uint32_t category = matcher.Match(path);
+    return category == CategoryMatcher::NO_CATEGORY ? std::string() : matcher.CategoryName(category);
+}
+
+// The engine's category totals against a recount from its app totals
+bool CategoriesMatchApps(const TrackingEngine& engine) {
+    const CategoryTotals& categories = engine.Categories();
+    std::vector<int64_t> recount(categories.CategoryCount() + 1, 0);
+    for (uint32_t appId = 0; appId < engine.AppCount(); ++appId) {
+        uint32_t category = engine.AppCategory(appId);
+        recount[category == CategoryMatcher::NO_CATEGORY ? recount.size() - 1 : category] += engine.AppActiveTime(appId).count();
+    }
+    bool same = recount.back() == categories.Uncategorized().count();
+    for (uint32_t category = 0; category < categories.CategoryCount(); ++category) {
+        same = same && recount[category] == categories.Time(category).count();
+    }
+    return same;
+}
+
+void TestCategoryRules() {
+    Check(WriteTextFile("category_rules_test.txt",
+                        "# Comment\n\nDev = *\\Code.exe\n  Dev=*/devenv.exe  \nWeb = re:\\\\(chrome|firefox)\\.exe$\nno separator\nBad = re:([a-z\n"
+                        "Shells = C:\\Windows\\System32\\???.exe\nMisc = re:x=1\n"),
+          "rules file written");
+    std::vector<CategoryRule> rules;
+    Check(LoadCategoryRules("category_rules_test.txt", rules), "rules file loads");
+    std::remove("category_rules_test.txt");
+    Check(!LoadCategoryRules("category_rules_test.txt", rules), "a missing rules file is reported");
+    Check(rules.size() == 6 && rules[1].category == "Dev" && rules[1].pattern == "*/devenv.exe" && rules[5].pattern == "re:x=1",
+          "rules parse with comments, blank lines and '=' in patterns");
+
+    CategoryMatcher matcher(rules);
+    Check(matcher.Rejected().size() == 1 && matcher.Rejected()[0] == 3, "a bad regular expression is left out and reported");
+    Check(matcher.CategoryCount() == 4, "categories are named once however many rules they have");
+    Check(MatchedName(matcher, "C:\\Users\\me\\AppData\\Local\\Programs\\Microsoft VS Code\\CODE.EXE") == "Dev" &&
+          MatchedName(matcher, "D:\\VS\\Common7\\IDE\\devenv.exe") == "Dev",
+          "globs ignore case and '/' matches '\\'");
+    Check(MatchedName(matcher, "C:\\Program Files\\Google\\Chrome\\Application\\chrome.exe") == "Web" &&
+          MatchedName(matcher, "C:\\firefox\\firefox.exe.bak").empty(),
+          "regular expressions are searched with their anchors");
+    Check(MatchedName(matcher, "C:\\Windows\\System32\\cmd.exe") == "Shells" && MatchedName(matcher, "C:\\Windows\\System32\\conhost.exe").empty(),
+          "'?' matches one character");
+    Check(MatchedName(matcher, "C:\\Code.exe\\x.exe").empty(), "globs match the whole path");
+    Check(MatchedName(matcher, "C:\\x=1\\Code.exe") == "Dev", "the first matching rule wins");
+
+    // Random rules and paths over a few overlapping words, against checking each rule in turn
+    std::mt19937 rng(61);
+    const char* words[] = { "code", "cod", "de", "app", "pp", "chrome", "rome", "term", "er", "x" };
+    auto word = [&]() { return std::string(words[rng() % 10]); };
+    std::vector<CategoryRule> randomRules;
+    for (int i = 0; i < 300; ++i) {
+        std::string category = "C" + std::to_string(rng() % 40);
+        switch (rng() % 6) {
+        case 0: randomRules.push_back({ category, "*\\" + word() + "*.exe" }); break;
+        case 1: randomRules.push_back({ category, "C:\\" + word() + "\\*" + word() + "?.EXE" }); break;
+        case 2: randomRules.push_back({ category, "*" + word() + "*" + word() + "*" }); break;
+        case 3: randomRules.push_back({ category, "re:\\\\" + word() + "[a-z]*" + word() + "\\.exe$" }); break;
+        case 4: randomRules.push_back({ category, "re:(" + word() + "|" + word() + ")+\\\\" }); break;
+        default: randomRules.push_back({ category, "re:^c:\\\\" + word() + "(\\\\" + word() + ")?" + word() + "{2}" }); break;
+        }
+    }
+    CategoryMatcher randomMatcher(randomRules);
+    std::vector<SequentialRule> sequential = CompileSequential(randomRules);
+    bool agrees = randomMatcher.Rejected().empty();
+    int matched = 0;
+    for (int i = 0; i < 3000 && agrees; ++i) {
+        std::string path = rng() % 2 ? "C:\\" : "c:/";
+        for (int part = 1 + static_cast<int>(rng() % 3); part > 0; --part) {
+            path += word() + (rng() % 3 ? "" : word()) + (part > 1 ? "\\" : "");
+        }
+        path += rng() % 4 ? ".exe" : "X.EXE";
+        std::string expected = SequentialMatch(sequential, path);
+        matched += !expected.empty();
+        agrees = MatchedName(randomMatcher, path) == expected;
+    }
+    Check(agrees, "the compiled matcher picks the same rule as checking each in turn");
+    Check(matched > 300, "random paths match some rules");
+
+    // Totals alongside the app totals, through rule changes, trims, snapshots and Clear()
+    TrackingEngine engine;
+    auto now = FromUnixSeconds(1700000000);
+    const ForegroundSample samples[] = { { "Code.exe", "C:\\VS Code\\Code.exe" }, { "chrome.exe", "C:\\Chrome\\chrome.exe" },
+                                         { "notes.exe", "C:\\Tools\\notes.exe" }, { "devenv.exe", "D:\\VS\\devenv.exe" } };
+    for (int tick = 0; tick < 4000; ++tick, now += std::chrono::seconds(1)) {
+        engine.Record(samples[tick / 7 % 4], now);
+    }
+    int64_t total = 0;
+    for (uint32_t appId = 0; appId < engine.AppCount(); ++appId) {
+        total += engine.AppActiveTime(appId).count();
+    }
+    Check(engine.Categories().CategoryCount() == 0 && engine.Categories().Uncategorized().count() == total, "without rules all time is uncategorized");
+    auto shared = std::make_shared<const CategoryMatcher>(matcher);
+    engine.SetCategoryMatcher(shared);
+    uint32_t dev = 0;
+    while (dev < shared->CategoryCount() && shared->CategoryName(dev) != "Dev") {
+        ++dev;
+    }
+    Check(CategoriesMatchApps(engine) && engine.Categories().Time(dev).count() > 0 &&
+          engine.AppCategory(engine.Apps().Find("notes.exe")) == CategoryMatcher::NO_CATEGORY,
+          "new rules recount the categories from the app totals");
+    engine.SetIdleThreshold(std::chrono::seconds(60));
+    bool follows = true;
+    for (int tick = 0; tick < 4000; ++tick, now += std::chrono::seconds(1)) {
+        engine.Record(samples[tick / 13 % 4], now, tick % 1000 < 600 ? now : now - std::chrono::seconds(tick % 1000 - 599));
+        follows = follows && (tick % 97 != 0 || CategoriesMatchApps(engine));
+    }
+    Check(follows && CategoriesMatchApps(engine), "category totals follow ticks and idle trims");
+
+    engine.Record({ "notes.exe", "C:\\Tools\\devenv.exe" }, now);
+    Check(engine.AppCategory(engine.Apps().Find("notes.exe")) == dev, "an app is matched again when its path changes");
+    engine.SetCategoryMatcher(shared);
+    Check(CategoriesMatchApps(engine), "rematching recounts under the new path");
+
+    SnapshotPublisher publisher({ std::chrono::hours(1) });
+    publisher.Publish(engine, now);
+    auto snapshot = publisher.Current();
+    bool published = snapshot->CategoryCount() == engine.Categories().CategoryCount() &&
+                     snapshot->uncategorizedTime == engine.Categories().Uncategorized();
+    for (uint32_t category = 0; category < snapshot->CategoryCount() && published; ++category) {
+        published = snapshot->categoryTimes[category] == engine.Categories().Time(category) &&
+                    snapshot->CategoryName(category) == engine.Categories().CategoryName(category);
+    }
+    for (uint32_t appId = 0; appId < engine.AppCount() && published; ++appId) {
+        published = snapshot->AppCategory(appId) == engine.AppCategory(appId);
+    }
+    Check(published, "snapshots carry the category totals");
+    now += std::chrono::seconds(1);
+    engine.Record(samples[1], now);
+    publisher.Publish(engine, now);
+    Check(publisher.Current()->categories == snapshot->categories, "unchanged categories are shared between snapshots");
+
+    Check(ExportTrackingDataToJson(engine, "categories_export.json"), "category export written");
+    std::ifstream file("categories_export.json");
+    nlohmann::json exported;
+    file >> exported;
+    file.close();
+    TrackingEngine imported;
+    Check(ImportTrackingDataFromJson(imported, "categories_export.json") && imported.AppCount() == engine.AppCount(),
+          "a file with categories imports");
+    std::remove("categories_export.json");
+    Check(exported["categories"]["Dev"].get<int64_t>() == engine.Categories().Time(dev).count() &&
+          exported["app_data"]["Code.exe"]["category"].get<std::string>() == "Dev" && exported["app_data"]["chrome.exe"]["category"].get<std::string>() == "Web",
+          "the JSON export lists category totals");
+
+    engine.SplitOpenInterval();
+    Check(WriteSnapshot(engine, "categories_snapshot.bin"), "category snapshot written");
+    TrackingEngine loaded;
+    Check(LoadSnapshot(loaded, "categories_snapshot.bin"), "category snapshot loads");
+    std::remove("categories_snapshot.bin");
+    loaded.SetCategoryMatcher(shared);
+    Check(CategoriesMatchApps(loaded) && loaded.Categories().Time(dev) == engine.Categories().Time(dev), "a loaded engine recounts the same categories");
+
+    engine.Clear(now);
+    Check(engine.Categories().Time(dev).count() == 0 && engine.Categories().Uncategorized().count() == 0, "Clear() zeroes the categories");
+
+    // The compiler keeps only the latest submission
+    CategoryRuleCompiler compiler;
+    Check(compiler.TakeCompiled() == nullptr && compiler.WaitCompiled() == nullptr, "nothing is compiled before a submission");
+    compiler.Submit(randomRules);
+    compiler.Submit(rules);
+    std::shared_ptr<const CategoryMatcher> compiled = compiler.WaitCompiled();
+    Check(compiled && compiled->CategoryCount() == matcher.CategoryCount() && MatchedName(*compiled, "C:\\Code.exe") == "Dev",
+          "the latest submission compiles in the background");
+    Check(compiler.TakeCompiled() == nullptr, "a compiled matcher is handed over once");
+}
+
+// Thousands of rules: compiling them, matching a path against the automaton
+// versus each rule in turn, and what categories add to a tick once apps are cached
+void BenchCategoryRules() {
+    std::mt19937 rng(67);
+    std::vector<CategoryRule> rules;
+    for (int i = 0; i < 3000; ++i) {
+        std::string category = "Category" + std::to_string(i % 25);
+        if (i % 10 == 0) {
+            rules.push_back({ category, "re:\\\\tool" + std::to_string(i) + "-v[0-9.]+\\\\[a-z]+\\.exe$" });
+        } else if (i % 10 == 1) {
+            rules.push_back({ category, "C:\\Program Files\\Vendor" + std::to_string(i) + "\\*" });
+        } else {
+            rules.push_back({ category, "*\\app" + std::to_string(i) + ".exe" });
+        }
+    }
+    std::vector<std::string> paths;
+    for (int i = 0; i < 2000; ++i) {
+        int rule = static_cast<int>(rng() % 4000);  // A quarter match nothing
+        switch (rng() % 3) {
+        case 0: paths.push_back("C:\\Program Files\\Vendor" + std::to_string(rule) + "\\bin\\main.exe"); break;
+        case 1: paths.push_back("D:\\Tools\\tool" + std::to_string(rule) + "-v2.1\\run.exe"); break;
+        default: paths.push_back("C:\\Users\\me\\AppData\\Local\\app" + std::to_string(rule) + "\\app" + std::to_string(rule) + ".exe"); break;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    CategoryMatcher matcher(rules);
+    double compileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<uint32_t> compiled(paths.size());
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < paths.size(); ++i) {
+        compiled[i] = matcher.Match(paths[i]);
+    }
+    double compiledNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / paths.size();
+
+    std::vector<SequentialRule> sequential = CompileSequential(rules);
+    const size_t checked = 200;
+    bool agrees = true;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < checked; ++i) {
+        std::string expected = SequentialMatch(sequential, paths[i]);
+        agrees = agrees && (compiled[i] == CategoryMatcher::NO_CATEGORY ? expected.empty() : expected == matcher.CategoryName(compiled[i]));
+    }
+    double sequentialNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / checked;
+
+    // Ticks switching among the bench apps, with and without categories
+    ScriptedForegroundSource source;
+    for (size_t i = 0; i < 200000 / 20; ++i) {
+        const std::string& path = paths[i % 500];
+        source.AddStep(path.substr(path.rfind('\\') + 1) + std::to_string(i % 500), path, 20);
+    }
+    double tickNs[2] = {};
+    bool follows = true;
+    for (int withRules = 0; withRules < 2; ++withRules) {
+        TrackingEngine engine;
+        if (withRules) {
+            engine.SetCategoryMatcher(std::make_shared<const CategoryMatcher>(rules));
+        }
+        source.Rewind();
+        auto now = FromUnixSeconds(1700000000);
+        start = std::chrono::steady_clock::now();
+        size_t ticks = 0;
+        for (; !source.Finished(); ++ticks, now += std::chrono::seconds(1)) {
+            engine.Tick(source, now);
+        }
+        tickNs[withRules] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ticks;
+        follows = follows && CategoriesMatchApps(engine);
+    }
+
+    std::printf("category rules=%zu states=%zu compile %.1f ms   automaton %.0f ns/path   one by one %.0f ns/path   tick %.0f ns plain, %.0f ns with categories\n",
+                rules.size(), matcher.StateCount(), compileMs, compiledNs, sequentialNs, tickNs[0], tickNs[1]);
+    Check(agrees, "the automaton agrees with checking each rule in turn");
+    Check(compiledNs < sequentialNs, "the automaton beats checking each rule in turn");
+    Check(follows, "benchmarked category totals match the app totals");
+}
+
+// An hour of the UI on a virtual 60 Hz clock: the tracker ticks once a second,
+// the user scrolls and switches range a few times, and the window spends the
+// second half hidden in the tray. Counts frame timer wakeups against the fixed
+// 60 Hz timer the window used to run.
+void BenchFrameScheduler() {
+    const int appCount = 40;
+    TrackingEngine engine;
+    int64_t now = 1700000000;
+    for (int i = 0; i < appCount * 4; ++i) {
+        std::string name = "app" + std::to_string(i % appCount) + ".exe";
+        engine.Record({ name, "C:\\Program Files\\" + name }, FromUnixSeconds(now));
+        now += 1 + (i * 37) % 300;
+    }
+
+    UsageListLayout layout;
+    UsageListParams params;
+    params.clientWidth = 400;
+    params.clientHeight = 600;
+    std::vector<int> barWidths;
+    auto stepBars = [&]() {
+        bool animating = false;
+        for (const UsageRow& row : layout.Rows()) {
+            if (row.appId >= barWidths.size()) {
+                barWidths.resize(row.appId + 1, -1);
+            }
+            int& width = barWidths[row.appId];
+            int previous = width;
+            width = width < 0 ? row.targetBarWidth : static_cast<int>(width + 0.1f * (row.targetBarWidth - width));
+            animating |= width != previous;
+        }
+        return animating;
+    };
+
+    FrameScheduler scheduler;
+    const auto start = FrameScheduler::Clock::time_point();
+    const int framesPerSecond = 60;
+    const int seconds = 3600;
+    uint64_t wakeups = 0;
+    uint64_t hiddenWakeups = 0;
+    int rangeHours = 24 * 7;
+    scheduler.Show();
+    for (int frame = 0; frame < seconds * framesPerSecond; ++frame) {
+        auto clock = start + std::chrono::microseconds(frame * 1000000LL / framesPerSecond);
+        int second = frame / framesPerSecond;
+        bool hidden = second >= seconds / 2;
+        if (hidden && scheduler.Visible()) {
+            scheduler.Hide();
+        }
+
+        if (frame % framesPerSecond == 0) {
+            // Alternate between two apps so the bars keep shifting
+            std::string name = (second / 30) % 2 ? "app5.exe" : "app9.exe";
+            engine.Record({ name, "C:\\Program Files\\" + name }, FromUnixSeconds(now + second));
+            scheduler.Wake();
+            if (second % 600 == 300) {
+                rangeHours = rangeHours == 2 ? 24 * 7 : 2;  // The user switches range
+                scheduler.Interact(clock);
+            }
+        }
+        if (second % 900 == 100 && frame % 6 == 0) {
+            scheduler.Interact(clock);  // A second of scrolling
+        }
+
+        if (scheduler.Ticking()) {
+            params.rangeStart = FromUnixSeconds(now + second - rangeHours * 3600);
+            params.now = FromUnixSeconds(now + second);
+            layout.Update(engine, params);
+            scheduler.FrameDone(stepBars(), clock);
+            ++wakeups;
+            hiddenWakeups += hidden ? 1 : 0;
+        }
+    }
+
+    uint64_t fixed = static_cast<uint64_t>(seconds) * framesPerSecond;
+    std::printf("frame scheduler 1 h, half hidden  fixed 60 Hz: %llu wakeups   adaptive: %llu wakeups (%.2f/s visible)\n",
+                static_cast<unsigned long long>(fixed), static_cast<unsigned long long>(wakeups),
+                static_cast<double>(wakeups) / (seconds / 2));
+    Check(hiddenWakeups == 0, "a hidden window gets no frames");
+    Check(wakeups * 10 < fixed, "frames only run while something changes");
+
+    // Animations run to completion, and interaction keeps frames coming
+    FrameScheduler check(std::chrono::milliseconds(250));
+    Check(check.Show() && !check.Show(), "showing starts the frame clock once");
+    Check(check.FrameDone(true, start), "an animating frame asks for another");
+    Check(!check.FrameDone(false, start), "a converged frame stops the clock");
+    Check(check.Interact(start) && check.FrameDone(false, start + std::chrono::milliseconds(200)) &&
+          !check.FrameDone(false, start + std::chrono::milliseconds(300)), "interaction keeps frames for its linger");
+    check.Hide();
+    Check(!check.Wake() && !check.Ticking(), "a hidden window is not woken");
+}
+
+// The per-frame work the UI thread does once the list has settled: layout
+// lookup, bar animation, damage diff and icon lookups. None of it should touch
+// the heap; allocations are counted by the replaced operator new.
+void BenchSteadyStateAllocations() {
+    const int appCount = 40;
+    TrackingEngine engine;
+    int64_t now = 1700000000;
+    for (int i = 0; i < appCount * 4; ++i) {
+        std::string name = "app" + std::to_string(i % appCount) + ".exe";
+        engine.Record({ name, "C:\\Program Files\\Some Vendor With A Long Name\\" + name }, FromUnixSeconds(now));
+        now += 1 + (i * 37) % 300;
+    }
+
+    SyntheticIconDecoder decoder;
+    IconCache icons(decoder);
+    UsageListLayout layout;
+    UsageListDamage damage;
+    DamageRegion region;
+    UsageListParams params;
+    params.clientWidth = 400;
+    params.clientHeight = 600;
+    params.rangeStart = FromUnixSeconds(now - 24 * 3600);
+    params.now = FromUnixSeconds(now);
+    std::vector<int> barWidths;
+
+    UsageListFrame frame;
+    frame.clientWidth = params.clientWidth;
+    frame.clientHeight = params.clientHeight;
+    frame.scrollBarWidth = 15;
+    frame.barWidths = &barWidths;
+    frame.iconReady = [&](const UsageRow& row) { return icons.Find(engine.AppPath(row.appId), layout.IconSize(), 96) != nullptr; };
+
+    auto runFrame = [&]() {
+        layout.Update(engine, params);
+        for (const UsageRow& row : layout.Rows()) {
+            if (row.appId >= barWidths.size()) {
+                barWidths.resize(row.appId + 1, 0);
+            }
+            int& width = barWidths[row.appId];
+            width = static_cast<int>(width + 0.1f * (row.targetBarWidth - width));
+        }
+        region.Clear();
+        damage.Diff(layout, frame, region);
+    };
+
+    // Warm up: first layout, icon decodes and scratch buffers
+    for (int i = 0; i < 3; ++i) {
+        runFrame();
+        icons.WaitIdle(std::chrono::seconds(5));
+    }
+
+    const int frames = 600;
+    uint64_t worst = 0;
+    uint64_t total = 0;
+    for (int i = 0; i < frames; ++i) {
+        uint64_t before = ThreadAllocationCount();
+        runFrame();
+        uint64_t made = ThreadAllocationCount() - before;
+        worst = std::max(worst, made);
+        total += made;
+    }
+    icons.Stop();
+
+    std::printf("steady-state frame  %llu heap allocations in %d frames (worst frame %llu)\n",
+                static_cast<unsigned long long>(total), frames, static_cast<unsigned long long>(worst));
+    Check(ThreadAllocationCount() > 0, "the allocation counter sees allocations");
+    Check(total == 0, "steady-state frames make no heap allocations");
+}
+
+// Scrolls through usage lists of very different lengths doing a frame's
+// per-row work (animation, icon lookups, damage diff, painted rows) only for
+// the rows RowsIn() the viewport. Frame cost should not follow the row count.
+void BenchVirtualizedRows() {
+    // Icons are trivial here so the decoder thread doesn't skew the timing
+    class FlatIconDecoder : public IconDecoder {
+    public:
+        bool Decode(const std::string&, int size, int, IconImage& image) override {
+            ++decodes;
+            image.width = size;
+            image.height = size;
+            image.pixels.assign(static_cast<size_t>(size) * size, 0xff808080u);
+            return true;
+        }
+        std::atomic<int> decodes{ 0 };
+    };
+
+    const int clientHeight = 600;
+    const int framesPerList = 2000;
+    const int scrollStep = 7;
+    double frameUs[2] = {};
+    const size_t appCounts[2] = { 20, 20000 };
+    for (int list = 0; list < 2; ++list) {
+        size_t appCount = appCounts[list];
+        TrackingEngine engine;
+        int64_t now = 1700000000;
+        for (size_t i = 0; i < appCount; ++i) {
+            std::string name = "app" + std::to_string(i) + ".exe";
+            engine.Record({ name, "C:\\Program Files\\" + name }, FromUnixSeconds(now));
+            now += 1 + (i * 37) % 300;
+        }
+
+        FlatIconDecoder decoder;
+        IconCache icons(decoder);
+        UsageListLayout layout;
+        UsageListDamage damage;
+        DamageRegion region;
+        UsageListParams params;
+        params.clientWidth = 400;
+        params.clientHeight = clientHeight;
+        params.rangeStart = FromUnixSeconds(now - 365LL * 24 * 3600);
+        params.now = FromUnixSeconds(now);
+        layout.Update(engine, params);
+        const auto& rows = layout.Rows();
+        Check(rows.size() == appCount - 1, "every app with time in range gets a row");  // The last one just opened
+
+        // RowsIn() agrees with a scan over every row
+        bool sameRows = true;
+        for (int top = -100; top < layout.ContentHeight() + 100 && top < 5000; top += 13) {
+            UsageRowRange range = layout.RowsIn(top, clientHeight);
+            size_t begin = rows.size();
+            size_t end = 0;
+            for (size_t i = 0; i < rows.size(); ++i) {
+                if (rows[i].top < top + clientHeight && rows[i].top + layout.RowHeight() > top) {
+                    begin = std::min(begin, i);
+                    end = i + 1;
+                }
+            }
+            if (end == 0) {
+                begin = 0;
+            }
+            sameRows &= range.end - range.begin == end - begin && (end == begin || range.begin == begin);
+        }
+        Check(sameRows, "the visible slice matches a full scan");
+
+        std::vector<int> barWidths(engine.AppCount(), 0);
+        UsageListFrame frame;
+        frame.clientWidth = params.clientWidth;
+        frame.clientHeight = clientHeight;
+        frame.scrollBarWidth = 15;
+        frame.barWidths = &barWidths;
+        frame.iconReady = [&](const UsageRow& row) { return icons.Find(engine.AppPath(row.appId), layout.IconSize(), 96) != nullptr; };
+
+        int scrollMax = std::max(layout.ContentHeight() - clientHeight, 0);
+        size_t reached = 0;
+        uint64_t painted = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int f = 0; f < framesPerList; ++f) {
+            frame.scrollPos = scrollMax > 0 ? (f * scrollStep) % scrollMax : 0;
+            UsageRowRange nearby = layout.RowsIn(frame.scrollPos, clientHeight, UsageListLayout::OVERSCAN_ROWS);
+            for (size_t i = nearby.begin; i < nearby.end; ++i) {
+                int& width = barWidths[rows[i].appId];
+                width = static_cast<int>(width + 0.1f * (rows[i].targetBarWidth - width));
+                icons.Find(engine.AppPath(rows[i].appId), layout.IconSize(), 96);
+            }
+            reached = std::max(reached, nearby.end);
+            region.Clear();
+            damage.Diff(layout, frame, region);
+            UsageRowRange shown = layout.RowsIn(frame.scrollPos, clientHeight);
+            for (size_t i = shown.begin; i < shown.end; ++i) {
+                painted += static_cast<uint64_t>(rows[i].name->text.size() + barWidths[rows[i].appId]);
+            }
+        }
+        frameUs[list] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / framesPerList;
+        icons.WaitIdle(std::chrono::seconds(5));
+        icons.Stop();
+
+        std::printf("virtualized rows apps=%zu  %.2f us/frame, %d icons decoded, rows reached %zu  (%llu)\n",
+                    appCount, frameUs[list], decoder.decodes.load(), reached, static_cast<unsigned long long>(painted % 10));
+        Check(static_cast<size_t>(decoder.decodes.load()) <= reached, "icons load only for rows near the viewport");
+    }
+    Check(frameUs[1] < frameUs[0] * 3 + 5.0, "frame cost stays flat as the list grows");
+}
+
+#ifndef _WIN32
+// Foreground pid sequence replayed against /proc: a fresh Resolve() every tick
+// (what the tracker used to do) versus the identity cache.
+void BenchProcessCache() {
+    std::vector<pid_t> children;
+    for (int i = 0; i < 4; ++i) {
+        pid_t child = fork();
+        if (child == 0) {
+            for (;;) {
+                pause();
+            }
+        }
+        if (child > 0) {
+            children.push_back(child);
+        }
+    }
+
+    std::vector<uint32_t> pids = { static_cast<uint32_t>(getpid()) };
+    for (pid_t child : children) {
+        pids.push_back(static_cast<uint32_t>(child));
+    }
+
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<size_t> pidDist(0, pids.size() - 1);
+    std::vector<uint32_t> sequence;
+    while (sequence.size() < 20000) {
+        uint32_t pid = pids[pidDist(rng)];
+        sequence.insert(sequence.end(), 50, pid); // ~50 s of focus per switch
+    }
+
+    ProcProcessResolver resolver;
+    ProcessIdentity identity;
+    size_t resolved = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t pid : sequence) {
+        resolved += resolver.Resolve(pid, identity) ? 1 : 0;
+    }
+    double uncachedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / sequence.size();
+
+    ProcessIdentityCache cache(resolver);
+    size_t cached = 0;
+    begin = std::chrono::steady_clock::now();
+    for (uint32_t pid : sequence) {
+        cached += cache.Lookup(pid) ? 1 : 0;
+    }
+    double cachedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / sequence.size();
+
+    double hitRate = 100.0 * cache.Hits() / (cache.Hits() + cache.Misses());
+    std::printf("process identity  uncached %.0f ns/tick, cached %.0f ns/tick, hit rate %.2f%%\n",
+                uncachedNs, cachedNs, hitRate);
+    Check(resolved == sequence.size() && cached == sequence.size(), "every live pid resolves");
+    Check(cache.Misses() == pids.size(), "each process is resolved once while it lives");
+
+    // An exited process must not be served from the cache
+    uint32_t victim = static_cast<uint32_t>(children.back());
+    Check(cache.Lookup(victim) != nullptr, "child resolves before exit");
+    kill(children.back(), SIGKILL);
+    waitpid(children.back(), nullptr, 0);
+    children.pop_back();
+    uint64_t invalidations = cache.Invalidations();
+    Check(cache.Lookup(victim) == nullptr, "exited process is not served from the cache");
+    Check(cache.Invalidations() == invalidations + 1, "exit invalidates the cached identity");
+
+    for (pid_t child : children) {
+        kill(child, SIGKILL);
+        waitpid(child, nullptr, 0);
+    }
+    cache.Sweep();
+    Check(cache.Size() == 1, "sweep drops every exited process");
+}
+#endif
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* tracePath = nullptr;
+    size_t ticks = 2000000;
+    size_t apps = 200;
+    const char* framePath = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            ticks = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--apps") == 0 && i + 1 < argc) {
+            apps = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--frame") == 0 && i + 1 < argc) {
+            framePath = argv[++i];
+        }
+    }
+
+    TestSwitchAccounting();
+    TestGapsAreSkipped();
+    TestIntervalSlicing();
+    TestJournalRecovery();
+    TestJsonImport();
+    TestIconCache();
+    TestTextRuns();
+    TestUsageSnapshots();
+    TestAppRanking();
+    TestUsageQuery();
+    TestUsageHeatmap();
+    TestWindowTitles();
+    TestIdleAccounting();
+    TestClockStepBack();
+    TestFocusAnalytics();
+    TestSessionSketches();
+    TestCategoryRules();
+    TestCpuRasterizer(framePath);
+
+    if (tracePath) {
+        ScriptedForegroundSource source;
+        if (!source.LoadTrace(tracePath)) {
+            return 1;
+        }
+        RunReplay("trace replay", source, true);
+    } else {
+        ScriptedForegroundSource source = MakeSyntheticTrace(ticks, apps, 42);
+        RunReplay("synthetic replay", source, true);
+    }
+    BenchRangeQueries();
+    BenchRollups();
+    BenchSnapshotLoad();
+    BenchJsonImport();
+    BenchAppLookups(1000);
+    BenchAppLookups(10000);
+    BenchIconCache();
+    BenchUsageListLayout();
+    BenchUsageListDamage();
+    BenchCpuRasterizer();
+    BenchSnapshotPublishing();
+    BenchRanking();
+    BenchUsageQuery();
+    BenchHeatmap();
+    BenchWindowTitles();
+    BenchIdle();
+    BenchFocusAnalytics();
+    BenchSessionSketches();
+    BenchCategoryRules();
+    BenchFrameScheduler();
+    BenchSteadyStateAllocations();
+    BenchVirtualizedRows();
+#ifndef _WIN32
+    BenchProcessCache();
+#endif
+
+    if (failures > 0) {
+        std::printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,377 @@
+#include "TrackingEngine.h"
+#include <algorithm>
+
+int64_t ToUnixSeconds(std::chrono::system_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point FromUnixSeconds(int64_t seconds) {
+    return std::chrono::system_clock::time_point(std::chrono::seconds(seconds));
+}
+
+TrackingEngine::TrackingEngine(const TrackingEngine& other) {
+    *this = other;
+}
+
+TrackingEngine& TrackingEngine::operator=(const TrackingEngine& other) {
+    apps = other.apps;
+    currentAppId = other.currentAppId;
+    intervalLog = other.intervalLog;
+    rollups = other.rollups;
+    openInterval = other.openInterval;
+    focus = other.focus;
+    titles = other.titles;
+    categories = other.categories;
+    currentTitle = other.currentTitle;
+    trackTitles = other.trackTitles;
+    idleThreshold = other.idleThreshold;
+    idle = other.idle;
+    revision = other.revision;
+    historyEpoch = std::max(historyEpoch, other.historyEpoch) + 1;
+    return *this;
+}
+
+void TrackingEngine::Record(const ForegroundSample& sample, std::chrono::system_clock::time_point now) {
+    if (sample.appName.empty()) {
+        return;
+    }
+    int64_t nowSeconds = ToUnixSeconds(now);
+    uint32_t appId = InternApp(sample.appName, sample.appPath);
+
+    if (idle) {
+        // Idle ended with no input to date it (idle detection turned off, or
+        // the input source failed), so counting restarts now, not back at the break
+        idle = false;
+        CloseOpenInterval();
+        currentAppId = appId;
+        openInterval = { std::max(nowSeconds, openInterval.End()), 0, appId };
+    } else if (appId != currentAppId) {
+        // Close the old app's interval
+        if (currentAppId != AppTable::NO_APP) {
+            ExtendOpenInterval(nowSeconds);
+            CloseOpenInterval();
+        }
+
+        // Reset tracking for the new app. After the clock stepped back the
+        // new interval waits for it at the old one's end, keeping the log in time order.
+        int64_t begin = currentAppId != AppTable::NO_APP ? std::max(nowSeconds, openInterval.End()) : nowSeconds;
+        currentAppId = appId;
+        openInterval = { begin, 0, appId };
+    } else {
+        // Update the active time for the current app
+        ExtendOpenInterval(nowSeconds);
+    }
+    if (trackTitles && currentTitle != sample.windowTitle) {
+        currentTitle = sample.windowTitle;
+    }
+    apps.lastActive[currentAppId] = nowSeconds;
+    ++revision;
+}
+
+bool TrackingEngine::Tick(ForegroundSource& source, std::chrono::system_clock::time_point now) {
+    ForegroundSample sample;
+    if (!source.Sample(sample)) {
+        return false;
+    }
+    Record(sample, now);
+    return true;
+}
+
+void TrackingEngine::Record(const ForegroundSample& sample, std::chrono::system_clock::time_point now,
+                            std::chrono::system_clock::time_point lastInput) {
+    if (idleThreshold <= 0) {
+        Record(sample, now);
+        return;
+    }
+    int64_t nowSeconds = ToUnixSeconds(now);
+    int64_t inputSeconds = std::min(ToUnixSeconds(lastInput), nowSeconds);
+    if (nowSeconds - inputSeconds >= idleThreshold) {
+        if (!idle) {
+            EnterIdle(inputSeconds);
+        }
+        return;
+    }
+    if (!idle) {
+        Record(sample, now);
+        return;
+    }
+    if (sample.appName.empty()) {
+        return;
+    }
+
+    // Back from idle: the sampled app gets the time since the input that woke us
+    idle = false;
+    CloseOpenInterval();
+    currentAppId = InternApp(sample.appName, sample.appPath);
+    openInterval = { std::max(inputSeconds, openInterval.begin), 0, currentAppId };
+    if (trackTitles) {
+        currentTitle = sample.windowTitle;
+    }
+    ExtendOpenInterval(nowSeconds);
+    apps.lastActive[currentAppId] = openInterval.End();
+    ++revision;
+}
+
+bool TrackingEngine::Tick(ForegroundSource& source, InputActivitySource& input, std::chrono::system_clock::time_point now) {
+    // Idleness is still noticed while there is no foreground app (e.g. a locked desktop)
+    ForegroundSample sample;
+    bool sampled = source.Sample(sample);
+    if (!sampled) {
+        sample.appName.clear();
+    }
+    std::chrono::system_clock::time_point lastInput;
+    if (input.LastInput(now, lastInput)) {
+        Record(sample, now, lastInput);
+    } else {
+        Record(sample, now);
+    }
+    return sampled;
+}
+
+void TrackingEngine::RestoreInterval(const std::string& appName, const std::string& appPath,
+                                     std::chrono::system_clock::time_point begin,
+                                     std::chrono::system_clock::time_point end) {
+    ++revision;
+    ++historyEpoch;
+    int64_t beginSeconds = ToUnixSeconds(begin);
+    int64_t endSeconds = ToUnixSeconds(end);
+    uint32_t appId = InternApp(appName, appPath);
+    if (endSeconds > beginSeconds) {
+        FocusInterval interval = { beginSeconds, static_cast<uint32_t>(endSeconds - beginSeconds), appId };
+        intervalLog.Append(interval);
+        focus.Add(interval);
+        if (listener) {
+            listener->OnIntervalClosed(interval);
+        }
+        rollups.Add(appId, beginSeconds, endSeconds);
+        apps.activeSeconds[appId] += endSeconds - beginSeconds;
+        categories.Charge(apps, appId, endSeconds - beginSeconds);
+    }
+    apps.lastActive[appId] = std::max(apps.lastActive[appId], endSeconds);
+}
+
+uint32_t TrackingEngine::RestoreApp(std::string_view appName, std::string_view appPath,
+                                    int64_t activeSeconds, int64_t lastActive) {
+    ++revision;
+    uint32_t appId = InternApp(appName, appPath);
+    apps.activeSeconds[appId] += activeSeconds;
+    categories.Charge(apps, appId, activeSeconds);
+    apps.lastActive[appId] = std::max(apps.lastActive[appId], lastActive);
+    return appId;
+}
+
+void TrackingEngine::RestoreIntervals(const FocusInterval* records, size_t count, const std::vector<uint32_t>& appIdMap) {
+    ++revision;
+    ++historyEpoch;
+    bool identity = true;
+    for (uint32_t appId = 0; appId < appIdMap.size() && identity; ++appId) {
+        identity = appIdMap[appId] == appId;
+    }
+    if (identity) {
+        intervalLog.AppendSorted(records, count);
+        return;
+    }
+
+    std::vector<FocusInterval> remapped(records, records + count);
+    for (FocusInterval& interval : remapped) {
+        interval.appId = appIdMap[interval.appId];
+    }
+    intervalLog.AppendSorted(remapped.data(), remapped.size());
+}
+
+void TrackingEngine::RestoreRollup(RollupStore::Tier tier, int64_t start, uint32_t appId, uint32_t seconds) {
+    ++revision;
+    rollups.Restore(tier, start, appId, seconds);
+}
+
+void TrackingEngine::RestoreRollupNewest(int64_t newest) {
+    ++revision;
+    rollups.RestoreNewest(std::max(newest, rollups.Newest()));
+}
+
+void TrackingEngine::RestoreFocus(const FocusAnalytics::State& state, std::vector<AppFocus> apps, SessionDistributions sessions) {
+    ++revision;
+    focus.Restore(state, std::move(apps), std::move(sessions));
+}
+
+void TrackingEngine::SetCategoryMatcher(std::shared_ptr<const CategoryMatcher> matcher) {
+    ++revision;
+    categories.SetMatcher(std::move(matcher), apps);
+}
+
+void TrackingEngine::SplitOpenInterval() {
+    ++revision;
+    if (currentAppId == AppTable::NO_APP) {
+        return;
+    }
+    CloseOpenInterval();
+    openInterval = { openInterval.End(), 0, currentAppId };
+}
+
+void TrackingEngine::Clear(std::chrono::system_clock::time_point now) {
+    ++revision;
+    ++historyEpoch;
+    if (listener) {
+        listener->OnCleared(ToUnixSeconds(now));
+    }
+    apps.ResetTotals();
+    categories.Reset();
+    focus.Clear();
+    for (TitleSketch& sketch : titles) {
+        sketch.Clear();
+    }
+    intervalLog.Clear();
+    rollups.Clear();
+
+    // Reset tracking for the current app
+    if (currentAppId != AppTable::NO_APP) {
+        apps.lastActive[currentAppId] = ToUnixSeconds(now);
+        openInterval = { ToUnixSeconds(now), 0, currentAppId };
+    }
+}
+
+std::vector<std::pair<uint32_t, std::chrono::seconds>> TrackingEngine::RangeTotals(
+        std::chrono::system_clock::time_point from, std::chrono::system_clock::time_point to) const {
+    int64_t fromSeconds = ToUnixSeconds(from);
+    int64_t toSeconds = ToUnixSeconds(to);
+
+    std::vector<int64_t> totals(apps.Size(), 0);
+    int64_t alignedFrom = rollups.AlignUp(fromSeconds);
+    int64_t alignedTo = rollups.AlignDown(toSeconds);
+    if (alignedFrom < alignedTo) {
+        rollups.Accumulate(alignedFrom, alignedTo, totals);
+        AccumulateRaw(fromSeconds, alignedFrom, totals);
+        AccumulateRaw(alignedTo, toSeconds, totals);
+    } else {
+        AccumulateRaw(fromSeconds, toSeconds, totals);
+    }
+
+    std::vector<std::pair<uint32_t, std::chrono::seconds>> result;
+    for (uint32_t appId = 0; appId < totals.size(); ++appId) {
+        if (totals[appId] > 0) {
+            result.emplace_back(appId, std::chrono::seconds(totals[appId]));
+        }
+    }
+    return result;
+}
+
+bool TrackingEngine::AppLastActive(uint32_t appId, std::chrono::system_clock::time_point& lastActive) const {
+    if (apps.lastActive[appId] == AppTable::NEVER) {
+        return false;
+    }
+    lastActive = FromUnixSeconds(apps.lastActive[appId]);
+    return true;
+}
+
+bool TrackingEngine::OpenInterval(FocusInterval& interval) const {
+    if (currentAppId == AppTable::NO_APP) {
+        return false;
+    }
+    interval = openInterval;
+    return true;
+}
+
+uint32_t TrackingEngine::InternApp(std::string_view appName, std::string_view appPath) {
+    size_t appCount = apps.Size();
+    uint32_t appId = apps.Intern(appName, appPath);
+    if (listener && appId >= appCount) {
+        listener->OnAppAdded(appId, apps.Name(appId), apps.Path(appId));
+    }
+    return appId;
+}
+
+void TrackingEngine::CloseOpenInterval() {
+    if (openInterval.length == 0) {
+        return;
+    }
+    if (!intervalLog.Append(openInterval)) {
+        // Landed before logged intervals (the clock stepped back across a restart)
+        ++historyEpoch;
+    }
+    focus.Add(openInterval);
+    if (listener) {
+        listener->OnIntervalClosed(openInterval);
+    }
+}
+
+const TitleSketch* TrackingEngine::AppTitles(uint32_t appId) const {
+    return appId < titles.size() && titles[appId].Total() > 0 ? &titles[appId] : nullptr;
+}
+
+void TrackingEngine::ExtendOpenInterval(int64_t nowSeconds) {
+    // Ignore samples that go back in time (e.g. after a clock adjustment)
+    int64_t elapsed = nowSeconds - openInterval.End();
+    if (elapsed <= 0) {
+        return;
+    }
+    rollups.Add(openInterval.appId, openInterval.End(), nowSeconds);
+    if (trackTitles) {
+        // Like the app, the title seen at the previous sample gets the time
+        if (titles.size() <= currentAppId) {
+            titles.resize(currentAppId + 1, TitleSketch(TITLES_PER_APP));
+        }
+        titles[currentAppId].Add(currentTitle, elapsed);
+    }
+    openInterval.length += static_cast<uint32_t>(elapsed);
+    apps.activeSeconds[currentAppId] += elapsed;
+    categories.Charge(apps, currentAppId, elapsed);
+    if (listener) {
+        listener->OnOpenIntervalExtended(openInterval);
+    }
+}
+
+void TrackingEngine::TrimOpenInterval(int64_t toSeconds) {
+    int64_t trim = openInterval.End() - std::max(toSeconds, openInterval.begin);
+    if (trim <= 0) {
+        return;
+    }
+    rollups.Remove(openInterval.appId, openInterval.End() - trim, openInterval.End());
+    if (trackTitles && currentAppId < titles.size()) {
+        // The tail may have spanned title changes; the latest title stands in for all of it
+        titles[currentAppId].Remove(currentTitle, trim);
+    }
+    openInterval.length -= static_cast<uint32_t>(trim);
+    apps.activeSeconds[currentAppId] -= trim;
+    categories.Charge(apps, currentAppId, -trim);
+    apps.lastActive[currentAppId] = openInterval.End();
+    if (listener) {
+        listener->OnOpenIntervalExtended(openInterval);
+    }
+}
+
+void TrackingEngine::EnterIdle(int64_t lastInputSeconds) {
+    idle = true;
+    ++revision;
+    if (currentAppId == AppTable::NO_APP) {
+        return;
+    }
+    // Samples taken after the last input were charged before anyone knew it
+    // was the last; samples due before it were not taken yet
+    if (openInterval.End() > lastInputSeconds) {
+        TrimOpenInterval(lastInputSeconds);
+    } else {
+        ExtendOpenInterval(lastInputSeconds);
+        apps.lastActive[currentAppId] = openInterval.End();
+    }
+    CloseOpenInterval();
+    openInterval = { openInterval.End(), 0, currentAppId };
+}
+
+void TrackingEngine::AccumulateRaw(int64_t from, int64_t to, std::vector<int64_t>& totals) const {
+    if (from >= to) {
+        return;
+    }
+    intervalLog.AccumulateRange(from, to, totals);
+
+    FocusInterval open;
+    if (OpenInterval(open)) {
+        int64_t begin = std::max(open.begin, from);
+        int64_t end = std::min(open.End(), to);
+        if (end > begin) {
+            if (open.appId >= totals.size()) {
+                totals.resize(open.appId + 1, 0);
+            }
+            totals[open.appId] += end - begin;
+        }
+    }
+}
@@ -0,0 +1,166 @@
+#ifndef TRACKING_ENGINE_H
+#define TRACKING_ENGINE_H
+
+#include "ForegroundSource.h"
+#include "InputActivitySource.h"
+#include "AppTable.h"
+#include "IntervalLog.h"
+#include "RollupStore.h"
+#include "TrackingListener.h"
+#include "TitleSketch.h"
+#include "FocusAnalytics.h"
+#include "CategoryRules.h"
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+// Platform-neutral accounting core. Charges elapsed wall time to whichever app
+// was in the foreground at the previous sample and records every focus span in
+// an append-only IntervalLog, rolling it up into time buckets as it goes.
+// Not thread-safe: callers serialize access (the Windows build uses dataMutex).
+class TrackingEngine {
+public:
+    // Accounts one foreground sample taken at "now".
+    void Record(const ForegroundSample& sample, std::chrono::system_clock::time_point now);
+
+    // Samples the source and records the result. Returns false if the source had nothing to report.
+    bool Tick(ForegroundSource& source, std::chrono::system_clock::time_point now);
+
+    // Idle-aware variants: once no input has been seen for the idle threshold,
+    // the open interval is cut back to the last input and nothing is charged
+    // until input resumes, when a fresh interval starts at that input.
+    void Record(const ForegroundSample& sample, std::chrono::system_clock::time_point now,
+                std::chrono::system_clock::time_point lastInput);
+    // A source that cannot tell the last input leaves the sample unfiltered.
+    // Returns false if the foreground source had nothing to report.
+    bool Tick(ForegroundSource& source, InputActivitySource& input, std::chrono::system_clock::time_point now);
+
+    // Zero, the default, turns idle detection off. An engine that is idle
+    // then starts counting again at the next sample, not at the break.
+    void SetIdleThreshold(std::chrono::seconds threshold) { idleThreshold = threshold.count(); }
+    std::chrono::seconds IdleThreshold() const { return std::chrono::seconds(idleThreshold); }
+    bool Idle() const { return idle; }
+
+    // Restores a previously saved focus interval (used when loading tracking_data.json).
+    // Intervals may be restored in any order.
+    void RestoreInterval(const std::string& appName, const std::string& appPath,
+                         std::chrono::system_clock::time_point begin, std::chrono::system_clock::time_point end);
+
+    // Verbatim restore used by the binary snapshot loader: rows first, then
+    // intervals and rollups, none of which is re-derived from the others.
+    // appIdMap translates snapshot app ids to engine app ids.
+    uint32_t RestoreApp(std::string_view appName, std::string_view appPath, int64_t activeSeconds, int64_t lastActive);
+    void RestoreIntervals(const FocusInterval* records, size_t count, const std::vector<uint32_t>& appIdMap);
+    void RestoreRollup(RollupStore::Tier tier, int64_t start, uint32_t appId, uint32_t seconds);
+    void RestoreRollupNewest(int64_t newest);
+    // Focus metrics as saved, with app ids already translated; replaces what
+    // the restores above would not have fed it (they leave it alone)
+    void RestoreFocus(const FocusAnalytics::State& state, std::vector<AppFocus> apps, SessionDistributions sessions);
+
+    // Closes the open interval where it currently ends and opens a fresh one for
+    // the same app, so that everything up to now is in the log. Used before checkpoints.
+    void SplitOpenInterval();
+
+    // Drops all history, keeping the current app as a fresh zero-length entry.
+    // App ids stay valid.
+    void Clear(std::chrono::system_clock::time_point now);
+
+    // Also charges time to the window title of each sample, per app, keeping
+    // the TITLES_PER_APP heaviest titles. Off by default; turning it off keeps
+    // what was counted. Titles live in memory only and go with Clear().
+    static const size_t TITLES_PER_APP = 32;
+    void SetTitleTracking(bool enabled) { trackTitles = enabled; }
+    bool TitleTracking() const { return trackTitles; }
+    // nullptr if no title time was charged to the app
+    const TitleSketch* AppTitles(uint32_t appId) const;
+
+    // Session lengths and context switches, fed each interval as it closes;
+    // pass OpenInterval() to its queries to include the session under way
+    const FocusAnalytics& Focus() const { return focus; }
+
+    // Groups apps into categories with the matcher; nullptr leaves every app
+    // uncategorized. Category totals are recounted from the app totals, then
+    // charged alongside them.
+    void SetCategoryMatcher(std::shared_ptr<const CategoryMatcher> matcher);
+    const CategoryTotals& Categories() const { return categories; }
+    // CategoryMatcher::NO_CATEGORY if no rule matches the app
+    uint32_t AppCategory(uint32_t appId) const { return categories.CategoryOf(apps, appId); }
+
+    // Receives every state change from now on; nullptr detaches. Not copied with the engine.
+    void SetListener(TrackingListener* newListener) { listener = newListener; }
+
+    // Focus time per app id within [from, to), including the interval that is still open.
+    // Answered from rollups, with only the partial buckets at either end read from the log.
+    // Apps without any time in the window are omitted.
+    std::vector<std::pair<uint32_t, std::chrono::seconds>> RangeTotals(
+            std::chrono::system_clock::time_point from, std::chrono::system_clock::time_point to) const;
+
+    const AppTable& Apps() const { return apps; }
+    size_t AppCount() const { return apps.Size(); }
+    const std::string& AppName(uint32_t appId) const { return apps.Name(appId); }
+    const std::string& AppPath(uint32_t appId) const { return apps.Path(appId); }
+    std::chrono::seconds AppActiveTime(uint32_t appId) const { return std::chrono::seconds(apps.activeSeconds[appId]); }
+    // False if the app has no recorded activity since the last Clear()
+    bool AppLastActive(uint32_t appId, std::chrono::system_clock::time_point& lastActive) const;
+
+    // Changes whenever anything above would answer differently; lets views
+    // rebuild derived state only when the data moved
+    uint64_t Revision() const { return revision; }
+
+    // Changes whenever history is rewritten rather than appended to (Clear(),
+    // restores, assignment), so incremental views know to recount
+    uint64_t HistoryEpoch() const { return historyEpoch; }
+
+    // AppTable::NO_APP until the first sample
+    uint32_t CurrentAppId() const { return currentAppId; }
+
+    const IntervalLog& Intervals() const { return intervalLog; }
+    const RollupStore& Rollups() const { return rollups; }
+
+    // The interval of the current app that has not been closed by a switch yet.
+    bool OpenInterval(FocusInterval& interval) const;
+
+    TrackingEngine() = default;
+    TrackingEngine(const TrackingEngine& other);
+    TrackingEngine& operator=(const TrackingEngine& other);
+
+private:
+    uint32_t InternApp(std::string_view appName, std::string_view appPath);
+    void CloseOpenInterval();
+    void ExtendOpenInterval(int64_t nowSeconds);
+    void TrimOpenInterval(int64_t toSeconds);
+    void EnterIdle(int64_t lastInputSeconds);
+    void AccumulateRaw(int64_t from, int64_t to, std::vector<int64_t>& totals) const;
+
+    AppTable apps;
+    uint32_t currentAppId = AppTable::NO_APP;
+
+    IntervalLog intervalLog;
+    RollupStore rollups;
+    FocusInterval openInterval = {};
+
+    FocusAnalytics focus;
+
+    std::vector<TitleSketch> titles;  // By app id, grown as apps get title time
+    CategoryTotals categories;
+
+    std::string currentTitle;         // Title of the last sample, charged on the next one
+    bool trackTitles = false;
+
+    int64_t idleThreshold = 0;  // Seconds without input before time stops counting
+    bool idle = false;
+
+    TrackingListener* listener = nullptr;
+    uint64_t revision = 0;
+    uint64_t historyEpoch = 0;
+};
+
+// Whole Unix seconds for a system_clock time point
+int64_t ToUnixSeconds(std::chrono::system_clock::time_point time);
+std::chrono::system_clock::time_point FromUnixSeconds(int64_t seconds);
+
+#endif
@@ -0,0 +1,402 @@
+#include "TrackingJournal.h"
+#include "TrackingEngine.h"
+#include "MappedFile.h"
+#include "FileUtils.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+namespace {
+
+const char JOURNAL_MAGIC[8] = { 'S', 'T', 'T', 'J', 'R', 'N', 'L', '\0' };
+constexpr uint32_t JOURNAL_VERSION = 1;
+
+struct JournalHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t firstSequence;
+};
+static_assert(sizeof(JournalHeader) == 24, "JournalHeader is part of the file format");
+
+enum RecordType : uint8_t {
+    RECORD_APP = 1,       // uint32 app id, uint16 name length, uint16 path length, name, path
+    RECORD_INTERVAL = 2,  // Varints: zigzag(begin - previous end), length, app id
+    RECORD_OPEN = 3,      // As RECORD_INTERVAL, the open interval so far; does not move "previous end"
+    RECORD_CLEAR = 4,     // int64 Unix seconds
+};
+
+constexpr size_t RECORD_OVERHEAD = 1 + 2 + 4;  // type, payload length, checksum
+constexpr size_t MAX_STRING_LENGTH = 30000;     // Keeps an app record within the uint16 length
+constexpr size_t MAX_PENDING_BYTES = 64 * 1024;
+
+// FNV-1a over the record's type, length and payload
+uint32_t Checksum(const uint8_t* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void PutVarint(uint8_t* out, size_t& size, uint64_t value) {
+    while (value >= 0x80) {
+        out[size++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    out[size++] = static_cast<uint8_t>(value);
+}
+
+bool GetVarint(const uint8_t*& in, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; in < end && shift < 64; shift += 7) {
+        uint8_t byte = *in++;
+        value |= uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t ZigZag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Decodes a RECORD_INTERVAL/RECORD_OPEN payload
+bool ReadInterval(const uint8_t* payload, size_t length, int64_t previousEnd, FocusInterval& interval) {
+    const uint8_t* end = payload + length;
+    uint64_t delta, intervalLength, appId;
+    if (!GetVarint(payload, end, delta) || !GetVarint(payload, end, intervalLength) || !GetVarint(payload, end, appId)
+        || payload != end || intervalLength > UINT32_MAX || appId > UINT32_MAX) {
+        return false;
+    }
+    interval = { previousEnd + UnZigZag(delta), static_cast<uint32_t>(intervalLength), static_cast<uint32_t>(appId) };
+    return true;
+}
+
+template <typename T>
+T ReadValue(const uint8_t* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+} // namespace
+
+TrackingJournal::TrackingJournal(std::chrono::milliseconds maxFlushDelay, std::chrono::milliseconds maxProgressDelay)
+        : maxFlushDelay(maxFlushDelay), maxProgressDelay(maxProgressDelay) {
+}
+
+TrackingJournal::~TrackingJournal() {
+    Close();
+}
+
+bool TrackingJournal::Open(const std::string& newFilename, uint64_t firstSequence, const AppTable& apps) {
+    std::lock_guard<std::mutex> lock(mutex);
+    CloseLocked();
+    return OpenLocked(newFilename, firstSequence, apps);
+}
+
+void TrackingJournal::Close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    CloseLocked();
+}
+
+bool TrackingJournal::IsOpen() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return file != nullptr;
+}
+
+bool TrackingJournal::Rotate(const std::string& archiveName, const AppTable& apps) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!file) {
+        return false;
+    }
+    std::string current = filename;
+    CloseLocked();
+    if (!RenameReplacing(current, archiveName)) {
+        std::cerr << "Error: Unable to archive " << current << std::endl;
+        // Keep journaling into the old file; its records stay numbered correctly
+        file = std::fopen(current.c_str(), "ab");
+        filename = current;
+        return false;
+    }
+    return OpenLocked(current, nextSequence, apps);
+}
+
+bool TrackingJournal::Flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return FlushLocked(true);
+}
+
+bool TrackingJournal::FlushIfDue(std::chrono::steady_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!pending.empty() && !pendingSeen) {
+        pendingSeen = true;
+        pendingSince = now;
+    }
+    if (openDirty && !openSeen) {
+        openSeen = true;
+        openSince = now;
+    }
+
+    bool progressDue = openDirty && now - openSince >= maxProgressDelay;
+    bool pendingDue = !pending.empty() && (now - pendingSince >= maxFlushDelay || pending.size() >= MAX_PENDING_BYTES);
+    if (!progressDue && !pendingDue) {
+        return true;
+    }
+    return FlushLocked(progressDue);
+}
+
+uint64_t TrackingJournal::NextSequence() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return nextSequence;
+}
+
+uint64_t TrackingJournal::FileSize() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return fileSize + pending.size();
+}
+
+uint64_t TrackingJournal::BytesWritten() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytesWritten;
+}
+
+void TrackingJournal::OnAppAdded(uint32_t appId, const std::string& appName, const std::string& appPath) {
+    std::lock_guard<std::mutex> lock(mutex);
+    AppendApp(appId, appName, appPath);
+}
+
+void TrackingJournal::OnIntervalClosed(const FocusInterval& interval) {
+    std::lock_guard<std::mutex> lock(mutex);
+    AppendInterval(RECORD_INTERVAL, interval);
+    // The closed record supersedes any unwritten progress of the same interval
+    if (openDirty && openInterval.begin == interval.begin && openInterval.appId == interval.appId) {
+        openDirty = false;
+        openSeen = false;
+    }
+}
+
+void TrackingJournal::OnOpenIntervalExtended(const FocusInterval& interval) {
+    std::lock_guard<std::mutex> lock(mutex);
+    openInterval = interval;
+    openDirty = true;
+}
+
+void TrackingJournal::OnCleared(int64_t now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    openDirty = false;
+    openSeen = false;
+    AppendRecord(RECORD_CLEAR, &now, sizeof(now));
+}
+
+void TrackingJournal::AppendRecord(uint8_t type, const void* payload, size_t size) {
+    size_t start = pending.size();
+    uint16_t length = static_cast<uint16_t>(size);
+    pending.push_back(type);
+    pending.insert(pending.end(), reinterpret_cast<const uint8_t*>(&length), reinterpret_cast<const uint8_t*>(&length) + 2);
+    pending.insert(pending.end(), static_cast<const uint8_t*>(payload), static_cast<const uint8_t*>(payload) + size);
+    uint32_t checksum = Checksum(pending.data() + start, pending.size() - start);
+    pending.insert(pending.end(), reinterpret_cast<const uint8_t*>(&checksum), reinterpret_cast<const uint8_t*>(&checksum) + 4);
+    ++nextSequence;
+}
+
+void TrackingJournal::AppendApp(uint32_t appId, const std::string& appName, const std::string& appPath) {
+    uint16_t nameLength = static_cast<uint16_t>(std::min(appName.size(), MAX_STRING_LENGTH));
+    uint16_t pathLength = static_cast<uint16_t>(std::min(appPath.size(), MAX_STRING_LENGTH));
+
+    std::vector<uint8_t> payload(8 + nameLength + pathLength);
+    std::memcpy(payload.data(), &appId, 4);
+    std::memcpy(payload.data() + 4, &nameLength, 2);
+    std::memcpy(payload.data() + 6, &pathLength, 2);
+    std::memcpy(payload.data() + 8, appName.data(), nameLength);
+    std::memcpy(payload.data() + 8 + nameLength, appPath.data(), pathLength);
+    AppendRecord(RECORD_APP, payload.data(), payload.size());
+}
+
+void TrackingJournal::AppendInterval(uint8_t type, const FocusInterval& interval) {
+    uint8_t payload[30];
+    size_t size = 0;
+    PutVarint(payload, size, ZigZag(interval.begin - lastEnd));
+    PutVarint(payload, size, interval.length);
+    PutVarint(payload, size, interval.appId);
+    AppendRecord(type, payload, size);
+    if (type == RECORD_INTERVAL) {
+        lastEnd = interval.End();
+    }
+}
+
+bool TrackingJournal::OpenLocked(const std::string& newFilename, uint64_t firstSequence, const AppTable& apps) {
+    file = std::fopen(newFilename.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error: Unable to open journal " << newFilename << std::endl;
+        return false;
+    }
+    filename = newFilename;
+    nextSequence = firstSequence;
+    lastEnd = 0;
+
+    JournalHeader header = {};
+    std::memcpy(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    header.version = JOURNAL_VERSION;
+    header.firstSequence = firstSequence;
+    std::fwrite(&header, sizeof(header), 1, file);
+    fileSize = sizeof(header);
+    bytesWritten += sizeof(header);
+
+    for (uint32_t appId = 0; appId < apps.Size(); ++appId) {
+        AppendApp(appId, apps.Name(appId), apps.Path(appId));
+    }
+    return FlushLocked(true);
+}
+
+bool TrackingJournal::FlushLocked(bool includeOpen) {
+    if (!file) {
+        return false;
+    }
+    if (includeOpen && openDirty) {
+        AppendInterval(RECORD_OPEN, openInterval);
+        openDirty = false;
+        openSeen = false;
+    }
+    if (pending.empty()) {
+        return true;
+    }
+
+    bool written = std::fwrite(pending.data(), 1, pending.size(), file) == pending.size() && SyncFile(file);
+    if (!written) {
+        std::cerr << "Error: Unable to write journal " << filename << std::endl;
+    }
+    fileSize += pending.size();
+    bytesWritten += pending.size();
+    pending.clear();
+    pendingSeen = false;
+    return written;
+}
+
+void TrackingJournal::CloseLocked() {
+    if (!file) {
+        return;
+    }
+    FlushLocked(true);
+    std::fclose(file);
+    file = nullptr;
+}
+
+bool ReplayJournal(TrackingEngine& engine, const std::string& filename, uint64_t fromSequence,
+                   JournalReplayResult& result) {
+    result = JournalReplayResult();
+
+    MappedFile file;
+    if (!file.Open(filename) || file.Size() < sizeof(JournalHeader)) {
+        return false;
+    }
+    JournalHeader header = ReadValue<JournalHeader>(file.Data());
+    if (std::memcmp(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 || header.version != JOURNAL_VERSION) {
+        return false;
+    }
+
+    // Journal app ids are the ids the writing engine used; App records map them
+    // to this engine and are applied even when skipped, since they are idempotent
+    std::unordered_map<uint32_t, uint32_t> appIds;
+    FocusInterval open = {};
+    bool hasOpen = false;
+    auto restoreOpen = [&]() {
+        if (hasOpen) {
+            engine.RestoreInterval(engine.AppName(open.appId), engine.AppPath(open.appId),
+                                   FromUnixSeconds(open.begin), FromUnixSeconds(open.End()));
+            hasOpen = false;
+        }
+    };
+
+    const uint8_t* data = file.Data();
+    size_t size = file.Size();
+    size_t offset = sizeof(JournalHeader);
+    uint64_t sequence = header.firstSequence;
+    int64_t lastEnd = 0;
+    while (offset < size) {
+        if (size - offset < RECORD_OVERHEAD) {
+            result.torn = true;
+            break;
+        }
+        uint8_t type = data[offset];
+        uint16_t length = ReadValue<uint16_t>(data + offset + 1);
+        if (size - offset < RECORD_OVERHEAD + length
+            || ReadValue<uint32_t>(data + offset + 3 + length) != Checksum(data + offset, 3 + length)) {
+            result.torn = true;
+            break;
+        }
+        const uint8_t* payload = data + offset + 3;
+        offset += RECORD_OVERHEAD + length;
+        bool apply = sequence++ >= fromSequence;
+
+        if (type == RECORD_APP && length >= 8) {
+            uint16_t nameLength = ReadValue<uint16_t>(payload + 4);
+            uint16_t pathLength = ReadValue<uint16_t>(payload + 6);
+            if (nameLength == 0 || 8u + nameLength + pathLength > length) {
+                continue;
+            }
+            std::string_view appName(reinterpret_cast<const char*>(payload + 8), nameLength);
+            std::string_view appPath(reinterpret_cast<const char*>(payload + 8 + nameLength), pathLength);
+            appIds[ReadValue<uint32_t>(payload)] = engine.RestoreApp(appName, appPath, 0, AppTable::NEVER);
+        } else if (type == RECORD_INTERVAL || type == RECORD_OPEN) {
+            // Decoded even when skipped, since the next interval is relative to it
+            FocusInterval interval;
+            if (!ReadInterval(payload, length, lastEnd, interval)) {
+                continue;
+            }
+            if (type == RECORD_INTERVAL) {
+                lastEnd = interval.End();
+            }
+            if (!apply) {
+                ++result.skipped;
+                continue;
+            }
+
+            auto it = appIds.find(interval.appId);
+            if (it == appIds.end()) {
+                continue; // Refers to an app this file never listed
+            }
+            interval.appId = it->second;
+
+            if (type == RECORD_OPEN) {
+                if (hasOpen && (open.begin != interval.begin || open.appId != interval.appId)) {
+                    restoreOpen();
+                }
+                open = interval;
+                hasOpen = true;
+            } else {
+                if (hasOpen && open.begin == interval.begin && open.appId == interval.appId) {
+                    hasOpen = false;
+                }
+                engine.RestoreInterval(engine.AppName(interval.appId), engine.AppPath(interval.appId),
+                                       FromUnixSeconds(interval.begin), FromUnixSeconds(interval.End()));
+            }
+        } else if (!apply) {
+            // Already in the snapshot
+        } else if (type == RECORD_CLEAR && length == sizeof(int64_t)) {
+            hasOpen = false;
+            engine.Clear(FromUnixSeconds(ReadValue<int64_t>(payload)));
+        } else {
+            continue; // Unknown or malformed record
+        }
+
+        if (apply) {
+            ++result.applied;
+        } else {
+            ++result.skipped;
+        }
+    }
+
+    // Progress on an interval that was still open when the journal ended
+    restoreOpen();
+    result.nextSequence = sequence;
+    return true;
+}
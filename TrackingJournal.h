@@ -0,0 +1,108 @@
+#ifndef TRACKING_JOURNAL_H
+#define TRACKING_JOURNAL_H
+
+#include "TrackingListener.h"
+#include "AppTable.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class TrackingEngine;
+
+// Append-only journal of engine events (tracking_data.bin.journal).
+//
+// A file is a JournalHeader followed by records of
+//   uint8 type, uint16 payload length, payload, uint32 checksum
+// numbered consecutively from the header's firstSequence. A snapshot records
+// the first sequence it does not contain, so replay can skip whatever a
+// checkpoint already covers. Every file starts with the app rows it refers
+// to, which makes it readable on its own. Intervals are varint-encoded
+// relative to the end of the previous one, about a dozen bytes per app switch.
+//
+// Events are encoded into memory and written in batches: Flush() appends
+// them and syncs the file, FlushIfDue() does so once the oldest unwritten
+// event is maxFlushDelay old. Progress of the open interval is only written
+// every maxProgressDelay, bounding what a crash can lose of the current app.
+class TrackingJournal : public TrackingListener {
+public:
+    explicit TrackingJournal(std::chrono::milliseconds maxFlushDelay = std::chrono::seconds(5),
+                             std::chrono::milliseconds maxProgressDelay = std::chrono::seconds(30));
+    ~TrackingJournal() override;
+
+    TrackingJournal(const TrackingJournal&) = delete;
+    TrackingJournal& operator=(const TrackingJournal&) = delete;
+
+    // Starts a new file (replacing any existing one) numbered from firstSequence
+    // and lists every row of apps at its start.
+    bool Open(const std::string& filename, uint64_t firstSequence, const AppTable& apps);
+    // Flushes and closes the file.
+    void Close();
+    bool IsOpen() const;
+
+    // Moves the current file to archiveName and opens a fresh one in its place,
+    // numbered from NextSequence(). Pending events go to the archived file.
+    bool Rotate(const std::string& archiveName, const AppTable& apps);
+
+    // Writes everything, including the open interval's progress.
+    bool Flush();
+    // Meant to be polled (the tracker does so every tick); deadlines count from
+    // the first poll that sees an event, so now only needs to be monotonic.
+    bool FlushIfDue(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    // Sequence number the next record will get
+    uint64_t NextSequence() const;
+    // Size of the current file, including events not flushed yet
+    uint64_t FileSize() const;
+    // Bytes appended to any file since construction
+    uint64_t BytesWritten() const;
+
+    void OnAppAdded(uint32_t appId, const std::string& appName, const std::string& appPath) override;
+    void OnIntervalClosed(const FocusInterval& interval) override;
+    void OnOpenIntervalExtended(const FocusInterval& interval) override;
+    void OnCleared(int64_t now) override;
+
+private:
+    void AppendRecord(uint8_t type, const void* payload, size_t size);
+    void AppendApp(uint32_t appId, const std::string& appName, const std::string& appPath);
+    void AppendInterval(uint8_t type, const FocusInterval& interval);
+    bool OpenLocked(const std::string& filename, uint64_t firstSequence, const AppTable& apps);
+    bool FlushLocked(bool includeOpen);
+    void CloseLocked();
+
+    mutable std::mutex mutex;
+    std::FILE* file = nullptr;
+    std::string filename;
+    std::chrono::milliseconds maxFlushDelay;
+    std::chrono::milliseconds maxProgressDelay;
+
+    std::vector<uint8_t> pending;
+    bool pendingSeen = false;  // FlushIfDue has started the deadline for pending
+    std::chrono::steady_clock::time_point pendingSince;
+    FocusInterval openInterval = {};
+    bool openDirty = false;
+    bool openSeen = false;
+    std::chrono::steady_clock::time_point openSince;
+    int64_t lastEnd = 0;  // End of the last interval encoded into the current file
+
+    uint64_t nextSequence = 0;
+    uint64_t fileSize = 0;
+    uint64_t bytesWritten = 0;
+};
+
+struct JournalReplayResult {
+    uint64_t nextSequence = 0;  // One past the last valid record
+    size_t applied = 0;         // Records applied to the engine
+    size_t skipped = 0;         // Records already covered by the snapshot
+    bool torn = false;          // The file ended in a partial or damaged record
+};
+
+// Applies the records of a journal file numbered fromSequence or later.
+// Stops at the first damaged record, as left by a crash mid-write. Returns
+// false if the file is missing or not a journal.
+bool ReplayJournal(TrackingEngine& engine, const std::string& filename, uint64_t fromSequence,
+                   JournalReplayResult& result);
+
+#endif
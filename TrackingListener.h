@@ -0,0 +1,29 @@
+#ifndef TRACKING_LISTENER_H
+#define TRACKING_LISTENER_H
+
+#include "IntervalLog.h"
+#include <cstdint>
+#include <string>
+
+// Receives the engine's state changes as they happen, e.g. to journal them.
+// Called with the engine's lock held, so implementations must not call back
+// into the engine and should return quickly.
+class TrackingListener {
+public:
+    virtual ~TrackingListener() = default;
+
+    // A new app row was created.
+    virtual void OnAppAdded(uint32_t appId, const std::string& appName, const std::string& appPath) = 0;
+
+    // A focus interval was closed and appended to the log.
+    virtual void OnIntervalClosed(const FocusInterval& interval) = 0;
+
+    // The still-open interval grew, or shrank when an idle tail was trimmed off.
+    // Sent on every sample, so cheap to handle.
+    virtual void OnOpenIntervalExtended(const FocusInterval& interval) = 0;
+
+    // All history was dropped at "now" (Unix seconds).
+    virtual void OnCleared(int64_t now) = 0;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include "TrackingStore.h"
+#include "SnapshotFile.h"
+#include "JsonStore.h"
+#include "FileUtils.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+namespace {
+
+constexpr uint64_t MAX_JOURNAL_BYTES = 1024 * 1024;
+constexpr std::chrono::minutes CHECKPOINT_INTERVAL(15);
+
+// Moves a file out of the way under a name nothing here writes to, never
+// replacing an earlier one. True if the file is gone from its old name.
+bool SetAside(const std::string& filename) {
+    if (!FileExists(filename)) {
+        return true;
+    }
+    std::string aside = filename + ".bad";
+    for (int attempt = 1; FileExists(aside); ++attempt) {
+        aside = filename + ".bad" + std::to_string(attempt);
+    }
+    if (!RenameReplacing(filename, aside)) {
+        std::cerr << "Error: Unable to set aside " << filename << std::endl;
+        return false;
+    }
+    std::cerr << "Error: Kept " << filename << " as " << aside << std::endl;
+    return true;
+}
+
+} // namespace
+
+TrackingStore::TrackingStore(const std::string& snapshotFile, std::chrono::milliseconds maxFlushDelay)
+        : snapshotFile(snapshotFile),
+          journalFile(snapshotFile + ".journal"),
+          archivedJournalFile(snapshotFile + ".journal.old"),
+          journal(maxFlushDelay) {
+}
+
+bool TrackingStore::Recover(TrackingEngine& engine, const std::string& legacyJsonFile) {
+    uint64_t sequence = 0;
+    bool imported = false;
+    bool hasSnapshot = FileExists(snapshotFile);
+    if (hasSnapshot && !LoadSnapshot(engine, snapshotFile, &sequence)) {
+        // Neither the legacy JSON nor the journals can stand in for the history
+        // it held, so keep the lot for recovery by hand rather than let a
+        // checkpoint or the new journal overwrite them; start from nothing.
+        std::cerr << "Error: " << snapshotFile << " is damaged, starting with empty history" << std::endl;
+        damaged = !(SetAside(snapshotFile) && SetAside(journalFile) && SetAside(archivedJournalFile));
+        if (damaged) {
+            return false;
+        }
+    } else if (!hasSnapshot && !legacyJsonFile.empty() && FileExists(legacyJsonFile)) {
+        std::cerr << "Warning: No " << snapshotFile << ", importing " << legacyJsonFile << std::endl;
+        int reported = -10;
+        JsonImportStats stats;
+        ImportTrackingDataFromJson(engine, legacyJsonFile, [&reported](size_t done, size_t total) {
+            int percent = static_cast<int>(done * 100 / (total ? total : 1));
+            if (percent / 10 != reported / 10) {
+                reported = percent;
+                std::cout << "Importing " << percent << "%" << std::endl;
+            }
+        }, &stats);
+        imported = stats.imported > 0;
+        std::cout << "Imported " << stats.imported << " entries, skipped " << stats.skipped << " malformed" << std::endl;
+    }
+
+    // The archived journal only survives a crash between rotation and the
+    // snapshot that was meant to replace it
+    JournalReplayResult archived;
+    JournalReplayResult current;
+    bool hasArchive = ReplayJournal(engine, archivedJournalFile, sequence, archived);
+    bool hasJournal = ReplayJournal(engine, journalFile, sequence, current);
+    uint64_t nextSequence = std::max({ sequence, archived.nextSequence, current.nextSequence });
+    if (archived.torn || current.torn) {
+        std::cerr << "Warning: Journal ended in a partial record, recovered up to it" << std::endl;
+    }
+
+    recoveredSequence = nextSequence;
+    committedSequence = sequence;
+    if (imported || hasArchive || (hasJournal && current.applied > 0)) {
+        if (!WriteSnapshot(engine, snapshotFile, nextSequence)) {
+            // Keep the journals; they are still needed next time
+            return false;
+        }
+        committedSequence = nextSequence;
+        std::remove(archivedJournalFile.c_str());
+    }
+
+    lastCheckpoint = std::chrono::steady_clock::now().time_since_epoch().count();
+    if (!journal.Open(journalFile, nextSequence, engine.Apps())) {
+        return false;
+    }
+    engine.SetListener(&journal);
+    return true;
+}
+
+TrackingStore::Checkpoint TrackingStore::PrepareCheckpoint(TrackingEngine& engine) {
+    engine.SplitOpenInterval();
+    if (journal.IsOpen()) {
+        // An archive left by a failed commit isn't covered by any snapshot yet;
+        // keep it and let this checkpoint cover both files
+        if (FileExists(archivedJournalFile)) {
+            journal.Flush();
+        } else {
+            journal.Rotate(archivedJournalFile, engine.Apps());
+        }
+    }
+
+    Checkpoint checkpoint;
+    checkpoint.engine = engine;
+    checkpoint.journalSequence = std::max(journal.NextSequence(), recoveredSequence);
+    lastCheckpoint = std::chrono::steady_clock::now().time_since_epoch().count();
+    return checkpoint;
+}
+
+bool TrackingStore::CommitCheckpoint(const Checkpoint& checkpoint) {
+    std::lock_guard<std::mutex> lock(commitMutex);
+    if (damaged) {
+        return false; // Leave the damaged files for recovery by hand
+    }
+    if (checkpoint.journalSequence < committedSequence) {
+        return true; // A newer checkpoint is already on disk
+    }
+    if (!WriteSnapshot(checkpoint.engine, snapshotFile, checkpoint.journalSequence)) {
+        return false;
+    }
+    committedSequence = checkpoint.journalSequence;
+    std::remove(archivedJournalFile.c_str());
+    return true;
+}
+
+bool TrackingStore::CheckpointDue() const {
+    std::chrono::steady_clock::time_point last{ std::chrono::steady_clock::duration(lastCheckpoint.load()) };
+    return journal.FileSize() > MAX_JOURNAL_BYTES || std::chrono::steady_clock::now() - last > CHECKPOINT_INTERVAL;
+}
+
+void TrackingStore::Close(TrackingEngine& engine) {
+    engine.SetListener(nullptr);
+    journal.Close();
+}
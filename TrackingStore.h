@@ -0,0 +1,73 @@
+#ifndef TRACKING_STORE_H
+#define TRACKING_STORE_H
+
+#include "TrackingEngine.h"
+#include "TrackingJournal.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// Crash-safe persistence for one engine: a binary snapshot (SnapshotFile.h)
+// plus a journal of everything that happened since (TrackingJournal.h).
+//
+// A checkpoint rotates the journal to "<snapshot>.journal.old", writes a new
+// snapshot from a copy of the engine and then deletes the old journal, so a
+// crash at any point leaves either the previous snapshot and both journals or
+// the new snapshot, whose journal sequence tells recovery what to skip.
+//
+// The engine is not locked here. Recover(), PrepareCheckpoint() and Close()
+// must run under the caller's engine lock; CommitCheckpoint() does the disk
+// work and should run outside it.
+class TrackingStore {
+public:
+    struct Checkpoint {
+        TrackingEngine engine;
+        uint64_t journalSequence = 0;
+    };
+
+    explicit TrackingStore(const std::string& snapshotFile,
+                           std::chrono::milliseconds maxFlushDelay = std::chrono::seconds(5));
+
+    // Loads the snapshot, or legacyJsonFile (if not empty) when there is no
+    // snapshot file at all, replays the journal tail, compacts it into a new
+    // snapshot and starts journaling the engine. A snapshot that exists but
+    // won't load is renamed aside with its journals ("<file>.bad") and history
+    // starts empty. Returns false if journaling could not be started, or the
+    // damaged files could not be set aside (checkpoints then fail too).
+    bool Recover(TrackingEngine& engine, const std::string& legacyJsonFile);
+
+    // Closes the open interval, rotates the journal and copies the engine.
+    Checkpoint PrepareCheckpoint(TrackingEngine& engine);
+    // Writes the copy out and drops the journal it replaces. Checkpoints
+    // older than one already committed are discarded.
+    bool CommitCheckpoint(const Checkpoint& checkpoint);
+
+    // True once the journal is large or old enough to be worth compacting
+    bool CheckpointDue() const;
+
+    // Stops journaling the engine and closes the journal.
+    void Close(TrackingEngine& engine);
+
+    TrackingJournal& Journal() { return journal; }
+    const std::string& SnapshotFile() const { return snapshotFile; }
+    const std::string& JournalFile() const { return journalFile; }
+    const std::string& ArchivedJournalFile() const { return archivedJournalFile; }
+
+private:
+    std::string snapshotFile;
+    std::string journalFile;
+    std::string archivedJournalFile;
+    TrackingJournal journal;
+
+    uint64_t recoveredSequence = 0;  // Floor for checkpoints taken while the journal is closed
+    // Steady clock ticks; written under dataMutex, read by CheckpointDue() without it
+    std::atomic<int64_t> lastCheckpoint{ std::chrono::steady_clock::now().time_since_epoch().count() };
+
+    std::mutex commitMutex;
+    uint64_t committedSequence = 0;
+    bool damaged = false;  // A damaged snapshot couldn't be set aside, so nothing may replace it
+};
+
+#endif
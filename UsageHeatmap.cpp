@@ -0,0 +1,115 @@
+#include "UsageHeatmap.h"
+#include <algorithm>
+
+namespace {
+
+const int64_t QUARTER_SECONDS = 15 * 60;
+const int64_t DAY_SECONDS = 24 * 3600;
+
+} // namespace
+
+uint32_t HeatmapGrid::PeakHour() const {
+    uint32_t peak = 0;
+    for (int day = 0; day < DAYS; ++day) {
+        for (int hour = 0; hour < HOURS; ++hour) {
+            peak = std::max(peak, Hour(day, hour));
+        }
+    }
+    return peak;
+}
+
+void UsageHeatmap::Cell(int64_t time, int64_t offset, int& day, int& quarter) {
+    int64_t local = time + offset;
+    int64_t days = local >= 0 ? local / DAY_SECONDS : -((-local + DAY_SECONDS - 1) / DAY_SECONDS);
+    day = static_cast<int>(((days + 3) % 7 + 7) % 7);  // 1 January 1970 was a Thursday
+    quarter = static_cast<int>((local - days * DAY_SECONDS) / QUARTER_SECONDS);
+}
+
+void UsageHeatmap::SetUtcOffset(std::chrono::seconds offset) {
+    if (offset.count() != utcOffset) {
+        utcOffset = offset.count();
+        valid = false;
+    }
+}
+
+HeatmapGrid& UsageHeatmap::Writable(std::shared_ptr<HeatmapGrid>& grid) {
+    if (!grid) {
+        grid = std::make_shared<HeatmapGrid>();
+    } else if (grid.use_count() > 1) {
+        grid = std::make_shared<HeatmapGrid>(*grid);  // A snapshot still shows the old one
+    }
+    return *grid;
+}
+
+void UsageHeatmap::Add(uint32_t appId, int64_t begin, int64_t end, int sign) {
+    if (end <= begin) {
+        return;
+    }
+    if (appId >= apps.size()) {
+        apps.resize(appId + 1);
+    }
+    HeatmapGrid& total = Writable(overall);
+    HeatmapGrid& app = Writable(apps[appId]);
+    int day;
+    int quarter;
+    Cell(begin, utcOffset, day, quarter);
+    while (begin < end) {
+        int64_t intoQuarter = ((begin + utcOffset) % QUARTER_SECONDS + QUARTER_SECONDS) % QUARTER_SECONDS;
+        int64_t split = std::min(end, begin + QUARTER_SECONDS - intoQuarter);
+        uint32_t amount = static_cast<uint32_t>(split - begin);
+        total.seconds[day][quarter] += sign > 0 ? amount : 0u - amount;
+        app.seconds[day][quarter] += sign > 0 ? amount : 0u - amount;
+        begin = split;
+        if (++quarter == HeatmapGrid::QUARTERS) {
+            quarter = 0;
+            day = (day + 1) % HeatmapGrid::DAYS;
+        }
+    }
+}
+
+void UsageHeatmap::Recount(const TrackingEngine& engine) {
+    overall = std::make_shared<HeatmapGrid>();
+    apps.clear();
+    apps.resize(engine.AppCount());
+    const std::vector<FocusInterval>& log = engine.Intervals().Data();
+    for (const FocusInterval& interval : log) {
+        Add(interval.appId, interval.begin, interval.End(), 1);
+    }
+    closedCount = log.size();
+    hasOpen = engine.OpenInterval(open);
+    if (hasOpen) {
+        Add(open.appId, open.begin, open.End(), 1);
+    }
+    historyEpoch = engine.HistoryEpoch();
+    valid = true;
+    ++recounts;
+}
+
+void UsageHeatmap::Advance(const TrackingEngine& engine) {
+    const std::vector<FocusInterval>& log = engine.Intervals().Data();
+    if (!valid || historyEpoch != engine.HistoryEpoch() || log.size() < closedCount) {
+        Recount(engine);
+        return;
+    }
+
+    // The open interval only grows until it closes, so while it stays open only
+    // its new tail is added; once closed it is swapped for its logged form
+    FocusInterval current = {};
+    bool hasCurrent = engine.OpenInterval(current);
+    bool sameOpen = hasOpen && hasCurrent && current.appId == open.appId && current.begin == open.begin;
+    if (hasOpen && !sameOpen) {
+        Add(open.appId, open.begin, open.End(), -1);
+    }
+    for (; closedCount < log.size(); ++closedCount) {
+        Add(log[closedCount].appId, log[closedCount].begin, log[closedCount].End(), 1);
+    }
+    if (sameOpen && current.End() >= open.End()) {
+        Add(current.appId, open.End(), current.End(), 1);
+    } else if (sameOpen) {
+        Add(current.appId, current.End(), open.End(), -1);  // An idle tail was trimmed
+    } else if (hasCurrent) {
+        Add(current.appId, current.begin, current.End(), 1);
+    }
+    hasOpen = hasCurrent;
+    open = current;
+}
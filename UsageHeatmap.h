@@ -0,0 +1,79 @@
+#ifndef USAGE_HEATMAP_H
+#define USAGE_HEATMAP_H
+
+#include "TrackingEngine.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Focus seconds by day of the week and quarter hour of local time. Hours are
+// the sum of their four quarters.
+struct HeatmapGrid {
+    static const int DAYS = 7;  // Monday first
+    static const int HOURS = 24;
+    static const int QUARTERS = 96;
+
+    uint32_t seconds[DAYS][QUARTERS] = {};
+
+    uint32_t Quarter(int day, int quarter) const { return seconds[day][quarter]; }
+    uint32_t Hour(int day, int hour) const {
+        const uint32_t* quarters = seconds[day] + hour * 4;
+        return quarters[0] + quarters[1] + quarters[2] + quarters[3];
+    }
+    // The busiest hour cell, for scaling a rendering
+    uint32_t PeakHour() const;
+};
+
+// Day-of-week by hour-of-day usage, overall and per app, over an engine's
+// whole history. Advance() follows the engine the way WindowRanking does:
+// newly closed intervals and the growth of the open one are added, and only
+// rewritten history (Clear(), restores) or a new UTC offset recounts. Reading
+// a cell is a lookup.
+//
+// Grids are shared copy-on-write: Overall() and Apps() hand out the current
+// grids, and the next Advance() copies a grid before changing it if anyone
+// still holds it, so snapshots can keep them without a lock.
+//
+// All history is binned with the one current UTC offset, not the offset each
+// interval was recorded under. Across a daylight saving change, the half
+// year on the other side shows an hour off, and the switch itself recounts
+// the whole log once (on the tracker thread, under its lock).
+class UsageHeatmap {
+public:
+    // utcOffset is added to Unix time to get local time
+    explicit UsageHeatmap(std::chrono::seconds utcOffset = std::chrono::seconds(0)) : utcOffset(utcOffset.count()) {}
+
+    void Advance(const TrackingEngine& engine);
+    // Recounts on the next Advance() if the offset changed (e.g. daylight saving)
+    void SetUtcOffset(std::chrono::seconds offset);
+    void Invalidate() { valid = false; }
+
+    std::shared_ptr<const HeatmapGrid> Overall() const { return overall; }
+    // By app id; nullptr for apps without any time
+    const std::vector<std::shared_ptr<HeatmapGrid>>& Apps() const { return apps; }
+    const HeatmapGrid* App(uint32_t appId) const { return appId < apps.size() ? apps[appId].get() : nullptr; }
+
+    uint64_t Recounts() const { return recounts; }
+
+    // Day (0 = Monday) and quarter hour of a Unix time shifted by offset
+    static void Cell(int64_t time, int64_t offset, int& day, int& quarter);
+
+private:
+    void Recount(const TrackingEngine& engine);
+    // Adds (sign 1) or removes (sign -1) [begin, end) of an app, split at quarter hours
+    void Add(uint32_t appId, int64_t begin, int64_t end, int sign);
+    HeatmapGrid& Writable(std::shared_ptr<HeatmapGrid>& grid);
+
+    int64_t utcOffset;
+    std::shared_ptr<HeatmapGrid> overall = std::make_shared<HeatmapGrid>();
+    std::vector<std::shared_ptr<HeatmapGrid>> apps;
+    bool valid = false;
+    uint64_t historyEpoch = 0;
+    size_t closedCount = 0;   // Log intervals included so far
+    bool hasOpen = false;
+    FocusInterval open = {};  // The open interval as last included
+    uint64_t recounts = 0;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#include "UsageListDamage.h"
+#include <algorithm>
+
+int UsageListFrame::BarWidth(const UsageListFrame& frame, const UsageRow& row) {
+    if (row.IsTitle()) {
+        return row.targetBarWidth;
+    }
+    if (!frame.barWidths || row.appId >= frame.barWidths->size()) {
+        return 0;
+    }
+    return std::max((*frame.barWidths)[row.appId], 0);
+}
+
+void UsageListDamage::Diff(const UsageListLayout& layout, const UsageListFrame& frame, DamageRegion& region) {
+    const auto& layoutRows = layout.Rows();
+    DamageRect client{ 0, 0, frame.clientWidth, frame.clientHeight };
+    DamageRect list{ 0, 0, frame.clientWidth - frame.scrollBarWidth, frame.clientHeight };
+    int rowHeight = layout.RowHeight();
+
+    // Snapshot what this frame shows; icons are only looked up for visible rows
+    UsageRowRange shown = layout.RowsIn(frame.scrollPos, frame.clientHeight);
+    next.resize(shown.end - shown.begin);
+    for (size_t i = shown.begin; i < shown.end; ++i) {
+        const UsageRow& row = layoutRows[i];
+        RowState& state = next[i - shown.begin];
+        state.appId = row.appId;
+        state.title = row.title;
+        state.top = row.top;
+        state.barWidth = UsageListFrame::BarWidth(frame, row);
+        state.minutes = row.time.count() / 60;
+        state.timeText = row.timeText;
+        state.timeWidth = row.timeText ? row.timeText->extent.width : 0;
+        state.iconReady = !row.IsTitle() && frame.iconReady && frame.iconReady(row);
+    }
+
+    bool full = !valid || empty != layoutRows.empty() || scrollPos != frame.scrollPos ||
+                clientWidth != frame.clientWidth || clientHeight != frame.clientHeight ||
+                shownIconSize != layout.IconSize() || shownRowHeight != rowHeight;
+    if (full) {
+        region.Add(client);
+    } else {
+        if (thumbY != frame.thumbY) {
+            region.Add({ list.Right(), 0, frame.scrollBarWidth, frame.clientHeight });
+        }
+
+        auto band = [&](int top) {
+            return DamageRect{ 0, top - frame.scrollPos, list.width, rowHeight }.Intersection(list);
+        };
+        // Both frames have the same scroll position and row height here, so the
+        // two slices only differ where rows were added or removed
+        size_t begin = std::min(firstRow, shown.begin);
+        size_t end = std::max(firstRow + rows.size(), shown.end);
+        for (size_t i = begin; i < end; ++i) {
+            bool wasShown = i >= firstRow && i < firstRow + rows.size();
+            bool isShown = i >= shown.begin && i < shown.end;
+            if (!wasShown && !isShown) {
+                continue;
+            }
+            if (!wasShown || !isShown) {
+                region.Add(band(isShown ? next[i - shown.begin].top : rows[i - firstRow].top));
+                continue;
+            }
+            const RowState& before = rows[i - firstRow];
+            const RowState& after = next[i - shown.begin];
+            if (before.appId != after.appId || before.title != after.title || before.top != after.top) {
+                region.Add(band(before.top));
+                region.Add(band(after.top));
+                continue;
+            }
+
+            const UsageRow& row = layoutRows[i];
+            if (before.iconReady != after.iconReady) {
+                int size = layout.IconSize();
+                region.Add(DamageRect{ row.iconX, row.iconY - frame.scrollPos, size, size }.Intersection(list));
+            }
+            if (before.barWidth != after.barWidth || before.minutes != after.minutes || before.timeText != after.timeText) {
+                // The time label sits right of the bar, so it moves with it. The
+                // bar's rounded ends reshape too, and their radius is at most
+                // half the bar height, so back off by a full height. The label's
+                // measured width bounds the strip on the right, with a gap's
+                // slack for glyph overhang.
+                int left = row.barX + std::max(std::min(before.barWidth, after.barWidth) - row.barHeight, 0);
+                int right = row.barX + std::max(before.barWidth, after.barWidth) + 2 * layout.TimeGap() +
+                            std::max(before.timeWidth, after.timeWidth);
+                DamageRect strip = band(after.top);
+                region.Add(DamageRect{ left, strip.y, right - left, strip.height }.Intersection(list));
+            }
+        }
+    }
+
+    rows.swap(next);
+    firstRow = shown.begin;
+    valid = true;
+    empty = layoutRows.empty();
+    scrollPos = frame.scrollPos;
+    thumbY = frame.thumbY;
+    clientWidth = frame.clientWidth;
+    clientHeight = frame.clientHeight;
+    shownIconSize = layout.IconSize();
+    shownRowHeight = rowHeight;
+}
@@ -0,0 +1,66 @@
+#ifndef USAGE_LIST_DAMAGE_H
+#define USAGE_LIST_DAMAGE_H
+
+#include "DamageRegion.h"
+#include "UsageListLayout.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// What the usage list shows besides its layout
+struct UsageListFrame {
+    int scrollPos = 0;
+    int thumbY = 0;
+    int clientWidth = 0;
+    int clientHeight = 0;
+    int scrollBarWidth = 0;
+    const std::vector<int>* barWidths = nullptr;  // Animated bar width per app id
+    std::function<bool(const UsageRow&)> iconReady;  // Only asked about visible rows
+
+    // The width a row's bar is drawn at: animated for apps, the target for
+    // title sub-rows, which don't animate
+    static int BarWidth(const UsageListFrame& frame, const UsageRow& row);
+};
+
+// Finds what changed on screen between two frames of the usage list. Only
+// the rows in the viewport are looked at, so the cost doesn't grow with the
+// length of the list. Each visible row is compared with what the previous
+// frame drew in its place: a different app or position damages the whole
+// row, otherwise only a changed icon, or the strip from the rounded end of
+// the shorter of the two bars to the end of the wider time label when the
+// bar or its label moved. Scrolling, resizing and the empty state damage
+// everything; the scrollbar is damaged when its thumb moves.
+class UsageListDamage {
+public:
+    // Adds the difference to the last frame passed here to region, in client
+    // coordinates, and remembers this one.
+    void Diff(const UsageListLayout& layout, const UsageListFrame& frame, DamageRegion& region);
+    // Damages everything on the next Diff().
+    void Invalidate() { valid = false; }
+
+private:
+    struct RowState {
+        uint32_t appId = 0;
+        uint32_t title = UsageRow::NO_TITLE;
+        int top = 0;
+        int barWidth = 0;
+        int64_t minutes = 0;
+        const TextRun* timeText = nullptr;  // Sub-rows show a share, which can move without the time
+        int timeWidth = 0;  // Measured width of the time label
+        bool iconReady = false;
+    };
+
+    std::vector<RowState> rows;  // The rows the last frame showed, from index firstRow
+    std::vector<RowState> next;  // Kept between frames so diffing doesn't allocate
+    size_t firstRow = 0;
+    bool valid = false;
+    bool empty = true;
+    int scrollPos = 0;
+    int thumbY = 0;
+    int clientWidth = 0;
+    int clientHeight = 0;
+    int shownIconSize = 0;
+    int shownRowHeight = 0;
+};
+
+#endif
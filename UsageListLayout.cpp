@@ -0,0 +1,205 @@
+#include "UsageListLayout.h"
+#include "FormatUtils.h"
+#include "CpuRasterizer.h"
+#include <algorithm>
+
+bool UsageListLayout::Key::operator==(const Key& other) const {
+    return revision == other.revision && rangeStart == other.rangeStart && range == other.range &&
+           dpiScaleX == other.dpiScaleX && dpiScaleY == other.dpiScaleY &&
+           clientWidth == other.clientWidth && clientHeight == other.clientHeight;
+}
+
+namespace {
+
+int64_t FloorDiv(int64_t value, int64_t divisor) {
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+// Only snapshots carry title summaries
+const TitleSummary* TitlesOf(const TrackingEngine&, uint32_t) {
+    return nullptr;
+}
+
+const TitleSummary* TitlesOf(const UsageSnapshot& snapshot, uint32_t appId) {
+    return snapshot.AppTitles(appId);
+}
+
+} // namespace
+
+UsageRowRange UsageListLayout::RowsIn(int top, int height, int overscan) const {
+    UsageRowRange range;
+    if (rows.empty() || rowHeight <= 0 || height <= 0) {
+        return range;
+    }
+    // Row i spans [firstRowTop + i * rowHeight, firstRowTop + (i + 1) * rowHeight)
+    int64_t count = static_cast<int64_t>(rows.size());
+    int64_t first = FloorDiv(static_cast<int64_t>(top) - firstRowTop, rowHeight) - overscan;
+    int64_t last = -FloorDiv(firstRowTop - (static_cast<int64_t>(top) + height), rowHeight) + overscan;
+    range.begin = static_cast<size_t>(std::min(std::max<int64_t>(first, 0), count));
+    range.end = static_cast<size_t>(std::min(std::max<int64_t>(last, 0), count));
+    range.begin = std::min(range.begin, range.end);
+    return range;
+}
+
+bool UsageListLayout::Update(const TrackingEngine& engine, const UsageListParams& params) {
+    Key next;
+    next.revision = engine.Revision();
+    next.rangeStart = ToUnixSeconds(params.rangeStart);
+    if (!Changed(next, params)) {
+        return false;
+    }
+
+    totals = engine.RangeTotals(params.rangeStart, params.now);
+    std::sort(totals.begin(), totals.end(), [](const auto& a, const auto& b) -> bool {
+        return a.second > b.second;
+    });
+    Rebuild(engine, params);
+    return true;
+}
+
+bool UsageListLayout::Update(const UsageSnapshot& snapshot, size_t range, const UsageListParams& params) {
+    Key next;
+    next.revision = snapshot.sequence;
+    next.range = static_cast<int>(range);
+    if (!Changed(next, params)) {
+        return false;
+    }
+
+    // Snapshots come sorted; assigning reuses the vector's capacity
+    const auto& rangeTotals = snapshot.ranges[range];
+    totals.assign(rangeTotals.begin(), rangeTotals.end());
+    Rebuild(snapshot, params);
+    return true;
+}
+
+bool UsageListLayout::Changed(Key& next, const UsageListParams& params) {
+    next.dpiScaleX = params.dpiScaleX;
+    next.dpiScaleY = params.dpiScaleY;
+    next.clientWidth = params.clientWidth;
+    next.clientHeight = params.clientHeight;
+    if (valid && next == key) {
+        return false;
+    }
+    key = next;
+    valid = true;
+    ++rebuilds;
+    return true;
+}
+
+template <typename Source>
+void UsageListLayout::Rebuild(const Source& source, const UsageListParams& params) {
+    float dpiScaleX = params.dpiScaleX;
+    float dpiScaleY = params.dpiScaleY;
+
+    const int LIST_PADDING = static_cast<int>(20 * dpiScaleY);
+    iconSize = static_cast<int>(32 * dpiScaleX);
+    timeGap = static_cast<int>(5 * dpiScaleX);
+    rowHeight = iconSize + static_cast<int>(15 * dpiScaleY);
+
+    // Expanded apps get a sub-row per listed title, and one for the rest.
+    // Title shares are the sketch's, counted since the tracker started: they
+    // aren't kept per interval, so they don't follow the selected range, and
+    // they aren't saved, so a restart begins them again. The sub-rows show
+    // each title's fraction of that count, never a time within the range.
+    auto expanded = [&](uint32_t appId) -> const TitleSummary* {
+        const std::vector<char>* apps = params.expandedApps;
+        return apps && appId < apps->size() && (*apps)[appId] ? TitlesOf(source, appId) : nullptr;
+    };
+    size_t rowCount = totals.size();
+    for (const auto& entry : totals) {
+        if (const TitleSummary* titles = expanded(entry.first)) {
+            rowCount += titles->top.size() + (titles->other.count() > 0 ? 1 : 0);
+        }
+    }
+    contentHeight = rowCount == 0 ? 0 : static_cast<int>(rowCount) * rowHeight + LIST_PADDING;
+
+    std::chrono::seconds totalTime(0);
+    for (const auto& entry : totals) {
+        totalTime += entry.second;
+    }
+    if (totalTime.count() == 0) {
+        totalTime = std::chrono::seconds(1); // Avoid division by zero
+    }
+
+    // Labels are measured for the DPI; the runs they point at go when the
+    // cache is trimmed, which is safe here because every row is reassigned
+    static GreekedTextMeasurer greekedMeasurer;
+    TextMeasurer& measurer = params.textMeasurer ? *params.textMeasurer : greekedMeasurer;
+    int dpi = static_cast<int>(96 * dpiScaleY + 0.5f);
+    if (textRuns.Trim() || dpi != labelDpi) {
+        labels.assign(labels.size(), Labels());
+        labelDpi = dpi;
+    }
+    if (labels.size() < source.AppCount()) {
+        labels.resize(source.AppCount());
+    }
+
+    int xPos = static_cast<int>(10 * dpiScaleX);
+    int yPos = static_cast<int>(30 * dpiScaleY);
+    firstRowTop = yPos;
+    int barMaxWidth = 0;
+    auto place = [&](UsageRow& row) {
+        row.top = yPos;
+        row.iconX = xPos;
+        row.iconY = yPos + static_cast<int>(15 * dpiScaleY) - 6;
+        row.textX = xPos + iconSize + static_cast<int>(5 * dpiScaleX);
+        row.nameY = yPos + static_cast<int>(3 * dpiScaleY) + 5;
+        row.barX = row.textX;
+        row.barY = yPos + iconSize + static_cast<int>(1 * dpiScaleY) - 5;
+        row.barHeight = static_cast<int>(8 * dpiScaleY);
+        row.timeY = row.barY - static_cast<int>(6 * dpiScaleY);
+        barMaxWidth = std::min(MAX_BAR_WIDTH, static_cast<int>(params.clientWidth - row.barX - 20 * dpiScaleX));
+        yPos += rowHeight;
+    };
+    // A sub-row's bar and label give its title's share of the app's title time
+    auto placeTitle = [&](UsageRow& row, uint32_t appId, uint32_t title, const std::string& text,
+                          std::chrono::seconds time, std::chrono::seconds appTotal) {
+        row.appId = appId;
+        row.title = title;
+        row.time = time;
+        place(row);
+        double share = static_cast<double>(time.count()) / std::max<int64_t>(appTotal.count(), 1);
+        row.targetBarWidth = std::max(static_cast<int>(share * barMaxWidth), MIN_BAR_WIDTH);
+        row.name = &textRuns.Get(TextRunCache::TitleId(appId, title), RenderFont::List, dpi, text, measurer);
+        int percent = static_cast<int>(share * 100 + 0.5);
+        row.timeText = &textRuns.Get(TextRunCache::PercentId(percent), RenderFont::List, dpi, std::to_string(percent) + "%", measurer);
+    };
+
+    rows.resize(rowCount);
+    size_t next = 0;
+    for (size_t i = 0; i < totals.size(); ++i) {
+        UsageRow& row = rows[next++];
+        row.appId = totals[i].first;
+        row.title = UsageRow::NO_TITLE;
+        row.time = totals[i].second;
+        place(row);
+
+        double percentage = static_cast<double>(row.time.count()) / totalTime.count();
+        row.targetBarWidth = std::max(static_cast<int>(percentage * barMaxWidth), MIN_BAR_WIDTH);
+
+        // Names never change for an id; durations only show whole minutes, and
+        // apps with the same minute count share one run
+        Labels& label = labels[row.appId];
+        if (!label.name) {
+            label.name = &textRuns.Get(TextRunCache::AppNameId(row.appId), RenderFont::List, dpi, source.AppName(row.appId), measurer);
+        }
+        int64_t minutes = row.time.count() / 60;
+        if (label.timeMinutes != minutes) {
+            label.timeText = &textRuns.Get(TextRunCache::DurationId(minutes), RenderFont::List, dpi, FormatDuration(row.time), measurer);
+            label.timeMinutes = minutes;
+        }
+        row.name = label.name;
+        row.timeText = label.timeText;
+
+        if (const TitleSummary* titles = expanded(row.appId)) {
+            uint32_t appId = row.appId;
+            for (const TitleShare& share : titles->top) {
+                placeTitle(rows[next++], appId, share.serial, share.title.empty() ? std::string("(untitled)") : share.title,
+                           share.time, titles->total);
+            }
+            if (titles->other.count() > 0) {
+                placeTitle(rows[next++], appId, UsageRow::OTHER_TITLE, "Other", titles->other, titles->total);
+            }
+        }
+    }
+}
@@ -0,0 +1,128 @@
+#ifndef USAGE_LIST_LAYOUT_H
+#define USAGE_LIST_LAYOUT_H
+
+#include "TrackingEngine.h"
+#include "TextRunCache.h"
+#include "UsageSnapshot.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One row of the usage list, positioned in content coordinates (subtract the
+// scroll offset to get client coordinates)
+struct UsageRow {
+    static const uint32_t NO_TITLE = UINT32_MAX;         // title of an app's own row
+    static const uint32_t OTHER_TITLE = UINT32_MAX - 1;  // title of the sub-row for unlisted titles
+
+    uint32_t appId = 0;
+    uint32_t title = NO_TITLE;  // Sub-rows under an expanded app: the title's serial
+    std::chrono::seconds time{ 0 };
+    int top = 0;  // The row spans [top, top + RowHeight())
+    int iconX = 0;
+    int iconY = 0;
+    int textX = 0;
+    int nameY = 0;
+    int barX = 0;
+    int barY = 0;
+    int barHeight = 0;
+    int targetBarWidth = 0;  // The bar animates towards this
+    int timeY = 0;
+    const TextRun* name = nullptr;      // Owned by the layout's text cache
+    const TextRun* timeText = nullptr;  // Owned by the layout's text cache; a share in percent on sub-rows
+
+    bool IsTitle() const { return title != NO_TITLE; }
+};
+
+// What the list depends on besides the engine
+struct UsageListParams {
+    std::chrono::system_clock::time_point rangeStart;
+    std::chrono::system_clock::time_point now;
+    float dpiScaleX = 1.0f;
+    float dpiScaleY = 1.0f;
+    int clientWidth = 0;
+    int clientHeight = 0;
+    TextMeasurer* textMeasurer = nullptr;  // Greeked metrics when null
+    // By app id: apps whose window titles are listed under them, from the
+    // snapshot's title summaries. Call Invalidate() after changing it.
+    const std::vector<char>* expandedApps = nullptr;
+};
+
+// Rows [begin, end) of UsageListLayout::Rows()
+struct UsageRowRange {
+    size_t begin = 0;
+    size_t end = 0;
+};
+
+// Retained layout of the usage list: app totals for the selected range, sorted
+// by time, with each row's geometry and display strings precomputed. Update()
+// only rebuilds when the engine revision, range, DPI or window size changed,
+// so painting a frame is a walk over the rows RowsIn() the viewport.
+class UsageListLayout {
+public:
+    static constexpr int MIN_BAR_WIDTH = 5;
+    static constexpr int MAX_BAR_WIDTH = 300;
+    // Rows kept warm (animated, icons loaded) beyond each edge of the viewport
+    static constexpr int OVERSCAN_ROWS = 3;
+
+    // Returns true if the layout was rebuilt.
+    bool Update(const TrackingEngine& engine, const UsageListParams& params);
+    // Lays out one of the snapshot's ranges instead; params.rangeStart and
+    // params.now are not used. Rebuilds only when a new snapshot arrives.
+    bool Update(const UsageSnapshot& snapshot, size_t range, const UsageListParams& params);
+    // Forces the next Update() to rebuild.
+    void Invalidate() { valid = false; }
+
+    const std::vector<UsageRow>& Rows() const { return rows; }
+    // Rows overlapping content y in [top, top + height), widened by overscan
+    // rows on both sides. Rows have a fixed height, so this is O(1).
+    UsageRowRange RowsIn(int top, int height, int overscan = 0) const;
+    int IconSize() const { return iconSize; }
+    int RowHeight() const { return rowHeight; }
+    int ContentHeight() const { return contentHeight; }
+    // Horizontal gap between the end of a bar and its time label
+    int TimeGap() const { return timeGap; }
+
+    const TextRunCache& TextRuns() const { return textRuns; }
+    uint64_t Rebuilds() const { return rebuilds; }
+
+private:
+    struct Key {
+        uint64_t revision = 0;  // Engine revision or snapshot sequence
+        int64_t rangeStart = 0;
+        int range = -1;         // Snapshot range, -1 when laid out from the engine
+        float dpiScaleX = 0.0f;
+        float dpiScaleY = 0.0f;
+        int clientWidth = 0;
+        int clientHeight = 0;
+        bool operator==(const Key& other) const;
+    };
+    // Each app's current runs, so a rebuild only looks up labels that changed
+    struct Labels {
+        const TextRun* name = nullptr;
+        const TextRun* timeText = nullptr;
+        int64_t timeMinutes = -1;  // Minute count timeText was formatted for
+    };
+
+    // Stores next as the key (filling in the params part) if it differs
+    bool Changed(Key& next, const UsageListParams& params);
+    // Lays out totals, already sorted; source names the apps
+    template <typename Source>
+    void Rebuild(const Source& source, const UsageListParams& params);
+
+    Key key;
+    bool valid = false;
+    std::vector<std::pair<uint32_t, std::chrono::seconds>> totals;
+    TextRunCache textRuns;
+    std::vector<Labels> labels;
+    int labelDpi = 0;
+    std::vector<UsageRow> rows;
+    int iconSize = 0;
+    int rowHeight = 0;
+    int firstRowTop = 0;
+    int contentHeight = 0;
+    int timeGap = 0;
+    uint64_t rebuilds = 0;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#include "UsageListRenderer.h"
+#include <algorithm>
+
+void PaintUsageList(RenderBackend& backend, const UsageListLayout& layout, const UsageListFrame& frame,
+                    const UsageListStyle& style, const UsageIconLookup& icon, const DamageRect& area) {
+    if (area.Empty()) {
+        return;
+    }
+    backend.SetClip(area.x, area.y, area.width, area.height);
+    backend.FillRect(area.x, area.y, area.width, area.height, style.background);
+
+    const auto& rows = layout.Rows();
+    if (rows.empty()) {
+        const wchar_t emptyMessage[] = L"No application data available.";
+        backend.DrawTextRun(emptyMessage, sizeof(emptyMessage) / sizeof(wchar_t) - 1, RenderFont::Message, 10, 10, style.text);
+    } else {
+        int iconSize = layout.IconSize();
+        UsageRowRange damagedRows = layout.RowsIn(frame.scrollPos + area.y, area.height);
+        for (size_t i = damagedRows.begin; i < damagedRows.end; ++i) {
+            const UsageRow& row = rows[i];
+            int iconY = row.iconY - frame.scrollPos;
+
+            // Icons are decoded off the UI thread; paint only blits them.
+            // Title sub-rows sit under their app's icon and have none.
+            std::shared_ptr<const IconImage> image = icon && !row.IsTitle() ? icon(row) : nullptr;
+            if (image) {
+                backend.DrawImage(image, row.iconX, iconY, iconSize, iconSize);
+            } else if (!row.IsTitle()) {
+                backend.FillRoundedRect(row.iconX, iconY, iconSize, iconSize, static_cast<int>(6 * style.dpiScaleX), style.iconPlaceholder);
+            }
+
+            backend.DrawTextRun(row.name->text.c_str(), row.name->text.size(), RenderFont::List, row.textX, row.nameY - frame.scrollPos, style.text);
+
+            int barWidth = UsageListFrame::BarWidth(frame, row);
+            backend.FillRoundedRectGradient(row.barX, row.barY - frame.scrollPos, barWidth, row.barHeight,
+                                            static_cast<int>(3 * style.dpiScaleX), style.barTop, style.barBottom);
+
+            backend.DrawTextRun(row.timeText->text.c_str(), row.timeText->text.size(), RenderFont::List,
+                             row.barX + barWidth + layout.TimeGap(), row.timeY - frame.scrollPos, style.text);
+        }
+    }
+
+    int scrollBarX = frame.clientWidth - frame.scrollBarWidth;
+    if (area.Right() > scrollBarX) {
+        backend.FillRect(scrollBarX, 0, frame.scrollBarWidth, frame.clientHeight, style.scrollBarBackground);
+        backend.FillRoundedRectGradient(scrollBarX, frame.thumbY, frame.scrollBarWidth, style.thumbHeight,
+                                        static_cast<int>(5 * style.dpiScaleX), style.thumbTop, style.thumbBottom);
+    }
+    backend.ResetClip();
+}
@@ -0,0 +1,32 @@
+#ifndef USAGE_LIST_RENDERER_H
+#define USAGE_LIST_RENDERER_H
+
+#include "RenderBackend.h"
+#include "UsageListDamage.h"
+#include "UsageListLayout.h"
+#include <functional>
+#include <memory>
+
+// Colours and sizes of the usage view that don't come from the layout
+struct UsageListStyle {
+    uint32_t background = MakeRgb(25, 25, 25);
+    uint32_t text = MakeRgb(255, 255, 255);
+    uint32_t iconPlaceholder = MakeRgb(50, 50, 50);
+    uint32_t scrollBarBackground = MakeRgb(25, 25, 25);
+    uint32_t barTop = MakeArgb(150, 150, 150, 150);
+    uint32_t barBottom = MakeArgb(90, 90, 90, 90);
+    uint32_t thumbTop = MakeRgb(50, 50, 50);
+    uint32_t thumbBottom = MakeArgb(90, 90, 90, 90);
+    int thumbHeight = 50;
+    float dpiScaleX = 1.0f;
+};
+
+using UsageIconLookup = std::function<std::shared_ptr<const IconImage>(const UsageRow&)>;
+
+// Paints the part of the usage view inside area (client coordinates): rows,
+// bars at their animated widths, icons or their placeholders, and the
+// scrollbar. Only the rows overlapping area are visited.
+void PaintUsageList(RenderBackend& backend, const UsageListLayout& layout, const UsageListFrame& frame,
+                    const UsageListStyle& style, const UsageIconLookup& icon, const DamageRect& area);
+
+#endif
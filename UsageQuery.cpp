@@ -0,0 +1,189 @@
+#include "UsageQuery.h"
+#include <algorithm>
+
+namespace {
+
+// Below this many intervals per segment, threading costs more than it saves
+const size_t MIN_SEGMENT_INTERVALS = 8192;
+
+int64_t FloorDiv(int64_t value, int64_t divisor) {
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+struct QueryPlan {
+    int64_t from = 0;
+    int64_t to = 0;
+    int64_t bucketSeconds = 0;  // 0 when the whole window is one bucket
+    int64_t offset = 0;
+    std::vector<char> included;  // By app id; empty when every app is
+
+    bool Includes(uint32_t appId) const {
+        return included.empty() || (appId < included.size() && included[appId]);
+    }
+    // Start of the bucket holding time, in Unix seconds
+    int64_t BucketStart(int64_t time) const {
+        return bucketSeconds == 0 ? from : FloorDiv(time + offset, bucketSeconds) * bucketSeconds - offset;
+    }
+    int64_t BucketEnd(int64_t bucketStart) const {
+        return bucketSeconds == 0 ? to : bucketStart + bucketSeconds;
+    }
+};
+
+// Sums one bucket at a time into a dense row by app id, so a scan does no
+// hashing; the apps it touched are written out in id order when the bucket is done.
+struct SegmentScan {
+    std::vector<int64_t> seconds;
+    std::vector<uint32_t> touched;
+    std::vector<UsageGroup> groups;
+
+    void Add(uint32_t appId, int64_t amount) {
+        if (seconds[appId] == 0) {
+            touched.push_back(appId);
+        }
+        seconds[appId] += amount;
+    }
+    void Flush(int64_t bucketStart) {
+        std::sort(touched.begin(), touched.end());
+        for (uint32_t appId : touched) {
+            groups.push_back({ appId, bucketStart, std::chrono::seconds(seconds[appId]) });
+            seconds[appId] = 0;
+        }
+        touched.clear();
+    }
+};
+
+// Scans [from, to), whose ends fall on bucket boundaries or the window's ends
+void ScanSegment(const QueryPlan& plan, const IntervalLog& log, int64_t from, int64_t to, SegmentScan& scan) {
+    const std::vector<FocusInterval>& intervals = log.Data();
+    size_t i = log.LowerBound(from);
+    int64_t bucket = plan.BucketStart(from);
+    while (bucket < to && i < intervals.size() && intervals[i].begin < to) {
+        int64_t begin = std::max(bucket, from);
+        int64_t end = std::min(plan.BucketEnd(bucket), to);
+        // Intervals still running at the end of this bucket are read again for the next
+        size_t resume = SIZE_MAX;
+        for (; i < intervals.size() && intervals[i].begin < end; ++i) {
+            const FocusInterval& interval = intervals[i];
+            int64_t clippedBegin = std::max(interval.begin, begin);
+            int64_t clippedEnd = std::min(interval.End(), end);
+            if (clippedEnd > clippedBegin && plan.Includes(interval.appId)) {
+                scan.Add(interval.appId, clippedEnd - clippedBegin);
+            }
+            if (interval.End() > end && resume == SIZE_MAX) {
+                resume = i;
+            }
+        }
+        scan.Flush(bucket);
+        if (resume != SIZE_MAX) {
+            i = resume;
+            bucket = plan.BucketEnd(bucket);
+        } else if (i < intervals.size()) {
+            bucket = plan.BucketStart(std::max(intervals[i].begin, end));  // Skips empty buckets
+        }
+    }
+}
+
+} // namespace
+
+std::vector<UsageGroup> RunUsageQuery(const TrackingEngine& engine, const UsageQuery& query, ThreadPool* pool) {
+    QueryPlan plan;
+    plan.from = ToUnixSeconds(query.from);
+    plan.to = ToUnixSeconds(query.to);
+    plan.bucketSeconds = query.grouping == UsageGrouping::AppDay ? 24 * 3600 : (query.grouping == UsageGrouping::AppHour ? 3600 : 0);
+    plan.offset = query.utcOffset.count();
+    if (plan.from >= plan.to) {
+        return {};
+    }
+    if (!query.apps.empty()) {
+        plan.included.assign(engine.AppCount(), 0);
+        for (uint32_t appId : query.apps) {
+            if (appId < plan.included.size()) {
+                plan.included[appId] = 1;
+            }
+        }
+    }
+
+    // Segment boundaries fall on interval begins spread evenly through the
+    // window's slice of the log, rounded down to a bucket boundary so no
+    // bucket is split between two segments
+    const IntervalLog& log = engine.Intervals();
+    const std::vector<FocusInterval>& intervals = log.Data();
+    size_t first = log.LowerBound(plan.from);
+    size_t last = static_cast<size_t>(std::lower_bound(intervals.begin() + first, intervals.end(), plan.to,
+                                                       [](const FocusInterval& interval, int64_t time) { return interval.begin < time; }) -
+                                      intervals.begin());
+    size_t segmentCount = 1;
+    if (pool && pool->Size() > 1) {
+        segmentCount = std::min(pool->Size() * 4, std::max<size_t>((last - first) / MIN_SEGMENT_INTERVALS, 1));
+    }
+    std::vector<int64_t> bounds{ plan.from };
+    for (size_t k = 1; k < segmentCount; ++k) {
+        int64_t split = intervals[first + (last - first) * k / segmentCount].begin;
+        if (plan.bucketSeconds != 0) {
+            split = plan.BucketStart(split);
+        }
+        if (split > bounds.back() && split < plan.to) {
+            bounds.push_back(split);
+        }
+    }
+    bounds.push_back(plan.to);
+
+    std::vector<SegmentScan> scans(bounds.size() - 1);
+    auto scan = [&](size_t segment) {
+        scans[segment].seconds.assign(engine.AppCount(), 0);
+        ScanSegment(plan, log, bounds[segment], bounds[segment + 1], scans[segment]);
+    };
+    if (pool && scans.size() > 1) {
+        pool->ParallelFor(scans.size(), scan);
+    } else {
+        for (size_t segment = 0; segment < scans.size(); ++segment) {
+            scan(segment);
+        }
+    }
+
+    // Merge: with buckets, segments hold disjoint runs of them in order;
+    // without, every segment has a partial total for the one bucket
+    std::vector<UsageGroup> result;
+    if (plan.bucketSeconds == 0) {
+        std::vector<int64_t> totals(engine.AppCount(), 0);
+        for (const SegmentScan& segment : scans) {
+            for (const UsageGroup& group : segment.groups) {
+                totals[group.appId] += group.time.count();
+            }
+        }
+        for (uint32_t appId = 0; appId < totals.size(); ++appId) {
+            if (totals[appId] > 0) {
+                result.push_back({ appId, plan.from, std::chrono::seconds(totals[appId]) });
+            }
+        }
+    } else {
+        size_t total = 0;
+        for (const SegmentScan& segment : scans) {
+            total += segment.groups.size();
+        }
+        result.reserve(total);
+        for (const SegmentScan& segment : scans) {
+            result.insert(result.end(), segment.groups.begin(), segment.groups.end());
+        }
+    }
+
+    // The open interval is not in the log; fold it in bucket by bucket
+    FocusInterval open;
+    if (engine.OpenInterval(open) && plan.Includes(open.appId)) {
+        for (int64_t begin = std::max(open.begin, plan.from), end = std::min(open.End(), plan.to); begin < end;) {
+            int64_t bucket = plan.BucketStart(begin);
+            int64_t split = std::min(end, plan.BucketEnd(bucket));
+            UsageGroup piece{ open.appId, bucket, std::chrono::seconds(split - begin) };
+            auto at = std::lower_bound(result.begin(), result.end(), piece, [](const UsageGroup& a, const UsageGroup& b) {
+                return a.bucketStart < b.bucketStart || (a.bucketStart == b.bucketStart && a.appId < b.appId);
+            });
+            if (at != result.end() && at->bucketStart == bucket && at->appId == open.appId) {
+                at->time += piece.time;
+            } else {
+                result.insert(at, piece);
+            }
+            begin = split;
+        }
+    }
+    return result;
+}
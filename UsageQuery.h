@@ -0,0 +1,46 @@
+#ifndef USAGE_QUERY_H
+#define USAGE_QUERY_H
+
+#include "TrackingEngine.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+enum class UsageGrouping {
+    App,      // One total per app over the whole window
+    AppDay,   // Per app per day
+    AppHour,  // Per app per hour
+};
+
+// Usage per app between two arbitrary times, for reporting
+struct UsageQuery {
+    std::chrono::system_clock::time_point from;
+    std::chrono::system_clock::time_point to;
+    UsageGrouping grouping = UsageGrouping::App;
+    std::vector<uint32_t> apps;  // Only these app ids; empty for every app
+    // Shifts where days and hours begin, e.g. by the local time zone's UTC offset
+    std::chrono::seconds utcOffset{ 0 };
+};
+
+// Time one app spent in focus within one bucket of a query
+struct UsageGroup {
+    uint32_t appId = 0;
+    int64_t bucketStart = 0;  // Unix seconds of the day or hour; the query's from for UsageGrouping::App
+    std::chrono::seconds time{ 0 };
+
+    bool operator==(const UsageGroup& other) const {
+        return appId == other.appId && bucketStart == other.bucketStart && time == other.time;
+    }
+};
+
+// Answers a query from the engine's interval log, including the open
+// interval. The window is split into time segments holding about the same
+// number of intervals, aligned to the grouping's buckets; with a pool each
+// segment is scanned on its own thread and the partial totals are merged
+// afterwards. The engine must not change while this runs (hold its lock or
+// query a copy). Groups without time are omitted; the result is ordered by
+// bucket, then app id.
+std::vector<UsageGroup> RunUsageQuery(const TrackingEngine& engine, const UsageQuery& query, ThreadPool* pool = nullptr);
+
+#endif
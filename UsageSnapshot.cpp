@@ -0,0 +1,123 @@
+#include "UsageSnapshot.h"
+
+AppFocus UsageSnapshot::AppFocusOf(uint32_t appId) const {
+    AppFocus focus;
+    if (finishedFocus && appId < finishedFocus->size()) {
+        focus = (*finishedFocus)[appId];
+    }
+    for (size_t i = 0; i < liveSessionCount; ++i) {
+        if (liveSessions[i].appId == appId) {
+            focus.AddSession(liveSessions[i]);
+        }
+    }
+    return focus;
+}
+
+SnapshotPublisher::SnapshotPublisher(const std::vector<std::chrono::seconds>& windows) {
+    for (std::chrono::seconds window : windows) {
+        rankings.emplace_back(window);
+    }
+}
+
+void SnapshotPublisher::Publish(const TrackingEngine& engine, std::chrono::system_clock::time_point now) {
+    auto snapshot = std::make_shared<UsageSnapshot>();
+    snapshot->revision = engine.Revision();
+    snapshot->takenAt = ToUnixSeconds(now);
+
+    // Rows are append-only and never change, so only new apps need copying
+    if (!apps || apps->names.size() != engine.AppCount()) {
+        bool grown = apps && apps->names.size() < engine.AppCount();
+        auto directory = grown ? std::make_shared<AppDirectory>(*apps) : std::make_shared<AppDirectory>();
+        for (uint32_t appId = static_cast<uint32_t>(directory->names.size()); appId < engine.AppCount(); ++appId) {
+            directory->names.push_back(engine.AppName(appId));
+            directory->paths.push_back(engine.AppPath(appId));
+        }
+        apps = std::move(directory);
+    }
+    snapshot->apps = apps;
+
+    snapshot->ranges.resize(rankings.size());
+    for (size_t i = 0; i < rankings.size(); ++i) {
+        rankings[i].Advance(engine, now);
+        const AppRanking& ranking = rankings[i].Ranking();
+        ranking.TopK(ranking.Size(), snapshot->ranges[i]);
+    }
+
+    heatmap.Advance(engine);
+    snapshot->heatmap = heatmap.Overall();
+    snapshot->appHeatmaps.assign(heatmap.Apps().begin(), heatmap.Apps().end());
+
+    titles.resize(engine.AppCount());
+    titleTotals.resize(engine.AppCount(), 0);
+    for (uint32_t appId = 0; appId < engine.AppCount(); ++appId) {
+        const TitleSketch* sketch = engine.AppTitles(appId);
+        int64_t total = sketch ? sketch->Total() : 0;
+        if (total != titleTotals[appId]) {
+            titleTotals[appId] = total;
+            if (sketch) {
+                auto summary = std::make_shared<TitleSummary>();
+                sketch->Summarize(TITLES_SHOWN, *summary);
+                titles[appId] = std::move(summary);
+            } else {
+                titles[appId] = nullptr;
+            }
+        }
+    }
+    snapshot->appTitles = titles;
+
+    // Finished sessions only change on a switch or a break
+    const FocusAnalytics& focus = engine.Focus();
+    if (!finishedFocus || focus.Version() != focusVersion) {
+        auto finished = std::make_shared<std::vector<AppFocus>>(focus.AppCount());
+        for (uint32_t appId = 0; appId < finished->size(); ++appId) {
+            (*finished)[appId] = focus.Finished(appId);
+        }
+        finishedFocus = std::move(finished);
+        focusVersion = focus.Version();
+
+        auto quantiles = sessionQuantiles ? std::make_shared<std::vector<SessionQuantiles>>(*sessionQuantiles)
+                                          : std::make_shared<std::vector<SessionQuantiles>>();
+        quantiles->resize(focus.AppCount());
+        for (uint32_t appId = 0; appId < quantiles->size(); ++appId) {
+            const SessionSketch* sketch = focus.Sessions().AllTime(appId);
+            uint64_t sessions = sketch ? sketch->Count() : 0;
+            if (sessions != (*quantiles)[appId].sessions) {
+                SessionQuantiles& entry = (*quantiles)[appId];
+                entry.sessions = sessions;
+                entry.p50 = sketch ? sketch->Quantile(0.5) : std::chrono::seconds(0);
+                entry.p90 = sketch ? sketch->Quantile(0.9) : std::chrono::seconds(0);
+                entry.p99 = sketch ? sketch->Quantile(0.99) : std::chrono::seconds(0);
+            }
+        }
+        sessionQuantiles = std::move(quantiles);
+    }
+    FocusInterval open;
+    const FocusInterval* openInterval = engine.OpenInterval(open) ? &open : nullptr;
+    snapshot->finishedFocus = finishedFocus;
+    snapshot->sessionQuantiles = sessionQuantiles;
+    snapshot->liveSessionCount = focus.Live(openInterval, snapshot->liveSessions);
+    focus.Summarize(openInterval, snapshot->takenAt, snapshot->focus);
+
+    const CategoryTotals& totals = engine.Categories();
+    if (!categories || totals.Version() != categoryVersion || categories->byApp.size() != engine.AppCount()) {
+        auto rebuilt = std::make_shared<AppCategories>();
+        for (uint32_t category = 0; category < totals.CategoryCount(); ++category) {
+            rebuilt->names.push_back(totals.CategoryName(category));
+        }
+        for (uint32_t appId = 0; appId < engine.AppCount(); ++appId) {
+            rebuilt->byApp.push_back(engine.AppCategory(appId));
+        }
+        categories = std::move(rebuilt);
+        categoryVersion = totals.Version();
+    }
+    snapshot->categories = categories;
+    for (uint32_t category = 0; category < totals.CategoryCount(); ++category) {
+        snapshot->categoryTimes.push_back(totals.Time(category));
+    }
+    snapshot->uncategorizedTime = totals.Uncategorized();
+
+    snapshot->sequence = sequence.load(std::memory_order_relaxed) + 1;
+    uint64_t published = snapshot->sequence;
+    std::atomic_store(&current, std::shared_ptr<const UsageSnapshot>(std::move(snapshot)));
+    sequence.store(published, std::memory_order_release);
+}
@@ -0,0 +1,130 @@
+#ifndef USAGE_SNAPSHOT_H
+#define USAGE_SNAPSHOT_H
+
+#include "TrackingEngine.h"
+#include "AppRanking.h"
+#include "UsageHeatmap.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Names and paths by app id. App rows are never removed, so one directory is
+// shared by every snapshot until an app is added.
+struct AppDirectory {
+    std::vector<std::string> names;
+    std::vector<std::string> paths;
+};
+
+// Category names by id and the category of each app id
+// (CategoryMatcher::NO_CATEGORY for apps no rule matches)
+struct AppCategories {
+    std::vector<std::string> names;
+    std::vector<uint32_t> byApp;
+};
+
+// Session length quantiles of one app over all history
+struct SessionQuantiles {
+    uint64_t sessions = 0;
+    std::chrono::seconds p50{ 0 };
+    std::chrono::seconds p90{ 0 };
+    std::chrono::seconds p99{ 0 };
+};
+
+// Immutable copy of what the usage view shows, taken by the tracker on each
+// tick. Readers hold it for as long as they like; nothing in it changes.
+struct UsageSnapshot {
+    uint64_t sequence = 0;  // Increases with every published snapshot
+    uint64_t revision = 0;  // TrackingEngine::Revision() it was taken at
+    int64_t takenAt = 0;    // Unix seconds
+    std::shared_ptr<const AppDirectory> apps;
+    // Per window passed to the publisher: time per app id within
+    // [takenAt - window, takenAt), longest first, apps without time omitted
+    std::vector<std::vector<std::pair<uint32_t, std::chrono::seconds>>> ranges;
+    // Day-of-week by hour usage over all history, overall and by app id
+    // (nullptr for apps without time); shared with later snapshots until they change
+    std::shared_ptr<const HeatmapGrid> heatmap;
+    std::vector<std::shared_ptr<const HeatmapGrid>> appHeatmaps;
+    // Heaviest window titles by app id over all history, when the engine
+    // tracks titles; nullptr for apps without title time
+    std::vector<std::shared_ptr<const TitleSummary>> appTitles;
+    // Session and context-switch metrics over all history, the sessions under
+    // way counted as ending at takenAt. Finished sessions by app id are shared
+    // with later snapshots until one ends.
+    FocusSummary focus;
+    std::shared_ptr<const std::vector<AppFocus>> finishedFocus;
+    FocusInterval liveSessions[2] = {};
+    size_t liveSessionCount = 0;
+    // Of finished sessions, by app id; shared like finishedFocus
+    std::shared_ptr<const std::vector<SessionQuantiles>> sessionQuantiles;
+    // Time per category id over all history, and the time of apps in none.
+    // The categories are shared until the rules change or an app is matched.
+    std::shared_ptr<const AppCategories> categories;
+    std::vector<std::chrono::seconds> categoryTimes;
+    std::chrono::seconds uncategorizedTime{ 0 };
+
+    const std::string& AppName(uint32_t appId) const { return apps->names[appId]; }
+    const std::string& AppPath(uint32_t appId) const { return apps->paths[appId]; }
+    size_t AppCount() const { return apps->names.size(); }
+    const TitleSummary* AppTitles(uint32_t appId) const { return appId < appTitles.size() ? appTitles[appId].get() : nullptr; }
+    AppFocus AppFocusOf(uint32_t appId) const;
+    size_t CategoryCount() const { return categoryTimes.size(); }
+    const std::string& CategoryName(uint32_t category) const { return categories->names[category]; }
+    uint32_t AppCategory(uint32_t appId) const {
+        return categories && appId < categories->byApp.size() ? categories->byApp[appId] : CategoryMatcher::NO_CATEGORY;
+    }
+    SessionQuantiles AppSessionQuantiles(uint32_t appId) const {
+        return sessionQuantiles && appId < sessionQuantiles->size() ? (*sessionQuantiles)[appId] : SessionQuantiles();
+    }
+};
+
+// Single-writer publication of UsageSnapshots. The tracker builds a new
+// snapshot while it holds the engine and swaps it in atomically; readers load
+// the current one without taking any lock the tracker holds, so a slow paint
+// never delays a tick and a tick never tears what a paint is reading. Old
+// snapshots are freed when their last reader lets go.
+class SnapshotPublisher {
+public:
+    // Titles listed per app; the rest of an app's title time shows as other
+    static const size_t TITLES_SHOWN = 5;
+
+    // windows lists the trailing time ranges each snapshot carries totals for
+    explicit SnapshotPublisher(const std::vector<std::chrono::seconds>& windows);
+
+    // Local time's offset from UTC, for the heatmaps; same thread as Publish()
+    void SetUtcOffset(std::chrono::seconds offset) { heatmap.SetUtcOffset(offset); }
+
+    // Snapshots engine as of now and makes it current. Callers serialize
+    // Publish() with each other and with writes to the engine.
+    void Publish(const TrackingEngine& engine, std::chrono::system_clock::time_point now);
+
+    // The latest snapshot; nullptr before the first Publish(). Only the
+    // pointer swap is synchronized, so this never waits for a tick's work.
+    std::shared_ptr<const UsageSnapshot> Current() const { return std::atomic_load(&current); }
+    // Sequence of the latest snapshot, so readers can skip loading an unchanged one
+    uint64_t Sequence() const { return sequence.load(std::memory_order_acquire); }
+
+    size_t WindowCount() const { return rankings.size(); }
+    // Ranking of one window as of the last Publish(); same thread as Publish()
+    const AppRanking& Ranking(size_t window) const { return rankings[window].Ranking(); }
+
+private:
+    std::vector<WindowRanking> rankings;  // Kept in order tick by tick, so publishing never sorts
+    UsageHeatmap heatmap;
+    // Summaries are rebuilt only for apps whose title time moved
+    std::vector<std::shared_ptr<const TitleSummary>> titles;
+    std::vector<int64_t> titleTotals;
+    std::shared_ptr<const std::vector<AppFocus>> finishedFocus;
+    std::shared_ptr<const std::vector<SessionQuantiles>> sessionQuantiles;  // Recomputed only for apps with new sessions
+    uint64_t focusVersion = 0;
+    std::shared_ptr<const AppCategories> categories;  // Rebuilt when the engine's matches change
+    uint64_t categoryVersion = 0;
+    std::shared_ptr<const UsageSnapshot> current;
+    std::shared_ptr<const AppDirectory> apps;  // Directory of the latest snapshot
+    std::atomic<uint64_t> sequence{ 0 };
+};
+
+#endif
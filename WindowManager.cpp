@@ -1,12 +1,13 @@
 #include <windows.h>
 #include <windowsx.h>
 #include "WindowManager.h"
-#include "FormatUtils.h"
+#include "Tracker.h"
 #include <gdiplus.h>
 #include <mutex>
 #include <string>
 #include <shellapi.h>
 #include <map>
+#include <memory>
 #include <vector>
 #include <algorithm>
 #include "Resource.h"
@@ -16,7 +17,19 @@
 #include <fstream>
 #include <iostream>
 #include <thread>
-#include "json.hpp"
+#include "JsonStore.h"
+#include "IconCache.h"
+#include "UsageListLayout.h"
+#include "UsageListDamage.h"
+#include "RateCounter.h"
+#include "FrameScheduler.h"
+#include "RenderSurface.h"
+#include "UsageListRenderer.h"
+#include "HeatmapView.h"
+#include "FormatUtils.h"
+#include "AllocationCounter.h"
+#include <shlobj.h>
+#include <cstring>
 #pragma comment(lib, "Dwmapi.lib")
 #pragma comment(lib, "Shcore.lib")
 
@@ -31,6 +44,7 @@
 #define IDC_BUTTON_3DAYS      1003
 #define IDC_BUTTON_WEEK       1004
 #define IDC_BUTTON_MONTH      1005
+#define IDC_BUTTON_HEATMAP    1006
 #endif
 
 enum DWM_WINDOW_CORNER_PREFERENCE {
@@ -44,17 +58,11 @@ enum TimeRange { TODAY, LAST_3_DAYS, LAST_WEEK, LAST_MONTH };
 TimeRange selectedTimeRange = TODAY;
 
 using namespace Gdiplus;
-using json = nlohmann::json;
 
 extern HINSTANCE hInst;
 extern HWND hWnd;
 extern bool isRunning;
 extern bool isPaused;
-extern std::mutex dataMutex;
-extern std::map<std::string, std::chrono::seconds> appActiveTime;
-extern std::map<std::string, std::string> appPaths;
-std::map<std::string, std::chrono::system_clock::time_point> appStartTime;
-extern std::string currentAppName;
 
 int scrollPos = 0;
 int scrollMax = 0;
@@ -83,115 +91,67 @@ bool isDraggingThumb = false;
 POINT dragStartPoint;
 int initialScrollPos = 0;
 
-// Animation state
-std::map<std::string, int> currentBarWidths;
-
-std::chrono::system_clock::time_point GetStartTimeForRange(TimeRange range) {
-    auto now = std::chrono::system_clock::now();
-    switch (range) {
-        case TODAY:
-            return now - std::chrono::hours(24);
-        case LAST_3_DAYS:
-            return now - std::chrono::hours(72);
-        case LAST_WEEK:
-            return now - std::chrono::hours(24 * 7);
-        case LAST_MONTH:
-            return now - std::chrono::hours(24 * 30);
-        default:
-            return now; // Should never happen
-    }
-}
-
-void SaveTrackingDataToFile(const std::string& filename) {
-    std::cout << "Saving data..." << std::endl;
-    json j;
-    {
-        std::lock_guard<std::mutex> lock(dataMutex); // Lock the dataMutex within a scoped block
-
-        for (const auto& [appName, timeSpent] : appActiveTime) {
-            // Ensure valid data before saving
-            if (appPaths.find(appName) != appPaths.end() && appStartTime.find(appName) != appStartTime.end()) {
-                j["app_data"][appName]["time_in_seconds"] = timeSpent.count();
-                j["app_data"][appName]["app_path"] = appPaths[appName];
-
-                // Convert the start time to a string
-                std::time_t startTime = std::chrono::system_clock::to_time_t(appStartTime[appName]);
-                j["app_data"][appName]["start_time"] = std::ctime(&startTime);
-            }
-        }
-    }
-
-    try {
-        std::ofstream file(filename, std::ios::out | std::ios::trunc); // Open in truncate mode
-        if (!file.is_open()) {
-            std::cerr << "Error: Unable to open file for saving data" << std::endl;
-            return;
-        }
+// Animation state, indexed by app id (-1 = not shown yet)
+std::vector<int> currentBarWidths;
 
-        // Dump the JSON with proper indentation
-        file << j.dump(4) << std::endl;  // 4-space indentation and ensuring newline at the end
+// Usage list rows, rebuilt by RefreshUsageList() only when their inputs change
+UsageListLayout usageLayout;
+UsageListDamage usageDamage;
+RateCounter repaintedPixels;
 
-        // Flush to make sure all content is written
-        file.flush();
+// Runs the frame timer only while bars animate or the user is interacting
+const UINT_PTR FRAME_TIMER_ID = 1;
+FrameScheduler frameScheduler;
+RateCounter frameWakeups;
+DamageRegion frameDamage;
 
-        // Close the file after writing
-        file.close();
+// The tracker snapshot the layout was built from; paint reads app paths from
+// it, so the UI thread never touches the engine or waits for a tick
+std::shared_ptr<const UsageSnapshot> shownSnapshot;
 
-        // Check if file failed to close properly
-        if (file.fail()) {
-            std::cerr << "Error: Failed to close the file properly after saving data" << std::endl;
-        }
-    } catch (const std::exception &e) {
-        std::cerr << "Error saving JSON to file: " << e.what() << std::endl;
-    }
-}
+// Apps whose window titles are listed under them, by app id; clicking an
+// app's icon toggles it
+std::vector<char> expandedApps;
 
-void LoadTrackingDataFromFile(const std::string& filename) {
-    std::ifstream file(filename, std::ios::in);
-    if (!file.is_open()) {
-        std::cerr << "Error: Could not open file for loading data" << std::endl;
-        return; // If the file doesn't exist, skip loading
-    }
+// The heatmap view replaces the list while toggled on; the window is a fixed
+// 400 pixels wide, too narrow for 24 hour columns beside the bars. It shows
+// all apps, or the app picked with the mouse wheel from the selected range's ranking.
+bool showHeatmap = false;
+uint32_t heatmapAppId = AppTable::NO_APP;
+HeatmapView heatmapView;
+std::wstring shownHeatmapTitle;  // Title line as of the last refresh
 
-    json j;
-    try {
-        file >> j;
-        file.close(); // Ensure the file is closed after reading
-    } catch (const std::exception& e) {
-        // Log the error or handle it if the file is not a valid JSON
-        std::cerr << "Error parsing JSON: " << e.what() << std::endl;
-        file.close();
-        return; // Exit function if the file contains invalid JSON
-    }
+// Back buffer and GDI+ objects, kept across paints
+RenderSurface renderSurface;
 
-    if (j.is_null() || j.empty()) {
-        // Handle empty or null JSON case
-        std::cerr << "Warning: Loaded JSON is empty or null." << std::endl;
-        return; // Don't proceed if the JSON is empty
-    }
+// Heap allocations made by the UI thread for the current frame (refresh and
+// paint), and the most any frame made since the last report
+uint64_t frameAllocations = 0;
+uint64_t worstFrameAllocations = 0;
 
-    std::lock_guard<std::mutex> lock(dataMutex);
+const char* const JSON_FILE = "tracking_data.json";
 
-    for (auto& [appName, data] : j["app_data"].items()) {
-        if (!data.contains("time_in_seconds") || !data.contains("app_path") || !data.contains("start_time")) {
-            continue; // Skip entries with missing data
-        }
+void SaveTrackingDataToFile() {
+    std::cout << "Saving data..." << std::endl;
+    CheckpointTrackingData();
+}
 
-        std::chrono::seconds timeSpent(data["time_in_seconds"].get<int>());
-        appActiveTime[appName] = timeSpent;
-        appPaths[appName] = data["app_path"].get<std::string>();
-
-        // Parse the start time
-        std::string startTimeStr = data["start_time"].get<std::string>();
-        std::tm tm = {};
-        std::istringstream ss(startTimeStr);
-        ss >> std::get_time(&tm, "%a %b %d %H:%M:%S %Y");
-        auto startTime = std::chrono::system_clock::from_time_t(std::mktime(&tm));
-        appStartTime[appName] = startTime;
+// Writes JSON_FILE from a copy of the engine, taken under dataMutex the way a
+// checkpoint is. A year of history takes about a second to serialize, so that
+// happens on a thread of its own, where it holds up neither paints nor ticks.
+void ExportTrackingDataInBackground() {
+    auto copy = std::make_shared<TrackingEngine>();
+    {
+        std::lock_guard<std::mutex> lock(dataMutex);
+        *copy = trackingEngine;
     }
+    std::thread([copy]() {
+        static std::mutex exportMutex;  // One export writes the file at a time
+        std::lock_guard<std::mutex> lock(exportMutex);
+        ExportTrackingDataToJson(*copy, JSON_FILE);
+    }).detach();
 }
 
-
 void RegisterMainWindowClass(HINSTANCE hInstance) {
     WNDCLASS wc = {};
     wc.style = CS_HREDRAW | CS_VREDRAW;
@@ -204,31 +164,27 @@ void RegisterMainWindowClass(HINSTANCE hInstance) {
     RegisterClass(&wc);
 }
 
-void DrawRoundedRectangle(Graphics& graphics, Brush& brush, Rect rect, int radius) {
-    GraphicsPath path;
-    path.AddArc(rect.X, rect.Y, radius * 2, radius * 2, 180, 90);
-    path.AddArc(rect.X + rect.Width - radius * 2, rect.Y, radius * 2, radius * 2, 270, 90);
-    path.AddArc(rect.X + rect.Width - radius * 2, rect.Y + rect.Height - radius * 2, radius * 2, radius * 2, 0, 90);
-    path.AddArc(rect.X, rect.Y + rect.Height - radius * 2, radius * 2, radius * 2, 90, 90);
-    path.CloseFigure();
-    graphics.FillPath(&brush, &path);
-}
-
 // Linear interpolation function
 float Lerp(float start, float end, float t) {
     return start + t * (end - start);
 }
 
-void UpdateBarWidth(const std::string& appName, int targetWidth) {
+// Steps one bar towards its target; returns false once it no longer moves
+bool UpdateBarWidth(uint32_t appId, int targetWidth) {
     const float animationSpeed = 0.1f;
-    if (currentBarWidths.find(appName) == currentBarWidths.end()) {
-        currentBarWidths[appName] = targetWidth; // Initialize if not present
+    if (appId >= currentBarWidths.size()) {
+        currentBarWidths.resize(appId + 1, -1);
+    }
+    if (currentBarWidths[appId] < 0) {
+        currentBarWidths[appId] = targetWidth; // Initialize if not present
     }
 
     // LERP towards the target width for smooth transitions
-    currentBarWidths[appName] = static_cast<int>(
-            Lerp(static_cast<float>(currentBarWidths[appName]), static_cast<float>(targetWidth), animationSpeed)
+    int previousWidth = currentBarWidths[appId];
+    currentBarWidths[appId] = static_cast<int>(
+            Lerp(static_cast<float>(currentBarWidths[appId]), static_cast<float>(targetWidth), animationSpeed)
     );
+    return currentBarWidths[appId] != previousWidth;
 }
 
 HWND CreateMainWindow(HINSTANCE hInstance) {
@@ -275,6 +231,271 @@ Bitmap* ResizeBitmap(Bitmap* source, int width, int height) {
     return resized;
 }
 
+// Extracts an executable's icon at the target size on the icon cache's worker
+// thread and stores it premultiplied, ready to blit
+class WindowsIconDecoder : public IconDecoder {
+public:
+    void ThreadStarted() override {
+        // Shell icon handlers may use COM; keep decoding from competing with paint
+        CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+    }
+
+    bool Decode(const std::string& path, int size, int, IconImage& image) override {
+        HICON hIcon = NULL;
+        bool ownsIcon = !path.empty() &&
+                SUCCEEDED(SHDefExtractIconW(Utf8ToWide(path).c_str(), 0, 0, &hIcon, NULL, MAKELONG(size, 0))) && hIcon;
+        if (!ownsIcon) {
+            hIcon = LoadIcon(NULL, IDI_APPLICATION); // Shared icon, not destroyed
+        }
+
+        Bitmap* pIconBitmap = Bitmap::FromHICON(hIcon);
+        Bitmap* pResizedIcon = ResizeBitmap(pIconBitmap, size, size);
+        delete pIconBitmap;
+        if (ownsIcon) {
+            DestroyIcon(hIcon);
+        }
+
+        bool decoded = false;
+        BitmapData data;
+        Rect rect(0, 0, size, size);
+        if (pResizedIcon && pResizedIcon->LockBits(&rect, ImageLockModeRead, PixelFormat32bppPARGB, &data) == Ok) {
+            image.width = size;
+            image.height = size;
+            image.pixels.resize(static_cast<size_t>(size) * size);
+            for (int y = 0; y < size; ++y) {
+                std::memcpy(&image.pixels[static_cast<size_t>(y) * size],
+                            static_cast<const BYTE*>(data.Scan0) + static_cast<ptrdiff_t>(y) * data.Stride,
+                            static_cast<size_t>(size) * sizeof(uint32_t));
+            }
+            pResizedIcon->UnlockBits(&data);
+            decoded = true;
+        }
+        delete pResizedIcon;
+        return decoded;
+    }
+};
+
+// Measures labels with the fonts RenderSurface draws them in, on a private
+// 1x1 surface so layout doesn't depend on the back buffer existing yet
+class GdiplusTextMeasurer : public TextMeasurer {
+public:
+    TextExtent Measure(const wchar_t* text, size_t length, RenderFont font, int dpi) override {
+        if (!graphics) {
+            bitmap = std::make_unique<Bitmap>(1, 1, PixelFormat32bppPARGB);
+            graphics = std::make_unique<Graphics>(bitmap.get());
+            graphics->SetTextRenderingHint(TextRenderingHintClearTypeGridFit);
+        }
+        if (dpi != fontDpi) {
+            float dpiScale = dpi / 96.0f;
+            listFont = std::make_unique<Font>(L"Segoe UI", static_cast<REAL>(10 * dpiScale));
+            messageFont = std::make_unique<Font>(L"Segoe UI", static_cast<REAL>(12 * dpiScale));
+            fontDpi = dpi;
+        }
+        RectF bounds;
+        graphics->MeasureString(text, static_cast<INT>(length), font == RenderFont::Message ? messageFont.get() : listFont.get(),
+                                PointF(0.0f, 0.0f), &bounds);
+        return { static_cast<int>(bounds.Width + 0.99f), static_cast<int>(bounds.Height + 0.99f) };
+    }
+
+    // GDI+ objects must go before GdiplusShutdown()
+    void Release() {
+        listFont.reset();
+        messageFont.reset();
+        graphics.reset();
+        bitmap.reset();
+        fontDpi = 0;
+    }
+
+private:
+    std::unique_ptr<Bitmap> bitmap;
+    std::unique_ptr<Graphics> graphics;
+    std::unique_ptr<Font> listFont;
+    std::unique_ptr<Font> messageFont;
+    int fontDpi = 0;
+};
+
+WindowsIconDecoder iconDecoder;
+GdiplusTextMeasurer textMeasurer;
+IconCache iconCache(iconDecoder, 256, [] { PostMessage(hWnd, WM_APP_REFRESH, 0, 0); });
+
+UsageListStyle PaintStyle() {
+    UsageListStyle style;
+    style.background = Color(25, 25, 25).GetValue();
+    style.text = Color(255, 255, 255).GetValue();
+    style.iconPlaceholder = Color(50, 50, 50).GetValue();
+    style.scrollBarBackground = DARK_SCROLL_BAR_BACKGROUND_COLOR.GetValue();
+    style.barTop = LESS_AGGRESSIVE_GRADIENT_START.GetValue();
+    style.barBottom = LESS_AGGRESSIVE_GRADIENT_END.GetValue();
+    style.thumbTop = DARK_SCROLL_BAR_THUMB_COLOR.GetValue();
+    style.thumbBottom = LESS_AGGRESSIVE_GRADIENT_END.GetValue();
+    style.thumbHeight = THUMB_HEIGHT;
+    style.dpiScaleX = dpiScaleX;
+    return style;
+}
+
+const HeatmapGrid* ShownHeatmap(const UsageSnapshot& snapshot) {
+    if (heatmapAppId == AppTable::NO_APP) {
+        return snapshot.heatmap.get();
+    }
+    return heatmapAppId < snapshot.appHeatmaps.size() ? snapshot.appHeatmaps[heatmapAppId].get() : nullptr;
+}
+
+// Session lengths are often under a minute, which FormatDuration rounds away
+std::string FormatSessionLength(std::chrono::seconds length) {
+    return length.count() < 60 ? std::to_string(length.count()) + "s" : FormatDuration(length);
+}
+
+// The heaviest categories over all history, e.g. "Dev 3h 10m, Comms 45m"
+std::string TopCategories(const UsageSnapshot& snapshot, size_t count) {
+    std::vector<uint32_t> order;
+    for (uint32_t category = 0; category < snapshot.CategoryCount(); ++category) {
+        if (snapshot.categoryTimes[category].count() > 0) {
+            order.push_back(category);
+        }
+    }
+    count = std::min(count, order.size());
+    std::partial_sort(order.begin(), order.begin() + count, order.end(), [&snapshot](uint32_t a, uint32_t b) {
+        return snapshot.categoryTimes[a] > snapshot.categoryTimes[b];
+    });
+    std::string text;
+    for (size_t i = 0; i < count; ++i) {
+        text += (i > 0 ? ", " : "") + snapshot.CategoryName(order[i]) + " " + FormatDuration(snapshot.categoryTimes[order[i]]);
+    }
+    return text;
+}
+
+// The heatmap's subject and how fragmented its focus is
+std::wstring HeatmapTitle(const UsageSnapshot& snapshot) {
+    std::string title;
+    if (heatmapAppId == AppTable::NO_APP) {
+        const FocusSummary& focus = snapshot.focus;
+        title = "All apps - " + std::to_string(focus.switchesLastHour) + " switches in the last hour";
+        if (focus.longestAppId < snapshot.AppCount()) {
+            title += ", longest focus " + FormatDuration(std::chrono::seconds(focus.longest)) +
+                     " (" + snapshot.AppName(focus.longestAppId) + ")";
+        }
+        std::string categories = TopCategories(snapshot, 3);
+        if (!categories.empty()) {
+            title += " - " + categories;
+        }
+    } else {
+        AppFocus focus = snapshot.AppFocusOf(heatmapAppId);
+        SessionQuantiles lengths = snapshot.AppSessionQuantiles(heatmapAppId);
+        title = snapshot.AppName(heatmapAppId) + " - " + std::to_string(focus.sessions) + " sessions, median " +
+                FormatSessionLength(lengths.p50) + ", p90 " + FormatSessionLength(lengths.p90) +
+                ", longest " + FormatDuration(std::chrono::seconds(focus.longest));
+    }
+    return Utf8ToWide(title);
+}
+
+// Moves the heatmap to the next or previous app of the selected range, with
+// "all apps" before the first
+void StepHeatmapApp(int steps) {
+    if (!shownSnapshot) {
+        return;
+    }
+    const auto& ranking = shownSnapshot->ranges[selectedTimeRange];
+    int position = -1;
+    for (size_t i = 0; i < ranking.size() && heatmapAppId != AppTable::NO_APP; ++i) {
+        if (ranking[i].first == heatmapAppId) {
+            position = static_cast<int>(i);
+        }
+    }
+    position = std::max(std::min(position + steps, static_cast<int>(ranking.size()) - 1), -1);
+    heatmapAppId = position < 0 ? AppTable::NO_APP : ranking[position].first;
+    heatmapView.Invalidate();
+}
+
+int ScrollThumbY(int scrollBarHeight) {
+    if (scrollMax == 0) return 0;
+    double proportion = (double)scrollPos / (double)scrollMax;
+    return static_cast<int>((scrollBarHeight - THUMB_HEIGHT) * proportion);
+}
+
+// Brings the usage list up to date and invalidates only the parts of the
+// window that changed. Only the frame timer steps the bar animation; returns
+// true if a bar is still moving.
+bool RefreshUsageList(HWND hwnd, bool animate) {
+    bool animating = false;
+    RECT clientRect;
+    GetClientRect(hwnd, &clientRect);
+    DamageRegion& damage = frameDamage;
+    damage.Clear();
+    if (!shownSnapshot || usagePublisher.Sequence() != shownSnapshot->sequence) {
+        shownSnapshot = usagePublisher.Current();
+    }
+    if (shownSnapshot && showHeatmap) {
+        // Cells read straight from the snapshot's grid; only a changed shade is repainted
+        // Below the range and Heatmap buttons, where the list's first row starts
+        int headerTop = static_cast<int>(30 * dpiScaleY);
+        DamageRect client{ 0, headerTop, clientRect.right - clientRect.left, clientRect.bottom - clientRect.top - headerTop };
+        if (heatmapView.Area().y != client.y || heatmapView.Area().width != client.width || heatmapView.Area().height != client.height) {
+            heatmapView.Layout(client, dpiScaleX, dpiScaleY);
+        }
+        std::wstring title = HeatmapTitle(*shownSnapshot);
+        if (title != shownHeatmapTitle) {
+            shownHeatmapTitle = std::move(title);
+            heatmapView.Invalidate();
+        }
+        heatmapView.Diff(ShownHeatmap(*shownSnapshot), damage);
+    } else if (shownSnapshot) {
+        const UsageSnapshot& snapshot = *shownSnapshot;
+        UsageListParams layoutParams;
+        layoutParams.dpiScaleX = dpiScaleX;
+        layoutParams.dpiScaleY = dpiScaleY;
+        layoutParams.clientWidth = clientRect.right - clientRect.left;
+        layoutParams.clientHeight = clientRect.bottom - clientRect.top;
+        layoutParams.textMeasurer = &textMeasurer;
+        layoutParams.expandedApps = &expandedApps;
+        usageLayout.Update(snapshot, selectedTimeRange, layoutParams);
+
+        scrollMax = std::max(usageLayout.ContentHeight() - layoutParams.clientHeight, 0);
+        scrollPos = std::min(scrollPos, scrollMax);
+
+        // Only rows in or next to the viewport animate and load icons; a bar
+        // scrolled in from further away animates from where it was left
+        const auto& rows = usageLayout.Rows();
+        UsageRowRange nearby = usageLayout.RowsIn(scrollPos, layoutParams.clientHeight, UsageListLayout::OVERSCAN_ROWS);
+        int iconDpi = static_cast<int>(96 * dpiScaleX);
+        for (size_t i = nearby.begin; i < nearby.end; ++i) {
+            if (rows[i].IsTitle()) {
+                continue;  // Title sub-rows don't animate and have no icon
+            }
+            if (animate) {
+                animating |= UpdateBarWidth(rows[i].appId, rows[i].targetBarWidth);
+            }
+            iconCache.Find(snapshot.AppPath(rows[i].appId), usageLayout.IconSize(), iconDpi); // Queues misses
+        }
+
+        UsageListFrame frame;
+        frame.scrollPos = scrollPos;
+        frame.thumbY = ScrollThumbY(layoutParams.clientHeight);
+        frame.clientWidth = layoutParams.clientWidth;
+        frame.clientHeight = layoutParams.clientHeight;
+        frame.scrollBarWidth = SCROLL_BAR_WIDTH;
+        frame.barWidths = &currentBarWidths;
+        frame.iconReady = [&snapshot, iconDpi](const UsageRow& row) {
+            return iconCache.Find(snapshot.AppPath(row.appId), usageLayout.IconSize(), iconDpi) != nullptr;
+        };
+        usageDamage.Diff(usageLayout, frame, damage);
+    }
+
+    for (const DamageRect& rect : damage.Rects()) {
+        RECT dirty = { rect.x, rect.y, rect.Right(), rect.Bottom() };
+        InvalidateRect(hwnd, &dirty, FALSE);
+    }
+    return animating;
+}
+
+// Starts the frame timer if the scheduler wants frames and it isn't running
+void RequestFrames(HWND hwnd, bool interacting) {
+    bool start = interacting ? frameScheduler.Interact() : frameScheduler.Wake();
+    if (start) {
+        SetTimer(hwnd, FRAME_TIMER_ID, 1000 / 60, NULL);
+    }
+}
+
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
     static NOTIFYICONDATA nid = {};
     static std::thread trackingThread;  // Keep a reference to the tracking thread
@@ -305,7 +526,8 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             else if (pDrawItem->CtlID == IDC_BUTTON_TODAY ||
                      pDrawItem->CtlID == IDC_BUTTON_3DAYS ||
                      pDrawItem->CtlID == IDC_BUTTON_WEEK ||
-                     pDrawItem->CtlID == IDC_BUTTON_MONTH) {
+                     pDrawItem->CtlID == IDC_BUTTON_MONTH ||
+                     pDrawItem->CtlID == IDC_BUTTON_HEATMAP) {
 
                 HDC hdc = pDrawItem->hDC;
                 RECT rect = pDrawItem->rcItem;
@@ -314,7 +536,8 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                 if ((pDrawItem->CtlID == IDC_BUTTON_TODAY && selectedTimeRange == TODAY) ||
                     (pDrawItem->CtlID == IDC_BUTTON_3DAYS && selectedTimeRange == LAST_3_DAYS) ||
                     (pDrawItem->CtlID == IDC_BUTTON_WEEK && selectedTimeRange == LAST_WEEK) ||
-                    (pDrawItem->CtlID == IDC_BUTTON_MONTH && selectedTimeRange == LAST_MONTH)) {
+                    (pDrawItem->CtlID == IDC_BUTTON_MONTH && selectedTimeRange == LAST_MONTH) ||
+                    (pDrawItem->CtlID == IDC_BUTTON_HEATMAP && showHeatmap)) {
                     isSelected = true;
                 }
 
@@ -339,14 +562,54 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                     DrawText(hdc, "Last Week", -1, &rect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
                 } else if (pDrawItem->CtlID == IDC_BUTTON_MONTH) {
                     DrawText(hdc, "Last Month", -1, &rect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
+                } else if (pDrawItem->CtlID == IDC_BUTTON_HEATMAP) {
+                    DrawText(hdc, "Heatmap", -1, &rect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
                 }
                 return TRUE;
             }
             break;
         }
         case WM_TIMER: {
-            if (wParam == 1) {  // Check if this is our timer
-                InvalidateRect(hwnd, NULL, TRUE); // Request the window to repaint
+            if (wParam == FRAME_TIMER_ID) {  // Check if this is our timer
+                // The previous frame's paint has happened by now
+                worstFrameAllocations = std::max(worstFrameAllocations, frameAllocations);
+                uint64_t allocationsBefore = ThreadAllocationCount();
+
+                bool animating = RefreshUsageList(hwnd, true); // Repaint whatever changed
+                if (!frameScheduler.FrameDone(animating)) {
+                    KillTimer(hwnd, FRAME_TIMER_ID); // Idle until the next change
+                }
+                frameAllocations = ThreadAllocationCount() - allocationsBefore;
+
+                if (frameWakeups.Add(1)) {
+                    OutputDebugStringA(("Frame timer " + std::to_string(frameWakeups.LastSecond()) + " wakeups/s, up to " +
+                                        std::to_string(worstFrameAllocations) + " heap allocations per frame\n").c_str());
+                    worstFrameAllocations = 0;
+                }
+            }
+            break;
+        }
+        case WM_APP_REFRESH: {
+            RequestFrames(hwnd, false);
+            break;
+        }
+        case WM_SHOWWINDOW: {
+            if (wParam) {
+                if (frameScheduler.Show()) {
+                    SetTimer(hwnd, FRAME_TIMER_ID, 1000 / 60, NULL);
+                }
+            } else {
+                frameScheduler.Hide();
+                KillTimer(hwnd, FRAME_TIMER_ID);
+            }
+            break;
+        }
+        case WM_SIZE: {
+            if (wParam == SIZE_MINIMIZED) {
+                frameScheduler.Hide();
+                KillTimer(hwnd, FRAME_TIMER_ID);
+            } else if (IsWindowVisible(hwnd) && frameScheduler.Show()) {
+                SetTimer(hwnd, FRAME_TIMER_ID, 1000 / 60, NULL);
             }
             break;
         }
@@ -355,8 +618,7 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             // AllocConsole();
             // freopen("CONOUT$", "w", stdout);
 
-            LoadTrackingDataFromFile("tracking_data.json"); // Load the tracking data from file
-            SetTimer(hwnd, 1, 1000 / 60, NULL);
+            RecoverTrackingData(); // Load the tracking data and replay the journal
 
             // Get the DPI scaling factor using GetDeviceCaps
             HDC screen = GetDC(hwnd);
@@ -412,6 +674,14 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             );
             SendMessage(hClearButton, WM_SETFONT, (WPARAM)GetStockObject(DEFAULT_GUI_FONT), TRUE);
 
+            HWND hHeatmapButton = CreateWindow(
+                    "BUTTON", "Heatmap",
+                    WS_TABSTOP | WS_VISIBLE | WS_CHILD | BS_OWNERDRAW,
+                    10 + 5 * (buttonWidth + buttonSpacing), 5, buttonWidth, buttonHeight,
+                    hwnd, (HMENU)IDC_BUTTON_HEATMAP, hInst, NULL
+            );
+            SendMessage(hHeatmapButton, WM_SETFONT, (WPARAM)GetStockObject(DEFAULT_GUI_FONT), TRUE);
+
             // Enable dark mode for the title bar
             BOOL useDarkMode = TRUE;
             DwmSetWindowAttribute(hwnd, DWMWA_USE_IMMERSIVE_DARK_MODE, &useDarkMode, sizeof(useDarkMode));
@@ -457,13 +727,35 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             double proportion = (double)scrollPos / (double)(scrollMax > 0 ? scrollMax : 1);
             int thumbY = static_cast<int>((scrollBarHeight - THUMB_HEIGHT) * proportion);
 
+            // An app's icon expands or collapses its window titles
+            const UsageRow* clickedRow = nullptr;
+            if (!showHeatmap) {
+                UsageRowRange hit = usageLayout.RowsIn(scrollPos + y, 1);
+                if (hit.begin < hit.end) {
+                    const UsageRow& row = usageLayout.Rows()[hit.begin];
+                    int iconY = row.iconY - scrollPos;
+                    bool onIcon = x >= row.iconX && x < row.iconX + usageLayout.IconSize() &&
+                                  y >= iconY && y < iconY + usageLayout.IconSize();
+                    clickedRow = onIcon && !row.IsTitle() && shownSnapshot && shownSnapshot->AppTitles(row.appId) ? &row : nullptr;
+                }
+            }
+
             // Check if click is within the thumb area
-            if (x >= scrollBarX && x <= scrollBarX + SCROLL_BAR_WIDTH &&
+            if (!showHeatmap && x >= scrollBarX && x <= scrollBarX + SCROLL_BAR_WIDTH &&
                 y >= thumbY && y <= thumbY + THUMB_HEIGHT) {
                 isDraggingThumb = true;
                 dragStartPoint = { x, y };
                 initialScrollPos = scrollPos;
                 SetCapture(hwnd); // Capture mouse input
+            } else if (clickedRow) {
+                uint32_t appId = clickedRow->appId;
+                if (expandedApps.size() <= appId) {
+                    expandedApps.resize(appId + 1, 0);
+                }
+                expandedApps[appId] = !expandedApps[appId];
+                usageLayout.Invalidate();
+                RefreshUsageList(hwnd, false);
+                RequestFrames(hwnd, true);
             } else {
                 // Enable window dragging if not clicking the scroll bar
                 ReleaseCapture();
@@ -495,7 +787,8 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 
                 // Update the custom scroll bar position
                 // No need to use SetScrollPos for standard scroll bar
-                InvalidateRect(hwnd, NULL, TRUE);
+                RefreshUsageList(hwnd, false);
+                RequestFrames(hwnd, true);
             }
             break;
         }
@@ -509,6 +802,13 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         case WM_MOUSEWHEEL: {
             // Extract the wheel delta
             int delta = GET_WHEEL_DELTA_WPARAM(wParam);
+            if (showHeatmap) {
+                // The wheel walks the heatmap through the ranking instead of scrolling
+                StepHeatmapApp(delta > 0 ? -1 : 1);
+                RefreshUsageList(hwnd, false);
+                RequestFrames(hwnd, true);
+                break;
+            }
 
             // Determine the scroll amount
             int linesToScroll = delta / WHEEL_DELTA; // Typically 1 line per wheel delta
@@ -522,7 +822,8 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 
             // Update the scroll bar position
             // No need to use SetScrollPos for standard scroll bar
-            InvalidateRect(hwnd, NULL, TRUE);
+            RefreshUsageList(hwnd, false);
+            RequestFrames(hwnd, true);
 
             break;
         }
@@ -533,217 +834,116 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                         std::lock_guard<std::mutex> lock(dataMutex);
 
                         // Clear active time, paths, and start time
-                        appActiveTime.clear();
-                        appPaths.clear();
-                        appStartTime.clear();
-
-                        // Reset tracking for the current app
-                        if (!currentAppName.empty()) {
-                            auto now = std::chrono::system_clock::now();
-                            appStartTime[currentAppName] = now;
-                            appActiveTime[currentAppName] = std::chrono::seconds(0);
-                        }
-
-                        // Save the cleared data as an empty JSON structure
-                        json j;
-                        std::ofstream file("tracking_data.json");
-                        if (file.is_open()) {
-                            file << j.dump(4); // Save as empty object
-                            file.close();
-                        }
+                        trackingEngine.Clear(std::chrono::system_clock::now());
 
                         // Debug output to ensure correct reset
                         std::time_t startTime = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
                         std::string startTimeStr = std::ctime(&startTime);
                         OutputDebugStringA(("Start time after clearing: " + startTimeStr).c_str());
                     }
+                    PublishUsageSnapshot();
+
+                    // Save the cleared data
+                    CheckpointTrackingData();
 
-                    // Immediately invalidate the window to trigger a repaint with new values
-                    InvalidateRect(hwnd, NULL, TRUE);
+                    // Immediately repaint with the new values
+                    RefreshUsageList(hwnd, false);
+                    RequestFrames(hwnd, true);
 
                     break;
                 }
                 case IDC_BUTTON_TODAY:
                     selectedTimeRange = TODAY;
-                    InvalidateRect(hwnd, NULL, TRUE); // Redraw the window
+                    RefreshUsageList(hwnd, false); // Redraw the window
+                    RequestFrames(hwnd, true);
                     break;
 
                 case IDC_BUTTON_3DAYS:
                     selectedTimeRange = LAST_3_DAYS;
-                    InvalidateRect(hwnd, NULL, TRUE);
+                    RefreshUsageList(hwnd, false);
+                    RequestFrames(hwnd, true);
                     break;
 
                 case IDC_BUTTON_WEEK:
                     selectedTimeRange = LAST_WEEK;
-                    InvalidateRect(hwnd, NULL, TRUE);
+                    RefreshUsageList(hwnd, false);
+                    RequestFrames(hwnd, true);
                     break;
 
                 case IDC_BUTTON_MONTH:
                     selectedTimeRange = LAST_MONTH;
-                    InvalidateRect(hwnd, NULL, TRUE);
+                    RefreshUsageList(hwnd, false);
+                    RequestFrames(hwnd, true);
+                    break;
+
+                case IDC_BUTTON_HEATMAP:
+                    // Whichever view comes back repaints in full
+                    showHeatmap = !showHeatmap;
+                    heatmapView.Invalidate();
+                    usageDamage.Invalidate();
+                    InvalidateRect(hwnd, NULL, FALSE);  // The list's scroll bar reaches into the header strip too
+                    RefreshUsageList(hwnd, false);
+                    RequestFrames(hwnd, true);
                     break;
             }
+            break;
         }
         case WM_PAINT: {
+            uint64_t allocationsBefore = ThreadAllocationCount();
             PAINTSTRUCT ps;
             HDC hdc = BeginPaint(hwnd, &ps);
 
-            Bitmap bufferBitmap(ps.rcPaint.right, ps.rcPaint.bottom);
-            Graphics bufferGraphics(&bufferBitmap);
-
-            bufferGraphics.SetSmoothingMode(SmoothingModeAntiAlias);
-            bufferGraphics.SetInterpolationMode(InterpolationModeHighQualityBicubic);
-            bufferGraphics.SetTextRenderingHint(TextRenderingHintClearTypeGridFit);
-            bufferGraphics.SetPixelOffsetMode(PixelOffsetModeHighQuality);
-            bufferGraphics.SetCompositingQuality(CompositingQualityHighQuality);
-
-            SolidBrush backgroundBrush(Color(25, 25, 25));
-            bufferGraphics.FillRectangle(&backgroundBrush, 0, 0, ps.rcPaint.right, ps.rcPaint.bottom);
-
-            SolidBrush textBrush(Color(255, 255, 255));
-
-            std::lock_guard<std::mutex> lock(dataMutex); // Lock data during painting
-
-            // Get the current time filter based on selected time range
-            auto timeFilter = GetStartTimeForRange(selectedTimeRange);
-
-            // Ensure there is data to display
-            if (appActiveTime.empty()) {
-                std::wstring emptyMessage = L"No application data available.";
-                Font font(L"Segoe UI", static_cast<REAL>(12 * dpiScaleY)); // Adjust font for DPI
-                bufferGraphics.DrawString(emptyMessage.c_str(), -1, &font, PointF(10.0f, 10.0f), &textBrush);
-            } else {
-                std::vector<std::pair<std::string, std::chrono::seconds>> apps(appActiveTime.begin(), appActiveTime.end());
-                std::sort(apps.begin(), apps.end(), [](const auto& a, const auto& b) -> bool {
-                    return a.second > b.second;
-                });
-
-                const int LIST_PADDING = static_cast<int>(20 * dpiScaleY);
-                int contentHeight = 0;
-                int iconSize = static_cast<int>(32 * dpiScaleX);
-                int yIncrement = iconSize + static_cast<int>(15 * dpiScaleY);
-
-                for (const auto& entry : apps) {
-                    if (appStartTime[entry.first] < timeFilter) {
-                        continue;
-                    }
-                    contentHeight += yIncrement;
-                }
-                contentHeight += LIST_PADDING;
-
-                RECT clientRect;
-                GetClientRect(hwnd, &clientRect);
-                int windowHeight = clientRect.bottom - clientRect.top;
-
-                if (contentHeight > windowHeight) {
-                    scrollMax = contentHeight - windowHeight;
-                } else {
-                    scrollMax = 0;
-                }
-
-                int xPos = static_cast<int>(10 * dpiScaleX);
-                int yPos = static_cast<int>(30 * dpiScaleY) - scrollPos;
-
-                std::chrono::seconds totalTime(0);
-                for (const auto& entry : appActiveTime) {
-                    totalTime += entry.second;
-                }
-                if (totalTime.count() == 0) {
-                    totalTime = std::chrono::seconds(1); // Avoid division by zero
-                }
-
-                Font font(L"Segoe UI", static_cast<REAL>(10 * dpiScaleY));
-
-                for (const auto& entry : apps) {
-                    std::string appName = entry.first;
-
-                    if (appStartTime.find(appName) == appStartTime.end() || appStartTime[appName] < timeFilter) {
-                        continue;
-                    }
-
-                    auto appTime = entry.second;
-                    std::string appPath = appPaths[appName];
-
-                    HICON hIconLarge = NULL;
-                    UINT iconCount = ExtractIconExA(appPath.c_str(), 0, &hIconLarge, NULL, 1);
-                    if (iconCount == 0 || !hIconLarge) {
-                        hIconLarge = LoadIcon(NULL, IDI_APPLICATION);
-                    }
-
-                    Bitmap* pIconBitmap = Bitmap::FromHICON(hIconLarge);
-                    Bitmap* pResizedIcon = ResizeBitmap(pIconBitmap, iconSize, iconSize);
-
-                    delete pIconBitmap;
-                    DestroyIcon(hIconLarge);
-
-                    int iconX = xPos;
-                    int iconY = yPos + static_cast<int>(15 * dpiScaleY) - 6;
-                    int textX = xPos + iconSize + static_cast<int>(5 * dpiScaleX);
-                    int appNameY = yPos + static_cast<int>(3 * dpiScaleY) + 5;
-                    int barX = textX;
-                    int barY = yPos + iconSize + static_cast<int>(1 * dpiScaleY) - 5;
-                    int timeY = barY - static_cast<int>(6 * dpiScaleY);
-
-                    if (pResizedIcon) {
-                        bufferGraphics.DrawImage(pResizedIcon, Rect(iconX, iconY, iconSize, iconSize));
-                        delete pResizedIcon;
-                    }
-
-                    std::wstring wAppName(appName.begin(), appName.end());
-                    bufferGraphics.DrawString(wAppName.c_str(), -1, &font, PointF(static_cast<REAL>(textX), static_cast<REAL>(appNameY)), &textBrush);
-
-                    double percentage = static_cast<double>(appTime.count()) / totalTime.count();
-                    int barMaxWidth = std::min(300, static_cast<int>(ps.rcPaint.right - barX - 20 * dpiScaleX));
-                    int targetBarWidth = std::max(static_cast<int>(percentage * barMaxWidth), MIN_BAR_WIDTH); // Ensure the bar has at least MIN_BAR_WIDTH
-                    UpdateBarWidth(appName, targetBarWidth);
-
-                    int animatedBarWidth = currentBarWidths[appName];
-                    Rect barRect(barX, barY, animatedBarWidth, static_cast<int>(8 * dpiScaleY));
-
-                    LinearGradientBrush gradientBrush(
-                            Point(barRect.X, barRect.Y),
-                            Point(barRect.X, barRect.Y + barRect.Height),
-                            LESS_AGGRESSIVE_GRADIENT_START,
-                            LESS_AGGRESSIVE_GRADIENT_END
-                    );
-
-                    DrawRoundedRectangle(bufferGraphics, gradientBrush, barRect, static_cast<int>(3 * dpiScaleX));
-
-                    std::string timeStr = FormatDuration(appTime);
-                    std::wstring wTimeStr(timeStr.begin(), timeStr.end());
-                    bufferGraphics.DrawString(wTimeStr.c_str(), -1, &font, PointF(static_cast<REAL>(barX + animatedBarWidth + static_cast<int>(5 * dpiScaleX)), static_cast<REAL>(timeY)), &textBrush);
-
-                    yPos += yIncrement;
-                }
-            }
+            // Only the damaged part of the window is rendered
+            int paintX = ps.rcPaint.left;
+            int paintY = ps.rcPaint.top;
+            int paintWidth = ps.rcPaint.right - ps.rcPaint.left;
+            int paintHeight = ps.rcPaint.bottom - ps.rcPaint.top;
 
             RECT clientRect;
             GetClientRect(hwnd, &clientRect);
-            int scrollBarX = clientRect.right - SCROLL_BAR_WIDTH;
-            int scrollBarY = 0;
-            int scrollBarHeight = clientRect.bottom - clientRect.top;
-
-            SolidBrush scrollBarBgBrush(DARK_SCROLL_BAR_BACKGROUND_COLOR);
-            bufferGraphics.FillRectangle(&scrollBarBgBrush, scrollBarX, scrollBarY, SCROLL_BAR_WIDTH, scrollBarHeight);
-
-            double proportion = (double)scrollPos / (double)(scrollMax > 0 ? scrollMax : 1);
-            int thumbY = static_cast<int>((scrollBarHeight - THUMB_HEIGHT) * proportion);
-            if (scrollMax == 0) thumbY = 0;
-
-            LinearGradientBrush thumbGradientBrush(
-                    Point(scrollBarX, thumbY),
-                    Point(scrollBarX, thumbY + THUMB_HEIGHT),
-                    DARK_SCROLL_BAR_THUMB_COLOR,
-                    LESS_AGGRESSIVE_GRADIENT_END
-            );
+            if (paintWidth <= 0 || paintHeight <= 0 ||
+                !renderSurface.Prepare(hdc, clientRect.right - clientRect.left, clientRect.bottom - clientRect.top, dpiScaleX, dpiScaleY)) {
+                EndPaint(hwnd, &ps);
+                break;
+            }
 
-            Rect thumbRect(scrollBarX, thumbY, SCROLL_BAR_WIDTH, THUMB_HEIGHT);
-            DrawRoundedRectangle(bufferGraphics, thumbGradientBrush, thumbRect, static_cast<int>(5 * dpiScaleX));
+            if (shownSnapshot && showHeatmap) {
+                const UsageSnapshot& snapshot = *shownSnapshot;
+                DamageRect dirty{ paintX, paintY, paintWidth, paintHeight };
+                // The strip behind the header buttons isn't the view's, but still needs clearing
+                DamageRect header = dirty.Intersection({ 0, 0, clientRect.right - clientRect.left, heatmapView.Area().y });
+                if (!header.Empty()) {
+                    renderSurface.SetClip(header.x, header.y, header.width, header.height);
+                    renderSurface.FillRect(header.x, header.y, header.width, header.height, HeatmapStyle().background);
+                }
+                heatmapView.Paint(renderSurface, ShownHeatmap(snapshot), shownHeatmapTitle, HeatmapStyle(), dirty);
+            } else if (shownSnapshot) {
+                // The layout is kept up to date by RefreshUsageList(), from the
+                // same snapshot, so painting takes no lock
+                const UsageSnapshot& snapshot = *shownSnapshot;
+                UsageListFrame frame;
+                frame.scrollPos = scrollPos;
+                frame.clientWidth = clientRect.right - clientRect.left;
+                frame.clientHeight = clientRect.bottom - clientRect.top;
+                frame.thumbY = ScrollThumbY(frame.clientHeight);
+                frame.scrollBarWidth = SCROLL_BAR_WIDTH;
+                frame.barWidths = &currentBarWidths;
+                int iconSize = usageLayout.IconSize();
+                int iconDpi = static_cast<int>(96 * dpiScaleX);
+                UsageIconLookup icon = [&snapshot, iconSize, iconDpi](const UsageRow& row) {
+                    return iconCache.Find(snapshot.AppPath(row.appId), iconSize, iconDpi);
+                };
+                PaintUsageList(renderSurface, usageLayout, frame, PaintStyle(), icon, { paintX, paintY, paintWidth, paintHeight });
+            }
 
-            Graphics graphics(hdc);
-            graphics.DrawImage(&bufferBitmap, 0, 0);
+            renderSurface.Present(hdc, ps.rcPaint);
 
             EndPaint(hwnd, &ps);
+            frameAllocations += ThreadAllocationCount() - allocationsBefore;
+
+            if (repaintedPixels.Add(static_cast<uint64_t>(paintWidth) * paintHeight)) {
+                OutputDebugStringA(("Repainted " + std::to_string(repaintedPixels.LastSecond()) + " px/s\n").c_str());
+            }
             break;
         }
         case WM_VSCROLL: {
@@ -758,6 +958,10 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                 if (hMenu) {
                     InsertMenu(hMenu, -1, MF_BYPOSITION, 1, "Show/Hide");
                     InsertMenu(hMenu, -1, MF_BYPOSITION, 2, isPaused ? "Resume" : "Pause");
+                    InsertMenu(hMenu, -1, MF_BYPOSITION | (WindowTitleTracking() ? MF_CHECKED : 0), 5, "Track Window Titles");
+                    InsertMenu(hMenu, -1, MF_BYPOSITION | (IdleDetection() ? MF_CHECKED : 0), 6, "Pause When Idle");
+                    InsertMenu(hMenu, -1, MF_BYPOSITION, 7, "Edit Categories");
+                    InsertMenu(hMenu, -1, MF_BYPOSITION, 4, "Export JSON");
                     InsertMenu(hMenu, -1, MF_BYPOSITION, 3, "Kill");
                     SetForegroundWindow(hwnd);
                     int cmd = TrackPopupMenu(hMenu, TPM_RETURNCMD | TPM_NONOTIFY, pt.x, pt.y, 0, hwnd, NULL);
@@ -769,10 +973,18 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                         }
                     } else if (cmd == 2) {
                         isPaused = !isPaused;
+                    } else if (cmd == 5) {
+                        SetWindowTitleTracking(!WindowTitleTracking());
+                    } else if (cmd == 6) {
+                        SetIdleDetection(!IdleDetection());
+                    } else if (cmd == 7) {
+                        EditCategoryRules();
+                    } else if (cmd == 4) {
+                        ExportTrackingDataInBackground();
                     } else if (cmd == 3) {  // "Kill" selected
                         isRunning = false;
 
-                        SaveTrackingDataToFile("tracking_data.json");
+                        SaveTrackingDataToFile();
 
                         PostMessage(hwnd, WM_DESTROY, 0, 0);
                     }
@@ -782,7 +994,14 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             break;
         }
         case WM_DESTROY: {
-            SaveTrackingDataToFile("tracking_data.json");
+            iconCache.Stop(); // The decoder uses GDI+, which shuts down after the window
+            renderSurface.Release();
+            textMeasurer.Release();
+            SaveTrackingDataToFile();
+            {
+                std::lock_guard<std::mutex> lock(dataMutex);
+                trackingStore.Close(trackingEngine);
+            }
             Shell_NotifyIcon(NIM_DELETE, &nid);
             PostQuitMessage(0);
             break;
@@ -6,9 +6,11 @@
 #include <string>
 #include <chrono>
 
+// Posted by background threads when what the window shows may have changed
+const UINT WM_APP_REFRESH = WM_APP + 2;
+
 void RegisterMainWindowClass(HINSTANCE hInstance);
 HWND CreateMainWindow(HINSTANCE hInstance);
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
-extern std::map<std::string, std::chrono::system_clock::time_point> appStartTime;
 
 #endif